@@ -21,8 +21,13 @@
  *
  */
 #include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
 #include "DSF2Text.h"
 #include "DSFLib.h"
+#include "MemFileUtils.h"
+#include "ThreadUtils.h"
 #include <list>
 
 using std::list;
@@ -42,6 +47,207 @@ static int count_net = 0;
 string			base_name;
 list<string>	dem_names;
 
+/************************************************************************************************************************
+ * DSF TO TEXT
+ ************************************************************************************************************************
+
+	Dumping a dense DSF used to be almost all libc: every vertex was a handful of fprintf calls, each one parsing its
+	format string, taking the FILE lock and running the general double formatter.
+
+	Now each callback builds its whole line in a scratch buffer and hands it to print_func once, as "%s".  Numbers are
+	formatted by hand: fixed-point values are scaled to an integer and printed digit by digit, which gives exactly
+	what printf would, except in the rare case where the scaled value lands so close to a rounding tie that the
+	multiply's error could matter - those (and NaN, inf and huge values) still go to snprintf.  So the output is byte
+	for byte what it always was.
+
+	Coordinates are printed at 9 decimals by default; DSF2Text_SetPrecision changes that, and -1 asks for the shortest
+	text that reads back to the same double.  Other fields (LODs, headings) keep their %lf formatting.
+
+	DSF2Text itself also swaps fprintf for a print_func that appends to a big buffer and writes it out in large
+	blocks; WED's exporter still passes fprintf and simply gets one call per line.
+
+	The reader hands us callbacks one at a time, in file order, so there is nothing to gain from formatting on
+	other threads - the per-line cost is now small enough that the dump is bound by decoding and the disk.
+
+ ************************************************************************************************************************/
+
+#define	TEXT_OUT_FLUSH	(1024*1024)
+
+static int sDSF2TEXT_Precision = 9;
+
+static const double kPow10[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+static const unsigned long long kPow10i[10] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL };
+
+// Writes the digits of v, returns the count.
+static int	format_uint(char * out, unsigned long long v)
+{
+	char tmp[24];
+	int n = 0;
+	do {
+		tmp[n++] = '0' + (int) (v % 10);
+		v /= 10;
+	} while(v);
+	for(int i = 0; i < n; ++i)
+		out[i] = tmp[n - 1 - i];
+	return n;
+}
+
+static int	format_int(char * out, int v)
+{
+	if(v < 0)
+	{
+		*out = '-';
+		return 1 + format_uint(out + 1, -(long long) v);
+	}
+	return format_uint(out, v);
+}
+
+// Same text as printf("%.*f", digits, v).  out must hold at least 350 chars.
+static int	format_fixed(char * out, double v, int digits)
+{
+	bool neg = v < 0.0 || (v == 0.0 && 1.0 / v < 0.0);
+	double s = (neg ? -v : v) * kPow10[digits <= 9 ? digits : 0];
+	if(digits >= 0 && digits <= 9 && s < 8796093022208.0)		// 2^43
+	{
+		double r = floor(s);
+		double f = s - r;
+		// Below 2^43 the multiply is off from the exact product by at most 2^-10, so unless we are within
+		// 2^-9 of a half, rounding s rounds the exact value the same way.
+		if(fabs(f - 0.5) > 1.0 / 512.0)
+		{
+			unsigned long long q = (unsigned long long) r + (f > 0.5 ? 1 : 0);
+			char * p = out;
+			if(neg) *p++ = '-';
+			p += format_uint(p, q / kPow10i[digits]);
+			if(digits > 0)
+			{
+				unsigned long long frac = q % kPow10i[digits];
+				*p++ = '.';
+				for(int d = digits - 1; d >= 0; --d)
+				{
+					p[d] = '0' + (int) (frac % 10);
+					frac /= 10;
+				}
+				p += digits;
+			}
+			return p - out;
+		}
+	}
+	return snprintf(out, 350, "%.*f", digits, v);
+}
+
+// Shortest %g text that reads back as exactly v.
+static int	format_shortest(char * out, double v)
+{
+	int n = 0;
+	for(int digits = 15; digits <= 17; ++digits)
+	{
+		n = snprintf(out, 350, "%.*g", digits, v);
+		if(strtod(out, NULL) == v)
+			break;
+	}
+	return n;
+}
+
+inline int	format_coord(char * out, double v)
+{
+	return sDSF2TEXT_Precision < 0 ? format_shortest(out, v) : format_fixed(out, v, sDSF2TEXT_Precision);
+}
+
+// One output line.  We keep a single one around and reuse it, the same way the printer keeps its other state in statics.
+class	text_line_t {
+public:
+	text_line_t() : mLen(0) { mBuf.resize(1024); }
+
+	void	clear(void) { mLen = 0; }
+	void	str(const char * s)			{ int n = strlen(s); reserve(n); memcpy(&mBuf[mLen], s, n); mLen += n; }
+	void	num(int v)					{ reserve(16); mBuf[mLen++] = ' '; mLen += format_int(&mBuf[mLen], v); }
+	void	fixed(double v, int digits)	{ reserve(360); mBuf[mLen++] = ' '; mLen += format_fixed(&mBuf[mLen], v, digits); }
+	void	coord(double v)				{ reserve(360); mBuf[mLen++] = ' '; mLen += format_coord(&mBuf[mLen], v); }
+
+	void	emit(print_funcs_s * p)
+	{
+		reserve(2);
+		mBuf[mLen++] = '\n';
+		mBuf[mLen] = 0;
+		p->print_func(p->ref, "%s", &mBuf[0]);
+		mLen = 0;
+	}
+
+private:
+	void	reserve(int n) { if(mLen + n + 2 > (int) mBuf.size()) mBuf.resize(mLen + n + 1024); }
+
+	vector<char>	mBuf;
+	int				mLen;
+};
+
+static text_line_t	sLine;
+
+// Buffered stand-in for fprintf that DSF2Text passes as print_func.
+struct	text_out_t {
+	FILE *			fi;
+	vector<char>	buf;
+	bool			ok;
+};
+
+static void	text_out_flush(text_out_t * o)
+{
+	if(!o->buf.empty() && fwrite(&o->buf[0], 1, o->buf.size(), o->fi) != o->buf.size())
+		o->ok = false;
+	o->buf.clear();
+}
+
+static int	text_out_print(void * ref, const char * fmt, ...)
+{
+	text_out_t * o = (text_out_t *) ref;
+	int n;
+	if(strchr(fmt, '%') == NULL)
+	{
+		n = strlen(fmt);
+		o->buf.insert(o->buf.end(), fmt, fmt + n);
+	}
+	else if(strcmp(fmt, "%s") == 0)
+	{
+		va_list	args;
+		va_start(args, fmt);
+		const char * s = va_arg(args, const char *);
+		va_end(args);
+		n = strlen(s);
+		o->buf.insert(o->buf.end(), s, s + n);
+	}
+	else
+	{
+		char	tmp[1024];
+		va_list	args;
+		va_start(args, fmt);
+		n = vsnprintf(tmp, sizeof(tmp), fmt, args);
+		va_end(args);
+		if(n >= 0 && n < (int) sizeof(tmp))
+			o->buf.insert(o->buf.end(), tmp, tmp + n);
+		else
+		{
+			// Long line (or an old MSVC CRT that returns -1) - flush and let stdio do it.
+			text_out_flush(o);
+			va_start(args, fmt);
+			n = vfprintf(o->fi, fmt, args);
+			va_end(args);
+		}
+	}
+	if(o->buf.size() >= TEXT_OUT_FLUSH)
+		text_out_flush(o);
+	return n;
+}
+
+void DSF2Text_SetPrecision(int digits)
+{
+	sDSF2TEXT_Precision = digits < 0 ? -1 : (digits > 17 ? 17 : digits);
+}
+
+
 
 
 int DSF2Text_AcceptTerrainDef(const char * inPartialPath, void * inRef)
@@ -101,7 +307,13 @@ void DSF2Text_BeginPatch(
 {
 	print_funcs_s * p = (print_funcs_s *) inRef;
 	sDSF2TEXT_CoordDepth = inCoordDepth;
-	p->print_func(p->ref, "BEGIN_PATCH %d %lf %lf %d %d\n", inTerrainType + offset_ter, inNearLOD, inFarLOD, inFlags, inCoordDepth);
+	sLine.str("BEGIN_PATCH");
+	sLine.num(inTerrainType + offset_ter);
+	sLine.fixed(inNearLOD, 6);
+	sLine.fixed(inFarLOD, 6);
+	sLine.num(inFlags);
+	sLine.num(inCoordDepth);
+	sLine.emit(p);
 }
 
 void DSF2Text_BeginPrimitive(
@@ -109,7 +321,9 @@ void DSF2Text_BeginPrimitive(
 	void *			inRef)
 {
 	print_funcs_s * p = (print_funcs_s *) inRef;
-	p->print_func(p->ref, "BEGIN_PRIMITIVE %d\n", inType);
+	sLine.str("BEGIN_PRIMITIVE");
+	sLine.num(inType);
+	sLine.emit(p);
 }
 
 void DSF2Text_AddPatchVertex(
@@ -117,10 +331,10 @@ void DSF2Text_AddPatchVertex(
 	void *			inRef)
 {
 	print_funcs_s * p = (print_funcs_s *) inRef;
-	p->print_func(p->ref, "PATCH_VERTEX");
+	sLine.str("PATCH_VERTEX");
 	for (int n = 0; n < sDSF2TEXT_CoordDepth; ++n)
-		p->print_func(p->ref, " %.9lf", inCoordinates[n]);
-	p->print_func(p->ref, "\n");
+		sLine.coord(inCoordinates[n]);
+	sLine.emit(p);
 }
 
 void DSF2Text_EndPrimitive(
@@ -146,10 +360,14 @@ void DSF2Text_AddObject(
 	if(inObjectType >= count_obj)
 		printf("WARNING: out of bounds obj.\n");
 	print_funcs_s * p = (print_funcs_s *) inRef;
+	sLine.str(inCoordinateDepth == 4 ? "OBJECT_MSL" : "OBJECT");
+	sLine.num(inObjectType + offset_obj);
+	sLine.coord(inCoordinates[0]);
+	sLine.coord(inCoordinates[1]);
 	if(inCoordinateDepth == 4)
-	p->print_func(p->ref, "OBJECT_MSL %d %.9lf %.9lf %.9lf %lf\n", inObjectType + offset_obj, inCoordinates[0], inCoordinates[1], inCoordinates[3], inCoordinates[2]);
-	else
-	p->print_func(p->ref, "OBJECT %d %.9lf %.9lf %lf\n", inObjectType + offset_obj, inCoordinates[0], inCoordinates[1], inCoordinates[2]);
+		sLine.coord(inCoordinates[3]);
+	sLine.fixed(inCoordinates[2], 6);
+	sLine.emit(p);
 }
 
 void DSF2Text_BeginSegment(
@@ -160,13 +378,16 @@ void DSF2Text_BeginSegment(
 	void *			inRef)
 {
 	print_funcs_s * p = (print_funcs_s *) inRef;
-	if (!inCurved)
-		p->print_func(p->ref, "BEGIN_SEGMENT %d %d %d %.9lf %.9lf %.9lf\n", inNetworkType + offset_net, inNetworkSubtype, (int) inCoordinates[3],
-															inCoordinates[0],inCoordinates[1],inCoordinates[2]);
-	else
-		p->print_func(p->ref, "BEGIN_SEGMENT_CURVED %d %d %d %.9lf %.9lf %.9lf %.9lf %.9lf %.9lf\n", inNetworkType, inNetworkSubtype, (int) inCoordinates[3],
-															inCoordinates[0],inCoordinates[1],inCoordinates[2],
-															inCoordinates[4],inCoordinates[5],inCoordinates[6]);
+	sLine.str(inCurved ? "BEGIN_SEGMENT_CURVED" : "BEGIN_SEGMENT");
+	sLine.num(inCurved ? inNetworkType : inNetworkType + offset_net);
+	sLine.num(inNetworkSubtype);
+	sLine.num((int) inCoordinates[3]);
+	for (int n = 0; n < 3; ++n)
+		sLine.coord(inCoordinates[n]);
+	if (inCurved)
+	for (int n = 4; n < 7; ++n)
+		sLine.coord(inCoordinates[n]);
+	sLine.emit(p);
 }
 
 void DSF2Text_AddSegmentShapePoint(
@@ -175,11 +396,10 @@ void DSF2Text_AddSegmentShapePoint(
 	void *			inRef)
 {
 	print_funcs_s * p = (print_funcs_s *) inRef;
-	if (!inCurved)
-		p->print_func(p->ref, "SHAPE_POINT %.9lf %.9lf %.9lf\n", inCoordinates[0],inCoordinates[1],inCoordinates[2]);
-	else
-		p->print_func(p->ref, "SHAPE_POINT_CURVED %.9lf %.9lf %.9lf %.9lf %.9lf %.9lf\n",inCoordinates[0],inCoordinates[1],inCoordinates[2],
-															inCoordinates[3],inCoordinates[4],inCoordinates[5]);
+	sLine.str(inCurved ? "SHAPE_POINT_CURVED" : "SHAPE_POINT");
+	for (int n = 0; n < (inCurved ? 6 : 3); ++n)
+		sLine.coord(inCoordinates[n]);
+	sLine.emit(p);
 }
 
 void DSF2Text_EndSegment(
@@ -188,11 +408,14 @@ void DSF2Text_EndSegment(
 	void *			inRef)
 {
 	print_funcs_s * p = (print_funcs_s *) inRef;
-	if (!inCurved)
-		p->print_func(p->ref, "END_SEGMENT %d %.9lf %.9lf %.9lf\n", (int) inCoordinates[3], inCoordinates[0],inCoordinates[1],inCoordinates[2]);
-	else
-		p->print_func(p->ref, "END_SEGMENT_CURVED %d %.9lf %.9lf %.9lf %.9lf %.9lf %.9lf\n",(int) inCoordinates[3], inCoordinates[0],inCoordinates[1],inCoordinates[2],
-															inCoordinates[4],inCoordinates[5],inCoordinates[6]);
+	sLine.str(inCurved ? "END_SEGMENT_CURVED" : "END_SEGMENT");
+	sLine.num((int) inCoordinates[3]);
+	for (int n = 0; n < 3; ++n)
+		sLine.coord(inCoordinates[n]);
+	if (inCurved)
+	for (int n = 4; n < 7; ++n)
+		sLine.coord(inCoordinates[n]);
+	sLine.emit(p);
 }
 
 bool DSF2Text_NextPass(int pass, void * ref)
@@ -214,7 +437,11 @@ void DSF2Text_BeginPolygon(
 {
 	sDSF2TEXT_CoordDepth = inDepth;
 	print_funcs_s * p = (print_funcs_s *) inRef;
-	p->print_func(p->ref, "BEGIN_POLYGON %d %d %d\n", inPolygonType + offset_pol, inParam, inDepth);
+	sLine.str("BEGIN_POLYGON");
+	sLine.num(inPolygonType + offset_pol);
+	sLine.num(inParam);
+	sLine.num(inDepth);
+	sLine.emit(p);
 }
 
 void DSF2Text_BeginPolygonWinding(
@@ -228,10 +455,10 @@ void DSF2Text_AddPolygonPoint(
 	void *			inRef)
 {
 	print_funcs_s * p = (print_funcs_s *) inRef;
-	p->print_func(p->ref, "POLYGON_POINT");
+	sLine.str("POLYGON_POINT");
 	for (int n = 0; n < sDSF2TEXT_CoordDepth; ++n)
-		p->print_func(p->ref, " %.9lf", inCoordinates[n]);
-	p->print_func(p->ref, "\n");
+		sLine.coord(inCoordinates[n]);
+	sLine.emit(p);
 }
 
 void DSF2Text_EndPolygonWinding(
@@ -325,16 +552,22 @@ bool DSF2Text(char ** inDSF, int n, const char * inFileName)
 	DSFCallbacks_t	cbs;
 	DSF2Text_CreateWriterCallbacks(&cbs);
 	
+	text_out_t out;
+	out.fi = fi;
+	out.ok = true;
+	out.buf.reserve(TEXT_OUT_FLUSH + 64*1024);
+
 	print_funcs_s pf;
-	pf.print_func = (int (*)(void *,const char *,...)) fprintf;
-	pf.ref = fi;
+	pf.print_func = text_out_print;
+	pf.ref = &out;
 
 	while(n--)
 	{
-		fprintf(fi,"# file: %s\n\n",*inDSF);
+		pf.print_func(pf.ref, "# file: %s\n\n",*inDSF);
 		int result = DSFReadFile(*inDSF, malloc, free, &cbs, NULL, &pf);
 
-		fprintf(fi, "# Result code: %d\n", result);
+		pf.print_func(pf.ref, "# Result code: %d\n", result);
+		text_out_flush(&out);		// Our text and the messages below may share stdout.
 		if(result == dsf_ErrNoAtoms || result == dsf_ErrBadCookie || result == dsf_ErrBadVersion)
 			fprintf(stderr,"The DFS was not readable.  Perhaps you need to unzip it with 7-zip?\n");
 
@@ -353,73 +586,371 @@ bool DSF2Text(char ** inDSF, int n, const char * inFileName)
 
 	if (strcmp(inFileName, "-"))
 		fclose(fi);
-	return true;
+	return out.ok;
+}
+
+/************************************************************************************************************************
+ * TEXT TO DSF
+ ************************************************************************************************************************
+
+	The text file is mapped into memory whole (a pipe is read into memory) and cut into chunks of about a megabyte,
+	each ending on a line break.  Chunks are tokenized on worker threads into a compact list of commands - a verb
+	plus its ints and doubles - which this thread then replays into the writer callbacks, in file order.  The
+	workers stay one window of chunks ahead of the replay, so only two windows' worth of commands are ever held.
+
+	The writer has to get the properties and definitions before any geometry, and they may be anywhere in the file,
+	so a quick first scan picks out just the PROPERTY, DIVISIONS and *_DEF lines.  It only looks at the first few
+	bytes of each line, so it costs next to nothing compared to parsing numbers.
+
+	Numbers are parsed by hand: up to 15 significant digits and a power of ten up to 22 can be converted exactly with
+	one multiply or divide (both operands are exact doubles, so the one rounding is the correct one).  Anything
+	else goes to strtod, so we get exactly what scanf used to give us.
+
+*/
+
+#define	TEXT_CHUNK_BYTES	(1024*1024)
+
+enum {
+	verb_none = 0,
+	verb_property,
+	verb_divisions,
+	verb_terrain_def,
+	verb_object_def,
+	verb_polygon_def,
+	verb_network_def,
+	verb_raster_def,
+	verb_patch_vertex,
+	verb_object,
+	verb_object_msl,
+	verb_begin_segment,
+	verb_shape_point,
+	verb_end_segment,
+	verb_begin_primitive,
+	verb_end_primitive,
+	verb_begin_patch,
+	verb_end_patch,
+	verb_polygon_point,
+	verb_begin_winding,
+	verb_end_winding,
+	verb_begin_polygon,
+	verb_end_polygon,
+	verb_begin_segment_curved,
+	verb_shape_point_curved,
+	verb_end_segment_curved,
+	verb_filter,
+	verb_raster_data
+};
+
+// Verb, then its arguments: i = int, d = double, s = the rest of the line.  A line's arguments are parsed in order
+// until one doesn't parse; the number that did is what scanf would have returned.
+static const struct { const char * name; int verb; const char * args; } kVerbs[] = {
+	{ "PROPERTY",				verb_property,				""				},
+	{ "DIVISIONS",				verb_divisions,				"i"				},
+	{ "TERRAIN_DEF",			verb_terrain_def,			"s"				},
+	{ "OBJECT_DEF",				verb_object_def,			"s"				},
+	{ "POLYGON_DEF",			verb_polygon_def,			"s"				},
+	{ "NETWORK_DEF",			verb_network_def,			"s"				},
+	{ "RASTER_DEF",				verb_raster_def,			"s"				},
+	{ "PATCH_VERTEX",			verb_patch_vertex,			"dddddddddd"	},
+	{ "OBJECT",					verb_object,				"iddd"			},
+	{ "OBJECT_MSL",				verb_object_msl,			"idddd"			},
+	{ "BEGIN_SEGMENT",			verb_begin_segment,			"iidddd"		},
+	{ "SHAPE_POINT",			verb_shape_point,			"ddd"			},
+	{ "END_SEGMENT",			verb_end_segment,			"dddd"			},
+	{ "BEGIN_PRIMITIVE",		verb_begin_primitive,		"i"				},
+	{ "END_PRIMITIVE",			verb_end_primitive,			""				},
+	{ "BEGIN_PATCH",			verb_begin_patch,			"iddii"			},
+	{ "END_PATCH",				verb_end_patch,				""				},
+	{ "POLYGON_POINT",			verb_polygon_point,			"dddddddd"		},
+	{ "BEGIN_WINDING",			verb_begin_winding,			""				},
+	{ "END_WINDING",			verb_end_winding,			""				},
+	{ "BEGIN_POLYGON",			verb_begin_polygon,			"iii"			},
+	{ "END_POLYGON",			verb_end_polygon,			""				},
+	{ "BEGIN_SEGMENT_CURVED",	verb_begin_segment_curved,	"iiddddddd"		},
+	{ "SHAPE_POINT_CURVED",		verb_shape_point_curved,	"dddddd"		},
+	{ "END_SEGMENT_CURVED",		verb_end_segment_curved,	"ddddddd"		},
+	{ "FILTER",					verb_filter,				"i"				},
+	{ "RASTER_DATA",			verb_raster_data,			"s"				},
+	{ NULL,						verb_none,					NULL			}
+};
+
+struct	text_cmd_t {
+	unsigned char	verb;
+	unsigned char	count;			// Arguments that parsed
+	int				ints[3];
+	int				dbl;			// Index of our first double in the chunk's doubles
+	const char *	str;			// For 's' - not null terminated
+	int				str_len;
+};
+
+struct	text_chunk_t {
+	const char *		begin;
+	const char *		end;
+	vector<text_cmd_t>	cmds;
+	vector<double>		dbls;
+};
+
+inline bool	is_space(char c) { return c == ' ' || c == '\t'; }
+
+// Trims a line the way we always have: leading white space goes, and anything from a # on is a comment.
+static void	clean_line(const char *& p, const char *& e)
+{
+	while(p < e && is_space(*p)) ++p;
+	const char * c = (const char *) memchr(p, '#', e - p);
+	if(c) e = c;
+	while(e > p && (e[-1] == '\r' || e[-1] == '\n')) --e;
+}
+
+// Returns the index of the line's verb in kVerbs, or -1.
+static int	find_verb(const char * p, const char * e, const char *& args)
+{
+	const char * t = p;
+	while(t < e && !is_space(*t)) ++t;
+	int len = t - p;
+	for(int n = 0; kVerbs[n].name; ++n)
+	if(kVerbs[n].name[0] == *p && strncmp(kVerbs[n].name, p, len) == 0 && kVerbs[n].name[len] == 0)
+	{
+		args = t;
+		return n;
+	}
+	return -1;
+}
+
+// Slow path for numbers the fast path can't do exactly: strtod on a null-terminated copy of the token.
+static bool	parse_double_slow(const char * p, const char * t, double& out)
+{
+	char	buf[64];
+	if(t - p >= (int) sizeof(buf)) return false;
+	memcpy(buf, p, t - p);
+	buf[t - p] = 0;
+	char * end;
+	out = strtod(buf, &end);
+	return end == buf + (t - p);
 }
 
-static char * strip_and_clean(char * raw)
+static bool	parse_double(const char *& p, const char * e, double& out)
 {
-	char * r = raw;
+	while(p < e && is_space(*p)) ++p;
+	const char * t = p;
+	while(t < e && !is_space(*t)) ++t;
+	if(t == p) return false;
+
+	const char * s = p;
+	bool neg = false;
+	if(*s == '-' || *s == '+')
+		neg = *s++ == '-';
+
+	unsigned long long	m = 0;
+	int					digits = 0;
+	int					exp10 = 0;
+	bool				any = false;
+	while(s < t && *s >= '0' && *s <= '9')
+	{
+		if(digits < 19)	{ m = m * 10 + (*s - '0'); if(m) ++digits; }
+		else			++exp10;
+		any = true;
+		++s;
+	}
+	if(s < t && *s == '.')
+	{
+		++s;
+		while(s < t && *s >= '0' && *s <= '9')
+		{
+			if(digits < 19)	{ m = m * 10 + (*s - '0'); if(m) ++digits; --exp10; }
+			any = true;
+			++s;
+		}
+	}
+
+	if(any && s == t && digits <= 15 && exp10 >= -22 && exp10 <= 22)
+	{
+		double v = (double) m;
+		v = exp10 < 0 ? v / kPow10[-exp10] : v * kPow10[exp10];
+		out = neg ? -v : v;
+	}
+	else if(!parse_double_slow(p, t, out))
+		return false;
+	p = t;
+	return true;
+}
 
-	while(*r == ' ' || *r == '\t')					// Advance past any white space, so we can start a line with tab indent.
-		++r;
+static bool	parse_int(const char *& p, const char * e, int& out)
+{
+	while(p < e && is_space(*p)) ++p;
+	const char * s = p;
+	bool neg = false;
+	if(s < e && (*s == '-' || *s == '+'))
+		neg = *s++ == '-';
+	if(s == e || *s < '0' || *s > '9') return false;
+	int v = 0;
+	while(s < e && *s >= '0' && *s <= '9')
+		v = v * 10 + (*s++ - '0');
+	if(s < e && !is_space(*s)) return false;
+	out = neg ? -v : v;
+	p = s;
+	return true;
+}
 
-	char * p = r;
+// Tokenizes one line.  Returns false for lines that aren't commands at all, and skips header commands (properties,
+// divisions and definitions) or everything else, depending on what we are scanning for.
+static bool	parse_line(const char * p, const char * e, bool header, text_cmd_t& cmd, vector<double>& dbls)
+{
+	clean_line(p, e);
+	if(p == e) return false;
+	const char * args;
+	int idx = find_verb(p, e, args);
+	if(idx < 0) return false;
+	int verb = kVerbs[idx].verb;
+	if(header != (verb < verb_patch_vertex)) return false;
+	const char * sig = kVerbs[idx].args;
+
+	cmd.verb = verb;
+	cmd.count = 0;
+	cmd.dbl = dbls.size();
+	cmd.str = NULL;
+	cmd.str_len = 0;
+
+	int ni = 0;
+	for(const char * a = sig; *a; ++a)
+	{
+		if(*a == 'i')
+		{
+			if(!parse_int(args, e, cmd.ints[ni])) break;
+			++ni;
+		}
+		else if(*a == 'd')
+		{
+			double d;
+			if(!parse_double(args, e, d)) break;
+			dbls.push_back(d);
+		}
+		else
+		{
+			while(args < e && is_space(*args)) ++args;
+			if(args == e) break;
+			cmd.str = args;
+			cmd.str_len = e - args;
+		}
+		++cmd.count;
+	}
+	if(verb == verb_property)
+	{
+		// PROPERTY <id> <value> - the value is the rest of the line.
+		cmd.str = p;
+		cmd.str_len = e - p;
+	}
+	return true;
+}
 
-	while(*p)										// Convert any CRLF or # to null term, so we don't pick them up.
+static void	parse_chunk(void * ref)
+{
+	text_chunk_t * c = (text_chunk_t *) ref;
+	const char * p = c->begin;
+	while(p < c->end)
 	{
-		if(*p == '#' || *p == '\r' || *p == '\n')
-			*p = 0;
-		++p;
+		const char * e = (const char *) memchr(p, '\n', c->end - p);
+		e = e ? e + 1 : c->end;
+		text_cmd_t	cmd;
+		if(parse_line(p, e, false, cmd, c->dbls))
+			c->cmds.push_back(cmd);
+		p = e;
 	}
-	return r;
 }
 
+// PROPERTY lines: splits off the id and the value, the way "PROPERTY %s %[^\r\n]" did.
+static bool	split_property(const text_cmd_t& cmd, string& id, string& value)
+{
+	const char * p = cmd.str + 8;
+	const char * e = cmd.str + cmd.str_len;
+	while(p < e && is_space(*p)) ++p;
+	const char * t = p;
+	while(t < e && !is_space(*t)) ++t;
+	if(t == p) return false;
+	id.assign(p, t);
+	while(t < e && is_space(*t)) ++t;
+	if(t == e) return false;
+	value.assign(t, e);
+	return true;
+}
 
 static bool Text2DSFWithWriterAny(const char * inFileName, const char * inDSF, DSFCallbacks_t * in_cbs, void * in_writer)
 {
 	bool is_pipe = strcmp(inFileName, "-") == 0;
-	FILE * fi = (!is_pipe) ? fopen(inFileName, "r") : stdin;
-	if (!fi) return NULL;
+
+	MFMemFile *		mf = NULL;
+	vector<char>	piped;
+	const char *	text_begin;
+	const char *	text_end;
+	if(is_pipe)
+	{
+		char	buf[65536];
+		size_t	n;
+		while((n = fread(buf, 1, sizeof(buf), stdin)) > 0)
+			piped.insert(piped.end(), buf, buf + n);
+		text_begin = piped.empty() ? NULL : &piped[0];
+		text_end = text_begin + piped.size();
+	}
+	else
+	{
+		mf = MemFile_Open(inFileName);
+		if (!mf) return false;
+		text_begin = MemFile_GetBegin(mf);
+		text_end = MemFile_GetEnd(mf);
+	}
 
 	int divisions = 8;
 	float west = 999.0, south = 999.0, north = 999.0, east = 999.0;
 
-	DSFRasterHeader_t	rheader;
-
-	char	buf[512];
-	char	prop_id[512];
-	char	prop_value[512];
-
 	DSFCallbacks_t	cbs;
 	void * writer;
 
-	int props_got = 0;
-
 	vector<pair<string, string> >		properties;
+	vector<text_cmd_t>					defs;
+	vector<double>						no_dbls;
 
 	printf("Scanning for dimension properties...\n");
 
-	while (fgets(buf, sizeof(buf), fi))
+	for(const char * p = text_begin; p < text_end; )
 	{
-		char * ptr = strip_and_clean(buf);
-		if (sscanf(ptr, "PROPERTY %s %[^\r\n]", prop_id, prop_value) == 2)
-			properties.push_back(pair<string, string>(prop_id, prop_value));
-
-		if (sscanf(ptr, "PROPERTY sim/west %f", &west) == 1) ++props_got;
-		if (sscanf(ptr, "PROPERTY sim/east %f", &east) == 1) ++props_got;
-		if (sscanf(ptr, "PROPERTY sim/north %f", &north) == 1) ++props_got;
-		if (sscanf(ptr, "PROPERTY sim/south %f", &south) == 1) ++props_got;
-		sscanf(ptr, "DIVISIONS %d", &divisions);
-
-		if(is_pipe)
-		if (strncmp(ptr,"DIVISIONS",9) != 0 &&
-		   strncmp(ptr,"PROPERTY",8) != 0 &&
-		   strncmp(ptr,"I",1) != 0 &&
-		   strncmp(ptr,"A",1) != 0 &&
-		   strncmp(ptr,"800",3) != 0 &&
-		   strncmp(ptr,"DSF2TEXT",8) != 0 &&
-		   ptr[0] != 0)
-			break;
+		const char * e = (const char *) memchr(p, '\n', text_end - p);
+		e = e ? e + 1 : text_end;
+		text_cmd_t	cmd;
+		if(parse_line(p, e, true, cmd, no_dbls))
+		{
+			switch(cmd.verb) {
+			case verb_property:
+				{
+					string id, value;
+					if(split_property(cmd, id, value))
+					{
+						properties.push_back(pair<string, string>(id, value));
+						char * end;
+						double v = strtod(value.c_str(), &end);
+						if(end != value.c_str())
+						{
+							if(id == "sim/west")	west = v;
+							if(id == "sim/east")	east = v;
+							if(id == "sim/north")	north = v;
+							if(id == "sim/south")	south = v;
+						}
+					}
+				}
+				break;
+			case verb_divisions:
+				if(cmd.count == 1)
+					divisions = cmd.ints[0];
+				break;
+			case verb_terrain_def:
+			case verb_object_def:
+			case verb_polygon_def:
+			case verb_network_def:
+			case verb_raster_def:
+				if(cmd.count == 1)
+					defs.push_back(cmd);
+				break;
+			}
+		}
+		p = e;
 	}
 
 	if (west >= 180.0 || west < -180.0 ||
@@ -428,14 +959,12 @@ static bool Text2DSFWithWriterAny(const char * inFileName, const char * inDSF, D
 		north > 90.0 || north <= -90.0)
 	{
 		fprintf(stdout, "ERROR: the DSF boundaries are out of range.  This can indicate a missing or corrupt sim/dimension properties.\n");
+		if(mf) MemFile_Close(mf);
 		return false;
 	}
 
 	printf("Got dimension properties, establishing file writer...\n");
 
-	if(!is_pipe)
-		fseek(fi,0,SEEK_SET);
-
 	if(in_cbs)
 	{
 		memcpy(&cbs,in_cbs,sizeof(cbs));
@@ -450,98 +979,221 @@ static bool Text2DSFWithWriterAny(const char * inFileName, const char * inDSF, D
 	for (int p = 0; p < properties.size(); ++p)
 		cbs.AcceptProperty_f(properties[p].first.c_str(), properties[p].second.c_str(), writer);
 
-	int		ptype, subtype, flags, depth = 99, param, filter;
-	double	lod_near, lod_far;
-
-	double	coords[10];
+	for (int d = 0; d < defs.size(); ++d)
+	{
+		string path(defs[d].str, defs[d].str_len);
+		switch(defs[d].verb) {
+		case verb_terrain_def:		cbs.AcceptTerrainDef_f(path.c_str(), writer);	break;
+		case verb_object_def:		cbs.AcceptObjectDef_f(path.c_str(), writer);	break;
+		case verb_polygon_def:		cbs.AcceptPolygonDef_f(path.c_str(), writer);	break;
+		case verb_network_def:		cbs.AcceptNetworkDef_f(path.c_str(), writer);	break;
+		case verb_raster_def:		cbs.AcceptRasterDef_f(path.c_str(), writer);	break;
+		}
+	}
 
-	if(!is_pipe)
+	// Cut the text into chunks on line breaks.
+	vector<text_chunk_t>	chunks;
+	for(const char * p = text_begin; p < text_end; )
 	{
-		fseek(fi,0,SEEK_SET);
-		while(fgets(buf, sizeof(buf), fi))
+		const char * e = min(p + TEXT_CHUNK_BYTES, text_end);
+		if(e < text_end)
 		{
-			char * ptr = strip_and_clean(buf);
-				 if (!is_pipe && sscanf(ptr, "TERRAIN_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptTerrainDef_f(prop_id, writer);
-			else if (!is_pipe && sscanf(ptr, "OBJECT_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptObjectDef_f(prop_id, writer);
-			else if (!is_pipe && sscanf(ptr, "POLYGON_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptPolygonDef_f(prop_id, writer);
-			else if (!is_pipe && sscanf(ptr, "NETWORK_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptNetworkDef_f(prop_id, writer);
-			else if (!is_pipe && sscanf(ptr, "RASTER_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptRasterDef_f(prop_id, writer);
-
+			const char * nl = (const char *) memchr(e, '\n', text_end - e);
+			e = nl ? nl + 1 : text_end;
 		}
+		chunks.push_back(text_chunk_t());
+		chunks.back().begin = p;
+		chunks.back().end = e;
+		p = e;
+	}
 
-		fseek(fi,0,SEEK_SET);
-		fgets(buf, sizeof(buf), fi);
-
+	int		depth = 99;
+	double	coords[10];
+	DSFRasterHeader_t	rheader;
+	char	prop_id[512];
+	bool	ok = true;
 
-	}
-	
+	// Parse the next window of chunks in the background while we feed this one to the writer.
+	THREAD_JobQueue	parsers;
+	int window = THREAD_CountCores() * 4;
+	for(int c = 0; c < min(window, (int) chunks.size()); ++c)
+		parsers.Add(parse_chunk, &chunks[c]);
 
-	do 
+	for(int w = 0; ok && w < chunks.size(); w += window)
 	{
-		char * ptr = strip_and_clean(buf);
-			 if (sscanf(ptr, "PATCH_VERTEX %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf", &coords[0], &coords[1], &coords[2], &coords[3], &coords[4], &coords[5], &coords[6], &coords[7], &coords[8], &coords[9]) == depth)		cbs.AddPatchVertex_f(coords, writer);
-		else if (sscanf(ptr, "OBJECT %d %lf %lf %lf", &ptype, &coords[0],&coords[1],&coords[2]) == 4)		cbs.AddObject_f(ptype, coords, 3, writer);
-		else if (sscanf(ptr, "OBJECT_MSL %d %lf %lf %lf %lf", &ptype, &coords[0],&coords[1],&coords[3],&coords[2]) == 5)		cbs.AddObject_f(ptype, coords, 4, writer);
-
-		else if (sscanf(ptr,"BEGIN_SEGMENT %d %d %lf %lf %lf %lf", &ptype, &subtype, &coords[3], &coords[0],&coords[1],&coords[2]) == 6)							cbs.BeginSegment_f(ptype, subtype, coords, false, writer);
-		else if (sscanf(ptr,"SHAPE_POINT %lf %lf %lf", &coords[0], &coords[1], &coords[2])== 3) 			cbs.AddSegmentShapePoint_f(coords, false, writer);
-		else if (sscanf(ptr,"END_SEGMENT %lf %lf %lf %lf", &coords[3], &coords[0], &coords[1], &coords[2])== 4) cbs.EndSegment_f(coords, false, writer);
-
-		else if (sscanf(ptr, "BEGIN_PRIMITIVE %d", &ptype) == 1)												cbs.BeginPrimitive_f(ptype, writer);
-		else if (!strncmp(ptr, "END_PRIMITIVE", strlen("END_PRIMITIVE")))										cbs.EndPrimitive_f(writer);
-		else if (sscanf(ptr,"BEGIN_PATCH %d %lf %lf %d %d", &ptype, &lod_near, &lod_far, &flags, &depth) == 5) 	cbs.BeginPatch_f(ptype, lod_near, lod_far, flags, depth, writer);
-		else if (!strncmp(ptr, "END_PATCH", strlen("END_PATCH")))												{ cbs.EndPatch_f(writer); depth = 99; }
-
-		else if (sscanf(ptr, "POLYGON_POINT %lf %lf %lf %lf %lf %lf %lf %lf", &coords[0], &coords[1], &coords[2], &coords[3], &coords[4], &coords[5], &coords[6], &coords[7])==depth)			cbs.AddPolygonPoint_f(coords, writer);
-		else if (!strncmp(ptr, "BEGIN_WINDING", strlen("BEGIN_WINDING")))					cbs.BeginPolygonWinding_f(writer);
-		else if (!strncmp(ptr, "END_WINDING", strlen("END_WINDING")))						cbs.EndPolygonWinding_f(writer);
-		else if (sscanf(ptr,"BEGIN_POLYGON %d %d %d", &ptype, &param, &depth)==3)			cbs.BeginPolygon_f(ptype, param, depth, writer);
-		else if (sscanf(ptr,"BEGIN_POLYGON %d %d %d", &ptype, &param, &depth)==2)			cbs.BeginPolygon_f(ptype, param, 2, 	writer);
-		else if (!strncmp(ptr, "END_POLYGON", strlen("END_POLYGON")))						cbs.EndPolygon_f(writer);
-
-		else if (is_pipe && sscanf(ptr, "TERRAIN_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptTerrainDef_f(prop_id, writer);
-		else if (is_pipe && sscanf(ptr, "OBJECT_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptObjectDef_f(prop_id, writer);
-		else if (is_pipe && sscanf(ptr, "POLYGON_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptPolygonDef_f(prop_id, writer);
-		else if (is_pipe && sscanf(ptr, "NETWORK_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptNetworkDef_f(prop_id, writer);
-		else if (is_pipe && sscanf(ptr, "RASTER_DEF %[^\r\n]", prop_id) == 1)							cbs.AcceptRasterDef_f(prop_id, writer);
-
-		else if (sscanf(ptr,"BEGIN_SEGMENT_CURVED %d %d %lf %lf %lf %lf %lf %lf %lf", &ptype, &subtype, &coords[3], &coords[0],&coords[1],&coords[2],&coords[4],&coords[5],&coords[6]) == 9) cbs.BeginSegment_f(ptype, subtype, coords, true, writer);
-		else if (sscanf(ptr,"SHAPE_POINT_CURVED %lf %lf %lf %lf %lf %lf", &coords[0], &coords[1], &coords[2], &coords[3], &coords[4], &coords[5])== 6) cbs.AddSegmentShapePoint_f(coords, true, writer);
-		else if (sscanf(ptr,"SHAPE_POINT_CURVED %lf %lf %lf %lf %lf %lf %lf ", &coords[3], &coords[0], &coords[1], &coords[2], &coords[4], &coords[5], &coords[6])== 7) cbs.EndSegment_f(coords, true, writer);
-
-		else if (sscanf(ptr,"FILTER %d", &filter) == 1) cbs.SetFilter_f(filter, writer);
-
-		else if (sscanf(ptr,"RASTER_DATA version=%hhu bpp=%hhu flags=%hu width=%u height=%u scale=%f offset=%f %[^\r\n]",
-							&rheader.version,&rheader.bytes_per_pixel,&rheader.flags,&rheader.width,&rheader.height,&rheader.scale,&rheader.offset,prop_id) == 8)
+		parsers.Wait();
+		int w_end = min(w + window, (int) chunks.size());
+		for(int c = w_end; c < min(w_end + window, (int) chunks.size()); ++c)
+			parsers.Add(parse_chunk, &chunks[c]);
+
+		for(int c = w; c < w_end; ++c)
 		{
-			int ds = rheader.bytes_per_pixel * rheader.width * rheader.height;
-			char * data = (char *) malloc(ds);
-			FILE * sf = fopen(prop_id,"rb");
-			if(sf)
+			text_chunk_t& chunk(chunks[c]);
+			for(vector<text_cmd_t>::iterator i = chunk.cmds.begin(); i != chunk.cmds.end(); ++i)
 			{
-				if(fread(data,1,ds,sf) == ds)
-				{
-					cbs.AddRasterData_f(&rheader,data,writer);
-				} 
-				else
-				{
-					fprintf(stdout, "ERROR: could not write %d bytes to file %s\n", ds, prop_id);
-					fclose(sf);
-					return false;
+				const double * d = chunk.dbls.empty() ? NULL : &chunk.dbls[0] + i->dbl;
+				const int * n = i->ints;
+				switch(i->verb) {
+				case verb_patch_vertex:
+					if(i->count == depth)
+					{
+						memcpy(coords, d, depth * sizeof(double));
+						cbs.AddPatchVertex_f(coords, writer);
+					}
+					break;
+				case verb_object:
+					if(i->count == 4)
+					{
+						coords[0] = d[0]; coords[1] = d[1]; coords[2] = d[2];
+						cbs.AddObject_f(n[0], coords, 3, writer);
+					}
+					break;
+				case verb_object_msl:
+					if(i->count == 5)
+					{
+						coords[0] = d[0]; coords[1] = d[1]; coords[3] = d[2]; coords[2] = d[3];
+						cbs.AddObject_f(n[0], coords, 4, writer);
+					}
+					break;
+				case verb_begin_segment:
+					if(i->count == 6)
+					{
+						coords[3] = d[0]; coords[0] = d[1]; coords[1] = d[2]; coords[2] = d[3];
+						cbs.BeginSegment_f(n[0], n[1], coords, false, writer);
+					}
+					break;
+				case verb_shape_point:
+					if(i->count == 3)
+					{
+						coords[0] = d[0]; coords[1] = d[1]; coords[2] = d[2];
+						cbs.AddSegmentShapePoint_f(coords, false, writer);
+					}
+					break;
+				case verb_end_segment:
+					if(i->count == 4)
+					{
+						coords[3] = d[0]; coords[0] = d[1]; coords[1] = d[2]; coords[2] = d[3];
+						cbs.EndSegment_f(coords, false, writer);
+					}
+					break;
+				case verb_begin_primitive:
+					if(i->count == 1)
+						cbs.BeginPrimitive_f(n[0], writer);
+					break;
+				case verb_end_primitive:
+					cbs.EndPrimitive_f(writer);
+					break;
+				case verb_begin_patch:
+					if(i->count == 5)
+					{
+						depth = n[2];
+						cbs.BeginPatch_f(n[0], d[0], d[1], n[1], depth, writer);
+					}
+					break;
+				case verb_end_patch:
+					cbs.EndPatch_f(writer);
+					depth = 99;
+					break;
+				case verb_polygon_point:
+					if(i->count == depth)
+					{
+						memcpy(coords, d, depth * sizeof(double));
+						cbs.AddPolygonPoint_f(coords, writer);
+					}
+					break;
+				case verb_begin_winding:
+					cbs.BeginPolygonWinding_f(writer);
+					break;
+				case verb_end_winding:
+					cbs.EndPolygonWinding_f(writer);
+					break;
+				case verb_begin_polygon:
+					if(i->count >= 2)
+					{
+						depth = i->count == 3 ? n[2] : 2;
+						cbs.BeginPolygon_f(n[0], n[1], depth, writer);
+					}
+					break;
+				case verb_end_polygon:
+					cbs.EndPolygon_f(writer);
+					break;
+				case verb_begin_segment_curved:
+					if(i->count == 9)
+					{
+						coords[3] = d[0]; coords[0] = d[1]; coords[1] = d[2]; coords[2] = d[3];
+						coords[4] = d[4]; coords[5] = d[5]; coords[6] = d[6];
+						cbs.BeginSegment_f(n[0], n[1], coords, true, writer);
+					}
+					break;
+				case verb_shape_point_curved:
+					if(i->count == 6)
+					{
+						memcpy(coords, d, 6 * sizeof(double));
+						cbs.AddSegmentShapePoint_f(coords, true, writer);
+					}
+					break;
+				case verb_end_segment_curved:
+					if(i->count == 7)
+					{
+						coords[3] = d[0]; coords[0] = d[1]; coords[1] = d[2]; coords[2] = d[3];
+						coords[4] = d[4]; coords[5] = d[5]; coords[6] = d[6];
+						cbs.EndSegment_f(coords, true, writer);
+					}
+					break;
+				case verb_filter:
+					if(i->count == 1)
+						cbs.SetFilter_f(n[0], writer);
+					break;
+				case verb_raster_data:
+					if(i->count == 1)
+					{
+						// Rare, and the format is fussy - scanf it like we always did.
+						string	line = string("RASTER_DATA ") + string(i->str, i->str_len);
+						if (sscanf(line.c_str(),"RASTER_DATA version=%hhu bpp=%hhu flags=%hu width=%u height=%u scale=%f offset=%f %[^\r\n]",
+									&rheader.version,&rheader.bytes_per_pixel,&rheader.flags,&rheader.width,&rheader.height,&rheader.scale,&rheader.offset,prop_id) == 8)
+						{
+							int ds = rheader.bytes_per_pixel * rheader.width * rheader.height;
+							char * data = (char *) malloc(ds);
+							FILE * sf = fopen(prop_id,"rb");
+							if(sf)
+							{
+								if(fread(data,1,ds,sf) == ds)
+								{
+									cbs.AddRasterData_f(&rheader,data,writer);
+								}
+								else
+								{
+									fprintf(stdout, "ERROR: could not write %d bytes to file %s\n", ds, prop_id);
+									ok = false;
+								}
+								fclose(sf);
+							} else {
+								fprintf(stdout, "ERROR: could not open file %s\n", prop_id);
+								ok = false;
+							}
+						}
+					}
+					break;
 				}
-				fclose(sf);
-			} else {
-				fprintf(stdout, "ERROR: could not open file %s\n", prop_id);
-				return false;
+				if(!ok)
+					break;
 			}
-
+			vector<text_cmd_t>().swap(chunk.cmds);
+			vector<double>().swap(chunk.dbls);
+			if(!ok)
+				break;
 		}
 	}
-	while(fgets(buf, sizeof(buf), fi));
-
+	parsers.Wait();
 
-	if (!is_pipe)
-		fclose(fi);
+	if (mf)
+		MemFile_Close(mf);
+	if (!ok)
+	{
+		if(!in_cbs)
+			DSFDestroyWriter(writer);
+		return false;
+	}
 
 	printf("Got entire file, processing and creating DSF.\n");
 
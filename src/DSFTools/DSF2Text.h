@@ -44,6 +44,9 @@ struct print_funcs_s {
 // that just print text...pass a print_funcs_s * as the ref.
 void DSF2Text_CreateWriterCallbacks(DSFCallbacks_t * cbs);
 
+// Decimals to print coordinates with (default 9); -1 prints the shortest text that reads back exactly.
+void DSF2Text_SetPrecision(int digits);
+
 // Complete tranlsation from binary to text.
 bool DSF2Text(char ** inDSF, int n, const char * inFileName);
 
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+
+#include <stdarg.h>
+#include <math.h>
+#include "DSF2Text.h"
+#include "DSFLib.h"
+#include "AssertUtils.h"
+
+// DSF2Text formats its numbers by hand.  These check that every line still comes out byte for byte the way the old
+// printf formats wrote it, and that text -> Text2DSFWithWriter -> DSF2Text gives back the same text.
+
+static unsigned int	sSeed = 1;
+
+static double	test_rand(double lo, double hi)
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return lo + (hi - lo) * (double) ((sSeed >> 8) & 0xFFFFFF) / (double) 0xFFFFFF;
+}
+
+// Mostly plain coordinates, with a share of the values that are hard to format: halfway cases at 9 and 6 decimals,
+// negative zero, whole numbers and huge values.
+static double	test_coord(void)
+{
+	switch((int) test_rand(0, 8)) {
+	case 0:		return (floor(test_rand(-180e9, 180e9)) + 0.5) / 1e9;
+	case 1:		return (floor(test_rand(-360e6, 360e6)) + 0.5) / 1e6;
+	case 2:		return floor(test_rand(-180, 180));
+	case 3:		return test_rand(0,1) < 0.5 ? -0.0 : 0.0;
+	case 4:		return test_rand(-1e15, 1e15);
+	default:	return test_rand(-180, 180) + test_rand(-1e-7, 1e-7);
+	}
+}
+
+static int	test_print(void * ref, const char * fmt, ...)
+{
+	string * s = (string *) ref;
+	char	buf[2048];
+	va_list	args;
+	va_start(args, fmt);
+	int n = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	if(n > 0)
+		s->append(buf, n);
+	return n;
+}
+
+static void	old_print(string& s, const char * fmt, ...)
+{
+	char	buf[2048];
+	va_list	args;
+	va_start(args, fmt);
+	int n = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	if(n > 0)
+		s.append(buf, n);
+}
+
+// Drives the writer callbacks with random data into "text", and prints what the old printf code would have into "old".
+static void	make_dsf_text(DSFCallbacks_t& cbs, print_funcs_s * p, string& old)
+{
+	double	c[8];
+	cbs.AcceptProperty_f("sim/west", "-123", p);			old_print(old, "PROPERTY sim/west -123\n");
+	cbs.AcceptProperty_f("sim/east", "-122", p);			old_print(old, "PROPERTY sim/east -122\n");
+	cbs.AcceptProperty_f("sim/south", "47", p);				old_print(old, "PROPERTY sim/south 47\n");
+	cbs.AcceptProperty_f("sim/north", "48", p);				old_print(old, "PROPERTY sim/north 48\n");
+	cbs.AcceptTerrainDef_f("terrain_Water", p);				old_print(old, "TERRAIN_DEF terrain_Water\n");
+	cbs.AcceptObjectDef_f("lib/a.obj", p);					old_print(old, "OBJECT_DEF lib/a.obj\n");
+	cbs.AcceptObjectDef_f("lib/b.obj", p);					old_print(old, "OBJECT_DEF lib/b.obj\n");
+	cbs.AcceptPolygonDef_f("lib/c.fac", p);					old_print(old, "POLYGON_DEF lib/c.fac\n");
+	cbs.AcceptNetworkDef_f("lib/roads.net", p);				old_print(old, "NETWORK_DEF lib/roads.net\n");
+
+	for(int t = 0; t < 200; ++t)
+	{
+		int depth = (int) test_rand(2, 8);
+		double near_lod = test_coord(), far_lod = test_coord();
+		cbs.BeginPatch_f(0, near_lod, far_lod, 1, depth, p);
+		old_print(old, "BEGIN_PATCH %d %lf %lf %d %d\n", 0, near_lod, far_lod, 1, depth);
+		cbs.BeginPrimitive_f(t % 3, p);						old_print(old, "BEGIN_PRIMITIVE %d\n", t % 3);
+		for(int v = 0; v < 30; ++v)
+		{
+			old_print(old, "PATCH_VERTEX");
+			for(int n = 0; n < depth; ++n)
+			{
+				c[n] = test_coord();
+				old_print(old, " %.9lf", c[n]);
+			}
+			old_print(old, "\n");
+			cbs.AddPatchVertex_f(c, p);
+		}
+		cbs.EndPrimitive_f(p);								old_print(old, "END_PRIMITIVE\n");
+		cbs.EndPatch_f(p);									old_print(old, "END_PATCH\n");
+
+		for(int n = 0; n < 4; ++n)
+			c[n] = test_coord();
+		cbs.AddObject_f(t % 2, c, 3, p);
+		old_print(old, "OBJECT %d %.9lf %.9lf %lf\n", t % 2, c[0], c[1], c[2]);
+		cbs.AddObject_f(t % 2, c, 4, p);
+		old_print(old, "OBJECT_MSL %d %.9lf %.9lf %.9lf %lf\n", t % 2, c[0], c[1], c[3], c[2]);
+
+		bool curved = t % 4 == 1;
+		for(int n = 0; n < 7; ++n)
+			c[n] = test_coord();
+		c[3] = floor(test_rand(0, 10000));
+		cbs.BeginSegment_f(0, t, c, curved, p);
+		if(curved)
+			old_print(old, "BEGIN_SEGMENT_CURVED %d %d %d %.9lf %.9lf %.9lf %.9lf %.9lf %.9lf\n", 0, t, (int) c[3], c[0], c[1], c[2], c[4], c[5], c[6]);
+		else
+			old_print(old, "BEGIN_SEGMENT %d %d %d %.9lf %.9lf %.9lf\n", 0, t, (int) c[3], c[0], c[1], c[2]);
+		for(int n = 0; n < 6; ++n)
+			c[n] = test_coord();
+		cbs.AddSegmentShapePoint_f(c, curved, p);
+		if(curved)
+			old_print(old, "SHAPE_POINT_CURVED %.9lf %.9lf %.9lf %.9lf %.9lf %.9lf\n", c[0], c[1], c[2], c[3], c[4], c[5]);
+		else
+			old_print(old, "SHAPE_POINT %.9lf %.9lf %.9lf\n", c[0], c[1], c[2]);
+		for(int n = 0; n < 7; ++n)
+			c[n] = test_coord();
+		c[3] = floor(test_rand(0, 10000));
+		cbs.EndSegment_f(c, curved, p);
+		if(curved)
+			old_print(old, "END_SEGMENT_CURVED %d %.9lf %.9lf %.9lf %.9lf %.9lf %.9lf\n", (int) c[3], c[0], c[1], c[2], c[4], c[5], c[6]);
+		else
+			old_print(old, "END_SEGMENT %d %.9lf %.9lf %.9lf\n", (int) c[3], c[0], c[1], c[2]);
+
+		depth = 2 + t % 3;
+		cbs.BeginPolygon_f(0, t, depth, p);					old_print(old, "BEGIN_POLYGON %d %d %d\n", 0, t, depth);
+		cbs.BeginPolygonWinding_f(p);						old_print(old, "BEGIN_WINDING\n");
+		for(int v = 0; v < 5; ++v)
+		{
+			old_print(old, "POLYGON_POINT");
+			for(int n = 0; n < depth; ++n)
+			{
+				c[n] = test_coord();
+				old_print(old, " %.9lf", c[n]);
+			}
+			old_print(old, "\n");
+			cbs.AddPolygonPoint_f(c, p);
+		}
+		cbs.EndPolygonWinding_f(p);							old_print(old, "END_WINDING\n");
+		cbs.EndPolygon_f(p);								old_print(old, "END_POLYGON\n");
+	}
+}
+
+static void	TEST_SameAsPrintf(void)
+{
+	DSFCallbacks_t	cbs;
+	DSF2Text_CreateWriterCallbacks(&cbs);
+	string			text, old;
+	print_funcs_s	p = { test_print, &text };
+	make_dsf_text(cbs, &p, old);
+	TEST_Run(text == old);
+}
+
+static void	TEST_RoundTrip(void)
+{
+	DSFCallbacks_t	cbs;
+	DSF2Text_CreateWriterCallbacks(&cbs);
+	string			text, old, again;
+	print_funcs_s	p = { test_print, &text };
+	make_dsf_text(cbs, &p, old);
+
+	const char * path = "DSF2Text_TEST.txt";
+	FILE * fi = fopen(path, "wb");
+	TEST_Run(fi != NULL);
+	if(!fi) return;
+	fwrite(text.c_str(), 1, text.size(), fi);
+	fclose(fi);
+
+	print_funcs_s	p2 = { test_print, &again };
+	TEST_Run(Text2DSFWithWriter(path, &cbs, &p2));
+	remove(path);
+	TEST_Run(again == text);
+}
+
+// At "shortest" precision every coordinate must read back as exactly the double we printed.
+static void	TEST_ShortestReadsBack(void)
+{
+	DSFCallbacks_t	cbs;
+	DSF2Text_CreateWriterCallbacks(&cbs);
+	string			text;
+	print_funcs_s	p = { test_print, &text };
+
+	DSF2Text_SetPrecision(-1);
+	cbs.BeginPatch_f(0, 0.0, 1.0, 1, 7, &p);
+	vector<double>	values;
+	for(int v = 0; v < 2000; ++v)
+	{
+		double c[7];
+		for(int n = 0; n < 7; ++n)
+		{
+			c[n] = n == 6 ? test_rand(-1, 1) / 3.0 : test_coord();
+			values.push_back(c[n]);
+		}
+		cbs.AddPatchVertex_f(c, &p);
+	}
+	DSF2Text_SetPrecision(9);
+
+	int k = 0;
+	bool all_same = true;
+	for(const char * l = strstr(text.c_str(), "PATCH_VERTEX"); l; l = strstr(l + 1, "PATCH_VERTEX"))
+	{
+		const char * s = l + 12;
+		for(int n = 0; n < 7; ++n)
+		{
+			char * e;
+			double d = strtod(s, &e);
+			if(e == s || k >= values.size() || d != values[k] || (d == 0.0 && (1.0 / d < 0.0) != (1.0 / values[k] < 0.0)))
+				all_same = false;
+			++k;
+			s = e;
+		}
+	}
+	TEST_Run(all_same);
+	TEST_Run(k == values.size());
+}
+
+void	TEST_DSF2Text(void)
+{
+	TEST_SameAsPrintf();
+	TEST_RoundTrip();
+	TEST_ShortestReadsBack();
+}
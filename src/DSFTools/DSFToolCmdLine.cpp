@@ -30,6 +30,10 @@
 #include <stdlib.h>
 #endif
 
+#if DEV
+void TEST_DSF2Text(void);
+#endif
+
 FILE * err_fi = stdout;
 
 void AssertShellBail(const char * condition, const char * file, int line)
@@ -55,6 +59,14 @@ int main(int argc, char * argv[])
 
 	for (int n = 1; n < argc; ++n)
 	{
+		if (!strcmp(argv[n], "--precision"))
+		{
+			++n;
+			if (n >= argc) goto help;
+			DSF2Text_SetPrecision(strcmp(argv[n], "shortest") ? atoi(argv[n]) : -1);
+			continue;
+		}
+
 		if (!strcmp(argv[n], "-dsf2text") ||
 			!strcmp(argv[n], "--dsf2text"))
 		{
@@ -92,11 +104,18 @@ int main(int argc, char * argv[])
 		{
 			print_product_version("DSFTool", DSFTOOL_VER, DSFTOOL_EXTRAVER);
 		}
+#if DEV
+		if (!strcmp(argv[n], "--selftest"))
+		{
+			TEST_DSF2Text();
+			printf("Self-tests completed.\n");
+		}
+#endif
 	}
 
 	return 0;
 help:
-	fprintf(err_fi, "Usage: %s --dsf2text [dsffile] [textfile]\n",argv[0]);
+	fprintf(err_fi, "Usage: %s [--precision digits|shortest] --dsf2text [dsffile] [textfile]\n",argv[0]);
 	fprintf(err_fi, "       %s --text2dsf [textfile] [dsffile]\n",argv[0]);
 	fprintf(err_fi, "       %s --version\n",argv[0]);
 	fprintf(err_fi, "Please note: dsftool still supports single-hyphen (-dsf2text) syntax for backward compatibility.\n");
@@ -268,6 +268,11 @@ public:
 	virtual	int				GetNumEntities(void ) const=0;
 	virtual	IGISEntity *	GetNthEntity  (int n) const=0;
 
+	// Appends, in ascending order, the index of every entity that might touch this box - that is, its bounds
+	// overlap, or its Cull() might accept the box.  This is a fast first cut for big composites; callers must still
+	// test each entity they get back.
+	virtual	void			GetEntitiesNear(const Bbox2& bounds, vector<int>& out_indices) const=0;
+
 };
 
 #endif
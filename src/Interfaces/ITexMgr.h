@@ -43,6 +43,10 @@ public:
 								int *	org_x,
 								int *	org_y)=0;
 
+	// Textures looked up with tex_Async that are still being decoded.  Their ID is 0 until the next lookup after
+	// they are done, so anyone drawing with them should redraw until this hits 0.
+	virtual	int			CountPendingLoads(void)=0;
+
 };
 
 #endif /* ITexMgr_H */
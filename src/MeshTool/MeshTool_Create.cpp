@@ -160,6 +160,8 @@ void MT_FinishCreate(void)
 {
 	CropMap(*the_map, sBounds[0],sBounds[1],sBounds[2],sBounds[3],false,ConsoleProgressFunc);
 
+	// The script is done adding custom terrains to the rules - index them once, before AssignLandusesToMesh needs them.
+	IndexNaturalTerrainRules();
 }
 
 static void print_mesh_stats(void)
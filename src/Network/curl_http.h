@@ -113,6 +113,9 @@ private:
 // Checks a short list of things that might indicate a net connectivity problem.
 bool	UTL_http_is_error_bad_net(int err);
 
+// Escapes the characters in a URL that cURL won't take as-is (spaces).
+void	UTL_http_encode_url(string& io_url);
+
 #endif /* HAS_GATEWAY */
 
 #endif /* UTL_http_H */
@@ -275,6 +275,7 @@ static int DoTiming(const vector<const char *>& args)		{	gTiming = 1;	return 0;
 static int DoNoTiming(const vector<const char *>& args)		{	gTiming = 0;	return 0;	}
 static int DoProgress(const vector<const char *>& args)		{	/*gProgress = ConsoleProgressFunc;	*/return 0;	}
 static int DoNoProgress(const vector<const char *>& args)	{	/*gProgress = NULL;					*/return 0;	}
+static int DoThreads(const vector<const char *>& args)		{	gThreads = atoi(args[0]);	return 0;	}
 
 static	GISTool_RegCmd_t		sUtilCmds[] = {
 //{ "-help",			0, 1, DoHelp, "Prints help info for a command.", "" },
@@ -284,6 +285,7 @@ static	GISTool_RegCmd_t		sUtilCmds[] = {
 { "-notiming",		0, 0, DoNoTiming, "Disables performance timing.", "" },
 { "-progress",		0, 0, DoProgress, "Shows progress bars", "" },
 { "-noprogress",	0, 0, DoNoProgress, "Disables progress bars", "" },
+{ "-threads",		1, 1, DoThreads, "Sets worker threads for zoning and landuse.", "0 means one per core, 1 runs single-threaded." },
 { "-selftest",		0, 0, DoSelfTest, "Self test internal algorithms.", "" },
 #if USE_CHUD
 { "-chud_start",	1, 1, DoChudStart, "Start profiling", "" },
@@ -36,8 +36,16 @@
 #include <jasper/jasper.h>
 #endif
 #include "AssertUtils.h"
+#include "ThreadUtils.h"
 #include <stdint.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define MIP_BOX_SSE2 1
+#else
+	#define MIP_BOX_SSE2 0
+#endif
+
 #if IBM
 #include "GUI_Unicode.h"
 #endif
@@ -381,6 +389,21 @@ int GetSupportedType(const char * path)
 	return -1;
 }
 
+int GetSupportedTypeFromData(const void * inBytes, int inLength)
+{
+	const unsigned char * b = (const unsigned char *) inBytes;
+
+	if(inLength >= 8 && memcmp(b, "\x89PNG\r\n\x1a\n", 8) == 0)					return WED_PNG;
+	if(inLength >= 4 && memcmp(b, "DDS ", 4) == 0)									return WED_DDS;
+	if(inLength >= 3 && b[0] == 0xFF && b[1] == 0xD8 && b[2] == 0xFF)				return WED_JPEG;
+	if(inLength >= 4 && (memcmp(b, "II*\0", 4) == 0 || memcmp(b, "MM\0*", 4) == 0))	return WED_TIF;
+	if(inLength >= 12 && memcmp(b, "\0\0\0\x0CjP  \r\n\x87\n", 12) == 0)			return WED_JP2K;	// JP2 box
+	if(inLength >= 4 && memcmp(b, "\xFF\x4F\xFF\x51", 4) == 0)						return WED_JP2K;	// Raw codestream
+	if(inLength >= 2 && b[0] == 'B' && b[1] == 'M')									return WED_BMP;
+
+	return -1;
+}
+
 int MakeSupportedType(const char * path, ImageInfo * inImage)
 {
 	int error = -1;//Guilty until proven innocent
@@ -1397,7 +1420,18 @@ bail:
 #endif
 
 #if USE_GEOJPEG2K
+// jas_init/jas_cleanup work on global state, so only one thread at a time may be in JasPer.
+static THREAD_Mutex	s_jasper_lock;
+
+static int create_bitmap_from_jp2k_locked(const char * inFilePath, struct ImageInfo * outImageInfo);
+
 int CreateBitmapFromJP2K(const char * inFilePath, struct ImageInfo * outImageInfo)
+{
+	THREAD_Lock	l(s_jasper_lock);
+	return create_bitmap_from_jp2k_locked(inFilePath, outImageInfo);
+}
+
+static int create_bitmap_from_jp2k_locked(const char * inFilePath, struct ImageInfo * outImageInfo)
 {
 	//Clean out the image info
 	outImageInfo->data = NULL;
@@ -1509,6 +1543,43 @@ static void	in_place_scaleXY(int x, int y, unsigned char * src, unsigned char *
 	x /= 2;
 	y /= 2;
 
+#if MIP_BOX_SSE2
+	// RGBA is what we almost always have; do two output pixels per step.  Same truncating average as below.
+	if(channels == 4)
+	{
+		__m128i zero = _mm_setzero_si128();
+		while(y--)
+		{
+			int ctr=x;
+			for(; ctr >= 2; ctr -= 2)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i *) s1);		// 4 source pixels from each row
+				__m128i b = _mm_loadu_si128((const __m128i *) s2);
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));				// low half is now the 2x2 sum for the first pixel
+				hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+				__m128i sum = _mm_srli_epi16(_mm_unpacklo_epi64(lo, hi), 2);
+				_mm_storel_epi64((__m128i *) d1, _mm_packus_epi16(sum, zero));
+				s1 += 16;
+				s2 += 16;
+				d1 += 8;
+			}
+			while(ctr--)
+			{
+				for(int c = 0; c < 4; ++c)
+					d1[c] = (s1[c] + s1[c+4] + s2[c] + s2[c+4]) >> 2;
+				s1 += 8;
+				s2 += 8;
+				d1 += 4;
+			}
+			s1 += rb;
+			s2 += rb;
+		}
+		return;
+	}
+#endif
+
 	int t1,t2,t3,t4;
 	while(y--)
 	{
@@ -1603,6 +1674,142 @@ static void copy_mip_with_filter(const ImageInfo& src, ImageInfo& dst,int level,
 	}
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------
+// sRGB MIP FILTER
+//------------------------------------------------------------------------------------------------------------------------------------
+/*
+	This is DDSTool's sRGB mip filter (color averaged in linear space, alpha averaged as is) without the five pow calls
+	per output sample.  Decoding a byte is a 256-entry table.  Encoding is a search: the byte we produce only changes at
+	255 places along the linear axis, so we find those once (by bisecting over float bit patterns with the very same
+	math the filter uses) and binary-search the average against them.  The output is bit-for-bit what the callback
+	version gives.
+
+	Big levels are cut into bands of rows and run on several threads; each output row only reads its own source rows.
+*/
+
+static inline float srgb_encode_f(float p)
+{
+	if(p <= 0.0031308f)
+		return 12.92f * p;
+	return 1.055f * pow(p,0.41666f) - 0.055f;
+}
+
+static inline float srgb_decode_f(float p)
+{
+	if(p <= 0.04045f)
+		return p / 12.92f;
+	else
+		return powf(p * (1.0/1.055f) + (0.055f/1.055f),2.4f);
+}
+
+static unsigned char srgb_encode_byte(float total)
+{
+	total = srgb_encode_f(total);
+	total *= 255.0f;
+	if(total <= 0.0f) return 0;
+	if (total >= 255.0f) return 255;
+	return round(total);
+}
+
+struct	srgb_tables_t {
+	float	decode[256];
+	float	encode[256];		// encode[k] is the smallest linear value that encodes to k or more; [0] is unused.
+
+	srgb_tables_t()
+	{
+		for(int i = 0; i < 256; ++i)
+			decode[i] = srgb_decode_f((float) i / 255.0f);
+
+		// Non-negative floats sort the same way as their bit patterns, so bisect on the bits.
+		float top = 2.0f;
+		uint32_t top_bits;
+		memcpy(&top_bits, &top, sizeof(top_bits));
+		for(int k = 1; k < 256; ++k)
+		{
+			uint32_t lo = 0, hi = top_bits;
+			while(lo < hi)
+			{
+				uint32_t mid = lo + (hi - lo) / 2;
+				float v;
+				memcpy(&v, &mid, sizeof(v));
+				if(srgb_encode_byte(v) >= k)	hi = mid;
+				else							lo = mid + 1;
+			}
+			memcpy(&encode[k], &lo, sizeof(float));
+		}
+	}
+
+	inline unsigned char	encode_byte(float v) const
+	{
+		int k = 0;
+		for(int step = 128; step > 0; step >>= 1)
+		if(k + step < 256 && v >= encode[k + step])
+			k += step;
+		return k;
+	}
+};
+
+// Built during static init, so the threads never race to fill it.
+static const srgb_tables_t	s_srgb;
+
+struct	srgb_mip_job_t {
+	const ImageInfo *	src;
+	const ImageInfo *	dst;
+	int					band;
+};
+
+static void	srgb_mip_rows(const ImageInfo& src, const ImageInfo& dst, int y0, int y1)
+{
+	int xr = src.width == dst.width ? 1 : 2;
+	int yr = src.height == dst.height ? 1 : 2;
+	int count = xr * yr;
+
+	int srb = src.width * src.channels + src.pad;
+	int drb = dst.width * dst.channels + dst.pad;
+
+	for(int y = y0; y < y1; ++y)
+	{
+		const unsigned char * r1 = src.data + (y * yr) * srb;
+		const unsigned char * r2 = r1 + (yr - 1) * srb;
+		unsigned char * d = dst.data + y * drb;
+		for(int x = 0; x < dst.width; ++x)
+		{
+			const unsigned char * p1 = r1 + x * xr * src.channels;
+			const unsigned char * p2 = r2 + x * xr * src.channels;
+			int o = (xr - 1) * src.channels;
+			for(int c = 0; c < src.channels; ++c)
+			{
+				if(c == 3)
+				{
+					int total = p1[c];
+					if(xr > 1)	total += p1[c+o];
+					if(yr > 1)	total += p2[c];
+					if(xr > 1 && yr > 1) total += p2[c+o];
+					*d++ = min(255, total / count);
+				}
+				else
+				{
+					// Same summation order as the callback filter, so the float rounding matches too.
+					float total = 0.f;
+					total += s_srgb.decode[p1[c]];
+					if(xr > 1)	total += s_srgb.decode[p1[c+o]];
+					if(yr > 1)	total += s_srgb.decode[p2[c]];
+					if(xr > 1 && yr > 1) total += s_srgb.decode[p2[c+o]];
+					total /= ((float) count);
+					*d++ = s_srgb.encode_byte(total);
+				}
+			}
+		}
+	}
+}
+
+static void	srgb_mip_band(int item, int worker, void * ref)
+{
+	srgb_mip_job_t * job = (srgb_mip_job_t *) ref;
+	int y0 = item * job->band;
+	srgb_mip_rows(*job->src, *job->dst, y0, min(y0 + job->band, (int) job->dst->height));
+}
+
 #if BIG
 	#if APL
 		#include <libkern/OSByteOrder.h>
@@ -1642,14 +1849,63 @@ static void swap_bgra_y(struct ImageInfo& i)
 
 }
 
+// Tag stamped into dwReserved1 by WriteBitmapToDDSEx: magic, then the low and high halves of the caller's tag.
+#define DDS_TAG_MAGIC	0x54444557		// "WEDT" in memory on little-endian machines.
+
 // Compressed DDS.
 int	WriteBitmapToDDS(struct ImageInfo& ioImage, int dxt, const char * file_name, int use_win_gamma)
+{
+	return WriteBitmapToDDSEx(ioImage, dxt, file_name, use_win_gamma, dxt_quality_best, 0, 0);
+}
+
+bool	ReadDDSTag(const char * file_name, unsigned long long * out_tag, int * out_width, int * out_height)
+{
+	FILE * fi = fopen(file_name,"rb");
+	if (fi == NULL) return false;
+	TEX_dds_desc header;
+	bool ok = fread(&header,sizeof(header),1,fi) == 1;
+	fclose(fi);
+
+	if(!ok || strncmp(header.dwMagic,"DDS ",4) != 0 || SWAP32(header.dwReserved1[0]) != DDS_TAG_MAGIC)
+		return false;
+
+	*out_tag = ((unsigned long long) SWAP32(header.dwReserved1[2]) << 32) | (unsigned long long) SWAP32(header.dwReserved1[1]);
+	*out_width = SWAP32(header.dwWidth);
+	*out_height = SWAP32(header.dwHeight);
+	return true;
+}
+
+// DXT blocks are 4x4 and stored a block-row at a time, so an image cut into bands of rows (multiples of 4) compresses
+// to exactly the bytes the whole image would, each band landing at its own offset.  So we hand bands to threads.
+#define DXT_BAND_ROWS 32
+
+struct	dxt_band_job_t {
+	const unsigned char *	src;
+	unsigned char *			dst;
+	int						width;
+	int						height;
+	int						flags;
+};
+
+static void	dxt_band(int item, int worker, void * ref)
+{
+	dxt_band_job_t * job = (dxt_band_job_t *) ref;
+	int y0 = item * DXT_BAND_ROWS;
+	int h = min(DXT_BAND_ROWS, job->height - y0);
+	squish::CompressImage(
+				job->src + y0 * job->width * 4, job->width, h,
+				job->dst + squish::GetStorageRequirements(job->width, y0, job->flags),
+				job->flags);
+}
+
+int	WriteBitmapToDDSEx(struct ImageInfo& ioImage, int dxt, const char * file_name, int use_win_gamma, int quality, unsigned long long tag, int max_workers)
 {
 	Assert(ioImage.channels == 4);//Your number of channels better equal 4 or else
 	FILE * fi = fopen(file_name,"wb");
 	if (fi == NULL) return -1;
 	vector<unsigned char>	src_v, dst_v;
 	int flags = (dxt == 1 ? squish::kDxt1 : (dxt == 3 ? squish::kDxt3 : squish::kDxt5));
+	int fit = (quality == dxt_quality_fast ? squish::kColourRangeFit : squish::kColourIterativeClusterFit);
 	dst_v.resize(squish::GetStorageRequirements(ioImage.width,ioImage.height,flags));
 	unsigned char * dst_mem = &*dst_v.begin();
 
@@ -1680,6 +1936,12 @@ int	WriteBitmapToDDS(struct ImageInfo& ioImage, int dxt, const char * file_name,
 	header.dwLinearSize=SWAP32(len);
 	header.dwDepth=0;
 	header.dwMipMapCount=SWAP32(mips);
+	if(tag)
+	{
+		header.dwReserved1[0]=SWAP32(DDS_TAG_MAGIC);
+		header.dwReserved1[1]=SWAP32((DWORD) (tag & 0xFFFFFFFF));
+		header.dwReserved1[2]=SWAP32((DWORD) (tag >> 32));
+	}
 	header.ddpfPixelFormat.dwSize=SWAP32(sizeof(header.ddpfPixelFormat));
 	header.ddpfPixelFormat.dwFlags=SWAP32(DDPF_FOURCC);
 	header.ddpfPixelFormat.dwFourCC[0]='D';
@@ -1698,7 +1960,8 @@ int	WriteBitmapToDDS(struct ImageInfo& ioImage, int dxt, const char * file_name,
 		// Get the image into RGBA upper left origin, that's what Squish/DXT/DDS wants.
 		swap_bgra_y(img);
 
-		squish::CompressImage(img.data, img.width, img.height, dst_mem, flags|squish::kColourIterativeClusterFit);
+		dxt_band_job_t job = { img.data, dst_mem, (int) img.width, (int) img.height, flags|fit };
+		THREAD_ParallelFor((img.height + DXT_BAND_ROWS - 1) / DXT_BAND_ROWS, dxt_band, &job, max_workers);
 		len = squish::GetStorageRequirements(img.width,img.height,flags);
 		fwrite(dst_mem,len,1,fi);
 
@@ -1792,15 +2055,15 @@ int	WriteUncompressedToDDS(struct ImageInfo& ioImage, const char * file_name, in
 	// close file
 }
 
-int		CreateBitmapFromDDS(const char * inFilePath, struct ImageInfo * outImageInfo)
-{
-	FILE * fi = fopen(inFilePath, "rb");
-	unsigned char * raw = NULL;
-	outImageInfo->data = NULL;
+//------------------------------------------------------------------------------------------------------------------------------------
+// DDS READING
+//------------------------------------------------------------------------------------------------------------------------------------
 
-	if(fi==NULL) return -1;
-	TEX_dds_desc header = { 0 };
-	if (fread(&header, 1, sizeof(header), fi) != sizeof(header)) goto bail;
+// Copies the DDS header out of memory with its fields in native endian.  Returns false if this isn't a DDS at all.
+static bool	read_dds_header(const void * inBytes, int inLength, TEX_dds_desc& header)
+{
+	if(inLength < (int) sizeof(header)) return false;
+	memcpy(&header, inBytes, sizeof(header));
 
 	header.dwSize = SWAP32(header.dwSize);
 	header.dwFlags = SWAP32(header.dwFlags);
@@ -1816,71 +2079,220 @@ int		CreateBitmapFromDDS(const char * inFilePath, struct ImageInfo * outImageInf
 	header.ddpfPixelFormat.dwBBitMask=SWAP32(header.ddpfPixelFormat.dwBBitMask);
 	header.ddpfPixelFormat.dwRGBAlphaBitMask=SWAP32(header.ddpfPixelFormat.dwRGBAlphaBitMask);
 
-	if (header.dwMagic[0] != 'D' ||
-		header.dwMagic[1] != 'D' ||
-		header.dwMagic[2] != 'S' ||
-		header.dwMagic[3] != ' ') goto bail;
+	return strncmp(header.dwMagic, "DDS ", 4) == 0 && header.dwWidth > 0 && header.dwHeight > 0;
+}
 
+static int	dxt_to_squish(int dxt)
+{
+	return dxt == 1 ? squish::kDxt1 : (dxt == 3 ? squish::kDxt3 : squish::kDxt5);
+}
 
-	if(header.ddpfPixelFormat.dwFlags & DDPF_RGB)
+// DDS files are stored top row first; our bitmaps are bottom row first.  A DXT image can be flipped without decoding
+// it: reverse the order of the rows of blocks, then the order of the pixel rows inside each block.  That only works
+// when every block row is full - a 1 or 2 pixel tall mip is fine (it is part of ONE block row), but a 6 pixel tall one
+// would need pixels to move between blocks.
+static bool	dxt_can_flip(int height)
+{
+	return height <= 2 || (height % 4) == 0;
+}
+
+static void	flip_dxt_block(unsigned char * b, int dxt, int rows)
+{
+	// Color indices are the last 4 bytes of the color half (the whole block for DXT1), one byte per row.
+	unsigned char * c = (dxt == 1 ? b : b + 8) + 4;
+	if(rows == 4)	{ swap(c[0],c[3]); swap(c[1],c[2]); }
+	else			{ swap(c[0],c[1]); }
+
+	if(dxt == 3)
 	{
-		outImageInfo->channels = (header.ddpfPixelFormat.dwFlags & DDPF_ALPHAPIXELS) ? 4 : 3;
-		outImageInfo->width = header.dwWidth;
-		outImageInfo->height = header.dwHeight;
-		outImageInfo->pad = (header.dwLinearSize == 0) ? 0 : (header.dwLinearSize - outImageInfo->width * outImageInfo->channels);
-		int im_len = (outImageInfo->width * outImageInfo->channels + outImageInfo->pad) * outImageInfo->height;
-		outImageInfo->data = (unsigned char *) malloc(im_len);
-		if(outImageInfo->data==NULL) goto bail;
+		// Explicit alpha: 4 bits per pixel, so 2 bytes per row.
+		if(rows == 4)	{ swap(b[0],b[6]); swap(b[1],b[7]); swap(b[2],b[4]); swap(b[3],b[5]); }
+		else			{ swap(b[0],b[2]); swap(b[1],b[3]); }
+	}
+	else if(dxt == 5)
+	{
+		// Interpolated alpha: two end points, then 48 bits of 3-bit indices, little-endian, 12 bits per row.
+		unsigned long long bits = 0;
+		for(int i = 0; i < 6; ++i)
+			bits |= (unsigned long long) b[2+i] << (8*i);
+		unsigned long long flipped = bits & ~((1ULL << (12 * rows)) - 1);
+		for(int r = 0; r < rows; ++r)
+			flipped |= ((bits >> (12 * r)) & 0xFFF) << (12 * (rows - 1 - r));
+		for(int i = 0; i < 6; ++i)
+			b[2+i] = (unsigned char) (flipped >> (8*i));
+	}
+}
 
-		if(fread(outImageInfo->data, 1, im_len, fi) != im_len) goto bail;
-		FlipImageY(*outImageInfo);
+static void	flip_dxt_mip(unsigned char * data, int width, int height, int dxt)
+{
+	int bs = dxt == 1 ? 8 : 16;
+	int bw = (width + 3) / 4;
+	int bh = (height + 3) / 4;
+	int rb = bw * bs;
+	for(int y = 0; y < bh / 2; ++y)
+		swap_ranges(data + y * rb, data + (y+1) * rb, data + (bh - 1 - y) * rb);
+
+	int rows = min(height, 4);
+	if(rows > 1)
+	for(int n = 0; n < bw * bh; ++n)
+		flip_dxt_block(data + n * bs, dxt, rows);
+}
 
-		fclose(fi);
-		return 0;
+// Pulls the DXT mips out of a DDS in memory: mips bigger than max_dim are skipped (but never the last one), and at most
+// max_mips are kept (0 for all of them).  If flip is set, the mips are flipped to lower-left origin; the chain stops at
+// the first mip we can't flip, and if that is the first one, we fail.
+static int	read_dxt_mips(const void * inBytes, int inLength, int max_dim, int max_mips, bool flip, struct DXTImageInfo * outInfo)
+{
+	outInfo->data = NULL;
+
+	TEX_dds_desc header;
+	if(!read_dds_header(inBytes, inLength, header)) return -1;
+	if((header.ddpfPixelFormat.dwFlags & DDPF_FOURCC) == 0) return -1;
+	if(header.ddpfPixelFormat.dwFourCC[0] != 'D' || header.ddpfPixelFormat.dwFourCC[1] != 'X' || header.ddpfPixelFormat.dwFourCC[2] != 'T') return -1;
+
+	int dxt;
+	switch(header.ddpfPixelFormat.dwFourCC[3]) {
+	case '1':		dxt = 1;	break;
+	case '3':		dxt = 3;	break;
+	case '5':		dxt = 5;	break;
+	default: return -1;
 	}
-	else if (header.ddpfPixelFormat.dwFlags & DDPF_FOURCC)
+	int sflags = dxt_to_squish(dxt);
+
+	int mips = ((header.dwFlags & DDSD_MIPMAPCOUNT) && header.dwMipMapCount > 1) ? header.dwMipMapCount : 1;
+	int x = header.dwWidth;
+	int y = header.dwHeight;
+	int offset = sizeof(header);
+
+	while(mips > 1 && max_dim > 0 && (x > max_dim || y > max_dim))
 	{
-		int sflags;
-		if(header.ddpfPixelFormat.dwFourCC[0] != 'D' || header.ddpfPixelFormat.dwFourCC[1] != 'X' || header.ddpfPixelFormat.dwFourCC[2] != 'T') goto bail;
-		switch(header.ddpfPixelFormat.dwFourCC[3]) {
-		case '1':		sflags = squish::kDxt1;	break;
-		case '3':		sflags = squish::kDxt3;	break;
-		case '5':		sflags = squish::kDxt5;	break;
-		default: goto bail;
+		offset += squish::GetStorageRequirements(x, y, sflags);
+		x = max(x / 2, 1);
+		y = max(y / 2, 1);
+		--mips;
+	}
+
+	int kept = 0;
+	int len = 0;
+	int kx = x, ky = y;
+	while(kept < mips && (max_mips == 0 || kept < max_mips) && (!flip || dxt_can_flip(ky)))
+	{
+		int l = squish::GetStorageRequirements(kx, ky, sflags);
+		if(offset + len + l > inLength) break;
+		len += l;
+		++kept;
+		kx = max(kx / 2, 1);
+		ky = max(ky / 2, 1);
+	}
+	if(kept == 0) return -1;
+
+	outInfo->data = (unsigned char *) malloc(len);
+	if(outInfo->data == NULL) return ENOMEM;
+	memcpy(outInfo->data, (const unsigned char *) inBytes + offset, len);
+
+	outInfo->length = len;
+	outInfo->dxt = dxt;
+	outInfo->width = x;
+	outInfo->height = y;
+	outInfo->mips = kept;
+	outInfo->org_width = header.dwWidth;
+	outInfo->org_height = header.dwHeight;
+
+	if(flip)
+	{
+		unsigned char * p = outInfo->data;
+		for(int m = 0; m < kept; ++m)
+		{
+			flip_dxt_mip(p, x, y, dxt);
+			p += squish::GetStorageRequirements(x, y, sflags);
+			x = max(x / 2, 1);
+			y = max(y / 2, 1);
 		}
-		outImageInfo->channels = 4;
+	}
+	return 0;
+}
+
+int		CreateDXTFromDDSData(const void * inBytes, int inLength, int max_dim, struct DXTImageInfo * outInfo)
+{
+	return read_dxt_mips(inBytes, inLength, max_dim, 0, true, outInfo);
+}
+
+int		CreateBitmapFromDXT(const struct DXTImageInfo& inInfo, struct ImageInfo * outImageInfo)
+{
+	if(CreateNewBitmap(inInfo.width, inInfo.height, 4, outImageInfo) != 0)
+		return -1;
+	squish::DecompressImage(outImageInfo->data, inInfo.width, inInfo.height, inInfo.data, dxt_to_squish(inInfo.dxt));
+	int count = inInfo.width * inInfo.height;
+	unsigned char * p = outImageInfo->data;
+	while(count--)
+	{
+		swap(p[0],p[2]);
+		p += 4;
+	}
+	return 0;
+}
+
+void	DestroyDXT(struct DXTImageInfo * ioInfo)
+{
+	if(ioInfo->data) free(ioInfo->data);
+	ioInfo->data = NULL;
+}
+
+int		CreateBitmapFromDDSData(const void * inBytes, int inLength, int max_dim, struct ImageInfo * outImageInfo)
+{
+	outImageInfo->data = NULL;
+
+	TEX_dds_desc header;
+	if(!read_dds_header(inBytes, inLength, header)) return -1;
+
+	if(header.ddpfPixelFormat.dwFlags & DDPF_RGB)
+	{
+		outImageInfo->channels = (header.ddpfPixelFormat.dwFlags & DDPF_ALPHAPIXELS) ? 4 : 3;
 		outImageInfo->width = header.dwWidth;
 		outImageInfo->height = header.dwHeight;
-		outImageInfo->pad = 0;
+		outImageInfo->pad = (header.dwLinearSize == 0) ? 0 : (header.dwLinearSize - outImageInfo->width * outImageInfo->channels);
 		int im_len = (outImageInfo->width * outImageInfo->channels + outImageInfo->pad) * outImageInfo->height;
+		if(im_len > inLength - (int) sizeof(header)) return -1;
 		outImageInfo->data = (unsigned char *) malloc(im_len);
-		if(outImageInfo->data==NULL) goto bail;
-		int im_raw = squish::GetStorageRequirements(header.dwWidth,header.dwHeight, sflags);
-
-		raw = (unsigned char *) malloc(im_raw);
-		if(raw==NULL) goto bail;
-		if(fread(raw, 1, im_raw, fi) != im_raw) goto bail;
-		squish::DecompressImage( outImageInfo->data, header.dwWidth, header.dwHeight, raw, sflags);
-		int count = header.dwWidth * header.dwHeight;
-		unsigned char * p = outImageInfo->data;
-		while(count--)
-		{
-			swap(p[0],p[2]);
-			p += 4;
-		}
+		if(outImageInfo->data==NULL) return -1;
+
+		memcpy(outImageInfo->data, (const unsigned char *) inBytes + sizeof(header), im_len);
 		FlipImageY(*outImageInfo);
-		free(raw);
-		fclose(fi);
 		return 0;
 	}
 
+	// Decode the mip as stored and flip the pixels - that works for any height, unlike flipping the blocks.
+	DXTImageInfo	dxt;
+	if(read_dxt_mips(inBytes, inLength, max_dim, 1, false, &dxt) != 0)
+		return -1;
+	int result = CreateBitmapFromDXT(dxt, outImageInfo);
+	DestroyDXT(&dxt);
+	if(result == 0)
+		FlipImageY(*outImageInfo);
+	return result;
+}
 
-bail:
-	if (fi) fclose(fi);
-	if (outImageInfo->data) free(outImageInfo->data);
-	outImageInfo->data = 0;
-	if(raw) free(raw);
-	return -1;
+int		CreateBitmapFromDDS(const char * inFilePath, struct ImageInfo * outImageInfo)
+{
+	outImageInfo->data = NULL;
+
+	FILE * fi = fopen(inFilePath, "rb");
+	if(fi==NULL) return -1;
+
+	vector<unsigned char>	raw;
+	fseek(fi, 0, SEEK_END);
+	long len = ftell(fi);
+	fseek(fi, 0, SEEK_SET);
+	if(len > 0)
+	{
+		raw.resize(len);
+		if(fread(&raw[0], 1, len, fi) != len)
+			raw.clear();
+	}
+	fclose(fi);
+
+	if(raw.empty()) return -1;
+	return CreateBitmapFromDDSData(&raw[0], raw.size(), 0, outImageInfo);
 }
 
 inline void swap_mem(unsigned char * p1, unsigned char * p2, int len)
@@ -2042,6 +2454,50 @@ int MakeMipmapStackWithFilter(struct ImageInfo * ioImage, unsigned char (* filte
 	return mips;
 }
 
+int MakeMipmapStackSRGB(struct ImageInfo * ioImage, int max_workers)
+{
+	int storage = 0;
+	int mips = 0;
+	int x = ioImage->width;
+	int y = ioImage->height;
+	do {
+		storage += (x * y * ioImage->channels);
+		++mips;
+		if(x == 1 && y == 1) break;
+		if (x > 1) x >>= 1;
+		if (y > 1) y >>= 1;
+	} while (1);
+
+	unsigned char * base = (unsigned char *) malloc(storage);
+
+	ImageInfo ni;
+	ni.width = ioImage->width;
+	ni.height = ioImage->height;
+	ni.pad = 0;
+	ni.channels = ioImage->channels;
+	ni.data = base;
+
+	CopyBitmapSectionDirect(*ioImage, ni, 0, 0, 0, 0, ni.width, ni.height);
+
+	while(ni.width > 1 || ni.height > 1)
+	{
+		ImageInfo sd(ni);
+		sd.data += (ni.channels * ni.width * ni.height);
+		if(sd.width > 1) sd.width >>= 1;
+		if(sd.height > 1) sd.height >>= 1;
+
+		// Bands of ~64k output pixels - below that a thread isn't worth starting.
+		srgb_mip_job_t job = { &ni, &sd, max(1, 65536 / (int) sd.width) };
+		THREAD_ParallelFor((sd.height + job.band - 1) / job.band, srgb_mip_band, &job, max_workers);
+		ni=sd;
+	}
+
+	free(ioImage->data);
+	ioImage->data = base;
+
+	return mips;
+}
+
 int AdvanceMipmapStack(struct ImageInfo * ioImage)
 {
 	if(ioImage->width == 1 && ioImage->height == 1) return 0;
@@ -78,6 +78,33 @@ int		CreateBitmapFromPNGData(const void * inBytes, int inLength, struct ImageInf
 /* Create a 4-channel image from a DDS file. */
 int		CreateBitmapFromDDS(const char * inFilePath, struct ImageInfo * outImageInfo);
 
+/* Same, for a DDS file in memory.  For DXT files, the first mip that is no bigger than max_dim on either axis is
+ * decoded instead of the top one; pass 0 for the top mip.  Uncompressed DDS files always give the top mip. */
+int		CreateBitmapFromDDSData(const void * inBytes, int inLength, int max_dim, struct ImageInfo * outImageInfo);
+
+/* The DXT blocks of a DDS file, as they would go to the card.  The mips are back to back, biggest first, and have been
+ * flipped to our lower-left origin - so they match what CreateBitmapFromDDS gives us. */
+struct	DXTImageInfo {
+	unsigned char *	data;
+	int				length;			// Bytes of data, all mips
+	int				dxt;			// 1, 3 or 5
+	int				width;			// Size of the first mip in data
+	int				height;
+	int				mips;
+	int				org_width;		// Size of the top mip in the file, which we may have skipped
+	int				org_height;
+};
+
+/* Copies the DXT mips out of a DDS file in memory, skipping the ones bigger than max_dim (0 keeps them all; the last
+ * mip is always kept).  Returns -1 if the file is not a DXT1/3/5 DDS or if its mips can't be flipped - in that case
+ * decode it with CreateBitmapFromDDSData. */
+int		CreateDXTFromDDSData(const void * inBytes, int inLength, int max_dim, struct DXTImageInfo * outInfo);
+
+/* Decompresses the first mip of a DXTImageInfo into a 4-channel BGRA bitmap. */
+int		CreateBitmapFromDXT(const struct DXTImageInfo& inInfo, struct ImageInfo * outImageInfo);
+
+void	DestroyDXT(struct DXTImageInfo * ioInfo);
+
 #if USE_JPEG
 
 /* Create a JPEG image from either a file on disk or a chunk of memory.  This requires the IJG reference
@@ -119,6 +146,23 @@ int		WriteBitmapToPNG(const struct ImageInfo * inImage, const char * inFilePath,
  * pass the data DIRECTLY to OpenGL. */
 int	WriteBitmapToDDS(struct ImageInfo& ioImage, int dxt, const char * file_name, int use_win_gamma);
 
+/* DXT encoder effort for WriteBitmapToDDSEx.  Best is squish's iterative cluster fit, which is what WriteBitmapToDDS
+ * always uses.  Fast is squish's range fit - many times faster, a little noisier on smooth gradients. */
+enum {
+	dxt_quality_best,
+	dxt_quality_fast
+};
+
+/* Same as WriteBitmapToDDS, plus a choice of encoder and a 64-bit tag that is stored in the reserved part of the
+ * DDS header (0 for none).  Use the tag to remember what the DDS was made from - see ReadDDSTag.  Large mips are
+ * compressed on up to max_workers threads (0 means one per core, which is what WriteBitmapToDDS does); pass 1 if
+ * you are already running one conversion per core. */
+int	WriteBitmapToDDSEx(struct ImageInfo& ioImage, int dxt, const char * file_name, int use_win_gamma, int quality, unsigned long long tag, int max_workers);
+
+/* Reads back the tag written by WriteBitmapToDDSEx and the size of the top mip.  Only the header is read.  Returns
+ * false if the file is missing, isn't a DDS or has no tag. */
+bool	ReadDDSTag(const char * file_name, unsigned long long * out_tag, int * out_width, int * out_height);
+
 /* This routine writes a 3 or 4 channel bitmap as a mip-mapped DXT1 or DXT3 image. */
 int	WriteUncompressedToDDS(struct ImageInfo& ioImage, const char * file_name, int use_win_gamma);
 
@@ -131,6 +175,9 @@ void	DestroyBitmap(const struct ImageInfo * inImageInfo);
 //supported image code (see the enum SupportedTypes
 int GetSupportedType(const char * path);
 
+//Same, but goes by the first few bytes of the file (the magic number) instead of the extension.  16 bytes is plenty.
+int GetSupportedTypeFromData(const void * inBytes, int inLength);
+
 //Attempts to make a supported image type using GetSupportedType and the various CreateBitmapFromX utils
 //Error codes are passed back up and returned by the method
 int MakeSupportedType(const char * path, ImageInfo * inImage);
@@ -217,6 +264,11 @@ int MakeMipmapStackFromImage(struct ImageInfo * ioImage);
 /* Make a mip-map stack with a custom filter. */
 int MakeMipmapStackWithFilter(struct ImageInfo * ioImage, unsigned char (* filter)(unsigned char src[], int count, int channel, int level));
 
+/* Make a mip-map stack averaging color in linear space (the image is sRGB) and alpha as is.  Gives exactly what
+ * MakeMipmapStackWithFilter does with DDSTool's sRGB filter, many times faster; big levels are split across up to
+ * max_workers threads (0 means one per core). */
+int MakeMipmapStackSRGB(struct ImageInfo * ioImage, int max_workers);
+
 
 
 /* This routine "advances" the ptr and sizes in the image to go to the next
@@ -27,6 +27,7 @@
 #include "AssertUtils.h"
 #include "STLUtils.h"
 #include "XESConstants.h"
+#include "MathUtils.h"
 #if DEV
 #  include <stdio.h>
 #endif
@@ -1345,4 +1346,101 @@ Point2	CoordTranslator2::Reverse(const Point2& input) const
 				  mSrcMin.y() + (input.y() - mDstMin.y()) * (mSrcMax.y() - mSrcMin.y()) / (mDstMax.y() - mDstMin.y()));
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------
+// BOX PAIRS
+//------------------------------------------------------------------------------------------------------------------------------------
 
+struct	box_grid_t {
+	Point2	origin;
+	double	cell;
+	int		dim_x;
+	int		dim_y;
+
+	int		cell_x(double x) const { return intlim((x - origin.x()) / cell, 0, dim_x - 1); }
+	int		cell_y(double y) const { return intlim((y - origin.y()) / cell, 0, dim_y - 1); }
+};
+
+void	FindOverlappingBoxes(
+				const vector<Bbox2>&		inBoxes,
+				vector<pair<int,int> >&		outPairs)
+{
+	outPairs.clear();
+	int n = inBoxes.size();
+	if(n < 2)
+		return;
+
+	Bbox2	all;
+	double	span_sum = 0.0;
+	int		live = 0;
+	for(int i = 0; i < n; ++i)
+	if(!inBoxes[i].is_null())
+	{
+		all += inBoxes[i];
+		span_sum += max(inBoxes[i].xspan(), inBoxes[i].yspan());
+		++live;
+	}
+	if(live < 2)
+		return;
+
+	// Cells about the size of an average box, so a box covers a few cells and a cell holds a few boxes.  But never
+	// more cells than about 3x the boxes, or a few tiny boxes spread far apart would give us a huge empty grid.
+	box_grid_t	grid;
+	grid.origin = all.p1;
+	grid.cell = span_sum / live;
+	grid.cell = max(grid.cell, sqrt(all.area() / live));
+	grid.cell = max(grid.cell, max(all.xspan(), all.yspan()) / live);
+	if(grid.cell <= 0.0)
+		grid.cell = 1.0;			// Every box is the same single point.
+	grid.dim_x = intlim(all.xspan() / grid.cell, 0, live) + 1;
+	grid.dim_y = intlim(all.yspan() / grid.cell, 0, live) + 1;
+
+	// Bucket the box indices by cell, counting-sort style: count, prefix-sum, fill.  Indices within a cell end up
+	// in ascending order.
+	int	cells = grid.dim_x * grid.dim_y;
+	vector<int>	cell_start(cells + 1, 0);
+	for(int i = 0; i < n; ++i)
+	if(!inBoxes[i].is_null())
+	{
+		int x1 = grid.cell_x(inBoxes[i].xmin()), x2 = grid.cell_x(inBoxes[i].xmax());
+		int y1 = grid.cell_y(inBoxes[i].ymin()), y2 = grid.cell_y(inBoxes[i].ymax());
+		for(int y = y1; y <= y2; ++y)
+		for(int x = x1; x <= x2; ++x)
+			++cell_start[y * grid.dim_x + x + 1];
+	}
+	for(int c = 0; c < cells; ++c)
+		cell_start[c+1] += cell_start[c];
+
+	vector<int>	cell_items(cell_start[cells]);
+	vector<int>	fill(cell_start.begin(), cell_start.end() - 1);
+	for(int i = 0; i < n; ++i)
+	if(!inBoxes[i].is_null())
+	{
+		int x1 = grid.cell_x(inBoxes[i].xmin()), x2 = grid.cell_x(inBoxes[i].xmax());
+		int y1 = grid.cell_y(inBoxes[i].ymin()), y2 = grid.cell_y(inBoxes[i].ymax());
+		for(int y = y1; y <= y2; ++y)
+		for(int x = x1; x <= x2; ++x)
+			cell_items[fill[y * grid.dim_x + x]++] = i;
+	}
+
+	// Two overlapping boxes can share many cells.  Report the pair only from the cell holding the low corner of
+	// their intersection - both boxes always cover that cell, so each pair is found exactly once.
+	for(int c = 0; c < cells; ++c)
+	{
+		int cx = c % grid.dim_x;
+		int cy = c / grid.dim_x;
+		for(int a = cell_start[c]; a < cell_start[c+1]; ++a)
+		for(int b = a + 1; b < cell_start[c+1]; ++b)
+		{
+			const Bbox2& ba(inBoxes[cell_items[a]]);
+			const Bbox2& bb(inBoxes[cell_items[b]]);
+			if(!ba.overlap(bb))
+				continue;
+			if(grid.cell_x(max(ba.xmin(), bb.xmin())) != cx ||
+			   grid.cell_y(max(ba.ymin(), bb.ymin())) != cy)
+				continue;
+			outPairs.push_back(pair<int,int>(cell_items[a], cell_items[b]));
+		}
+	}
+
+	sort(outPairs.begin(), outPairs.end());
+}
@@ -304,6 +304,25 @@ void	SmoothPolygon(Polygon2& ioPolygon, double smooth_radius, double max_turn_de
 void	MakePolygonConvex(Polygon2& ioPolygon);
 #endif
 
+/*
+ * FindOverlappingBoxes
+ *
+ * Given a set of bounding boxes, find every pair that overlaps (touching
+ * counts, null boxes never overlap).  This is the broad phase for the
+ * "compare everything with everything" checks: expand each item's box by
+ * the tolerance of the test, get the candidate pairs here, and run the
+ * exact test only on those.
+ *
+ * The boxes are binned into a uniform grid sized to the average box, so
+ * for the usual case of many small items this is about linear rather than
+ * quadratic.  Pairs come back as (i,j) with i < j, sorted - so walking them
+ * visits pairs in the same order a nested i/j loop would.
+ *
+ */
+void	FindOverlappingBoxes(
+				const vector<Bbox2>&		inBoxes,
+				vector<pair<int,int> >&		outPairs);
+
 
 
 #endif
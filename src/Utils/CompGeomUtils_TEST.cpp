@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+
+#include "CompGeomUtils.h"
+#include "AssertUtils.h"
+
+// These check FindOverlappingBoxes against the nested i/j loops it replaced in the WED validation and selection
+// passes, on the kinds of input those passes see: lots of short taxi route edges on a jittered grid, a few long
+// ones crossing the field, stacked duplicate nodes, and the degenerate cases.  The passes themselves are run on
+// real taxi routes in WED_GroupCommands_TEST.cpp.
+
+static unsigned int	sSeed = 1;
+
+static double	test_rand(double lo, double hi)
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return lo + (hi - lo) * (double) ((sSeed >> 8) & 0xFFFFFF) / (double) 0xFFFFFF;
+}
+
+static void	brute_force_pairs(const vector<Bbox2>& boxes, vector<pair<int,int> >& pairs)
+{
+	pairs.clear();
+	for(int i = 0; i < boxes.size(); ++i)
+	for(int j = i + 1; j < boxes.size(); ++j)
+	if(!boxes[i].is_null() && !boxes[j].is_null() && boxes[i].overlap(boxes[j]))
+		pairs.push_back(pair<int,int>(i,j));
+}
+
+static void	TEST_SamePairs(const vector<Bbox2>& boxes)
+{
+	vector<pair<int,int> >	grid, brute;
+	FindOverlappingBoxes(boxes, grid);
+	brute_force_pairs(boxes, brute);
+	TEST_Run(grid == brute);
+}
+
+// Taxi-route-like edges: short segments between jittered grid nodes, plus a few long ones across the whole field.
+static void	make_route_edges(int dim, int long_edges, vector<Segment2>& edges)
+{
+	edges.clear();
+	vector<Point2>	nodes;
+	for(int y = 0; y < dim; ++y)
+	for(int x = 0; x < dim; ++x)
+		nodes.push_back(Point2(x + test_rand(-0.3, 0.3), y + test_rand(-0.3, 0.3)));
+	for(int y = 0; y < dim; ++y)
+	for(int x = 0; x < dim; ++x)
+	{
+		if(x + 1 < dim)	edges.push_back(Segment2(nodes[y * dim + x], nodes[y * dim + x + 1]));
+		if(y + 1 < dim)	edges.push_back(Segment2(nodes[y * dim + x], nodes[(y + 1) * dim + x]));
+		if(x + 1 < dim && y + 1 < dim && test_rand(0,1) < 0.2)
+			edges.push_back(Segment2(nodes[y * dim + x + 1], nodes[(y + 1) * dim + x]));
+	}
+	for(int n = 0; n < long_edges; ++n)
+		edges.push_back(Segment2(Point2(test_rand(0, dim), test_rand(0, dim)), Point2(test_rand(0, dim), test_rand(0, dim))));
+}
+
+static void	TEST_BoxPairs(void)
+{
+	vector<Bbox2>	boxes;
+
+	// Nothing, one box, only null boxes - no pairs.
+	TEST_SamePairs(boxes);
+	boxes.push_back(Bbox2(0,0,1,1));
+	TEST_SamePairs(boxes);
+	boxes.assign(5, Bbox2());
+	TEST_SamePairs(boxes);
+
+	// Every box the same point: every pair overlaps.
+	boxes.assign(40, Bbox2(Point2(3,4)));
+	TEST_SamePairs(boxes);
+
+	// Touching counts as overlapping, right on the cell boundaries too.
+	boxes.clear();
+	for(int i = 0; i < 50; ++i)
+		boxes.push_back(Bbox2(i, 0, i + 1, 1));
+	TEST_SamePairs(boxes);
+
+	// Random boxes of mixed sizes, some nulls mixed in.
+	for(int t = 0; t < 20; ++t)
+	{
+		boxes.clear();
+		int n = (int) test_rand(2, 400);
+		double big = test_rand(0.01, 50);
+		for(int i = 0; i < n; ++i)
+		{
+			if(test_rand(0,1) < 0.05)
+				boxes.push_back(Bbox2());
+			else
+			{
+				Point2	p(test_rand(0, 100), test_rand(0, 100));
+				boxes.push_back(Bbox2(p, p + Vector2(test_rand(0, big), test_rand(0, big))));
+			}
+		}
+		TEST_SamePairs(boxes);
+	}
+
+	// A few tiny boxes very far apart - the grid must not blow up.
+	boxes.clear();
+	for(int i = 0; i < 10; ++i)
+		boxes.push_back(Bbox2(Point2(i * 1.0e6, -i * 1.0e6)));
+	boxes.push_back(boxes.back());
+	TEST_SamePairs(boxes);
+
+	vector<Segment2>	edges;
+	make_route_edges(40, 30, edges);
+	boxes.clear();
+	for(int i = 0; i < edges.size(); ++i)
+		boxes.push_back(Bbox2(edges[i].p1, edges[i].p2));
+	TEST_SamePairs(boxes);
+}
+
+void	TEST_CompGeomUtils(void)
+{
+	TEST_BoxPairs();
+}
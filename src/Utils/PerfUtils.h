@@ -40,12 +40,18 @@ struct StProfileInit {
 #endif
 
 
+#include "TraceUtils.h"
+
 #if APL
 #include <mach/mach_time.h>
+#include <mach/mach.h>
 #elif LIN
 #include <time.h>
+#include <stdio.h>
+#include <unistd.h>
 #elif IBM
 	// XDEFs should have gotten windows.
+#include <psapi.h>
 #else
 	#error platform not defined
 #endif
@@ -96,7 +102,31 @@ inline double hpc_to_microseconds(unsigned long long in_hpc_delta)
 	#endif
 }
 
-
+// Bytes of RAM the process is actually holding right now (resident set / working set), or 0 if the OS won't say.
+// Note that freed memory often stays with the allocator, so this falls by less than what was released.
+inline unsigned long long query_resident_bytes()
+{
+	#if APL
+		mach_task_basic_info_data_t	info;
+		mach_msg_type_number_t		count = MACH_TASK_BASIC_INFO_COUNT;
+		if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS) return 0;
+		return info.resident_size;
+	#elif IBM
+		PROCESS_MEMORY_COUNTERS	info;
+		if(!GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info))) return 0;
+		return info.WorkingSetSize;
+	#elif LIN
+		FILE * fi = fopen("/proc/self/statm", "r");
+		if(!fi) return 0;
+		unsigned long long total = 0, resident = 0;
+		int got = fscanf(fi, "%llu %llu", &total, &resident);
+		fclose(fi);
+		if(got != 2) return 0;
+		return resident * (unsigned long long) sysconf(_SC_PAGESIZE);
+	#else
+		#error not implemented
+	#endif
+}
 
 
 
@@ -142,16 +172,22 @@ public:
 
 };
 
+// Prints how long the scope took, and is a TRACE_Zone too, so every timed scope shows up in the trace.  Pass
+// inPrint = false to only trace.  Like a zone, the name is not copied.
 class	StElapsedTime {
+	TRACE_Zone			mZone;
 	unsigned long long 	mStartTime;
 	const char *		mName;
+	bool				mPrint;
 public:
-	StElapsedTime(const char * inName): mName(inName)
+	StElapsedTime(const char * inName, bool inPrint = true): mZone(inName), mName(inName), mPrint(inPrint)
 	{
 		mStartTime = query_hpc();
 	}
 	~StElapsedTime()
 	{
+		if (!mPrint)
+			return;
 		unsigned long long stopTime = query_hpc();
 		unsigned long long delta = stopTime - mStartTime;
 		printf("%s - %lf seconds.\n", mName, hpc_to_microseconds(delta) / 1000000.0);
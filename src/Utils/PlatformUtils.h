@@ -115,5 +115,13 @@ enum {
  */
 int DoSaveDiscardDialog(const char * inMessage1, const char * inMessage2);
 
+/*
+ * SetUserAlertHandler takes the three dialogs above off the screen, for running with no GUI at all.  Every
+ * message goes to the handler instead; ConfirmMessage then answers cancel and DoSaveDiscardDialog answers
+ * close_Cancel, so nothing unattended ever takes the destructive choice.  Pass NULL to get the dialogs back.
+ */
+typedef void (* UserAlert_f)(const char * inMsg, void * inRef);
+void	SetUserAlertHandler(UserAlert_f inHandler, void * inRef);
+
 
 #endif
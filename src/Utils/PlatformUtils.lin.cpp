@@ -175,8 +175,18 @@ char *	GetMultiFilePathFromUser(
 	return ret;
 }
 
+static UserAlert_f	sAlertHandler = NULL;
+static void *		sAlertRef = NULL;
+
+void	SetUserAlertHandler(UserAlert_f inHandler, void * inRef)
+{
+	sAlertHandler = inHandler;
+	sAlertRef = inRef;
+}
+
 void	DoUserAlert(const char * inMsg)
 {
+	if(sAlertHandler) { sAlertHandler(inMsg, sAlertRef); return; }
 	QMessageBox::warning(0, "", QString::fromUtf8(inMsg));
 }
 
@@ -188,11 +198,13 @@ void	ShowProgressMessage(const char * inMsg, float * inProgress)
 
 int		ConfirmMessage(const char * inMsg, const char * proceedBtn, const char * cancelBtn)
 {
+	if(sAlertHandler) { sAlertHandler(inMsg, sAlertRef); return 0; }
 	return (QMessageBox::question(0,"", QString::fromUtf8(inMsg), proceedBtn, cancelBtn) == 0 ) ;
 }
 
 int DoSaveDiscardDialog(const char * inMessage1, const char * inMessage2)
 {
+	if(sAlertHandler) { sAlertHandler(inMessage2, sAlertRef); return close_Cancel; }
 	int res = QMessageBox::question(0, QString::fromUtf8(inMessage1), QString::fromUtf8(inMessage2),
 	QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel,
 	QMessageBox::Cancel);
@@ -158,8 +158,18 @@ char *	GetMultiFilePathFromUser(
 
 
 
+static UserAlert_f	sAlertHandler = NULL;
+static void *		sAlertRef = NULL;
+
+void	SetUserAlertHandler(UserAlert_f inHandler, void * inRef)
+{
+	sAlertHandler = inHandler;
+	sAlertRef = inRef;
+}
+
 void	DoUserAlert(const char * inMsg)
 {
+	if(sAlertHandler) { sAlertHandler(inMsg, sAlertRef); return; }
 	NSAlert *alert = [[NSAlert alloc] init];;
 	[alert setMessageText:[NSString stringWithUTF8String:inMsg]];
 	[alert runModal];
@@ -168,6 +178,7 @@ void	DoUserAlert(const char * inMsg)
 
 int		ConfirmMessage(const char * inMsg, const char * proceedBtn, const char * cancelBtn)
 {
+	if(sAlertHandler) { sAlertHandler(inMsg, sAlertRef); return 0; }
 	NSAlert *alert = [[NSAlert alloc] init];;
 	[alert setMessageText:[NSString stringWithUTF8String:inMsg]];
 	[alert addButtonWithTitle:[NSString stringWithUTF8String:proceedBtn]];
@@ -180,6 +191,7 @@ int		ConfirmMessage(const char * inMsg, const char * proceedBtn, const char * ca
 
 int DoSaveDiscardDialog(const char * inMessage1, const char * inMessage2)
 {
+	if(sAlertHandler) { sAlertHandler(inMessage2, sAlertRef); return close_Cancel; }
 	NSAlert *alert = [[NSAlert alloc] init];;
 	[alert setMessageText:[NSString stringWithUTF8String:inMessage1]];
 	[alert setInformativeText:[NSString stringWithUTF8String:inMessage2]];
@@ -212,13 +212,24 @@ char *	GetMultiFilePathFromUser(
 
 
 
+static UserAlert_f	sAlertHandler = NULL;
+static void *		sAlertRef = NULL;
+
+void	SetUserAlertHandler(UserAlert_f inHandler, void * inRef)
+{
+	sAlertHandler = inHandler;
+	sAlertRef = inRef;
+}
+
 void	DoUserAlert(const char * inMsg)
 {
+	if(sAlertHandler) { sAlertHandler(inMsg, sAlertRef); return; }
 	MessageBoxW(NULL, convert_str_to_utf16(inMsg).c_str(), L"Alert", MB_OK + MB_ICONWARNING);
 }
 
 int		ConfirmMessage(const char * inMsg, const char * proceedBtn, const char * cancelBtn)
 {
+	if(sAlertHandler) { sAlertHandler(inMsg, sAlertRef); return 0; }
 	int result = MessageBoxW(
 						NULL,				// No Parent HWND
 						convert_str_to_utf16(inMsg).c_str(),
@@ -234,6 +245,7 @@ int		ConfirmMessage(const char * inMsg, const char * proceedBtn, const char * ca
 
 int DoSaveDiscardDialog(const char * inMessage1, const char * inMessage2)
 {
+	if(sAlertHandler) { sAlertHandler(inMessage2, sAlertRef); return close_Cancel; }
 	int result = MessageBoxW(
 			NULL,
 			convert_str_to_utf16(inMessage2).c_str(),
@@ -23,10 +23,13 @@
 #ifndef PROGRESSUTILS_H
 #define PROGRESSUTILS_H
 
-#define PROGRESS_START(__FUNC, __STAGE, __STAGECOUNT, __MSG)							if (__FUNC) __FUNC(__STAGE, __STAGECOUNT, __MSG, 0.0);
-#define PROGRESS_SHOW(__FUNC, __STAGE, __STAGECOUNT, __MSG, __NOW, __MAX)				if (__FUNC && (__MAX)) __FUNC(__STAGE, __STAGECOUNT, __MSG, (float) (__NOW) / (float) (__MAX));
-#define PROGRESS_CHECK(__FUNC, __STAGE, __STAGECOUNT, __MSG, __NOW, __MAX, __INTERVAL)	if (__FUNC && (__MAX) && (__INTERVAL) && (((__NOW) % (__INTERVAL)) == 0)) __FUNC(__STAGE, __STAGECOUNT, __MSG, (float) (__NOW) / (float) (__MAX));
-#define PROGRESS_DONE(__FUNC, __STAGE, __STAGECOUNT, __MSG)								if (__FUNC) __FUNC(__STAGE, __STAGECOUNT, __MSG, 1.0);
+#include "TraceUtils.h"
+
+// These also mark the stage in the trace (see TraceUtils.h) - even with no progress func, so headless runs get timed.
+#define PROGRESS_START(__FUNC, __STAGE, __STAGECOUNT, __MSG)							{ if (gTraceEnabled) TRACE_StageBegin(__MSG); if (__FUNC) __FUNC(__STAGE, __STAGECOUNT, __MSG, 0.0); }
+#define PROGRESS_SHOW(__FUNC, __STAGE, __STAGECOUNT, __MSG, __NOW, __MAX)				if ((__FUNC || gTraceEnabled) && (__MAX)) { if (gTraceEnabled) TRACE_StageProgress(__MSG, (float) (__NOW) / (float) (__MAX)); if (__FUNC) __FUNC(__STAGE, __STAGECOUNT, __MSG, (float) (__NOW) / (float) (__MAX)); }
+#define PROGRESS_CHECK(__FUNC, __STAGE, __STAGECOUNT, __MSG, __NOW, __MAX, __INTERVAL)	if ((__FUNC || gTraceEnabled) && (__MAX) && (__INTERVAL) && (((__NOW) % (__INTERVAL)) == 0)) { if (gTraceEnabled) TRACE_StageProgress(__MSG, (float) (__NOW) / (float) (__MAX)); if (__FUNC) __FUNC(__STAGE, __STAGECOUNT, __MSG, (float) (__NOW) / (float) (__MAX)); }
+#define PROGRESS_DONE(__FUNC, __STAGE, __STAGECOUNT, __MSG)								{ if (gTraceEnabled) TRACE_StageEnd(__MSG); if (__FUNC) __FUNC(__STAGE, __STAGECOUNT, __MSG, 1.0); }
 
 typedef	bool (* ProgressFunc)(
 						int				inCurrentStage,
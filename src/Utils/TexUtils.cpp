@@ -35,6 +35,17 @@
 #if IBM
 // Ben says - this sucks!
 #include "XWinGL.h"
+#define glCompressedTexImage2D(t,l,f,w,h,b,n,d) glCompressedTexImage2DARB(t,l,f,w,h,b,n,(GLvoid *)(d))
+#endif
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT		0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT	0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT	0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT	0x83F3
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL				0x813D
 #endif
 
 struct  gl_info_t {
@@ -43,6 +54,7 @@ struct  gl_info_t {
 	bool	has_tex_compression;
 	bool	has_edge_clamp;
 	bool	has_non_pots;
+	bool	has_s3tc;
 	int		max_tex_size;
 };
 
@@ -66,6 +78,7 @@ static void init_gl_info(gl_info_t * i)
 	i->has_edge_clamp = true;		// If a user runs WED on a machine with less than GL 1.2, I will find that user and punch him directly in the throat.
 	i->has_tex_compression = (glv >= 130) || strstr(ext_str,"GL_ARB_texture_compression") != NULL;
 	i->has_non_pots = (glv >= 200) || strstr(ext_str,"GL_ARB_texture_non_power_of_two") != NULL;
+	i->has_s3tc = i->has_tex_compression && strstr(ext_str,"GL_EXT_texture_compression_s3tc") != NULL;
 	glGetIntegerv(GL_MAX_TEXTURE_SIZE,&i->max_tex_size);
 	if(i->max_tex_size > 8192)
 		i->max_tex_size = 8192;
@@ -117,41 +130,163 @@ bool LoadTextureFromFile(
 						float *  		outS,
 						float * 		outT)
 {
-	struct ImageInfo	im = { 0 };
+	DecodedTexture	tex;
+	if (!DecodeTexture(inFileName, 0, &tex))
+		return false;
+	bool res = LoadTextureFromDecoded(tex, inTexNum, flags, outWidth, outHeight, outS, outT);
+	DestroyDecodedTexture(&tex);
+	return res;
+}
 
-/*	MFMemFile * mf = MemFile_Open(inFileName);
-	if(mf)
-	{
-		if(LoadTextureFromDDS((const unsigned char *) MemFile_GetBegin(mf),(const unsigned char *) MemFile_GetEnd(mf),inTexNum,flags,outWidth,outHeight))
+/*****************************************************************************************
+ * DecodeTexture
+ *****************************************************************************************/
+bool DecodeTexture(const char * inFileName, int inMaxDim, DecodedTexture * outTex)
+{
+	memset(outTex, 0, sizeof(*outTex));
+
+	MFMemFile * mf = MemFile_Open(inFileName);
+	if (mf == NULL)
+		return false;
+
+	const char * begin = MemFile_GetBegin(mf);
+	int len = MemFile_GetEnd(mf) - begin;
+
+	// PNG, JPEG and DDS decode straight out of the memory we already have.  The others only have decoders that
+	// take a path, so for those we just go by the magic number and let the decoder read the file.
+	int result = -1;
+	switch(GetSupportedTypeFromData(begin, len)) {
+	case WED_PNG:
+		result = CreateBitmapFromPNGData(begin, len, &outTex->image, false, GAMMA_SRGB);
+		break;
+	case WED_DDS:
+		result = CreateDXTFromDDSData(begin, len, inMaxDim, &outTex->dxt);
+		if (result == 0)
 		{
-			if(outS) *outS = 1.0;
-			if(outT) *outT = 1.0;
-			MemFile_Close(mf);
-			return true;
+			outTex->org_width = outTex->dxt.org_width;
+			outTex->org_height = outTex->dxt.org_height;
 		}
-		MemFile_Close(mf);
-	}
-*/
-
-	int result =  CreateBitmapFromPNG(inFileName, &im, false, GAMMA_SRGB);
-	if (result) result = CreateBitmapFromDDS(inFileName, &im);
-	if (result) result = CreateBitmapFromFile(inFileName, &im);
+		else
+			result = CreateBitmapFromDDSData(begin, len, 0, &outTex->image);	// Not DXT, or an odd size we can't flip as blocks.
+		break;
+	#if USE_JPEG
+	case WED_JPEG:
+		result = CreateBitmapFromJPEGData((void *) begin, len, &outTex->image);
+		break;
+	#endif
+	case WED_BMP:
+		result = CreateBitmapFromFile(inFileName, &outTex->image);
+		break;
 	#if USE_TIF
-	if (result) result = CreateBitmapFromTIF(inFileName, &im);
+	case WED_TIF:
+		result = CreateBitmapFromTIF(inFileName, &outTex->image);
+		break;
 	#endif
-	#if USE_JPEG
-	if (result) result = CreateBitmapFromJPEG(inFileName, &im);
+	#if USE_GEOJPEG2K
+	case WED_JP2K:
+		result = CreateBitmapFromJP2K(inFileName, &outTex->image);
+		break;
 	#endif
-	if (result == 0)
+	}
+	MemFile_Close(mf);
+
+	if (result != 0)
+	{
+		DestroyDecodedTexture(outTex);
+		return false;
+	}
+	if (outTex->image.data)
+	{
+		if (outTex->image.pad != 0)
+			UnpadImage(&outTex->image);
+		if (outTex->org_width == 0)
+		{
+			outTex->org_width = outTex->image.width;
+			outTex->org_height = outTex->image.height;
+		}
+	}
+	return true;
+}
+
+void DestroyDecodedTexture(DecodedTexture * ioTex)
+{
+	if (ioTex->image.data)
+		DestroyBitmap(&ioTex->image);
+	ioTex->image.data = NULL;
+	DestroyDXT(&ioTex->dxt);
+}
+
+/*****************************************************************************************
+ * LoadTextureFromDecoded
+ *****************************************************************************************/
+static bool is_pow2(int n)
+{
+	return (n & (n - 1)) == 0;
+}
+
+static void set_tex_params(int inFlags);
+
+bool LoadTextureFromDecoded(DecodedTexture& ioTex, int inTexNum, int inFlags, int * outWidth, int * outHeight, float * outS, float * outT)
+{
+	INIT_GL_INFO
+
+	DXTImageInfo& dxt(ioTex.dxt);
+	if (dxt.data)
 	{
-		if (im.pad != 0)
-			UnpadImage(&im);
+		// Skip mips the card can't take; past that, DXT goes up as is unless we'd have to change the pixels: pad
+		// to a power of 2, chroma-key, or decompress for a card without S3TC.
+		int sflags = dxt.dxt == 1 ? squish::kDxt1 : (dxt.dxt == 3 ? squish::kDxt3 : squish::kDxt5);
+		int x = dxt.width, y = dxt.height, mips = dxt.mips;
+		const unsigned char * p = dxt.data;
+		while (mips > 1 && (x > gl_info.max_tex_size || y > gl_info.max_tex_size))
+		{
+			p += squish::GetStorageRequirements(x, y, sflags);
+			x = max(x / 2, 1);
+			y = max(y / 2, 1);
+			--mips;
+		}
+
+		bool pots = is_pow2(x) && is_pow2(y);
+		bool as_is = gl_info.has_s3tc &&
+					 x <= gl_info.max_tex_size && y <= gl_info.max_tex_size &&
+					 (pots || (gl_info.has_non_pots && !(inFlags & tex_Always_Pad))) &&
+					 !(inFlags & tex_MagentaAlpha);
+
+		if (!as_is)
+		{
+			if (ioTex.image.data == NULL && CreateBitmapFromDXT(dxt, &ioTex.image) != 0)
+				return false;
+			DestroyDXT(&dxt);
+			return LoadTextureFromImage(ioTex.image, inTexNum, inFlags, outWidth, outHeight, outS, outT);
+		}
+
+		GLenum format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		if (dxt.dxt == 1)	format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;		// Keep 1-bit alpha, same as squish gives us when we decode.
+		if (dxt.dxt == 3)	format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+
+		glBindTexture(GL_TEXTURE_2D, inTexNum);
+		for (int level = 0; level < mips; ++level)
+		{
+			int l = squish::GetStorageRequirements(x, y, sflags);
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, format, x, y, 0, l, p);
+			p += l;
+			x = max(x / 2, 1);
+			y = max(y / 2, 1);
+		}
+
+		if (outWidth) *outWidth = max(dxt.width >> (dxt.mips - mips), 1);
+		if (outHeight) *outHeight = max(dxt.height >> (dxt.mips - mips), 1);
+		if (outS) *outS = 1.0;
+		if (outT) *outT = 1.0;
 
-		int res = LoadTextureFromImage(im, inTexNum, flags, outWidth, outHeight, outS, outT);
-		DestroyBitmap(&im);
-		return res;
+		// A DDS's mip chain doesn't have to go down to 1x1; tell GL where it stops or the texture is incomplete.
+		// The stored mips are free, so use them whether or not the caller asked for mipmapping.
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips - 1);
+		set_tex_params(mips > 1 ? (inFlags | tex_Mipmap) : (inFlags & ~tex_Mipmap));
+		return true;
 	}
-	return false;
+
+	return LoadTextureFromImage(ioTex.image, inTexNum, inFlags, outWidth, outHeight, outS, outT);
 }
 
 /*****************************************************************************************
@@ -260,158 +395,36 @@ bool LoadTextureFromImage(ImageInfo& im, int inTexNum, int inFlags, int * outWid
 		DestroyBitmap(&rescaleBits);
 
 	if (ok)
-	{
-		// BAS note: for some reason on my WinXP system with GF-FX, if
-		// I do not set these explicitly to linear, I get no drawing at all.
-		// Who knows what default state the card is in. :-(
+		set_tex_params(inFlags);
+	return ok;
+}
+
+static void set_tex_params(int inFlags)
+{
+	// BAS note: for some reason on my WinXP system with GF-FX, if
+	// I do not set these explicitly to linear, I get no drawing at all.
+	// Who knows what default state the card is in. :-(
 //		if(inFlags & tex_Nearest)
 //		{
 //			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 //			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 //		} else 
-		if (inFlags & tex_Linear) {
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (inFlags & tex_Mipmap) ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
-		} else {
-			// If we have nearest-neighboring and we are down-sampling WITHOUT a mip-map we STILL use linear in an attempt to keep this thing from looking TOTALY blitzed, I guess?
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (inFlags & tex_Mipmap) ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR);
-		}
-
-			 if(inFlags & tex_Wrap){glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_REPEAT		 );
-								    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_REPEAT		 );}
-// Janos says: why not on windows? without it the terraserver overlay looks ...well, not clamped :-)
-//#if !IBM
-		else if(gl_info.has_edge_clamp){glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
-								    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);}
-//#endif
-		else					   {glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP		 );
-								    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP		 );}
-
-	}
-	return ok;
-}
-
-#if BIG
-	#if APL
-		#include <libkern/OSByteOrder.h>
-		#define SWAP32(x) (OSSwapConstInt32(x))
-	#else
-		#error we do not have big endian support on non-Mac platforms
-	#endif
-#elif LIL
-	#define SWAP32(x) (x)
-#else
-	#error BIG or LIL are not defined - what endian are we?
-#endif
-
-
-#if 0
-bool	LoadTextureFromDDS(
-				const unsigned char *	mem_start,
-				const unsigned char *	mem_end,
-				int						in_tex_num,
-				int					in_flags,
-				int *					outWidth,
-				int *					outHeight)
-{
-	if((mem_end - mem_start) < sizeof(TEX_dds_desc)) return false;
-
-	const TEX_dds_desc * desc = (const TEX_dds_desc *) mem_start;
-
-	if (desc->dwMagic[0] != 'D' ||
-		desc->dwMagic[1] != 'D' ||
-		desc->dwMagic[2] != 'S' ||
-		desc->dwMagic[3] != ' ') return false;
-
-	if((SWAP32(desc->dwSize)) != (sizeof(*desc) - sizeof(desc->dwMagic))) return false;
-
-	if(desc->ddpfPixelFormat.dwFourCC[0] != 'D' ||
-	   desc->ddpfPixelFormat.dwFourCC[1] != 'X' ||
-	   desc->ddpfPixelFormat.dwFourCC[2] != 'T') return false;
-
-	GLenum format = 0;
-	int	flags = 0;
-	switch(desc->ddpfPixelFormat.dwFourCC[3]) {
-	case '1':		flags = squish::kDxt1;			format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;	break;
-	case '3':		flags = squish::kDxt3;			format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;	break;
-	case '5':		flags = squish::kDxt5;			format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;	break;
-	default: return false;
-	}
-
-	int mips = 0;
-	if((SWAP32(desc->dwFlags)) & DDSD_MIPMAPCOUNT)
-		mips = SWAP32(desc->dwMipMapCount);
-	int has_mips = (mips > 1);
-	int x = SWAP32(desc->dwWidth);
-	int y = SWAP32(desc->dwHeight);
-
-	if (outWidth) *outWidth = x;
-	if (outHeight) *outHeight = y;
-
-	const unsigned char * data = mem_start + sizeof(TEX_dds_desc);
-
-	glBindTexture(GL_TEXTURE_2D, in_tex_num);
-
-	int level = 0;
-	do {
-		int data_len = squish::GetStorageRequirements(x,y,flags);
-		if((data + data_len) > mem_end) return false;
-
-		glCompressedTexImage2DARB(
-			GL_TEXTURE_2D,
-			level,
-			format,
-			x,
-			y,
-			0,
-			data_len,
-			data);
-
-		if (x==1 && y == 1)	break;
-		++level;
-		if (x > 1) x >>= 1;
-		if (y > 1) y >>= 1;
-		--mips;
-		if(mips<=0) break;
-		data += data_len;
-	} while (1);
-
-	if(inFlags & tex_Nearest)
-	{
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	} else if (inFlags & tex_Linear) {
+	if (inFlags & tex_Linear) {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (in_flags & tex_Mipmap) ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (inFlags & tex_Mipmap) ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
 	} else {
+		// If we have nearest-neighboring and we are down-sampling WITHOUT a mip-map we STILL use linear in an attempt to keep this thing from looking TOTALY blitzed, I guess?
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (in_flags & tex_Mipmap) ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (inFlags & tex_Mipmap) ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR);
 	}
 
-	static const char * ver_str = (const char *) glGetString(GL_VERSION);
-	static const char * ext_str = (const char *) glGetString(GL_EXTENSIONS);
-
-	static bool tex_clamp_avail =
-		strstr(ext_str,"GL_SGI_texture_edge_clamp"		) ||
-		strstr(ext_str,"GL_SGIS_texture_edge_clamp"		) ||
-		strstr(ext_str,"GL_ARB_texture_edge_clamp"		) ||
-		strstr(ext_str,"GL_EXT_texture_edge_clamp"		) ||
-		strncmp(ver_str,"1.2", 3) ||
-		strncmp(ver_str,"1.3", 3) ||
-		strncmp(ver_str,"1.4", 3) ||
-		strncmp(ver_str,"1.5", 3);
-
-
-		 if(in_flags & tex_Wrap){glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_REPEAT		 );
-								glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_REPEAT		 );}
-#if !IBM
-	else if(tex_clamp_avail)   {glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
-								glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);}
-#endif
+		 if(inFlags & tex_Wrap){glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_REPEAT		 );
+							    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_REPEAT		 );}
+// Janos says: why not on windows? without it the terraserver overlay looks ...well, not clamped :-)
+//#if !IBM
+	else if(gl_info.has_edge_clamp){glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+							    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);}
+//#endif
 	else					   {glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP		 );
-								glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP		 );}
-
-	return true;
+							    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP		 );}
 }
-#endif
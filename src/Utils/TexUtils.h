@@ -23,7 +23,7 @@
 #ifndef TEXUTILS_H
 #define TEXUTILS_H
 
-struct	ImageInfo;
+#include "BitmapUtils.h"
 
 enum {
 
@@ -34,7 +34,9 @@ enum {
 	tex_Rescale			=	16,	// Rescale to use whole tex
 //	tex_Nearest			=	32,	// Use nearest-neighbor - appears to be legacy that this is explicit?
 	tex_Compress_Ok		=	64,	// Allow driver-driven texture compression
-	tex_Always_Pad		=	128	// Force pad up to pow2 even if we have non-pots card.  Needed for UI
+	tex_Always_Pad		=	128,// Force pad up to pow2 even if we have non-pots card.  Needed for UI
+	tex_Async			=	256,// Texture managers only: decode in the background, texture ID is 0 until it is ready
+	tex_Thumbnail		=	512	// Texture managers only: a preview is enough, DDS files load from a smaller mip
 
 };
 
@@ -56,12 +58,35 @@ bool LoadTextureFromImage(
 				float *			outS,
 				float *			outT);
 
-/*bool	LoadTextureFromDDS(
-				const unsigned char *	mem_start,
-				const unsigned char *	mem_end,
-				int						in_tex_num,
-				int						in_flags,
-				int *					outWidth,
-				int *					outHeight);*/
+/*
+	Loading a texture in two halves: DecodeTexture reads the file and decodes it without touching GL, so it can run on
+	any thread.  LoadTextureFromDecoded does the upload and must be called with the GL context current.
+
+	The decoder is picked by the file's magic number, not its name, and the file is only read once.  DXT-compressed
+	DDS files are not decoded at all - their blocks and stored mips go straight to the card if it can take them.
+	max_dim (0 for none) lets DDS files skip mips bigger than that, for when we only need a thumbnail.
+*/
+struct	DecodedTexture {
+	ImageInfo		image;			// The pixels, or image.data is NULL if we have...
+	DXTImageInfo	dxt;			// ...DXT blocks instead.
+	int				org_width;		// Size of the image in the file, before skipping mips
+	int				org_height;
+};
+
+bool DecodeTexture(
+				const char *	inFileName,
+				int				inMaxDim,
+				DecodedTexture *outTex);
+
+bool LoadTextureFromDecoded(
+				DecodedTexture&	ioTex,
+				int 			inTexNum,
+				int				inFlags,
+				int * 			outWidth,
+				int * 			outHeight,
+				float *			outS,
+				float *			outT);
+
+void DestroyDecodedTexture(DecodedTexture * ioTex);
 
 #endif
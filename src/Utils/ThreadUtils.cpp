@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "ThreadUtils.h"
+#include "AssertUtils.h"
+
+#if !IBM
+#include <unistd.h>
+#endif
+
+// Don't go crazy on big boxes - past this the work we have is usually memory-bound anyway.
+#define MAX_WORKERS 32
+
+THREAD_Mutex::THREAD_Mutex()
+{
+	#if IBM
+	InitializeCriticalSection(&mCS);
+	#else
+	pthread_mutexattr_t	attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&mMutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+	#endif
+}
+
+THREAD_Mutex::~THREAD_Mutex()
+{
+	#if IBM
+	DeleteCriticalSection(&mCS);
+	#else
+	pthread_mutex_destroy(&mMutex);
+	#endif
+}
+
+void	THREAD_Mutex::Lock(void)
+{
+	#if IBM
+	EnterCriticalSection(&mCS);
+	#else
+	pthread_mutex_lock(&mMutex);
+	#endif
+}
+
+void	THREAD_Mutex::Unlock(void)
+{
+	#if IBM
+	LeaveCriticalSection(&mCS);
+	#else
+	pthread_mutex_unlock(&mMutex);
+	#endif
+}
+
+int		THREAD_CountCores(void)
+{
+	#if IBM
+	SYSTEM_INFO	info;
+	GetSystemInfo(&info);
+	int n = info.dwNumberOfProcessors;
+	#else
+	int n = sysconf(_SC_NPROCESSORS_ONLN);
+	#endif
+	return n > 0 ? n : 1;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------
+// PARALLEL FOR
+//------------------------------------------------------------------------------------------------------------------------------------
+
+struct	parallel_for_t {
+	THREAD_Mutex	lock;
+	int				next;
+	int				count;
+	THREAD_Work_f	work;
+	void *			ref;
+};
+
+struct	parallel_worker_t {
+	parallel_for_t *	job;
+	int					worker;
+	#if IBM
+	HANDLE				thread;
+	#else
+	pthread_t			thread;
+	#endif
+};
+
+static void	run_parallel_worker(parallel_for_t * job, int worker)
+{
+	while(1)
+	{
+		int item;
+		{
+			THREAD_Lock	l(job->lock);
+			if(job->next >= job->count)
+				return;
+			item = job->next++;
+		}
+		job->work(item, worker, job->ref);
+	}
+}
+
+#if IBM
+static DWORD WINAPI	parallel_thread_proc(void * param)
+#else
+static void *		parallel_thread_proc(void * param)
+#endif
+{
+	parallel_worker_t * me = (parallel_worker_t *) param;
+	run_parallel_worker(me->job, me->worker);
+	return 0;
+}
+
+int		THREAD_WorkerCount(int max_workers)
+{
+	int n = max_workers > 0 ? max_workers : THREAD_CountCores();
+	return n > MAX_WORKERS ? MAX_WORKERS : n;
+}
+
+int		THREAD_ParallelFor(int count, THREAD_Work_f work, void * ref, int max_workers)
+{
+	if(count <= 0)
+		return 0;
+
+	int n = THREAD_WorkerCount(max_workers);
+	if(n > count)		n = count;
+
+	parallel_for_t	job;
+	job.next = 0;
+	job.count = count;
+	job.work = work;
+	job.ref = ref;
+
+	// Worker 0 is us; spin up the rest.  If a thread fails to start, the items just go to whoever is left.
+	parallel_worker_t	workers[MAX_WORKERS];
+	int started = 1;
+	for(int w = 1; w < n; ++w)
+	{
+		parallel_worker_t * me = workers + started;
+		me->job = &job;
+		me->worker = started;
+		#if IBM
+		me->thread = CreateThread(NULL, 0, parallel_thread_proc, me, 0, NULL);
+		if(me->thread == NULL)
+			break;
+		#else
+		if(pthread_create(&me->thread, NULL, parallel_thread_proc, me) != 0)
+			break;
+		#endif
+		++started;
+	}
+
+	run_parallel_worker(&job, 0);
+
+	for(int w = 1; w < started; ++w)
+	{
+		#if IBM
+		WaitForSingleObject(workers[w].thread, INFINITE);
+		CloseHandle(workers[w].thread);
+		#else
+		pthread_join(workers[w].thread, NULL);
+		#endif
+	}
+	DebugAssert(job.next == count);
+	return started;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------
+// JOB QUEUE
+//------------------------------------------------------------------------------------------------------------------------------------
+
+THREAD_JobQueue::THREAD_JobQueue(int max_workers) : mRunning(0)
+{
+	mMaxWorkers = max_workers > 0 ? max_workers : THREAD_CountCores();
+	if(mMaxWorkers > MAX_WORKERS) mMaxWorkers = MAX_WORKERS;
+}
+
+THREAD_JobQueue::~THREAD_JobQueue()
+{
+	Wait();
+}
+
+void	THREAD_JobQueue::Add(THREAD_Job_f job, void * ref)
+{
+	THREAD_Lock	l(mLock);
+	mJobs.push_back(pair<THREAD_Job_f, void *>(job, ref));
+
+	// A worker only quits when it finds the queue empty while holding the lock, so if one is running it WILL
+	// see this job.  We only need a new thread if we are under the limit.
+	if(mRunning < mMaxWorkers)
+	{
+		thread_t t;
+		#if IBM
+		t = CreateThread(NULL, 0, thread_proc, this, 0, NULL);
+		bool ok = t != NULL;
+		#else
+		bool ok = pthread_create(&t, NULL, thread_proc, this) == 0;
+		#endif
+		if(ok)
+		{
+			mThreads.push_back(t);
+			++mRunning;
+		}
+		else if(mRunning == 0)
+		{
+			// Can't get a thread at all - don't strand the job, just do it now.
+			mJobs.pop_back();
+			job(ref);
+		}
+	}
+}
+
+void	THREAD_JobQueue::Wait(void)
+{
+	// Workers drain the queue before they quit, so once every thread we started has exited, all jobs are done.
+	// Jobs don't add jobs, so no new threads can show up behind our back while we join.
+	vector<thread_t>	threads;
+	{
+		THREAD_Lock	l(mLock);
+		threads.swap(mThreads);
+	}
+	for(vector<thread_t>::iterator t = threads.begin(); t != threads.end(); ++t)
+	{
+		#if IBM
+		WaitForSingleObject(*t, INFINITE);
+		CloseHandle(*t);
+		#else
+		pthread_join(*t, NULL);
+		#endif
+	}
+	DebugAssert(mJobs.empty());
+}
+
+#if IBM
+DWORD WINAPI	THREAD_JobQueue::thread_proc(void * param)
+#else
+void *			THREAD_JobQueue::thread_proc(void * param)
+#endif
+{
+	THREAD_JobQueue * me = (THREAD_JobQueue *) param;
+	while(1)
+	{
+		pair<THREAD_Job_f, void *>	job;
+		{
+			THREAD_Lock	l(me->mLock);
+			if(me->mJobs.empty())
+			{
+				--me->mRunning;
+				return 0;
+			}
+			job = me->mJobs.front();
+			me->mJobs.pop_front();
+		}
+		job.first(job.second);
+	}
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef ThreadUtils_H
+#define ThreadUtils_H
+
+/*
+
+	ThreadUtils - THEORY OF OPERATION
+
+	A minimal cross-platform threading kit: a mutex, a scoped lock, a parallel-for and a background job queue.  It is pthreads on Mac and
+	Linux and Win32 threads on Windows, same as curl_http and GUI_Timer, so it adds no new libraries.
+
+	THREAD_ParallelFor runs work items 0..count-1 on up to N threads and returns
+	when all of them are done.  The calling thread works too (as worker 0), so a count of 1 or a worker limit of
+	1 runs everything inline with no threads created at all - handy for debugging.  Items are handed out in
+	ascending order, one at a time, so a few expensive items don't leave the other workers idle.
+
+	Items run in no particular order relative to each other.  If the results have to come out in a stable order,
+	have each item write into its own slot (indexed by the item number) and merge the slots after the call.
+
+	THREAD_JobQueue is for work that should run in the background while the caller gets on with something else.
+	Add() queues a job and returns right away; up to N worker threads run the queue in the order jobs were added.
+	Workers are started as jobs come in and exit when the queue runs dry, so an idle queue costs nothing.  Wait()
+	blocks until everything queued so far is done.  The queue must outlive its jobs - the destructor waits.
+
+	THREAD_Mutex is recursive - the same thread may lock it again - which matches Win32 critical sections and
+	lets lazy-loading caches call their own accessors.
+
+*/
+
+#include <list>
+#include <vector>
+
+#if !IBM
+#include <pthread.h>
+#endif
+
+class	THREAD_Mutex {
+public:
+				 THREAD_Mutex();
+				~THREAD_Mutex();
+
+		void	Lock(void);
+		void	Unlock(void);
+
+private:
+				 THREAD_Mutex(const THREAD_Mutex&);
+	THREAD_Mutex& operator=(const THREAD_Mutex&);
+
+	#if IBM
+	CRITICAL_SECTION	mCS;
+	#else
+	pthread_mutex_t		mMutex;
+	#endif
+};
+
+class	THREAD_Lock {
+public:
+	explicit	THREAD_Lock(THREAD_Mutex& m) : mMutex(m) { mMutex.Lock(); }
+				~THREAD_Lock() { mMutex.Unlock(); }
+private:
+				 THREAD_Lock(const THREAD_Lock&);
+	THREAD_Lock& operator=(const THREAD_Lock&);
+
+	THREAD_Mutex&	mMutex;
+};
+
+// Number of CPUs the OS will schedule us on; always at least 1.
+int		THREAD_CountCores(void);
+
+// Called once per item.  worker is 0..N-1 and identifies the thread running the item, so callers can keep
+// per-thread scratch space without locking.
+typedef void (* THREAD_Work_f)(int item, int worker, void * ref);
+
+// Runs work(i, worker, ref) for every i in [0,count), on at most max_workers threads (0 means one per core),
+// and returns when all items are done.  Returns the number of workers actually used.
+int		THREAD_ParallelFor(int count, THREAD_Work_f work, void * ref, int max_workers = 0);
+
+// The most workers THREAD_ParallelFor will use for a given max_workers - size per-worker scratch space with this.
+int		THREAD_WorkerCount(int max_workers = 0);
+
+typedef void (* THREAD_Job_f)(void * ref);
+
+class	THREAD_JobQueue {
+public:
+	explicit	 THREAD_JobQueue(int max_workers = 0);		// 0 means one per core
+				~THREAD_JobQueue();
+
+		void	Add(THREAD_Job_f job, void * ref);
+		void	Wait(void);
+
+private:
+				 THREAD_JobQueue(const THREAD_JobQueue&);
+	THREAD_JobQueue& operator=(const THREAD_JobQueue&);
+
+	#if IBM
+	typedef HANDLE		thread_t;
+	static DWORD WINAPI	thread_proc(void * param);
+	#else
+	typedef pthread_t	thread_t;
+	static void *		thread_proc(void * param);
+	#endif
+
+	THREAD_Mutex						mLock;
+	list<pair<THREAD_Job_f, void *> >	mJobs;
+	vector<thread_t>					mThreads;		// Every thread we started since the last Wait, running or not.
+	int									mRunning;
+	int									mMaxWorkers;
+};
+
+#endif /* ThreadUtils_H */
@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+
+#include "TraceUtils.h"
+#include "ThreadUtils.h"
+#include "PerfUtils.h"
+
+int	gTraceEnabled = 0;
+
+struct	trace_event_t {
+	const char *		name;		// zone, counter or stage; NULL for a zone end
+	unsigned long long	when;		// query_hpc
+	long long			value;		// counter total or stage percent
+	char				type;		// Chrome phases: B/E zone, C counter, b/e stage, P stage progress
+};
+
+struct	trace_counter_t {
+	const char *	name;
+	long long		value;
+	bool			dirty;
+};
+
+// Events go in fixed-size blocks so a long trace never has to copy what it has already recorded.
+#define TRACE_BLOCK_EVENTS	16384
+
+struct	trace_thread_t {
+	int								tid;
+	int								depth;
+	vector<trace_event_t *>			blocks;
+	int								used;			// events in the last block
+	vector<trace_counter_t>			counters;
+	const char *					stage_raw;		// last stage name passed in, and what we interned it as
+	const char *					stage_name;
+	int								stage_pct;
+};
+
+static THREAD_Mutex					sLock;
+static vector<trace_thread_t *>		sThreads;
+static vector<trace_thread_t *>		sRetired;		// buffers of threads that have exited, free for the next new thread
+static set<string>					sNames;			// interned stage names
+static unsigned long long			sEpoch = 0;
+
+static void	trace_flush_counters(trace_thread_t * me);
+static void	trace_push(trace_thread_t * me, char type, const char * name, long long value);
+
+// Called by the OS as a thread that recorded something exits.  The buffer stays in sThreads for the dump; closing
+// what the thread left open lets the next thread carry on in the same buffer with its zones still nesting.
+#if IBM
+static void WINAPI	trace_thread_exit(void * ref)
+#else
+static void			trace_thread_exit(void * ref)
+#endif
+{
+	trace_thread_t * me = (trace_thread_t *) ref;
+	if(me == NULL)
+		return;
+	trace_flush_counters(me);
+	for(; me->depth > 0; --me->depth)
+		trace_push(me, 'E', NULL, 0);
+	me->stage_raw = me->stage_name = NULL;
+	me->stage_pct = -1;
+
+	THREAD_Lock	l(sLock);
+	sRetired.push_back(me);
+}
+
+#if IBM
+static DWORD						sTLS = FlsAlloc(trace_thread_exit);
+#else
+static pthread_key_t make_tls_key(void) { pthread_key_t k; pthread_key_create(&k, trace_thread_exit); return k; }
+static pthread_key_t				sTLS = make_tls_key();
+#endif
+
+static trace_thread_t *	trace_thread(void)
+{
+	#if IBM
+	trace_thread_t * me = (trace_thread_t *) FlsGetValue(sTLS);
+	#else
+	trace_thread_t * me = (trace_thread_t *) pthread_getspecific(sTLS);
+	#endif
+	if(me == NULL)
+	{
+		THREAD_Lock	l(sLock);
+		if(!sRetired.empty())
+		{
+			me = sRetired.back();
+			sRetired.pop_back();
+		}
+		else
+		{
+			me = new trace_thread_t;
+			me->depth = 0;
+			me->stage_raw = me->stage_name = NULL;
+			me->stage_pct = -1;
+			me->used = TRACE_BLOCK_EVENTS;
+			me->tid = sThreads.size();
+			sThreads.push_back(me);
+		}
+		#if IBM
+		FlsSetValue(sTLS, me);
+		#else
+		pthread_setspecific(sTLS, me);
+		#endif
+	}
+	return me;
+}
+
+static const char *	trace_intern(trace_thread_t * me, const char * name)
+{
+	if(name != me->stage_raw)
+	{
+		THREAD_Lock	l(sLock);
+		me->stage_raw = name;
+		me->stage_name = sNames.insert(string(name)).first->c_str();
+		me->stage_pct = -1;
+	}
+	return me->stage_name;
+}
+
+static void	trace_push(trace_thread_t * me, char type, const char * name, long long value)
+{
+	if(me->used == TRACE_BLOCK_EVENTS)
+	{
+		me->blocks.push_back(new trace_event_t[TRACE_BLOCK_EVENTS]);
+		me->used = 0;
+	}
+	trace_event_t * e = me->blocks.back() + me->used++;
+	e->name = name;
+	e->when = query_hpc();
+	e->value = value;
+	e->type = type;
+}
+
+// How many events are in block b of a thread.
+static int	trace_block_size(const trace_thread_t * me, int b)
+{
+	return (b == me->blocks.size() - 1) ? me->used : TRACE_BLOCK_EVENTS;
+}
+
+static void	trace_flush_counters(trace_thread_t * me)
+{
+	for(vector<trace_counter_t>::iterator c = me->counters.begin(); c != me->counters.end(); ++c)
+	if(c->dirty)
+	{
+		trace_push(me, 'C', c->name, c->value);
+		c->dirty = false;
+	}
+}
+
+void	TRACE_Enable(bool enable)
+{
+	if(enable && sEpoch == 0)
+		sEpoch = query_hpc();
+	gTraceEnabled = enable;
+}
+
+void	TRACE_Clear(void)
+{
+	THREAD_Lock	l(sLock);
+	for(vector<trace_thread_t *>::iterator t = sThreads.begin(); t != sThreads.end(); ++t)
+	{
+		for(vector<trace_event_t *>::iterator b = (*t)->blocks.begin(); b != (*t)->blocks.end(); ++b)
+			delete [] *b;
+		(*t)->blocks.clear();
+		(*t)->used = TRACE_BLOCK_EVENTS;
+		(*t)->counters.clear();
+		(*t)->depth = 0;
+	}
+	sEpoch = query_hpc();
+}
+
+void	TRACE_Begin(const char * zone)
+{
+	trace_thread_t * me = trace_thread();
+	++me->depth;
+	trace_push(me, 'B', zone, 0);
+}
+
+void	TRACE_End(void)
+{
+	trace_thread_t * me = trace_thread();
+	trace_flush_counters(me);
+	if(me->depth > 0)
+		--me->depth;
+	trace_push(me, 'E', NULL, 0);
+}
+
+void	TRACE_Count(const char * counter, long long delta)
+{
+	trace_thread_t * me = trace_thread();
+	vector<trace_counter_t>::iterator c;
+	for(c = me->counters.begin(); c != me->counters.end(); ++c)
+	if(c->name == counter)
+		break;
+	if(c == me->counters.end())
+	{
+		trace_counter_t nc = { counter, 0, false };
+		c = me->counters.insert(me->counters.end(), nc);
+	}
+	c->value += delta;
+	c->dirty = true;
+	if(me->depth == 0)
+		trace_flush_counters(me);
+}
+
+void	TRACE_StageBegin(const char * stage)
+{
+	trace_thread_t * me = trace_thread();
+	trace_push(me, 'b', trace_intern(me, stage), 0);
+}
+
+void	TRACE_StageProgress(const char * stage, float progress)
+{
+	trace_thread_t * me = trace_thread();
+	const char * name = trace_intern(me, stage);
+	int pct = progress * 100.0f;
+	if(pct != me->stage_pct)
+	{
+		me->stage_pct = pct;
+		trace_push(me, 'P', name, pct);
+	}
+}
+
+void	TRACE_StageEnd(const char * stage)
+{
+	trace_thread_t * me = trace_thread();
+	trace_push(me, 'e', trace_intern(me, stage), 0);
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------
+// OUTPUT
+//------------------------------------------------------------------------------------------------------------------------------------
+
+static double	trace_usec(unsigned long long when)
+{
+	return when > sEpoch ? hpc_to_microseconds(when - sEpoch) : 0.0;
+}
+
+static void	trace_json_string(FILE * fi, const char * s)
+{
+	fputc('"', fi);
+	for(; *s; ++s)
+	{
+		if(*s == '"' || *s == '\\')			fprintf(fi, "\\%c", *s);
+		else if((unsigned char) *s < 0x20)	fprintf(fi, "\\u%04x", (unsigned char) *s);
+		else								fputc(*s, fi);
+	}
+	fputc('"', fi);
+}
+
+bool	TRACE_WriteChrome(const char * path)
+{
+	FILE * fi = fopen(path, "w");
+	if(fi == NULL)
+		return false;
+
+	THREAD_Lock	l(sLock);
+	fprintf(fi, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+	for(vector<trace_thread_t *>::iterator t = sThreads.begin(); t != sThreads.end(); ++t)
+	{
+		int tid = (*t)->tid;
+		fprintf(fi, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+			first ? "" : ",\n", tid, tid == 0 ? "main" : "thread", tid);
+		first = false;
+
+		for(int b = 0; b < (*t)->blocks.size(); ++b)
+		for(trace_event_t * e = (*t)->blocks[b]; e != (*t)->blocks[b] + trace_block_size(*t, b); ++e)
+		{
+			fprintf(fi, ",\n{");
+			if(e->name)
+			{
+				fprintf(fi, "\"name\":");
+				trace_json_string(fi, e->name);
+				fprintf(fi, ",");
+			}
+			switch(e->type) {
+			case 'B':
+			case 'E':
+				fprintf(fi, "\"ph\":\"%c\"", e->type);
+				break;
+			case 'C':
+				// One counter track per name; each thread's running total is a series on it.
+				fprintf(fi, "\"ph\":\"C\",\"args\":{\"thread %d\":%lld}", tid, e->value);
+				break;
+			case 'b':
+			case 'e':
+				// Stages are async spans so they don't have to nest with the zones.
+				fprintf(fi, "\"cat\":\"stage\",\"ph\":\"%c\",\"id\":\"%d:%p\"", e->type, tid, e->name);
+				break;
+			case 'P':
+				fprintf(fi, "\"cat\":\"stage\",\"ph\":\"n\",\"id\":\"%d:%p\",\"args\":{\"percent\":%lld}", tid, e->name, e->value);
+				break;
+			}
+			fprintf(fi, ",\"ts\":%.3lf,\"pid\":1,\"tid\":%d}", trace_usec(e->when), tid);
+		}
+	}
+	fprintf(fi, "\n]}\n");
+	bool ok = ferror(fi) == 0;
+	fclose(fi);
+	return ok;
+}
+
+struct	trace_zone_stats_t {
+	int		calls;
+	double	total;		// microseconds, including children
+	double	self;
+	trace_zone_stats_t() : calls(0), total(0), self(0) { }
+};
+
+struct	trace_open_zone_t {
+	const char *		name;
+	unsigned long long	start;
+	double				children;
+};
+
+static bool	sort_by_total(const pair<string, trace_zone_stats_t>& lhs, const pair<string, trace_zone_stats_t>& rhs)
+{
+	return lhs.second.total > rhs.second.total;
+}
+
+void	TRACE_PrintSummary(FILE * fi)
+{
+	map<string, trace_zone_stats_t>	zones;
+	map<string, long long>			counters;
+	map<string, double>				stages;
+
+	THREAD_Lock	l(sLock);
+	for(vector<trace_thread_t *>::iterator t = sThreads.begin(); t != sThreads.end(); ++t)
+	{
+		// Replay the thread's zones with a stack to split out self time.  Zones still open are left out, and a zone
+		// that recurses counts its time once per level in the total.
+		vector<trace_open_zone_t>					stack;
+		map<const char *, unsigned long long>		open_stages;
+		for(int b = 0; b < (*t)->blocks.size(); ++b)
+		for(trace_event_t * e = (*t)->blocks[b]; e != (*t)->blocks[b] + trace_block_size(*t, b); ++e)
+		switch(e->type) {
+		case 'B':
+			{
+				trace_open_zone_t z = { e->name, e->when, 0.0 };
+				stack.push_back(z);
+			}
+			break;
+		case 'E':
+			if(!stack.empty())
+			{
+				double dur = hpc_to_microseconds(e->when - stack.back().start);
+				trace_zone_stats_t& s(zones[stack.back().name]);
+				++s.calls;
+				s.total += dur;
+				s.self += dur - stack.back().children;
+				stack.pop_back();
+				if(!stack.empty())
+					stack.back().children += dur;
+			}
+			break;
+		case 'b':
+			open_stages[e->name] = e->when;
+			break;
+		case 'e':
+			if(open_stages.count(e->name))
+			{
+				stages[e->name] += hpc_to_microseconds(e->when - open_stages[e->name]);
+				open_stages.erase(e->name);
+			}
+			break;
+		}
+		for(vector<trace_counter_t>::iterator c = (*t)->counters.begin(); c != (*t)->counters.end(); ++c)
+			counters[c->name] += c->value;
+	}
+
+	vector<pair<string, trace_zone_stats_t> >	sorted(zones.begin(), zones.end());
+	sort(sorted.begin(), sorted.end(), sort_by_total);
+
+	fprintf(fi, "%-48s %10s %12s %12s\n", "Zone", "Calls", "Total (s)", "Self (s)");
+	for(vector<pair<string, trace_zone_stats_t> >::iterator z = sorted.begin(); z != sorted.end(); ++z)
+		fprintf(fi, "%-48s %10d %12.3lf %12.3lf\n", z->first.c_str(), z->second.calls, z->second.total / 1000000.0, z->second.self / 1000000.0);
+	if(!stages.empty())
+	{
+		fprintf(fi, "\n%-48s %12s\n", "Stage", "Time (s)");
+		for(map<string, double>::iterator s = stages.begin(); s != stages.end(); ++s)
+			fprintf(fi, "%-48s %12.3lf\n", s->first.c_str(), s->second / 1000000.0);
+	}
+	if(!counters.empty())
+	{
+		fprintf(fi, "\n%-48s %12s\n", "Counter", "Total");
+		for(map<string, long long>::iterator c = counters.begin(); c != counters.end(); ++c)
+			fprintf(fi, "%-48s %12lld\n", c->first.c_str(), c->second);
+	}
+}
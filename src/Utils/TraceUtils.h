@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+
+#ifndef TraceUtils_H
+#define TraceUtils_H
+
+/*
+
+	TraceUtils - THEORY OF OPERATION
+
+	StElapsedTime and the TIMER macros print one line per scope and leave you to add it up.  The tracer records
+	nested zones, counters and progress stages from every thread into a timeline that can be loaded into Chrome's
+	about://tracing or ui.perfetto.dev, and prints a flat summary (calls, total and self time per zone, counter
+	totals, stage times) at the end of a run.  Every StElapsedTime (and so every TIMER) is also a zone, so the
+	scopes people already time show up in the trace without being converted.
+
+	ZONES are scoped: declare a TRACE_Zone (or use TRACE_ZONE) and it covers the rest of the block.  Zones nest,
+	and each thread gets its own timeline.  The zone name is not copied - it has to be a string literal or some
+	other string that outlives the trace.
+
+	COUNTERS (TRACE_COUNT) keep a running total per thread.  The trace gets a sample of each counter that changed
+	when the zone around it closes, not on every call, so counting every point inserted is cheap.
+
+	STAGES are what the PROGRESS_START/PROGRESS_DONE macros feed in: a named span that doesn't have to follow
+	block scope.  PROGRESS_SHOW/PROGRESS_CHECK add a progress sample (in whole percent) to the stage.
+
+	Each thread appends to its own buffer with no locking, found through thread-local storage; the lock is taken
+	only the first time a thread records anything.  When a thread exits, its open zones are closed and its buffer
+	is handed to the next thread that starts recording, so the workers each THREAD_ParallelFor starts and joins
+	share buffers instead of leaving a mostly empty block apiece.  The timeline gets one row per buffer - as many
+	as were recording at once.  When tracing is off (the default) every macro is one test of
+	gTraceEnabled.  The buffers are read by TRACE_WriteChrome/TRACE_PrintSummary, so only call those when no
+	other thread is recording - e.g. after THREAD_ParallelFor returns or the job queue has been waited on.
+
+*/
+
+#include <stdio.h>
+
+extern int	gTraceEnabled;		// Read-only - use TRACE_Enable.
+
+void	TRACE_Enable(bool enable);
+void	TRACE_Clear(void);		// Throws away everything recorded so far.  Same rules as writing.
+
+// The raw calls behind the macros.  Begin and End must pair up on the same thread - prefer TRACE_Zone.
+void	TRACE_Begin(const char * zone);
+void	TRACE_End(void);
+void	TRACE_Count(const char * counter, long long delta);
+void	TRACE_StageBegin(const char * stage);		// Stage names ARE copied.
+void	TRACE_StageProgress(const char * stage, float progress);
+void	TRACE_StageEnd(const char * stage);
+
+// Chrome trace event format (JSON), for about://tracing or Perfetto.  Returns false if the file can't be written.
+bool	TRACE_WriteChrome(const char * path);
+void	TRACE_PrintSummary(FILE * fi);
+
+class	TRACE_Zone {
+public:
+	explicit	TRACE_Zone(const char * zone) : mOn(gTraceEnabled) { if (mOn) TRACE_Begin(zone); }
+				~TRACE_Zone() { if (mOn) TRACE_End(); }
+private:
+				 TRACE_Zone(const TRACE_Zone&);
+	TRACE_Zone&	 operator=(const TRACE_Zone&);
+
+	bool		mOn;		// Remembered, so turning tracing on or off mid-zone doesn't unbalance the timeline.
+};
+
+#define TRACE_ZONE_NAME2(x, y)			x##y
+#define TRACE_ZONE_NAME(x, y)			TRACE_ZONE_NAME2(x, y)
+#define TRACE_ZONE(__NAME)				TRACE_Zone TRACE_ZONE_NAME(__TraceZone, __LINE__)(__NAME);
+#define TRACE_COUNT(__NAME, __DELTA)	if (gTraceEnabled) TRACE_Count(__NAME, __DELTA);
+
+#endif /* TraceUtils_H */
@@ -25,6 +25,10 @@
 #if DEV
 //Adds the abilty to bring up a console for debuging
 #include <stdio.h>
+void	TEST_GroupCommands(void);
+#if WITHNWLINK
+void	TEST_NWBinary(void);
+#endif
 #endif
 
 #include "WED_AboutBox.h"
@@ -52,6 +56,8 @@
 #include "GUI_Splitter.h"
 
 #include "WED_FileCache.h"
+#include "TraceUtils.h"
+#include "WED_Batch.h"
 
 #define	REGISTER_LIST	\
 	_R(WED_Airport) \
@@ -120,6 +126,16 @@ HINSTANCE gInstance = NULL;
 #include "initializer.h"
 #endif
 
+static void register_classes(void)
+{
+	#define _R(x)	x##_Register();
+	REGISTER_LIST
+	#if AIRPORT_ROUTING
+	REGISTER_LIST_ATC
+	#endif
+	#undef _R
+}
+
 
 #if IBM
 int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd)
@@ -130,7 +146,22 @@ int main(int argc, char * argv[])
 #if IBM
 	gInstance = hInstance;
 	SetErrorMode(SEM_NOOPENFILEERRORBOX|SEM_FAILCRITICALERRORS);
+	int argc = __argc;
+	char ** argv = __argv;
+#endif
+#if DEV
+	if(argc == 2 && strcmp(argv[1], "--selftest") == 0)
+	{
+		TEST_GroupCommands();
+	#if WITHNWLINK
+		TEST_NWBinary();
+	#endif
+		return 0;
+	}
 #endif
+	if(WED_IsBatchCommandLine(argc, argv))
+		return WED_BatchMain(argc, argv, register_classes);
+
 	GUI_MemoryHog::InstallNewHandler();
 	GUI_InitClipboard();
 #if LIN
@@ -175,6 +206,11 @@ int main(int argc, char * argv[])
 	GUI_Prefs_Read("WED");
 	WED_Document::ReadGlobalPrefs();
 
+	// Set trace_file in the [debug] section of the prefs to record a trace of the whole session; written at quit.
+	string trace_file(GUI_GetPrefString("debug","trace_file",""));
+	if(!trace_file.empty())
+		TRACE_Enable(true);
+
 	start->ShowMessage("Scanning X-System Folder...");
 	pMgr.SetXPlaneFolder(GUI_GetPrefString("packages","xsystem",""));
 
@@ -190,12 +226,7 @@ int main(int argc, char * argv[])
 	ENUM_Init();
 
 	start->ShowMessage("Registering classes...");
-	#define _R(x)	x##_Register();
-	REGISTER_LIST
-	#if AIRPORT_ROUTING
-	REGISTER_LIST_ATC
-	#endif
-	#undef _R
+	register_classes();
 
 	app.SetAbout(about);
 
@@ -226,5 +257,17 @@ int main(int argc, char * argv[])
 	WED_Document::WriteGlobalPrefs();
 	GUI_Prefs_Write("WED");
 
+	if(!trace_file.empty())
+	{
+		TRACE_Enable(false);
+		TRACE_WriteChrome(trace_file.c_str());
+		FILE * summary = fopen((trace_file + ".txt").c_str(), "w");
+		if(summary)
+		{
+			TRACE_PrintSummary(summary);
+			fclose(summary);
+		}
+	}
+
 	return 0;
 }
@@ -40,6 +40,7 @@
 int gIsFeet = 0;
 int gInfoDMS = 0;
 int gModeratorMode = 0;
+int gOrthoFastDXT = 0;
 
 static int settings_bounds[4] = { 0, 0, 512, 384};
 
@@ -121,6 +122,10 @@ void WED_Settings::ReceiveMessage(
 	{
 			gModeratorMode = ((GUI_Button *) inParam)->GetValue();
 	}
+	else if(inMsg == (intptr_t) &gOrthoFastDXT)
+	{
+			gOrthoFastDXT = ((GUI_Button *) inParam)->GetValue();
+	}
 /*	else if (inMsg == kMsg_Close)
 	{
 		Hide();
@@ -140,6 +145,7 @@ WED_Settings::WED_Settings(GUI_Commander * cmdr) : GUI_Window("WED Preferences",
 
 	RadioButton(220, 350 , this, &gIsFeet, "Length Units", "Meters", "Feet");
 	RadioButton(220, 300 , this, &gInfoDMS, "Info Bar\nCoordinates", "DD.DDDDD", "DD MM SS");
+	RadioButton(220, 200 , this, &gOrthoFastDXT, "Orthophoto\nDDS Encoder", "Best", "Fast");
 	
 	int k_yes[4] = { 0, 1, 1, 3 };
 	int k_no[4]  = { 0, 2, 1, 3 };
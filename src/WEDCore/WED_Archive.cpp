@@ -36,7 +36,7 @@ WED_Archive::WED_Archive(IResolver * r) : mResolver(r), mDying(false), mUndo(NUL
  #if WITHNWLINK
  mNWAdapter(NULL),
  #endif
- mID(1), mOpCount(0), mCacheKey(0)
+ mID(1), mOpCount(0), mCacheKey(0), mChangeLogStart(0), mBulkFirstID(0)
 {
 
 }
@@ -69,11 +69,15 @@ void		WED_Archive::ChangedObject(WED_Persistent * inObject, int change_kind)
 {
 	if (mDying) return;
 	++mCacheKey;
+	if (!mBulkFirstID) LogChange(inObject->GetID());
 #if WITHNWLINK
 	if (mNWAdapter) mNWAdapter->ObjectChanged(inObject, change_kind);
 #endif
 	if (mUndo == UNDO_DISCARD) return;
-	if (mUndo)	mUndo->ObjectChanged(inObject, change_kind);
+	// Undo keeps the state from BEFORE the command, and an object made in this command had none - so there is nothing to find.
+	if (mBulkFirstID && inObject->GetID() >= mBulkFirstID && mUndo)
+		mUndo->MarkChanged(change_kind);
+	else if (mUndo)	mUndo->ObjectChanged(inObject, change_kind);
 	else		DebugAssert(!"Error: object changed outside of a command.");
 }
 
@@ -81,6 +85,7 @@ void		WED_Archive::AddObject(WED_Persistent * inObject)
 {
 	if (mDying) return;
 	++mCacheKey;
+	if (!mBulkFirstID) LogChange(inObject->GetID());
 	mID = max(mID,inObject->GetID()+1);
 	ObjectMap::iterator iter = mObjects.find(inObject->GetID());
 	DebugAssert(iter == mObjects.end() || iter->second == NULL);
@@ -100,6 +105,7 @@ void		WED_Archive::RemoveObject(WED_Persistent * inObject)
 {
 	if (mDying) return;
 	++mCacheKey;
+	if (!mBulkFirstID) LogChange(inObject->GetID());
 	ObjectMap::iterator iter = mObjects.find(inObject->GetID());
 	Assert(iter != mObjects.end());
 	iter->second = NULL;
@@ -120,20 +126,47 @@ void	WED_Archive::ClearAll(void)
 		ob->second->Delete();
 }
 
-void			WED_Archive::SaveToXML(WED_XMLElement * parent)
+void			WED_Archive::SaveToXML(WED_XMLWriter * writer)
 {
 	// old code bumps cache key on save...wHY?!
 	//++mCacheKey;
-	WED_XMLElement * obj = parent->add_sub_element("objects");
+	writer->open_element("objects");
 	for (ObjectMap::iterator ob = mObjects.begin(); ob != mObjects.end(); ++ob)
 	if(ob->second != NULL)
-	{
-		ob->second->ToXML(obj);
-		obj->flush();
-	}
+		ob->second->ToXML(writer);
+	writer->close_element();
 
 	mOpCount = 0;
 }
+
+void			WED_Archive::ReserveObjects(int count)
+{
+#if defined(_MSC_VER)
+	mObjects.rehash(count);
+#else
+	mObjects.resize(count);
+#endif
+}
+
+void			WED_Archive::StartBulkCreate(int expected_objects)
+{
+	DebugAssert(mBulkFirstID == 0);
+	DebugAssert(mUndo != NULL);		// Only inside a command - the undo layer must know the objects as created.
+	mBulkFirstID = mID;
+	ReserveObjects(mObjects.size() + expected_objects);
+	if (mUndo && mUndo != UNDO_DISCARD)
+		mUndo->Reserve(expected_objects);
+}
+
+void			WED_Archive::EndBulkCreate(void)
+{
+	DebugAssert(mBulkFirstID != 0);
+	mBulkFirstID = 0;
+	// Skip a change number: anyone synced before the bulk now finds GetChangesSince failing and rebuilds.
+	mChangeLogStart = ChangeLogEnd() + 1;
+	mChangeLog.clear();
+}
+
 #if WITHNWLINK
 void			WED_Archive::SetNWLinkAdapter(WED_NWLinkAdapter * inAdapter)
 {
@@ -154,6 +187,7 @@ void			WED_Archive::__StartCommand(const string& inName, const char * file, int
 void			WED_Archive::CommitCommand(void)
 {
 	DebugAssert(mUndoMgr != NULL);
+	DebugAssert(mBulkFirstID == 0);
 	// Inc this first, so that anyone listening (via the undo mgr) sees we are dirty!
 	++mOpCount;
 	mUndoMgr->CommitCommand();
@@ -168,6 +202,10 @@ void			WED_Archive::AbortCommand(void)
 {
 	++mCacheKey;
 
+	// Whoever started the bulk create threw before ending it - the undo takes the objects out again either way.
+	if (mBulkFirstID)
+		EndBulkCreate();
+
 	DebugAssert(mUndoMgr != NULL);
 	mUndoMgr->AbortCommand();
 }
@@ -182,6 +220,27 @@ long long WED_Archive::CacheKey(void)
 	return mCacheKey;
 }
 
+// Past this many entries, we drop the log and anyone behind has to rebuild - by then that is cheaper anyway.
+#define MAX_CHANGE_LOG	(1024*1024)
+
+void	WED_Archive::LogChange(int id)
+{
+	if (mChangeLog.size() >= MAX_CHANGE_LOG)
+	{
+		mChangeLogStart += mChangeLog.size();
+		mChangeLog.clear();
+	}
+	mChangeLog.push_back(id);
+}
+
+bool	WED_Archive::GetChangesSince(long long since, vector<int>& out_ids) const
+{
+	if (since < mChangeLogStart || since > ChangeLogEnd())
+		return false;
+	out_ids.insert(out_ids.end(), mChangeLog.begin() + (since - mChangeLogStart), mChangeLog.end());
+	return true;
+}
+
 int		WED_Archive::IsDirty(void)
 {
 	return mOpCount;
@@ -51,7 +51,7 @@ struct sqlite3;
 class	WED_Persistent;
 class	WED_UndoLayer;
 class	WED_UndoMgr;
-class	WED_XMLElement;
+class	WED_XMLWriter;
 class	IResolver;
 #if WITHNWLINK
 class	WED_NWLinkAdapter;
@@ -80,7 +80,16 @@ public:
 	void			ClearAll(void);
 	void			LoadFromDB(sqlite3 * db, const map<int,int>& mapping);
 	void			SaveToDB(sqlite3 * db);
-	void			SaveToXML(WED_XMLElement * parent);
+	void			SaveToXML(WED_XMLWriter * writer);
+	// Pre-sizes the object table for a bulk load of about this many objects.
+	void			ReserveObjects(int count);
+
+	// Bulk create: for making a LOT of new objects in one command, e.g. a global apt.dat import.  While it is on, changes to
+	// objects created since the start skip the undo layer and the change log - the creation already tells them everything they
+	// need.  The change log is cut at the end instead of logging every object, so views rebuild once.  Start and end inside
+	// one command.
+	void			StartBulkCreate(int expected_objects);
+	void			EndBulkCreate(void);
 #if WITHNWLINK
 	void			SetNWLinkAdapter(WED_NWLinkAdapter * inAdapter);
 #endif
@@ -95,6 +104,12 @@ public:
 
 	long long		CacheKey(void);
 
+	// Change log: the IDs of objects created, destroyed or changed, in order, so views can update just what changed.  Remember
+	// ChangeLogEnd() when you sync, and later GetChangesSince appends the IDs touched after that (with repeats).  It returns false
+	// if the log has been trimmed past that point, in which case you have to rebuild from scratch.
+	long long		ChangeLogEnd(void) const { return mChangeLogStart + mChangeLog.size(); }
+	bool			GetChangesSince(long long since, vector<int>& out_ids) const;
+
 	void			Validate(void);
 
 	IResolver *		GetResolver(void) { return mResolver; }
@@ -110,11 +125,13 @@ public:
 private:
 
 	void			ChangedObject	(WED_Persistent * inObject, int change_kind);
+	void			LogChange		(int id);
 	void			AddObject		(WED_Persistent * inObject);
 	void			RemoveObject	(WED_Persistent * inObject);
 
 	friend class	WED_Persistent;
 	friend	class	WED_UndoMgr;
+	friend	class	WED_Snapshot;
 	typedef hash_map<int, WED_Persistent *>	ObjectMap;
 
 	ObjectMap		mObjects;		// Our objects!
@@ -133,6 +150,9 @@ private:
 	int				mOpCount;
 
 	long long		mCacheKey;
+	vector<int>		mChangeLog;
+	long long		mChangeLogStart;	// Change number of mChangeLog[0]
+	int				mBulkFirstID;		// First ID made in bulk create mode, 0 if not in it
 
 	IResolver *		mResolver;
 
@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "WED_Batch.h"
+#include "WED_Document.h"
+#include "WED_PackageMgr.h"
+#include "WED_Globals.h"
+#include "WED_Errors.h"
+#include "WED_Version.h"
+#include "WED_Validate.h"
+#include "WED_Airport.h"
+#include "WED_HierarchyUtils.h"
+#include "WED_ToolUtils.h"
+#include "WED_SceneryPackExport.h"
+#include "WED_DSFExport.h"
+#include "WED_AptIE.h"
+#include "WED_Assert.h"
+#include "WED_EnumSystem.h"
+#include "WED_FileCache.h"
+#if HAS_GATEWAY
+#include "WED_GatewayExport.h"
+#endif
+#include "ILibrarian.h"
+#include "GUI_Prefs.h"
+#include "PlatformUtils.h"
+#include "FileUtils.h"
+#include "ThreadUtils.h"
+#include "PerfUtils.h"
+#include <json/json.h>
+
+#if IBM
+#define popen _popen
+#define pclose _pclose
+#endif
+
+#define BATCH_RESULT_TAG "WED_BATCH_RESULT "
+
+struct	batch_target_t {
+	const char *		name;
+	WED_Export_Target	target;
+};
+
+static const batch_target_t	k_targets[] = {
+	{ "900",		wet_xplane_900	},
+	{ "1000",		wet_xplane_1000	},
+	{ "1021",		wet_xplane_1021	},
+	{ "1050",		wet_xplane_1050	},
+	{ "1100",		wet_xplane_1100	},
+#if HAS_GATEWAY
+	{ "gateway",	wet_gateway		},
+#endif
+	{ NULL,			wet_latest_xplane }
+};
+
+struct	batch_options_t {
+	string				exe;				// how to launch another one of us
+	string				xsystem;
+	bool				all;
+	bool				do_export;
+	string				target;				// empty means whatever each package was last exported for
+	int					jobs;
+	string				results;
+	vector<string>		packages;
+	string				child_package;		// if not empty, we ARE the child - run this and report
+};
+
+static double	batch_seconds(unsigned long long start)
+{
+	return hpc_to_microseconds(query_hpc() - start) / 1000000.0;
+}
+
+static void	batch_usage(const char * msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	fprintf(stderr, "usage: WED --batch [--xsystem <folder>] [--all] [--validate] [--export] [--target 900|1000|1021|1050|1100"
+#if HAS_GATEWAY
+		"|gateway"
+#endif
+		"] [--jobs <n>] [--results <file>] package...\n");
+}
+
+static bool	batch_parse_args(int argc, char * argv[], batch_options_t& opts)
+{
+	opts.exe = argv[0];
+#if IBM
+	// argv[0] is whatever the user typed; the module path works no matter how we got launched.
+	opts.exe = GetApplicationPath();
+#endif
+	opts.xsystem = GUI_GetPrefString("packages","xsystem","");
+	opts.all = false;
+	opts.do_export = false;
+	opts.jobs = 0;
+
+	for(int n = 1; n < argc; ++n)
+	{
+		string a(argv[n]);
+		bool has_value = n + 1 < argc;
+		if(a == "--batch" || a == "--validate")
+			continue;
+		else if(a == "--export")
+			opts.do_export = true;
+		else if(a == "--all")
+			opts.all = true;
+		else if(a == "--xsystem" && has_value)
+			opts.xsystem = argv[++n];
+		else if(a == "--results" && has_value)
+			opts.results = argv[++n];
+		else if(a == "--batch-package" && has_value)
+			opts.child_package = argv[++n];
+		else if(a == "--jobs" && has_value)
+		{
+			opts.jobs = atoi(argv[++n]);
+			if(opts.jobs < 1)
+			{
+				batch_usage("--jobs needs a number of 1 or more.");
+				return false;
+			}
+		}
+		else if(a == "--target" && has_value)
+		{
+			opts.target = argv[++n];
+			const batch_target_t * t = k_targets;
+			while(t->name && opts.target != t->name)
+				++t;
+			if(t->name == NULL)
+			{
+				batch_usage(("Unknown export target: " + opts.target).c_str());
+				return false;
+			}
+		}
+		else if(a.size() > 1 && a[0] == '-')
+		{
+			batch_usage(("Unknown or incomplete option: " + a).c_str());
+			return false;
+		}
+		else
+			opts.packages.push_back(a);
+	}
+
+	if(opts.child_package.empty() && opts.packages.empty() && !opts.all)
+	{
+		batch_usage("No packages to work on - name some, or use --all.");
+		return false;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------------------
+// ONE PACKAGE
+//------------------------------------------------------------------------------------------------------------
+
+// Alerts only come from the main thread today, but validation runs threads - don't bet on it staying that way.
+struct	batch_alerts_t {
+	THREAD_Mutex		lock;
+	vector<string>		msgs;
+};
+
+// Between packages there is nobody to collect alerts - they just go to stderr.
+static void	batch_stderr_alert_handler(const char * msg, void * ref)
+{
+	fprintf(stderr, "WED: %s\n", msg);
+}
+
+static void	batch_alert_handler(const char * msg, void * ref)
+{
+	batch_alerts_t * alerts = (batch_alerts_t *) ref;
+	THREAD_Lock	l(alerts->lock);
+	alerts->msgs.push_back(msg);
+}
+
+static int	batch_alert_count(batch_alerts_t& alerts)
+{
+	THREAD_Lock	l(alerts.lock);
+	return alerts.msgs.size();
+}
+
+static const char *	batch_target_name(WED_Export_Target t)
+{
+	for(const batch_target_t * i = k_targets; i->name; ++i)
+	if(i->target == t)
+		return i->name;
+	return "unknown";
+}
+
+static void	batch_export(WED_Document * doc, set<WED_Thing *>& problems)
+{
+	ILibrarian * lib = WED_GetLibrarian(doc);
+	WED_Thing * wrl = WED_GetWorld(doc);
+
+	string pack_base;
+	lib->LookupPath(pack_base);
+
+#if HAS_GATEWAY
+	// What the gateway dialog would upload, minus the upload: every airport's apt.dat and (if it has any) its
+	// overlay DSF, as text, side by side in one folder.
+	if(gExportTarget == wet_gateway)
+	{
+		string folder = pack_base + "Gateway Export" DIR_STR;
+		FILE_make_dir_exist(folder.c_str());
+
+		vector<WED_Airport *> apts;
+		CollectRecursiveNoNesting(wrl, back_inserter(apts), WED_Airport::sClass);
+		for(vector<WED_Airport *>::iterator a = apts.begin(); a != apts.end(); ++a)
+		{
+			string icao;
+			(*a)->GetICAO(icao);
+			if(WED_AirportHasDSFContent(*a))
+				DSF_ExportAirportOverlay(doc, *a, folder, problems);
+			WED_AptExport(*a, (folder + icao + ".dat").c_str());
+		}
+		return;
+	}
+#endif
+	WED_ExportPackToPath(wrl, doc, pack_base, problems);
+}
+
+static void	batch_run_package(const string& package, const batch_options_t& opts, Json::Value& rec)
+{
+	batch_alerts_t	alerts;
+	SetUserAlertHandler(batch_alert_handler, &alerts);
+
+	unsigned long long start = query_hpc();
+	rec["package"] = package;
+	rec["status"] = "failed";
+
+	WED_Export_Target old_target = gExportTarget;
+	try {
+		if(!FILE_exists(gPackageMgr->ComputePath(package, "earth.wed.xml").c_str()))
+			WED_ThrowPrintf("No earth.wed.xml in package '%s'.", package.c_str());
+
+		unsigned long long t = query_hpc();
+		double b[4] = { -180, -90, 180, 90 };
+		WED_Document * doc = new WED_Document(package, b);
+		rec["load_seconds"] = batch_seconds(t);
+
+		if(opts.target.empty())
+			gExportTarget = (WED_Export_Target) doc->ReadIntPref("doc/export_target", wet_latest_xplane);
+		else
+		{
+			const batch_target_t * i = k_targets;
+			while(i->name && opts.target != i->name)
+				++i;
+			gExportTarget = i->target;
+		}
+		rec["target"] = batch_target_name(gExportTarget);
+
+		vector<WED_Airport *> apts;
+		CollectRecursiveNoNesting(WED_GetWorld(doc), back_inserter(apts), WED_Airport::sClass);
+		rec["airports"] = (int) apts.size();
+
+		t = query_hpc();
+		validation_error_vector	msgs;
+		validation_result_t	result = WED_ValidateApt(doc, NULL, NULL, true, &msgs);
+		rec["validate_seconds"] = batch_seconds(t);
+
+		// stdout is the report, so the messages go to stderr - the counts are all the report carries.
+		int errors = 0;
+		for(validation_error_vector::iterator m = msgs.begin(); m != msgs.end(); ++m)
+		{
+			string aname;
+			if(m->airport)
+				m->airport->GetICAO(aname);
+			fprintf(stderr, "[%s] %s: %s%s\n", package.c_str(), aname.c_str(), m->msg.c_str(), m->err_code > warnings_start_here ? " (warning only)" : "");
+			if(m->err_code < warnings_start_here)
+				++errors;
+		}
+		rec["errors"] = errors;
+		rec["warnings"] = (int) msgs.size() - errors;
+		rec["status"] = result == validation_clean ? "clean" : (result == validation_warnings_only ? "warnings" : "errors");
+
+		// Same rule as the export command: never write out a package that doesn't validate.
+		if(opts.do_export)
+		{
+			if(result == validation_errors)
+				rec["export"] = "skipped";
+			else
+			{
+				int alerts_before = batch_alert_count(alerts);
+				set<WED_Thing *>	problems;
+				t = query_hpc();
+				batch_export(doc, problems);
+				rec["export_seconds"] = batch_seconds(t);
+				rec["export_problems"] = (int) problems.size();
+				rec["export"] = problems.empty() && batch_alert_count(alerts) == alerts_before ? "ok" : "problems";
+			}
+		}
+
+		delete doc;
+	}
+	// If we threw half way, the document may be in any state at all - leak it rather than run its destructor.
+	catch(exception& e) {
+		rec["error"] = e.what();
+	} catch(...) {
+		rec["error"] = "An unknown error occurred.";
+	}
+	gExportTarget = old_target;
+
+	SetUserAlertHandler(batch_stderr_alert_handler, NULL);
+
+	Json::Value alert_list(Json::arrayValue);
+	for(vector<string>::iterator a = alerts.msgs.begin(); a != alerts.msgs.end(); ++a)
+		alert_list.append(*a);
+	rec["alerts"] = alert_list;
+	rec["seconds"] = batch_seconds(start);
+}
+
+static bool	batch_package_ok(const Json::Value& rec)
+{
+	string status = rec["status"].asString();
+	if(status == "failed" || status == "errors")
+		return false;
+	return !rec.isMember("export") || rec["export"].asString() == "ok";
+}
+
+//------------------------------------------------------------------------------------------------------------
+// WORKER PROCESSES
+//------------------------------------------------------------------------------------------------------------
+
+struct	batch_job_t {
+	const batch_options_t *	opts;
+	string					package;
+	Json::Value				rec;
+};
+
+static string	batch_quote(const string& s)
+{
+#if IBM
+	// Windows file names can't have a quote in them, so this is enough.
+	return "\"" + s + "\"";
+#else
+	string r("'");
+	for(string::const_iterator c = s.begin(); c != s.end(); ++c)
+	if(*c == '\'')
+		r += "'\\''";
+	else
+		r += *c;
+	return r + "'";
+#endif
+}
+
+static void	batch_job(void * ref)
+{
+	batch_job_t * job = (batch_job_t *) ref;
+	const batch_options_t& opts(*job->opts);
+
+	string cmd = batch_quote(opts.exe) + " --batch --batch-package " + batch_quote(job->package);
+	if(!opts.xsystem.empty())	cmd += " --xsystem " + batch_quote(opts.xsystem);
+	if(!opts.target.empty())	cmd += " --target " + opts.target;
+	if(opts.do_export)			cmd += " --export";
+#if IBM
+	// cmd.exe strips the outer quotes off the whole line, then runs what is left.
+	cmd = "\"" + cmd + "\"";
+#endif
+
+	unsigned long long start = query_hpc();
+	bool got_result = false;
+	FILE * pipe = popen(cmd.c_str(), "r");
+	if(pipe)
+	{
+		string line;
+		char buf[1024];
+		while(fgets(buf, sizeof(buf), pipe))
+		{
+			line += buf;
+			if(line.empty() || line[line.size()-1] != '\n')
+				continue;
+			if(line.compare(0, strlen(BATCH_RESULT_TAG), BATCH_RESULT_TAG) == 0)
+			{
+				Json::Reader reader;
+				got_result = reader.parse(line.substr(strlen(BATCH_RESULT_TAG)), job->rec);
+			}
+			else
+				fprintf(stderr, "[%s] %s", job->package.c_str(), line.c_str());
+			line.clear();
+		}
+		int status = pclose(pipe);
+		if(!got_result)
+		{
+			char msg[256];
+			sprintf(msg, "The batch process for this package quit with status %d and no result.", status);
+			job->rec["error"] = msg;
+		}
+	}
+	else
+		job->rec["error"] = "Unable to start a batch process.";
+
+	if(!got_result)
+	{
+		job->rec["package"] = job->package;
+		job->rec["status"] = "failed";
+	}
+	// The child's own seconds leave out process start-up and app init; this is what the package really cost us.
+	job->rec["process_seconds"] = batch_seconds(start);
+}
+
+//------------------------------------------------------------------------------------------------------------
+// MAIN
+//------------------------------------------------------------------------------------------------------------
+
+bool	WED_IsBatchCommandLine(int argc, char * argv[])
+{
+	for(int n = 1; n < argc; ++n)
+	if(strcmp(argv[n], "--batch") == 0)
+		return true;
+	return false;
+}
+
+int		WED_BatchMain(int argc, char * argv[], void (* register_classes)(void))
+{
+	// Same start-up as the GUI minus everything that makes a window: no application object, no about box or GL
+	// contexts, no clipboard, no menus.  Nothing here may wait on a human, starting with the prefs reader.
+	// The prefs are read but never written, so a CI run can't disturb the GUI's settings.
+	SetUserAlertHandler(batch_stderr_alert_handler, NULL);
+	GUI_Prefs_Read("WED");
+	WED_Document::ReadGlobalPrefs();
+	WED_file_cache_init();
+	WED_AssertInit();
+	ENUM_Init();
+	register_classes();
+
+	setlocale(LC_ALL,"C");
+	#if LIN
+	setlocale(LC_CTYPE,"en_US.UTF-8");
+	#endif
+
+	batch_options_t	opts;
+	if(!batch_parse_args(argc, argv, opts))
+		return 2;
+
+	WED_PackageMgr	pMgr(NULL);
+	if(!pMgr.SetXPlaneFolder(opts.xsystem))
+	{
+		fprintf(stderr, "Unable to use '%s' as the X-System folder.\n", opts.xsystem.c_str());
+		return 2;
+	}
+
+	if(!opts.child_package.empty())
+	{
+		Json::Value rec;
+		batch_run_package(opts.child_package, opts, rec);
+		Json::FastWriter writer;
+		printf(BATCH_RESULT_TAG "%s", writer.write(rec).c_str());
+		fflush(stdout);
+		return batch_package_ok(rec) ? 0 : 1;
+	}
+
+	if(opts.all)
+	for(int n = 0; n < pMgr.CountCustomPackages(); ++n)
+	{
+		string name;
+		pMgr.GetNthCustomPackageName(n, name);
+		if(FILE_exists(pMgr.ComputePath(name, "earth.wed.xml").c_str()))
+			opts.packages.push_back(name);
+	}
+
+	unsigned long long start = query_hpc();
+	int jobs = THREAD_WorkerCount(opts.jobs);
+	vector<batch_job_t>	work(opts.packages.size());
+	for(int n = 0; n < work.size(); ++n)
+	{
+		work[n].opts = &opts;
+		work[n].package = opts.packages[n];
+	}
+
+	if(jobs == 1)
+	{
+		for(vector<batch_job_t>::iterator w = work.begin(); w != work.end(); ++w)
+			batch_run_package(w->package, opts, w->rec);
+	}
+	else
+	{
+		THREAD_JobQueue	queue(jobs);
+		for(vector<batch_job_t>::iterator w = work.begin(); w != work.end(); ++w)
+			queue.Add(batch_job, &*w);
+		queue.Wait();
+	}
+
+	Json::Value report;
+	Json::Value packages(Json::arrayValue);
+	int failed = 0;
+	for(vector<batch_job_t>::iterator w = work.begin(); w != work.end(); ++w)
+	{
+		if(!batch_package_ok(w->rec))
+			++failed;
+		packages.append(w->rec);
+	}
+	report["version"] = WED_VERSION_STRING;
+	report["jobs"] = jobs;
+	report["packages"] = packages;
+	report["failed"] = failed;
+	report["seconds"] = batch_seconds(start);
+
+	Json::StyledWriter writer;
+	string text = writer.write(report);
+	if(opts.results.empty())
+		fputs(text.c_str(), stdout);
+	else
+	{
+		FILE * fi = fopen(opts.results.c_str(), "w");
+		if(fi == NULL)
+		{
+			fprintf(stderr, "Unable to write results to '%s'.\n", opts.results.c_str());
+			fputs(text.c_str(), stdout);
+			return 1;
+		}
+		fputs(text.c_str(), fi);
+		fclose(fi);
+	}
+
+	SetUserAlertHandler(NULL, NULL);
+	return failed ? 1 : 0;
+}
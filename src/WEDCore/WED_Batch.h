@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef WED_Batch_H
+#define WED_Batch_H
+
+/*
+	WED_Batch - THEORY OF OPERATION
+
+	"WED --batch" validates and exports a list of scenery packages with no windows, no GL context and no event
+	loop, then prints one JSON report with the outcome and timings of every package.  It is for CI and for
+	measuring changes to WED itself.
+
+		WED --batch [options] package...
+
+		--xsystem <folder>	X-System folder; defaults to the one the GUI used last.
+		--all				every custom package in the X-System folder that has an earth.wed.xml.
+		--validate			validate only.  This is the default.
+		--export			validate, and if there are no errors, export: the whole scenery pack for X-Plane
+							targets, or each airport's apt.dat and overlay DSF into "Gateway Export" for gateway.
+		--target <t>		900, 1000, 1021, 1050, 1100 (the default) or gateway - same as the export target menu.
+		--jobs <n>			how many packages run at once; the default is one per core.
+		--results <file>	write the JSON here instead of to stdout.
+
+	Packages are named the way the start window names them: by their folder in Custom Scenery.  On Windows WED
+	is a GUI program with no console of its own, so use --results there.
+
+	Each package gets its own WED process.  A document leans on app globals - the package manager, the export
+	target, the file cache, the assert handler - so two documents can't load or export side by side in one
+	process.  Separate processes also mean an assert or a crash in one package just fails that package.  The
+	parent runs a THREAD_JobQueue with --jobs workers; each one launches "WED --batch-package <name>" with the same
+	options and waits for it.  The child prints its record on one line starting with BATCH_RESULT_TAG; anything
+	else it prints goes to our stderr with the package name in front.  With --jobs 1 there are no children at
+	all, the packages simply run in this process one after another.
+
+	Alerts that would have been dialogs (export problems, repaired documents, asserts) are collected into the
+	package's record instead - see SetUserAlertHandler.
+
+	The exit code is 0 if every package loaded, had no validation errors and exported cleanly (if asked to), 1 if
+	any didn't and 2 if the command line made no sense.
+*/
+
+// True if the command line asks for batch mode; call before any GUI gets made.
+bool	WED_IsBatchCommandLine(int argc, char * argv[]);
+
+// Does the non-GUI half of app start-up, runs the batch and returns the exit code.  register_classes is the
+// app's list of WED_Thing classes, which only WED_AppMain knows.
+int		WED_BatchMain(int argc, char * argv[], void (* register_classes)(void));
+
+#endif /* WED_Batch_H */
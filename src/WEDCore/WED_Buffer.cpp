@@ -53,57 +53,50 @@ WED_Buffer::~WED_Buffer()
 
 void	WED_Buffer::ResetRead(void)
 {
+	CloseWindows();
 	mReadIterator = mStorage;
 	mReadSubpos = 0;
+	OpenWindows();
 }
 
-void	WED_Buffer::ReadShort(short& v)
+void	WED_Buffer::CloseWindows(void)
 {
-	ReadInternal((char *) &v, sizeof(v));
-}
-void	WED_Buffer::ReadInt(int& v)
-{
-	ReadInternal((char *) &v, sizeof(v));
-}
-
-void	WED_Buffer::ReadFloat(float& v)
-{
-	ReadInternal((char *) &v, sizeof(v));
+	if (mReadEnd)
+		mReadSubpos = mReadPos - mReadIterator->data;
+	if (mWriteEnd)
+		mWriteIterator->size = mWritePos - mWriteIterator->data;
+	mReadPos = mReadEnd = NULL;
+	mWritePos = mWriteEnd = NULL;
 }
 
-void	WED_Buffer::ReadDouble(double& v)
+void	WED_Buffer::OpenWindows(void)
 {
-	ReadInternal((char *) &v, sizeof(v));
+	// If we are reading the block we are writing, the read window ends where the writing was when we opened it;
+	// reading past that just comes back through ReadMore, which picks up the new size.
+	if (mReadIterator)
+	{
+		mReadPos = mReadIterator->data + mReadSubpos;
+		mReadEnd = mReadIterator->data + mReadIterator->size;
+	}
+	if (mWriteIterator)
+	{
+		mWritePos = mWriteIterator->data + mWriteIterator->size;
+		mWriteEnd = mWriteIterator->data + mWriteIterator->capacity;
+	}
 }
 
-void	WED_Buffer::ReadBulk(char * inBuf, int inLength, bool inZip)
+void	WED_Buffer::ReadMore(char * inBuf, int inLength)
 {
+	CloseWindows();
 	ReadInternal(inBuf, inLength);
+	OpenWindows();
 }
 
-void	WED_Buffer::WriteShort(short v)
-{
-	WriteInternal((const char *) &v, sizeof(v));
-}
-
-void	WED_Buffer::WriteInt(int v)
-{
-	WriteInternal((const char *) &v, sizeof(v));
-}
-
-void	WED_Buffer::WriteFloat(float v)
-{
-	WriteInternal((const char *) &v, sizeof(v));
-}
-
-void	WED_Buffer::WriteDouble(double v)
-{
-	WriteInternal((const char *) &v, sizeof(v));
-}
-
-void	WED_Buffer::WriteBulk(const char * inBuf, int inLength, bool inZip)
+void	WED_Buffer::WriteMore(const char * inBuf, int inLength)
 {
+	CloseWindows();
 	WriteInternal(inBuf, inLength);
+	OpenWindows();
 }
 
 void	WED_Buffer::ReadInternal(char* p, unsigned long l)
@@ -164,6 +157,7 @@ void	WED_Buffer::WriteInternal(const char * p, unsigned long l)
 
 void *	WED_Buffer::AllocContiguous(int len)
 {
+	CloseWindows();
 	// How much capacity do we already have?
 	unsigned long a = mStorage == NULL ? 0 : mWriteIterator->capacity - mWriteIterator->size;
 	if (a >= len)
@@ -171,6 +165,7 @@ void *	WED_Buffer::AllocContiguous(int len)
 		// If our block has enough space, simply cut off an area.
 		void * p = (mWriteIterator->data + mWriteIterator->size);
 		mWriteIterator->size += len;
+		OpenWindows();
 		return p;
 	}
 
@@ -186,11 +181,14 @@ void *	WED_Buffer::AllocContiguous(int len)
 	buf->capacity = alloc_size - sizeof(Storage);
 	buf->size = len;
 	mWriteIterator = buf;
+	OpenWindows();
 	return buf->data;
 }
 
 void WED_Buffer::GetWritePos(intptr_t& a, intptr_t& b)
 {
+	CloseWindows();
+	OpenWindows();
 	a = (intptr_t) mWriteIterator;
 	// Careful: if we still have spare space left, the next write will go into THIS last buffer,
 	// otherwise a new one gets chopped.  This is correct for normal writes but NOT for contigous alloc.
@@ -200,9 +198,11 @@ void WED_Buffer::GetWritePos(intptr_t& a, intptr_t& b)
 
 void WED_Buffer::SetReadPos(uintptr_t a, int b)
 {
+	CloseWindows();
 	mReadIterator = (Storage *) a;
 	if (mReadIterator == NULL && mStorage != NULL)
 		mReadIterator = mStorage;
 	mReadSubpos = b;
+	OpenWindows();
 }
 
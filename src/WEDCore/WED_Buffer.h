@@ -41,6 +41,11 @@
 	split; the buffer may waste some space to do this.  The pointer is stable for the life
 	of the buffer.
 
+	The IOReader/IOWriter windows are the unread part of the block we are reading and the free
+	part of the block we are writing, so most reads and writes never leave the inline path.  Any
+	time we go to the block list we fold the windows back into mReadSubpos and the write block's
+	size first, then open them again afterward.
+
 */
 
 #include "IODefs.h"
@@ -60,27 +65,21 @@ public:
 
 //			void	Reserve(unsigned long inBytes);
 
-	// IOReader
-	virtual	void	ReadShort(short&);
-	virtual	void	ReadInt(int&);
-	virtual	void	ReadFloat(float&);
-	virtual	void	ReadDouble(double&);
-	virtual	void	ReadBulk(char * inBuf, int inLength, bool inZip);
-
-	// IOWriter
-	virtual	void	WriteShort(short);
-	virtual	void	WriteInt(int);
-	virtual	void	WriteFloat(float);
-	virtual	void	WriteDouble(double);
-	virtual	void	WriteBulk(const char * inBuf, int inLength, bool inZip);
-
 			void	ResetRead(void);				// Resets reading to the beginning.
 			void *	AllocContiguous(int len);		// Allocates a chunk of memory that is not split across buffers.
 			void	GetWritePos(intptr_t& a, intptr_t& b);	// Get and set arbitrary positions as two ints.
 			void	SetReadPos(uintptr_t a, int b);
 
+protected:
+
+	virtual	void	ReadMore(char * inBuf, int inLength);
+	virtual	void	WriteMore(const char * inBuf, int inLength);
+
 private:
 
+			void	CloseWindows(void);
+			void	OpenWindows(void);
+
 			void	ReadInternal (char * p, unsigned long l);
 			void	WriteInternal(const char * p, unsigned long l);
 
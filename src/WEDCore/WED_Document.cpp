@@ -42,6 +42,7 @@
 #include "WED_Messages.h"
 #include "WED_EnumSystem.h"
 #include "WED_XMLWriter.h"
+#include "WED_Snapshot.h"
 #include "WED_Errors.h"
 #include "GUI_Resources.h"
 #include "GUI_Prefs.h"
@@ -270,6 +271,12 @@ void	WED_Document::Save(void)
 		// This is the save-was-okay case.
 		mOnDisk=true;
 	}
+
+	// The snapshot is only a load accelerator - if we can't write one, the old one is stale anyway, so lose it.
+	string snap = mFilePath + ".snap";
+	if(ferrorErr != 0 || fcloseErr != 0 || !WED_Snapshot::Save(snap, xml, &mArchive, mDocPrefs, mDocPrefsItems))
+		if(FILE_exists(snap.c_str()))
+			FILE_delete_file(snap.c_str(), false);
 	
 	//if the second backup still exists after the error handling
 	if(FILE_exists(tempBakBak.c_str()) == true)
@@ -299,9 +306,19 @@ void	WED_Document::Revert(void)
 		fname+=".xml";
 		mArchive.ClearAll();
 
-		// First: try to IO the XML file.
-		bool xml_exists;
-		string result = reader.ReadFile(fname.c_str(),&xml_exists);
+		// First: see if we have a binary snapshot that matches the XML file - that is a LOT faster to load.
+		// If it's stale or damaged, throw out whatever it got us and go to the XML file.
+		bool xml_exists = false;
+		string result;
+		if(WED_Snapshot::Load(mFilePath + ".snap", fname, &mArchive, mDocPrefs, mDocPrefsItems))
+			xml_exists = true;
+		else
+		{
+			mArchive.ClearAll();
+			mDocPrefs.clear();
+			mDocPrefsItems.clear();
+			result = reader.ReadFile(fname.c_str(),&xml_exists);
+		}
 
 		if(xml_exists && !result.empty())
 			WED_ThrowPrintf("Unable to open XML file: %s",result.c_str());
@@ -562,12 +579,18 @@ void	WED_Document::ReadGlobalPrefs(void)
 	
 	*(int *) &gIsFeet  = atoi(GUI_GetPrefString("preferences","use_feet","0"));    // This is ugly, but I really wanna override the write protection 
 	*(int *) &gInfoDMS = atoi(GUI_GetPrefString("preferences","InfoDMS","0"));     // given in WED_Globals.h to these variables here.
+	*(int *) &gOrthoFastDXT = atoi(GUI_GetPrefString("preferences","OrthoFastDXT","0"));
+	WED_UndoMgr::SetMemoryBudget((size_t) atoi(GUI_GetPrefString("preferences","UndoMemoryMB","256")) * 1024 * 1024);
 }
 
 void	WED_Document::WriteGlobalPrefs(void)
 {
 	GUI_SetPrefString("preferences","use_feet",gIsFeet ? "1" : "0");
 	GUI_SetPrefString("preferences","InfoDMS",gInfoDMS ? "1" : "0");
+	GUI_SetPrefString("preferences","OrthoFastDXT",gOrthoFastDXT ? "1" : "0");
+	char undo_mb[32];
+	snprintf(undo_mb, sizeof(undo_mb), "%d", (int) (WED_UndoMgr::GetMemoryBudget() / (1024 * 1024)));
+	GUI_SetPrefString("preferences","UndoMemoryMB",undo_mb);
 	
 	for (map<string,string>::iterator i = sGlobalPrefs.begin(); i != sGlobalPrefs.end(); ++i)
 		GUI_SetPrefString("doc_prefs", i->first.c_str(), i->second.c_str());
@@ -675,29 +698,32 @@ void WED_Document::Panic(void)
 void		WED_Document::WriteXML(FILE * xml_file)
 {
 	//print to file the xml file passed in with the following encoding
-	fprintf(xml_file,"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	WED_XMLWriter	writer(xml_file);
+	writer.write_raw("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	writer.open_element("doc");
+	mArchive.SaveToXML(&writer);
+	writer.open_element("prefs");
+	for(map<string,set<int> >::iterator pi = mDocPrefsItems.begin(); pi != mDocPrefsItems.end(); ++pi)
 	{
-		WED_XMLElement	top_level("doc",0,xml_file);
-		mArchive.SaveToXML(&top_level);
-		WED_XMLElement * pref;
-		WED_XMLElement * prefs = top_level.add_sub_element("prefs");
-		for(map<string,set<int> >::iterator pi = mDocPrefsItems.begin(); pi != mDocPrefsItems.end(); ++pi)
-		{
-			pref = prefs->add_sub_element("pref");
-			pref->add_attr_stl_str("name",pi->first);
-			for(set<int>::iterator i = pi->second.begin(); i != pi->second.end(); ++i)
-			{
-				WED_XMLElement *item = pref->add_sub_element("item");
-				item->add_attr_int("value",*i);
-			}
-		}
-		for(map<string,string>::iterator p = mDocPrefs.begin(); p != mDocPrefs.end(); ++p)
+		writer.open_element("pref");
+		writer.add_attr_stl_str("name",pi->first);
+		for(set<int>::iterator i = pi->second.begin(); i != pi->second.end(); ++i)
 		{
-			pref = prefs->add_sub_element("pref");
-			pref->add_attr_stl_str("name",p->first);
-			pref->add_attr_stl_str("value",p->second);
+			writer.open_element("item");
+			writer.add_attr_int("value",*i);
+			writer.close_element();
 		}
+		writer.close_element();
+	}
+	for(map<string,string>::iterator p = mDocPrefs.begin(); p != mDocPrefs.end(); ++p)
+	{
+		writer.open_element("pref");
+		writer.add_attr_stl_str("name",p->first);
+		writer.add_attr_stl_str("value",p->second);
+		writer.close_element();
 	}
+	writer.close_element();
+	writer.close_element();
 }
 
 
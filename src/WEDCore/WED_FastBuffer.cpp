@@ -25,45 +25,13 @@
 #include "WED_Buffer.h"
 
 
-void	WED_FastBuffer::ReadShort(short& x)
+void	WED_FastBuffer::ReadMore(char * inBuf, int inLength)
 {
-	mSource->ReadShort(x);
+	mSource->ReadBulk(inBuf,inLength,false);
 }
-void	WED_FastBuffer::ReadInt(int& x)
+void	WED_FastBuffer::WriteMore(const char * inBuf, int inLength)
 {
-	mSource->ReadInt(x);
-}
-void	WED_FastBuffer::ReadFloat(float& x)
-{
-	mSource->ReadFloat(x);
-}
-void	WED_FastBuffer::ReadDouble(double& x)
-{
-	mSource->ReadDouble(x);
-}
-void	WED_FastBuffer::ReadBulk(char * inBuf, int inLength, bool inZip)
-{
-	mSource->ReadBulk(inBuf,inLength,inZip);
-}
-void	WED_FastBuffer::WriteShort(short x)
-{
-	mSource->WriteShort(x);
-}
-void	WED_FastBuffer::WriteInt(int x)
-{
-	mSource->WriteInt(x);
-}
-void	WED_FastBuffer::WriteFloat(float x)
-{
-	mSource->WriteFloat(x);
-}
-void	WED_FastBuffer::WriteDouble(double x)
-{
-	mSource->WriteDouble(x);
-}
-void	WED_FastBuffer::WriteBulk(const char * inBuf, int inLength, bool inZip)
-{
-	mSource->WriteBulk(inBuf,inLength,inZip);
+	mSource->WriteBulk(inBuf,inLength,false);
 }
 
 WED_FastBuffer::WED_FastBuffer(WED_Buffer * source)
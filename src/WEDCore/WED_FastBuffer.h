@@ -42,6 +42,9 @@
 
 	Each fast buffer knows the stream position of its data.
 
+	A fast buffer has no IOReader/IOWriter window of its own - it can't, since its bytes live in the pool's
+	buffer alongside everyone else's - so each number costs one virtual call to get to the pool's inline path.
+
 */
 
 #include "IODefs.h"
@@ -50,19 +53,12 @@
 class	WED_FastBuffer : public IOReader, public IOWriter {
 public:
 
-	virtual	void	ReadShort(short&);
-	virtual	void	ReadInt(int&);
-	virtual	void	ReadFloat(float&);
-	virtual	void	ReadDouble(double&);
-	virtual	void	ReadBulk(char * inBuf, int inLength, bool inZip);
+			void	ResetRead(void);
 
-	virtual	void	WriteShort(short);
-	virtual	void	WriteInt(int);
-	virtual	void	WriteFloat(float);
-	virtual	void	WriteDouble(double);
-	virtual	void	WriteBulk(const char * inBuf, int inLength, bool inZip);
+protected:
 
-			void	ResetRead(void);
+	virtual	void	ReadMore(char * inBuf, int inLength);
+	virtual	void	WriteMore(const char * inBuf, int inLength);
 
 private:
 
@@ -46,6 +46,7 @@ void	debug_mesh_polygon(const Polygon2& p1, float r1, float g1, float b1);
 	extern	int	gIsFeet;
 	extern	int	gInfoDMS;
 	extern	int	gModeratorMode;
+	extern	int	gOrthoFastDXT;
 #else
 	/* Is WED running in English or metric units?  (feet == 0 -> metric.) */
 	extern const int gIsFeet;
@@ -56,6 +57,9 @@ void	debug_mesh_polygon(const Polygon2& p1, float r1, float g1, float b1);
 	/* Changes the listing in the gateway Import for GW moderation purposes */
 	extern const int gModeratorMode;
 
+	/* DXT encoder for orthophoto DDS files: 0 = squish's best (slow) fit, 1 = its fast range fit */
+	extern const int gOrthoFastDXT;
+
 #endif
 
 enum WED_Export_Target {
@@ -69,6 +69,9 @@ public:
 				~WED_LibraryMgr();
 
 				
+	// The lookups below only read the resource table, so they may be called from worker threads - the table only
+	// changes in Rescan, which runs on the main thread in response to package manager messages.
+
 	//Returns "My Package" of .../Custom Scenery/My Package
 	//Combine with WED_PackageMgr::ComputePath to save a file in the package dir
 	string		GetLocalPackage() const;
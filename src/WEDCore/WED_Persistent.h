@@ -32,7 +32,7 @@
 
 class	IOReader;
 class	IOWriter;
-class	WED_XMLElement;
+class	WED_XMLWriter;
 
 /*
 	WED_Persistent.h - THEORY OF OPERATION
@@ -206,7 +206,7 @@ public:
 	virtual WED_Persistent*	Clone(void) const=0;
 	virtual	bool 			ReadFrom(IOReader * reader)=0;
 	virtual	void 			WriteTo(IOWriter * writer)=0;
-	virtual	void			ToXML(WED_XMLElement * parent)=0;
+	virtual	void			ToXML(WED_XMLWriter * writer)=0;
 	virtual	void			FromXML(WED_XMLReader * reader, const XML_Char ** atts)=0;
 
 	// If you return true from read, this is called on you AFTER the entire archive is
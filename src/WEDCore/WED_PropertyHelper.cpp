@@ -40,65 +40,140 @@ inline int remap(const map<int,int>& m, int v)
 	return i->second;
 }
 
+// One node per distinct sequence of item registrations.  Nodes are never freed - there are only as many as there are
+// items declared across all classes.
+struct WED_PropertyLayout {
+	vector<int>									offsets;
+	vector<const char *>						titles;
+	hash_map<string, int>						names;
+	map<pair<int, const char *>, WED_PropertyLayout *>	next;
+
+	WED_PropertyLayout *	Extend(int offset, const char * title)
+	{
+		pair<int, const char *> k(offset, title);
+		map<pair<int, const char *>, WED_PropertyLayout *>::iterator i = next.find(k);
+		if (i != next.end())
+			return i->second;
+
+		WED_PropertyLayout * n = new WED_PropertyLayout;
+		n->offsets = offsets;
+		n->titles = titles;
+		n->names = names;
+		n->offsets.push_back(offset);
+		n->titles.push_back(title);
+		n->names.insert(hash_map<string, int>::value_type(title, titles.size()));		// first one wins, like the old linear search
+		next[k] = n;
+		return n;
+	}
+};
+
+static WED_PropertyLayout *	empty_layout(void)
+{
+	static WED_PropertyLayout * root = new WED_PropertyLayout;
+	return root;
+}
+
+WED_PropertyHelper::WED_PropertyHelper() : mLayout(empty_layout())
+{
+}
+
+inline WED_PropertyItem *	WED_PropertyHelper::GetItem(int n) const
+{
+	return (WED_PropertyItem *) ((const char *) this + mLayout->offsets[n]);
+}
+
 int		WED_PropertyHelper::FindProperty(const char * in_prop) const
 {
-	for (int n = 0; n < mItems.size(); ++n)
-		if (strcmp(mItems[n]->mTitle, in_prop)==0) return n;
-	return -1;
+	hash_map<string, int>::const_iterator i = mLayout->names.find(in_prop);
+	return i == mLayout->names.end() ? -1 : i->second;
 }
 
 int		WED_PropertyHelper::CountProperties(void) const
 {
-	return mItems.size();
+	return mLayout->offsets.size();
 }
 
 void		WED_PropertyHelper::GetNthPropertyInfo(int n, PropertyInfo_t& info) const
 {
-	mItems[n]->GetPropertyInfo(info);
+	GetItem(n)->GetPropertyInfo(info);
 }
 
 void		WED_PropertyHelper::GetNthPropertyDict(int n, PropertyDict_t& dict) const
 {
-	mItems[n]->GetPropertyDict(dict);
+	GetItem(n)->GetPropertyDict(dict);
 }
 
 void		WED_PropertyHelper::GetNthPropertyDictItem(int n, int e, string& item) const
 {
-	mItems[n]->GetPropertyDictItem(e, item);
+	GetItem(n)->GetPropertyDictItem(e, item);
 }
 
 void		WED_PropertyHelper::GetNthProperty(int n, PropertyVal_t& val) const
 {
-	mItems[n]->GetProperty(val);
+	GetItem(n)->GetProperty(val);
 }
 
 void		WED_PropertyHelper::SetNthProperty(int n, const PropertyVal_t& val)
 {
-	mItems[n]->SetProperty(val,this);
+	GetItem(n)->SetProperty(val,this);
 }
 
-WED_PropertyItem::WED_PropertyItem(WED_PropertyHelper * pops, const char * title) : mTitle(title), mParent(pops)
+WED_PropertyItem::WED_PropertyItem(WED_PropertyHelper * pops, const char * title) : mOffset(0), mIndex(-1)
 {
 	if (pops)
-		pops->mItems.push_back(this);
+	{
+		mOffset = (const char *) this - (const char *) pops;
+		DebugAssert(mOffset != 0);
+		mIndex = pops->mLayout->offsets.size();
+		pops->mLayout = pops->mLayout->Extend(mOffset, title);
+	}
+}
+
+const char *	WED_PropertyItem::GetTitle(void) const
+{
+	return mOffset ? GetParent()->mLayout->titles[mIndex] : "\0";
 }
 
 void 		WED_PropertyHelper::ReadPropsFrom(IOReader * reader)
 {
-	for (int n = 0; n < mItems.size(); ++n)
-		mItems[n]->ReadFrom(reader);
+	for (int n = 0; n < mLayout->offsets.size(); ++n)
+		GetItem(n)->ReadFrom(reader);
 }
 
 void 		WED_PropertyHelper::WritePropsTo(IOWriter * writer)
 {
-	for (int n = 0; n < mItems.size(); ++n)
-		mItems[n]->WriteTo(writer);
+	for (int n = 0; n < mLayout->offsets.size(); ++n)
+		GetItem(n)->WriteTo(writer);
 }
 
-void		WED_PropertyHelper::PropsToXML(WED_XMLElement * parent)
+void		WED_PropertyHelper::PropsToXML(WED_XMLWriter * writer)
 {
-	for(int n = 0; n < mItems.size(); ++n)
-		mItems[n]->ToXML(parent);
+	// Several items can share one XML element (e.g. <point latitude= longitude=>) and they are not always
+	// next to each other in the layout.  The writer can't go back to an element once it is closed, so gather
+	// each element's items up before moving on to the next one.
+	int n = mLayout->offsets.size();
+	vector<char> done(n, 0);
+	for(int i = 0; i < n; ++i)
+	if(!done[i])
+	{
+		done[i] = 1;
+		const char * ele = GetItem(i)->XMLElementName();
+		if(ele == NULL || *ele == 0)
+			continue;
+		writer->open_element(ele);
+		GetItem(i)->ToXML(writer);
+		for(int j = i + 1; j < n; ++j)
+		if(!done[j])
+		{
+			const char * other = GetItem(j)->XMLElementName();
+			if(other && strcmp(ele, other) == 0)
+			{
+				done[j] = 1;
+				GetItem(j)->ToXML(writer);
+			}
+		}
+		writer->close_element();
+	}
 }
 
 
@@ -108,16 +183,16 @@ void		WED_PropertyHelper::StartElement(
 								const XML_Char **	atts)
 {
 	int n;
-	for(n = 0; n < mItems.size(); ++n)
-	if(mItems[n]->WantsElement(reader,name))
+	for(n = 0; n < mLayout->offsets.size(); ++n)
+	if(GetItem(n)->WantsElement(reader,name))
 		return;
 
 	while(*atts)
 	{
 		const XML_Char * k = *atts++;
 		const XML_Char * v = *atts++;
-		for(n = 0; n < mItems.size(); ++n)
-		if(mItems[n]->WantsAttribute(name,k,v))
+		for(n = 0; n < mLayout->offsets.size(); ++n)
+		if(GetItem(n)->WantsAttribute(name,k,v))
 			break;
 	}		
 }
@@ -132,9 +207,7 @@ void		WED_PropertyHelper::PopHandler(void)
 
 int			WED_PropertyHelper::PropertyItemNumber(const WED_PropertyItem * item) const
 {
-	for(int n = 0; n < mItems.size(); ++n)
-		if(item == mItems[n]) return n;
-	return -1;
+	return item->GetParent() == this ? item->mIndex : -1;
 }
 
 #pragma mark -
@@ -144,7 +217,7 @@ void		WED_PropIntText::GetPropertyInfo(PropertyInfo_t& info)
 	info.can_delete = false;
 	info.can_edit = 1;
 	info.prop_kind = prop_Int;
-	info.prop_name = mTitle;
+	info.prop_name = GetTitle();
 	info.digits = mDigits;
 	info.synthetic = 0;
 }
@@ -186,17 +259,16 @@ void 		WED_PropIntText::WriteTo(IOWriter * writer)
 	writer->WriteInt(value);
 }
 
-void		WED_PropIntText::ToXML(WED_XMLElement * parent)
+void		WED_PropIntText::ToXML(WED_XMLWriter * writer)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
-	WED_XMLElement * xml = parent->add_or_find_sub_element(p);
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
-	xml->add_attr_int(p,value);
+	writer->add_attr_int(p,value);
 }
 
 bool		WED_PropIntText::WantsAttribute(const char * ele, const char * att_name, const char * att_value)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
+	const char *p = GetXMLNames();
 	if(strcasecmp(p,ele)==0)
 	p += strlen(p)+1;
 	if(strcasecmp(p,att_name)==0)
@@ -214,7 +286,7 @@ void		WED_PropBoolText::GetPropertyInfo(PropertyInfo_t& info)
 	info.can_delete = false;
 	info.can_edit = 1;
 	info.prop_kind = prop_Bool;
-	info.prop_name = mTitle;
+	info.prop_name = GetTitle();
 	info.synthetic = 0;
 }
 
@@ -255,17 +327,16 @@ void 		WED_PropBoolText::WriteTo(IOWriter * writer)
 	writer->WriteInt(value);
 }
 
-void		WED_PropBoolText::ToXML(WED_XMLElement * parent)
+void		WED_PropBoolText::ToXML(WED_XMLWriter * writer)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
-	WED_XMLElement * xml = parent->add_or_find_sub_element(p);
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
-	xml->add_attr_int(p,value);
+	writer->add_attr_int(p,value);
 }
 
 bool		WED_PropBoolText::WantsAttribute(const char * ele, const char * att_name, const char * att_value)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
+	const char *p = GetXMLNames();
 	if(strcasecmp(p,ele)==0)
 	p += strlen(p)+1;
 	if(strcasecmp(p,att_name)==0)
@@ -283,7 +354,7 @@ void		WED_PropDoubleText::GetPropertyInfo(PropertyInfo_t& info)
 	info.can_delete = false;
 	info.can_edit = 1;
 	info.prop_kind = prop_Double;
-	info.prop_name = mTitle;
+	info.prop_name = GetTitle();
 	info.digits = mDigits;
 	info.decimals = mDecimals;
 	info.round_down = false;
@@ -328,17 +399,16 @@ void 		WED_PropDoubleText::WriteTo(IOWriter * writer)
 	writer->WriteDouble(value);
 }
 
-void		WED_PropDoubleText::ToXML(WED_XMLElement * parent)
+void		WED_PropDoubleText::ToXML(WED_XMLWriter * writer)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
-	WED_XMLElement * xml = parent->add_or_find_sub_element(p);
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
-	xml->add_attr_double(p,value,mDecimals);
+	writer->add_attr_double(p,value,mDecimals);
 }
 
 bool		WED_PropDoubleText::WantsAttribute(const char * ele, const char * att_name, const char * att_value)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
+	const char *p = GetXMLNames();
 	if(strcasecmp(p,ele)==0)
 	p += strlen(p)+1;
 	if(strcasecmp(p,att_name)==0)
@@ -372,12 +442,11 @@ void	WED_PropFrequencyText::AssignFrom10Khz(int freq_10khz)
 	*this = mhz;
 }
 
-void		WED_PropFrequencyText::ToXML(WED_XMLElement * parent)
+void		WED_PropFrequencyText::ToXML(WED_XMLWriter * writer)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
-	WED_XMLElement * xml = parent->add_or_find_sub_element(p);
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
-	xml->add_attr_double(p,value,mDecimals+1);
+	writer->add_attr_double(p,value,mDecimals+1);
 }
 
 //----------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -408,7 +477,7 @@ void		WED_PropStringText::GetPropertyInfo(PropertyInfo_t& info)
 	info.can_delete = false;
 	info.can_edit = 1;
 	info.prop_kind = prop_String;
-	info.prop_name = mTitle;
+	info.prop_name = GetTitle();
 	info.synthetic = 0;
 }
 
@@ -454,17 +523,16 @@ void 		WED_PropStringText::WriteTo(IOWriter * writer)
 	writer->WriteBulk(value.c_str(),value.size(),false);
 }
 
-void		WED_PropStringText::ToXML(WED_XMLElement * parent)
+void		WED_PropStringText::ToXML(WED_XMLWriter * writer)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
-	WED_XMLElement * xml = parent->add_or_find_sub_element(p);
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
-	xml->add_attr_stl_str(p,value);
+	writer->add_attr_stl_str(p,value);
 }
 
 bool		WED_PropStringText::WantsAttribute(const char * ele, const char * att_name, const char * att_value)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
+	const char *p = GetXMLNames();
 	if(strcasecmp(p,ele)==0)
 	p += strlen(p)+1;
 	if(strcasecmp(p,att_name)==0)
@@ -482,7 +550,7 @@ void		WED_PropFileText::GetPropertyInfo(PropertyInfo_t& info)
 	info.can_delete = false;
 	info.can_edit = 1;
 	info.prop_kind = prop_FilePath;
-	info.prop_name = mTitle;
+	info.prop_name = GetTitle();
 	info.synthetic = 0;
 }
 
@@ -528,17 +596,16 @@ void 		WED_PropFileText::WriteTo(IOWriter * writer)
 	writer->WriteBulk(value.c_str(),value.size(),false);
 }
 
-void		WED_PropFileText::ToXML(WED_XMLElement * parent)
+void		WED_PropFileText::ToXML(WED_XMLWriter * writer)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
-	WED_XMLElement * xml = parent->add_or_find_sub_element(p);
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
-	xml->add_attr_stl_str(p,value);
+	writer->add_attr_stl_str(p,value);
 }
 
 bool		WED_PropFileText::WantsAttribute(const char * ele, const char * att_name, const char * att_value)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
+	const char *p = GetXMLNames();
 	if(strcasecmp(p,ele)==0)
 	p += strlen(p)+1;
 	if(strcasecmp(p,att_name)==0)
@@ -556,7 +623,7 @@ void		WED_PropIntEnum::GetPropertyInfo(PropertyInfo_t& info)
 	info.can_delete = false;
 	info.can_edit = 1;
 	info.prop_kind = prop_Enum;
-	info.prop_name = mTitle;
+	info.prop_name = GetTitle();
 	info.synthetic = 0;
 }
 
@@ -603,17 +670,16 @@ void 		WED_PropIntEnum::WriteTo(IOWriter * writer)
 	writer->WriteInt(value);
 }
 
-void		WED_PropIntEnum::ToXML(WED_XMLElement * parent)
+void		WED_PropIntEnum::ToXML(WED_XMLWriter * writer)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
-	WED_XMLElement * xml = parent->add_or_find_sub_element(p);
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
-	xml->add_attr_c_str(p,ENUM_Desc(value));
+	writer->add_attr_c_str(p,ENUM_Desc(value));
 }
 
 bool		WED_PropIntEnum::WantsAttribute(const char * ele, const char * att_name, const char * att_value)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
+	const char *p = GetXMLNames();
 	if(strcasecmp(p,ele)==0)
 	p += strlen(p)+1;
 	if(strcasecmp(p,att_name)==0)
@@ -631,7 +697,7 @@ void		WED_PropIntEnumSet::GetPropertyInfo(PropertyInfo_t& info)
 	info.can_delete = false;
 	info.can_edit = 1;
 	info.prop_kind = prop_EnumSet;
-	info.prop_name = mTitle;
+	info.prop_name = GetTitle();
 	info.exclusive = this->exclusive;
 	info.synthetic = 0;
 }
@@ -692,15 +758,15 @@ void 		WED_PropIntEnumSet::WriteTo(IOWriter * writer)
 	}
 }
 
-void		WED_PropIntEnumSet::ToXML(WED_XMLElement * parent)
+void		WED_PropIntEnumSet::ToXML(WED_XMLWriter * writer)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
-	WED_XMLElement * xml = parent->add_or_find_sub_element(p);
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
 	for(set<int>::iterator i = value.begin(); i != value.end(); ++i)
 	{
-		WED_XMLElement * ele = xml->add_sub_element(p);
-		ele->add_attr_c_str("value",ENUM_Desc(*i));
+		writer->open_element(p);
+		writer->add_attr_c_str("value",ENUM_Desc(*i));
+		writer->close_element();
 	}
 }
 
@@ -711,7 +777,7 @@ bool		WED_PropIntEnumSet::WantsAttribute(const char * ele, const char * att_name
 
 bool		WED_PropIntEnumSet::WantsElement(WED_XMLReader * reader, const char * name)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
+	const char *p = GetXMLNames();
 	if(strcasecmp(name,p)==0)
 	{
 		reader->PushHandler(this);
@@ -726,7 +792,7 @@ void		WED_PropIntEnumSet::StartElement(
 								const XML_Char *	name,
 								const XML_Char **	atts)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
 	if(strcasecmp(name,p) == 0)
 	{
@@ -752,7 +818,7 @@ void		WED_PropIntEnumBitfield::GetPropertyInfo(PropertyInfo_t& info)
 	info.can_delete = false;
 	info.can_edit = 1;
 	info.prop_kind = prop_EnumSet;
-	info.prop_name = mTitle;
+	info.prop_name = GetTitle();
 	info.exclusive = false;
 	info.synthetic = 0;
 }
@@ -815,17 +881,16 @@ void 		WED_PropIntEnumBitfield::WriteTo(IOWriter * writer)
 	}
 }
 
-void		WED_PropIntEnumBitfield::ToXML(WED_XMLElement * parent)
+void		WED_PropIntEnumBitfield::ToXML(WED_XMLWriter * writer)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
-	WED_XMLElement * xml = parent->add_or_find_sub_element(p);
+	const char *p = GetXMLNames();
 	p += strlen(p)+1;
-	xml->add_attr_int(p,ENUM_ExportSet(value));
+	writer->add_attr_int(p,ENUM_ExportSet(value));
 }
 
 bool		WED_PropIntEnumBitfield::WantsAttribute(const char * ele, const char * att_name, const char * att_value)
 {
-	const char *p = mTitle+strlen(mTitle)+1;
+	const char *p = GetXMLNames();
 	if(strcasecmp(p,ele)==0)
 	p += strlen(p)+1;
 	if(strcasecmp(p,att_name)==0)
@@ -841,18 +906,18 @@ bool		WED_PropIntEnumBitfield::WantsAttribute(const char * ele, const char * att
 
 void		WED_PropIntEnumSetFilter::GetPropertyInfo(PropertyInfo_t& info)
 {
-	int me = mParent->FindProperty(host);
-	mParent->GetNthPropertyInfo(me, info);
-	info.prop_name = mTitle;
+	int me = GetParent()->FindProperty(host);
+	GetParent()->GetNthPropertyInfo(me, info);
+	info.prop_name = GetTitle();
 	info.exclusive = exclusive;
 	info.synthetic = 1;
 }
 
 void		WED_PropIntEnumSetFilter::GetPropertyDict(PropertyDict_t& dict)
 {
-	int me = mParent->FindProperty(host);
+	int me = GetParent()->FindProperty(host);
 	PropertyDict_t	d;
-	mParent->GetNthPropertyDict(me,d);
+	GetParent()->GetNthPropertyDict(me,d);
 	for (PropertyDict_t::iterator i = d.begin(); i != d.end(); ++i)
 	if (i->first >= minv && i->first <= maxv)
 		dict.insert(PropertyDict_t::value_type(i->first,i->second));
@@ -860,15 +925,15 @@ void		WED_PropIntEnumSetFilter::GetPropertyDict(PropertyDict_t& dict)
 
 void		WED_PropIntEnumSetFilter::GetPropertyDictItem(int e, string& item)
 {
-	int me = mParent->FindProperty(host);
-	mParent->GetNthPropertyDictItem(me, e,item);
+	int me = GetParent()->FindProperty(host);
+	GetParent()->GetNthPropertyDictItem(me, e,item);
 }
 
 void		WED_PropIntEnumSetFilter::GetProperty(PropertyVal_t& val) const
 {
-	int me = mParent->FindProperty(host);
+	int me = GetParent()->FindProperty(host);
 	PropertyVal_t	local;
-	mParent->GetNthProperty(me,local);
+	GetParent()->GetNthProperty(me,local);
 	val = local;
 	val.set_val.clear();
 	for(set<int>::iterator i = local.set_val.begin(); i != local.set_val.end(); ++i)
@@ -879,18 +944,18 @@ void		WED_PropIntEnumSetFilter::GetProperty(PropertyVal_t& val) const
 
 void		WED_PropIntEnumSetFilter::SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent)
 {
-	int me = mParent->FindProperty(host);
+	int me = GetParent()->FindProperty(host);
 	PropertyVal_t	clone(val), old;
 	clone.set_val.clear();
 	set<int>::const_iterator i;
-	mParent->GetNthProperty(me, old);
+	GetParent()->GetNthProperty(me, old);
 	for(i=old.set_val.begin();i!=old.set_val.end();++i)
 	if(*i < minv || *i > maxv)
 		clone.set_val.insert(*i);
 	for(i=val.set_val.begin();i!=val.set_val.end();++i)
 	if(*i >= minv && *i <= maxv)
 		clone.set_val.insert(*i);
-	mParent->SetNthProperty(me,clone);
+	GetParent()->SetNthProperty(me,clone);
 }
 
 void 		WED_PropIntEnumSetFilter::ReadFrom(IOReader * reader)
@@ -901,7 +966,7 @@ void 		WED_PropIntEnumSetFilter::WriteTo(IOWriter * writer)
 {
 }
 
-void		WED_PropIntEnumSetFilter::ToXML(WED_XMLElement * parent)
+void		WED_PropIntEnumSetFilter::ToXML(WED_XMLWriter * writer)
 {
 }
 
@@ -925,10 +990,10 @@ void		WED_PropIntEnumSetUnion::GetPropertyInfo(PropertyInfo_t& info)
 
 void		WED_PropIntEnumSetUnion::GetPropertyDict(PropertyDict_t& dict)
 {
-	int nn = mParent->CountSubs();
+	int nn = GetParent()->CountSubs();
 	for (int n = 0; n < nn; ++n)
 	{
-		IPropertyObject * inf = mParent->GetNthSub(n);
+		IPropertyObject * inf = GetParent()->GetNthSub(n);
 		if (inf)
 		{
 			int idx = inf->FindProperty(host);
@@ -950,10 +1015,10 @@ void		WED_PropIntEnumSetUnion::GetProperty(PropertyVal_t& val) const
 {
 	val.prop_kind = prop_EnumSet;
 	val.set_val.clear();
-	int nn = mParent->CountSubs();
+	int nn = GetParent()->CountSubs();
 	for (int n = 0; n < nn; ++n)
 	{
-		IPropertyObject * inf = mParent->GetNthSub(n);
+		IPropertyObject * inf = GetParent()->GetNthSub(n);
 		if (inf)
 		{
 			PropertyVal_t	local;
@@ -984,10 +1049,10 @@ void		WED_PropIntEnumSetUnion::SetProperty(const PropertyVal_t& val, WED_Propert
 					val.set_val.begin(),val.set_val.end(),
 					set_inserter(deleted));
 
-	int nn = mParent->CountSubs();
+	int nn = GetParent()->CountSubs();
 	for (int n = 0; n < nn; ++n)
 	{
-		IPropertyObject * inf = mParent->GetNthSub(n);
+		IPropertyObject * inf = GetParent()->GetNthSub(n);
 		if (inf)
 		{
 			int idx = inf->FindProperty(host);
@@ -1019,7 +1084,7 @@ void 		WED_PropIntEnumSetUnion::WriteTo(IOWriter * writer)
 {
 }
 
-void		WED_PropIntEnumSetUnion::ToXML(WED_XMLElement * parent)
+void		WED_PropIntEnumSetUnion::ToXML(WED_XMLWriter * writer)
 {
 }
 
@@ -1032,9 +1097,9 @@ bool		WED_PropIntEnumSetUnion::WantsAttribute(const char * ele, const char * att
 
 void		WED_PropIntEnumSetFilterVal::GetPropertyDict(PropertyDict_t& dict)
 {
-	int me = mParent->FindProperty(host);
+	int me = GetParent()->FindProperty(host);
 	PropertyDict_t	d;
-	mParent->GetNthPropertyDict(me,d);
+	GetParent()->GetNthPropertyDict(me,d);
 	
 	for (PropertyDict_t::iterator i = d.begin(); i != d.end(); ++i)
 	{
@@ -1047,9 +1112,9 @@ void		WED_PropIntEnumSetFilterVal::GetPropertyDict(PropertyDict_t& dict)
 
 void		WED_PropIntEnumSetFilterVal::GetProperty(PropertyVal_t& val) const
 {
-	int me = mParent->FindProperty(host);
+	int me = GetParent()->FindProperty(host);
 	PropertyVal_t	local;
-	mParent->GetNthProperty(me,local);
+	GetParent()->GetNthProperty(me,local);
 	val = local;
 	val.set_val.clear();
 	for(set<int>::iterator i = local.set_val.begin(); i != local.set_val.end(); ++i)
@@ -1063,11 +1128,11 @@ void		WED_PropIntEnumSetFilterVal::GetProperty(PropertyVal_t& val) const
 
 void		WED_PropIntEnumSetFilterVal::SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent)
 {
-	int me = mParent->FindProperty(host);
+	int me = GetParent()->FindProperty(host);
 	PropertyVal_t	clone(val), old;
 	clone.set_val.clear();
 	set<int>::const_iterator i;
-	mParent->GetNthProperty(me, old);
+	GetParent()->GetNthProperty(me, old);
 	for(i=old.set_val.begin();i!=old.set_val.end();++i)
 	{
 		int n = ENUM_Export(*i);
@@ -1080,5 +1145,5 @@ void		WED_PropIntEnumSetFilterVal::SetProperty(const PropertyVal_t& val, WED_Pro
 		if(n >= minv && n <= maxv)
 			clone.set_val.insert(*i);
 	}
-	mParent->SetNthProperty(me,clone);
+	GetParent()->SetNthProperty(me,clone);
 }
@@ -36,6 +36,20 @@
 	As a side note besides providing prop interfaces, it provides a way to stream properties to IODef reader/writers.  This is used to
 	save undo work in WED_thing.
 
+	PROPERTY LAYOUTS
+
+	Every instance of a given class has the same items with the same titles at the same offsets from its helper, so none of that is
+	stored per instance.  Instead each item registers (offset, title) with its parent as it is constructed, and the parent walks down
+	a shared tree of WED_PropertyLayouts - one node per distinct prefix of registrations - so when construction finishes it points at
+	the one layout shared by all objects of its class.  The layout holds the offsets, titles and a hash of names for FindProperty.
+
+	What is left per object is one layout pointer in the helper, and in each item its vtable, its offset from the helper and its index.
+	For a taxi route node, that is about half of what the item list and the title/parent pointers in each item used to cost.
+
+	Items must be members of the helper they are registered with (that's what makes the offsets constant), and objects are built
+	on the main thread only, which the layout tree relies on.  An item constructed with a NULL parent is not a property at all and
+	has no title.
+
 */
 
 #include <vector>
@@ -45,9 +59,10 @@
 using std::vector;
 
 class	WED_PropertyHelper;
+struct	WED_PropertyLayout;
 class	IOWriter;
 class	IOReader;
-class	WED_XMLElement;
+class	WED_XMLWriter;
 
 // macros to create a *single* string containing a properties WED name and XML names
 // this saves another 2 pointers in each property item, after the sqlite removal already removed 2 pointers.
@@ -67,21 +82,32 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent)=0;
 	virtual	void 		ReadFrom(IOReader * reader)=0;
 	virtual	void 		WriteTo(IOWriter * writer)=0;
-	virtual	void		ToXML(WED_XMLElement * parent)=0;
+	// Writes this item's attributes (or sub-elements) into its XML element, which the helper has already opened.
+	virtual	void		ToXML(WED_XMLWriter * writer)=0;
+	// The XML element this item lives in, or NULL if the item is not saved to XML.
+	virtual	const char *	XMLElementName(void) const { return GetXMLNames(); }
 
 	virtual	bool		WantsElement(WED_XMLReader * reader, const char * name) { return false; }
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value)=0;
 
-	const char *			mTitle;
-	WED_PropertyHelper *	mParent;
+	WED_PropertyHelper *	GetParent(void) const { return mOffset ? (WED_PropertyHelper *) ((const char *) this - mOffset) : NULL; }
+	const char *			GetTitle(void) const;
+	const char *			GetXMLNames(void) const { const char * t = GetTitle(); return t + strlen(t) + 1; }	// element name, then attribute name
+
 private:
 	WED_PropertyItem();
+
+	friend class	WED_PropertyHelper;
+	int						mOffset;		// From our parent helper to us, 0 if no parent
+	int						mIndex;			// Our property number in the parent's layout
 };
 
 
 class WED_PropertyHelper : public WED_XMLHandler, public IPropertyObject {
 public:
 
+						WED_PropertyHelper();
+
 	virtual	int			FindProperty(const char * in_prop) const;
 	virtual int			CountProperties(void) const;
 	virtual void		GetNthPropertyInfo(int n, PropertyInfo_t& info) const;
@@ -99,7 +125,7 @@ public:
 	// Utility to help manage streaming
 			void 		ReadPropsFrom(IOReader * reader);
 			void 		WritePropsTo(IOWriter * writer);
-			void		PropsToXML(WED_XMLElement * parent);
+			void		PropsToXML(WED_XMLWriter * writer);
 
 	virtual void		StartElement(
 								WED_XMLReader * reader,
@@ -112,8 +138,10 @@ public:
 	virtual	int			PropertyItemNumber(const WED_PropertyItem * item) const;
 private:
 
+	WED_PropertyItem *	GetItem(int n) const;
+
 	friend class	WED_PropertyItem;
-	vector<WED_PropertyItem *>		mItems;
+	WED_PropertyLayout *			mLayout;
 
 };
 
@@ -128,7 +156,7 @@ public:
 
 	operator int&() { return value; }
 	operator int() const { return value; }
-	WED_PropIntText& operator=(int v) { if (value != v) { if (mParent) mParent->PropEditCallback(1); value = v; if (mParent) mParent->PropEditCallback(0); } return *this; }
+	WED_PropIntText& operator=(int v) { if (value != v) { if (GetParent()) GetParent()->PropEditCallback(1); value = v; if (GetParent()) GetParent()->PropEditCallback(0); } return *this; }
 
 	WED_PropIntText(WED_PropertyHelper * parent, const char * title, int initial, int digits)  : WED_PropertyItem(parent, title), value(initial), mDigits(digits) { }
 
@@ -139,7 +167,7 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 
 };
@@ -152,7 +180,7 @@ public:
 
 	operator int&() { return value; }
 	operator int() const { return value; }
-	WED_PropBoolText& operator=(int v) { if (value != v) { if (mParent) mParent->PropEditCallback(1); value = v; if (mParent) mParent->PropEditCallback(0); } return *this; }
+	WED_PropBoolText& operator=(int v) { if (value != v) { if (GetParent()) GetParent()->PropEditCallback(1); value = v; if (GetParent()) GetParent()->PropEditCallback(0); } return *this; }
 
 	WED_PropBoolText(WED_PropertyHelper * parent, const char * title, int initial)  : WED_PropertyItem(parent, title), value(initial) { }
 
@@ -163,7 +191,7 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 };
 
@@ -182,7 +210,7 @@ public:
 
 						operator double&() { return value; }
 						operator double() const { return value; }
-	WED_PropDoubleText& operator=(double v) { if (value != v) { if (mParent) mParent->PropEditCallback(1); value = v; if (mParent) mParent->PropEditCallback(0); } return *this; }
+	WED_PropDoubleText& operator=(double v) { if (value != v) { if (GetParent()) GetParent()->PropEditCallback(1); value = v; if (GetParent()) GetParent()->PropEditCallback(0); } return *this; }
 
 	WED_PropDoubleText(WED_PropertyHelper * parent, const char * title, double initial, int digits, int decimals, const char * unit = "") 
 		: WED_PropertyItem(parent, title), mDigits(digits), mDecimals(decimals), value(initial) { strncpy(mUnit,unit,6); }
@@ -194,7 +222,7 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 };
 
@@ -205,7 +233,7 @@ public:
 	WED_PropFrequencyText& operator=(double v) { WED_PropDoubleText::operator=(v); return *this; }
 
 	virtual void		GetPropertyInfo(PropertyInfo_t& info);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
 	
 	int		GetAs10Khz(void) const;
 	void	AssignFrom10Khz(int freq_10khz);
@@ -232,7 +260,7 @@ public:
 
 						operator string&() { return value; }
 						operator string() const { return value; }
-	WED_PropStringText& operator=(const string& v) { if (value != v) { if (mParent) mParent->PropEditCallback(1); value = v; if (mParent) mParent->PropEditCallback(0); } return *this; }
+	WED_PropStringText& operator=(const string& v) { if (value != v) { if (GetParent()) GetParent()->PropEditCallback(1); value = v; if (GetParent()) GetParent()->PropEditCallback(0); } return *this; }
 
 	WED_PropStringText(WED_PropertyHelper * parent, const char * title, const string& initial)  : WED_PropertyItem(parent, title), value(initial) { }
 
@@ -243,7 +271,7 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 };
 
@@ -255,7 +283,7 @@ public:
 
 						operator string&() { return value; }
 						operator string() const { return value; }
-	WED_PropFileText& operator=(const string& v) { if (value != v) { if (mParent) mParent->PropEditCallback(1); value = v; if (mParent) mParent->PropEditCallback(0); } return *this; }
+	WED_PropFileText& operator=(const string& v) { if (value != v) { if (GetParent()) GetParent()->PropEditCallback(1); value = v; if (GetParent()) GetParent()->PropEditCallback(0); } return *this; }
 
 	WED_PropFileText(WED_PropertyHelper * parent, const char * title, const string& initial)  : WED_PropertyItem(parent, title), value(initial) { }
 
@@ -266,7 +294,7 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 };
 
@@ -279,7 +307,7 @@ public:
 
 						operator int&() { return value; }
 						operator int() const { return value; }
-	WED_PropIntEnum& operator=(int v) { if (value != v) { if (mParent) mParent->PropEditCallback(1); value = v; if (mParent) mParent->PropEditCallback(0); } return *this; }
+	WED_PropIntEnum& operator=(int v) { if (value != v) { if (GetParent()) GetParent()->PropEditCallback(1); value = v; if (GetParent()) GetParent()->PropEditCallback(0); } return *this; }
 
 	WED_PropIntEnum(WED_PropertyHelper * parent, const char * title, int idomain, int initial)  : WED_PropertyItem(parent, title), value(initial), domain(idomain) { }
 
@@ -290,7 +318,7 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 };
 
@@ -306,8 +334,8 @@ public:
 
 						operator set<int>&() { return value; }
 						operator set<int>() const { return value; }
-	WED_PropIntEnumSet& operator=(const set<int>& v) { if (value != v) { if (mParent) mParent->PropEditCallback(1); value = v; if (mParent) mParent->PropEditCallback(0); } return *this; }
-	WED_PropIntEnumSet& operator+=(const int v) { if(value.count(v) == 0) { if (mParent) mParent->PropEditCallback(1); value.insert(v); if (mParent) mParent->PropEditCallback(0); } return *this; }
+	WED_PropIntEnumSet& operator=(const set<int>& v) { if (value != v) { if (GetParent()) GetParent()->PropEditCallback(1); value = v; if (GetParent()) GetParent()->PropEditCallback(0); } return *this; }
+	WED_PropIntEnumSet& operator+=(const int v) { if(value.count(v) == 0) { if (GetParent()) GetParent()->PropEditCallback(1); value.insert(v); if (GetParent()) GetParent()->PropEditCallback(0); } return *this; }
 	WED_PropIntEnumSet(WED_PropertyHelper * parent, const char * title, int idomain, int iexclusive)  : WED_PropertyItem(parent, title), domain(idomain), exclusive(iexclusive) { }
 
 	virtual void		GetPropertyInfo(PropertyInfo_t& info);
@@ -317,7 +345,7 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 	virtual	bool		WantsElement(WED_XMLReader * reader, const char * name);
 
@@ -344,7 +372,7 @@ public:
 						
 						operator set<int>&() { return value; }
 						operator set<int>() const { return value; }
-	WED_PropIntEnumBitfield& operator=(const set<int>& v) { if (value != v) { if (mParent) mParent->PropEditCallback(1); value = v; if (mParent) mParent->PropEditCallback(0); } return *this; }
+	WED_PropIntEnumBitfield& operator=(const set<int>& v) { if (value != v) { if (GetParent()) GetParent()->PropEditCallback(1); value = v; if (GetParent()) GetParent()->PropEditCallback(0); } return *this; }
 
 	WED_PropIntEnumBitfield(WED_PropertyHelper * parent, const char * title, int idomain, int be_none)  : WED_PropertyItem(parent, title), domain(idomain), can_be_none(be_none) { }
 
@@ -355,7 +383,7 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 
 };
@@ -384,7 +412,8 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
+	virtual	const char *	XMLElementName(void) const { return NULL; }
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 };
 
@@ -407,7 +436,8 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
+	virtual	const char *	XMLElementName(void) const { return NULL; }
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);
 };
 
@@ -60,6 +60,7 @@ WED_ResourceMgr::~WED_ResourceMgr()
 
 void	WED_ResourceMgr::Purge(void)
 {
+	THREAD_Lock	lock(mLock);
 	for(map<string, vector<XObj8 *> >::iterator i = mObj.begin(); i != mObj.end(); ++i)
 		for(vector<XObj8 *>::iterator j = i->second.begin(); j != i->second.end(); ++j)
 			delete *j;
@@ -89,6 +90,7 @@ int		WED_ResourceMgr::GetNumVariants(const string& path)
 
 bool	WED_ResourceMgr::GetObjRelative(const string& obj_path, const string& parent_path, XObj8 *& obj)
 {
+	THREAD_Lock	lock(mLock);
 	if(GetObj(obj_path,obj))
 		return true;
 	string lib_key = parent_path + string("\n") + obj_path;
@@ -132,6 +134,7 @@ bool	WED_ResourceMgr::GetObjRelative(const string& obj_path, const string& paren
 
 bool	WED_ResourceMgr::GetObj(const string& path, XObj8 *& obj, int variant)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,vector<XObj8 *> >::iterator i = mObj.find(path);
 
 	if(i != mObj.end())
@@ -180,6 +183,7 @@ bool	WED_ResourceMgr::GetObj(const string& path, XObj8 *& obj, int variant)
 
 bool 	WED_ResourceMgr::SetPolUV(const string& path, Bbox2 box)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,pol_info_t>::iterator i = mPol.find(path);
 	if(i != mPol.end())
 	{
@@ -192,6 +196,7 @@ bool 	WED_ResourceMgr::SetPolUV(const string& path, Bbox2 box)
 
 bool	WED_ResourceMgr::GetLin(const string& path, lin_info_t& out_info)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,lin_info_t>::iterator i = mLin.find(path);
 	if(i != mLin.end())
 	{
@@ -291,6 +296,7 @@ static void clean_rpath(string& s)
 
 bool	WED_ResourceMgr::GetStr(const string& path, str_info_t& out_info)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,str_info_t>::iterator i = mStr.find(path);
 	if(i != mStr.end())
 	{
@@ -371,6 +377,7 @@ bool	WED_ResourceMgr::GetStr(const string& path, str_info_t& out_info)
 
 bool	WED_ResourceMgr::GetPol(const string& path, pol_info_t& out_info)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,pol_info_t>::iterator i = mPol.find(path);
 	if(i != mPol.end())
 	{
@@ -458,6 +465,7 @@ bool	WED_ResourceMgr::GetPol(const string& path, pol_info_t& out_info)
 
 void WED_ResourceMgr::MakePol(const string& path, const pol_info_t& out_info)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,pol_info_t>::iterator i = mPol.find(path);
 	if(i != mPol.end())
 	{
@@ -501,6 +509,7 @@ void	WED_ResourceMgr::ReceiveMessage(
 
 bool	WED_ResourceMgr::GetFac(const string& path, fac_info_t& out_info, int variant)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,vector<fac_info_t> >::iterator i = mFac.find(path);
 	if(i != mFac.end())
 	{
@@ -743,6 +752,7 @@ struct tree_t {
 
 bool	WED_ResourceMgr::GetFor(const string& path,  XObj8 *& obj)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,XObj8 *>::iterator i = mFor.find(path);
 	if(i != mFor.end())
 	{
@@ -945,6 +955,7 @@ bool	WED_ResourceMgr::GetFor(const string& path,  XObj8 *& obj)
 #if AIRPORT_ROUTING
 bool	WED_ResourceMgr::GetAGP(const string& path, agp_t& out_info)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,agp_t>::iterator i = mAGP.find(path);
 	if(i != mAGP.end())
 	{
@@ -1112,6 +1123,7 @@ bool	WED_ResourceMgr::GetAGP(const string& path, agp_t& out_info)
 
 bool	WED_ResourceMgr::GetRoad(const string& path, road_info_t& out_info)
 {
+	THREAD_Lock	lock(mLock);
 	map<string,road_info_t>::iterator i = mRoad.find(path);
 	if(i != mRoad.end())
 	{
@@ -42,6 +42,12 @@
 	it's also definitely not very dangerous at this point in the code's development - that is, WED is not so big that this
 	represents a scalability issue.
 
+	THREADING
+
+	The accessors may be called from worker threads (e.g. the validator checks airports in parallel), so every
+	accessor holds mLock while it looks in or fills the cache.  The returned XObj8 pointers stay owned by us and
+	live until the next Purge, which only happens on the main thread when the system folder changes.
+
 */
 
 #include "GUI_Listener.h"
@@ -49,6 +55,7 @@
 #include "IBase.h"
 #include "XObjDefs.h"
 #include "CompGeomDefs2.h"
+#include "ThreadUtils.h"
 
 class	WED_LibraryMgr;
 
@@ -168,6 +175,7 @@ private:
 	map<string,road_info_t>		mRoad;
 #endif	
 	WED_LibraryMgr *			mLibrary;
+	THREAD_Mutex				mLock;
 };	
 
 #endif /* WED_ResourceMgr_H */
@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "WED_Snapshot.h"
+#include "WED_Archive.h"
+#include "WED_Persistent.h"
+#include "WED_Version.h"
+#include "IODefs.h"
+#include "FileUtils.h"
+#include "MemFileUtils.h"
+#include "AssertUtils.h"
+#include <sys/stat.h>
+#include <zlib.h>
+
+/*
+	FILE LAYOUT
+
+	header			"WEDSNAP" + format version byte
+					endian tag (int)
+					WED version string
+					XML file size, XML mod date (64-bit each), adler32 of the XML file
+					adler32 of everything after the header, byte count of same
+	body			prefs:			count, then name/value string pairs
+					pref items:		count, then name, item count, items
+					class table:	count, then class names
+					objects:		count, then per object: class index, ID, payload size, WriteTo() payload
+					end tag
+
+	Strings are an int length followed by the bytes - no terminator.
+*/
+
+#define SNAP_MAGIC			"WEDSNAP"
+#define SNAP_FORMAT			1
+#define SNAP_ENDIAN_TAG		0x01020304
+#define SNAP_END_TAG		0x534E4150		// 'SNAP'
+
+// We write the file in chunks of roughly this size.
+#define SNAP_FLUSH_SIZE		(4*1024*1024)
+
+// Writes into a growable memory block that the snapshot periodically spills to disk.  The block is kept bigger
+// than what is in it, so that the write window has room; size() is how much has actually been written.
+class	WED_SnapshotWriter : public IOWriter {
+public:
+
+			void	WriteString(const string& s) { WriteInt(s.size()); put(s.data(), s.size()); }
+			void	put(const void * p, size_t l) { WriteBulk((const char *) p, l, false); }
+
+			size_t	size(void) const	{ return mWriteEnd ? mWritePos - &mData[0] : 0; }
+			char *	data(void)			{ return mWriteEnd ? &mData[0] : NULL; }
+			void	clear(void)			{ mWritePos = data(); }
+			void	reserve(size_t n)	{ if(n > mData.size()) grow(n); }
+
+protected:
+
+	virtual	void	WriteMore(const char * inBuf, int inLength)
+	{
+		grow(2 * mData.size() + inLength);
+		memcpy(mWritePos, inBuf, inLength);
+		mWritePos += inLength;
+	}
+
+private:
+
+			void	grow(size_t n)
+			{
+				size_t used = size();
+				mData.resize(n);
+				mWritePos = &mData[0] + used;
+				mWriteEnd = &mData[0] + mData.size();
+			}
+
+	vector<char>	mData;
+};
+
+// Reads out of the mapped file.  Reading past the end doesn't crash - it returns zeros and sets a flag
+// that the loader checks, so a truncated or damaged file just fails to load.
+class	WED_SnapshotReader : public IOReader {
+public:
+
+	WED_SnapshotReader(const char * b, const char * e) : mOverrun(false) { mReadPos = b; mReadEnd = e; }
+
+			bool	ReadString(string& s)
+			{
+				int l;
+				ReadInt(l);
+				if(l < 0 || l > mReadEnd - mReadPos) { mOverrun = true; return false; }
+				s.assign(mReadPos, l);
+				mReadPos += l;
+				return true;
+			}
+
+			void	get(void * p, int l) { ReadBulk((char *) p, l, false); }
+
+			const char *	pos(void) const { return mReadPos; }
+			const char *	end(void) const { return mReadEnd; }
+			void			skip(int l) { mReadPos += l; }
+
+	bool			mOverrun;
+
+protected:
+
+	// The window is all there is, so running out of it means the file is bad.
+	virtual	void	ReadMore(char * inBuf, int inLength)
+	{
+		mOverrun = true;
+		mReadPos = mReadEnd;
+		if(inLength > 0) memset(inBuf, 0, inLength);
+	}
+};
+
+// Identifies the XML file a snapshot goes with.  The mod date alone only has 1 second resolution, so we
+// checksum the XML too - reading it is cheap next to parsing it.
+struct	snap_xml_stamp {
+	int64_t		size;
+	int64_t		mtime;
+	int			sum;
+
+	bool operator==(const snap_xml_stamp& rhs) const { return size == rhs.size && mtime == rhs.mtime && sum == rhs.sum; }
+	bool operator!=(const snap_xml_stamp& rhs) const { return !(*this == rhs); }
+};
+
+static bool snap_get_xml_stamp(const string& xml_path, snap_xml_stamp& stamp)
+{
+	struct stat meta;
+	if(FILE_get_file_meta_data(xml_path, meta) != 0)
+		return false;
+	stamp.size = meta.st_size;
+	stamp.mtime = meta.st_mtime;
+
+	MFMemFile * mf = MemFile_Open(xml_path.c_str());
+	if(mf == NULL)
+		return false;
+	uLong sum = adler32(0L, Z_NULL, 0);
+	sum = adler32(sum, (const Bytef *) MemFile_GetBegin(mf), MemFile_GetEnd(mf) - MemFile_GetBegin(mf));
+	stamp.sum = (int) sum;
+	MemFile_Close(mf);
+	return true;
+}
+
+static void snap_write_header(WED_SnapshotWriter& w, const snap_xml_stamp& xml, uLong sum, int64_t body_len)
+{
+	char magic[8];
+	memcpy(magic, SNAP_MAGIC, 7);
+	magic[7] = SNAP_FORMAT;
+	w.put(magic, 8);
+	w.WriteInt(SNAP_ENDIAN_TAG);
+	w.WriteString(WED_VERSION_STRING);
+	w.put(&xml.size, 8);
+	w.put(&xml.mtime, 8);
+	w.WriteInt(xml.sum);
+	int s = (int) sum;
+	w.WriteInt(s);
+	w.put(&body_len, 8);
+}
+
+bool	WED_Snapshot::Save(
+						const string&					snap_path,
+						const string&					xml_path,
+						WED_Archive *					archive,
+						const map<string,string>&		prefs,
+						const map<string,set<int> >&	pref_items)
+{
+	snap_xml_stamp xml;
+	if(!snap_get_xml_stamp(xml_path, xml))
+		return false;
+
+	FILE * fi = fopen(snap_path.c_str(), "wb");
+	if(fi == NULL)
+		return false;
+
+	// Write a header with no checksum; we come back and fill it in when we know it.
+	WED_SnapshotWriter w;
+	snap_write_header(w, xml, 0, 0);
+	size_t header_len = w.size();
+	bool ok = fwrite(w.data(), 1, header_len, fi) == header_len;
+	w.clear();
+	w.reserve(SNAP_FLUSH_SIZE + SNAP_FLUSH_SIZE / 4);
+
+	uLong sum = adler32(0L, Z_NULL, 0);
+	int64_t body_len = 0;
+
+	w.WriteInt(prefs.size());
+	for(map<string,string>::const_iterator p = prefs.begin(); p != prefs.end(); ++p)
+	{
+		w.WriteString(p->first);
+		w.WriteString(p->second);
+	}
+	w.WriteInt(pref_items.size());
+	for(map<string,set<int> >::const_iterator pi = pref_items.begin(); pi != pref_items.end(); ++pi)
+	{
+		w.WriteString(pi->first);
+		w.WriteInt(pi->second.size());
+		for(set<int>::const_iterator i = pi->second.begin(); i != pi->second.end(); ++i)
+			w.WriteInt(*i);
+	}
+
+	// Class names are static strings (sClass), so we can index them by pointer.
+	map<const char *, int>	class_idx;
+	vector<const char *>	classes;
+	int						obj_count = 0;
+	for(WED_Archive::ObjectMap::iterator ob = archive->mObjects.begin(); ob != archive->mObjects.end(); ++ob)
+	if(ob->second != NULL)
+	{
+		++obj_count;
+		const char * c = ob->second->GetClass();
+		if(class_idx.count(c) == 0)
+		{
+			class_idx[c] = classes.size();
+			classes.push_back(c);
+		}
+	}
+
+	w.WriteInt(classes.size());
+	for(vector<const char *>::iterator c = classes.begin(); c != classes.end(); ++c)
+		w.WriteString(*c);
+
+	w.WriteInt(obj_count);
+	for(WED_Archive::ObjectMap::iterator ob = archive->mObjects.begin(); ob != archive->mObjects.end(); ++ob)
+	if(ob->second != NULL)
+	{
+		w.WriteInt(class_idx[ob->second->GetClass()]);
+		w.WriteInt(ob->first);
+
+		// Payload size isn't known until WriteTo is done - reserve it and patch it.
+		size_t len_pos = w.size();
+		w.WriteInt(0);
+		ob->second->WriteTo(&w);
+		int len = w.size() - len_pos - sizeof(int);
+		memcpy(w.data() + len_pos, &len, sizeof(int));
+
+		if(w.size() >= SNAP_FLUSH_SIZE)
+		{
+			sum = adler32(sum, (const Bytef *) w.data(), w.size());
+			body_len += w.size();
+			ok = ok && fwrite(w.data(), 1, w.size(), fi) == w.size();
+			w.clear();
+		}
+	}
+	w.WriteInt(SNAP_END_TAG);
+
+	sum = adler32(sum, (const Bytef *) w.data(), w.size());
+	body_len += w.size();
+	ok = ok && fwrite(w.data(), 1, w.size(), fi) == w.size();
+
+	w.clear();
+	snap_write_header(w, xml, sum, body_len);
+	DebugAssert(w.size() == header_len);
+	ok = ok && fseek(fi, 0, SEEK_SET) == 0;
+	ok = ok && fwrite(w.data(), 1, header_len, fi) == header_len;
+
+	if(fclose(fi) != 0)
+		ok = false;
+	if(!ok)
+		FILE_delete_file(snap_path.c_str(), false);
+	return ok;
+}
+
+bool	WED_Snapshot::Load(
+						const string&					snap_path,
+						const string&					xml_path,
+						WED_Archive *					archive,
+						map<string,string>&				prefs,
+						map<string,set<int> >&			pref_items)
+{
+	snap_xml_stamp xml;
+	if(!FILE_exists(snap_path.c_str()) || !snap_get_xml_stamp(xml_path, xml))
+		return false;
+
+	MFMemFile * mf = MemFile_Open(snap_path.c_str());
+	if(mf == NULL)
+		return false;
+
+	WED_SnapshotReader r(MemFile_GetBegin(mf), MemFile_GetEnd(mf));
+	bool ok = false;
+
+	do {
+		char magic[8];
+		r.get(magic, 8);
+		if(r.mOverrun || memcmp(magic, SNAP_MAGIC, 7) != 0 || magic[7] != SNAP_FORMAT)	break;
+
+		int endian, sum;
+		string version;
+		snap_xml_stamp snap_xml;
+		int64_t body_len;
+		r.ReadInt(endian);
+		r.ReadString(version);
+		r.get(&snap_xml.size, 8);
+		r.get(&snap_xml.mtime, 8);
+		r.ReadInt(snap_xml.sum);
+		r.ReadInt(sum);
+		r.get(&body_len, 8);
+		if(r.mOverrun || endian != SNAP_ENDIAN_TAG || version != WED_VERSION_STRING)		break;
+		if(snap_xml != xml)																	break;
+		if(body_len != r.end() - r.pos())														break;
+
+		uLong real_sum = adler32(0L, Z_NULL, 0);
+		real_sum = adler32(real_sum, (const Bytef *) r.pos(), r.end() - r.pos());
+		if((int) real_sum != sum)															break;
+
+		int ct;
+		r.ReadInt(ct);
+		for(int n = 0; n < ct && !r.mOverrun; ++n)
+		{
+			string k, v;
+			r.ReadString(k);
+			r.ReadString(v);
+			prefs[k] = v;
+		}
+		r.ReadInt(ct);
+		for(int n = 0; n < ct && !r.mOverrun; ++n)
+		{
+			string k;
+			int ic, item;
+			r.ReadString(k);
+			r.ReadInt(ic);
+			set<int>& items(pref_items[k]);
+			for(int i = 0; i < ic && !r.mOverrun; ++i)
+			{
+				r.ReadInt(item);
+				items.insert(item);
+			}
+		}
+
+		vector<string> classes;
+		r.ReadInt(ct);
+		if(r.mOverrun || ct < 0)															break;
+		classes.resize(ct);
+		for(int n = 0; n < ct; ++n)
+			r.ReadString(classes[n]);
+
+		int obj_count;
+		r.ReadInt(obj_count);
+		if(r.mOverrun || obj_count < 0)														break;
+
+		// Size the archive once rather than growing it (and re-hashing) a hundred thousand times.
+		archive->ReserveObjects(obj_count);
+
+		vector<WED_Persistent *>	needs_post_call;
+		bool						obj_ok = true;
+		for(int n = 0; n < obj_count; ++n)
+		{
+			int cls, id, len;
+			r.ReadInt(cls);
+			r.ReadInt(id);
+			r.ReadInt(len);
+			if(r.mOverrun || cls < 0 || cls >= classes.size() || len < 0 || len > r.end() - r.pos())
+			{
+				obj_ok = false;
+				break;
+			}
+			WED_Persistent * obj = WED_Persistent::CreateByClass(classes[cls].c_str(), archive, id);
+			if(obj == NULL)
+			{
+				obj_ok = false;
+				break;
+			}
+
+			// Give the object a reader that ends exactly at its payload, so a mismatched WriteTo/ReadFrom
+			// pair is caught here rather than corrupting everything after it.
+			WED_SnapshotReader payload(r.pos(), r.pos() + len);
+			if(obj->ReadFrom(&payload))
+				needs_post_call.push_back(obj);
+			r.skip(len);
+			if(payload.mOverrun || payload.pos() != payload.end())
+			{
+				obj_ok = false;
+				break;
+			}
+		}
+		if(!obj_ok)																			break;
+
+		int end_tag;
+		r.ReadInt(end_tag);
+		if(r.mOverrun || end_tag != SNAP_END_TAG || r.pos() != r.end())						break;
+
+		for(vector<WED_Persistent *>::iterator o = needs_post_call.begin(); o != needs_post_call.end(); ++o)
+			(*o)->PostChangeNotify();
+
+		// Same as finishing an XML load - we are now clean.
+		archive->mOpCount = 0;
+		++archive->mCacheKey;
+		ok = true;
+
+	} while(0);
+
+	MemFile_Close(mf);
+	if(!ok)
+	{
+		prefs.clear();
+		pref_items.clear();
+	}
+	return ok;
+}
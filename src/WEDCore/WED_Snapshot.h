@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef WED_Snapshot_H
+#define WED_Snapshot_H
+
+/*
+
+	WED_Snapshot - THEORY OF OPERATION
+
+	earth.wed.xml is THE file format - it is what we interchange, what users back up, and what we trust.  But
+	opening a big one is slow: expat, then element dispatch, then atoi/atof on every attribute.
+
+	So after every successful save we also write earth.wed.snap: a binary image of the archive, which is
+	simply each object's class, ID and WriteTo() stream - the same stream the undo system uses - plus the
+	document prefs.  The snapshot records the size, mod date and checksum of the XML file it was written
+	with; if the XML has been touched since (by anyone), the snapshot is ignored.  It is also ignored if it
+	was written by a different WED version, if its own checksum fails, or if any object's ReadFrom doesn't
+	consume exactly the bytes its WriteTo produced.  In all of those cases the caller just loads the XML.
+
+	The snapshot is a cache, nothing more - deleting it is always safe.
+
+	The snapshot is native-endian and is not meant to be moved between machines.
+
+*/
+
+#include <map>
+#include <set>
+#include <string>
+
+class	WED_Archive;
+
+class	WED_Snapshot {
+public:
+
+	// Writes a snapshot of the archive and prefs.  xml_path must be the XML file we just saved.
+	// Returns false (and leaves no snapshot behind) on failure.
+	static	bool	Save(
+						const string&					snap_path,
+						const string&					xml_path,
+						WED_Archive *					archive,
+						const map<string,string>&		prefs,
+						const map<string,set<int> >&	pref_items);
+
+	// Loads the snapshot if it is valid for xml_path.  Must be called on an empty archive inside a command.
+	// Returns false if the snapshot is missing, stale or damaged - in that case the archive may have been
+	// partially filled, so the caller must clear it before falling back to the XML.
+	static	bool	Load(
+						const string&					snap_path,
+						const string&					xml_path,
+						WED_Archive *					archive,
+						map<string,string>&				prefs,
+						map<string,set<int> >&			pref_items);
+
+};
+
+#endif /* WED_Snapshot_H */
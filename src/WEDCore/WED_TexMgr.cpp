@@ -33,32 +33,72 @@
 	#include <GL/gl.h>
 #endif
 
-WED_TexMgr::WED_TexMgr(const string& package) : mPackage(package)
+// tex_Thumbnail textures load from the first DDS mip that is no bigger than this.
+#define THUMBNAIL_DIM 512
+
+// Leave a core for the UI.
+static int	decode_workers(void)
+{
+	return max(THREAD_CountCores() - 1, 1);
+}
+
+WED_TexMgr::WED_TexMgr(const string& package) : mPackage(package), mPending(0), mQueue(decode_workers())
 {
 }
 
 WED_TexMgr::~WED_TexMgr()
 {
+	mQueue.Wait();
 	for(map<string,TexInfo *>::iterator t = mTexes.begin(); t != mTexes.end(); ++t)
 	{
+		if(t->second->job)
+		{
+			DestroyDecodedTexture(&t->second->job->tex);
+			delete t->second->job;
+		}
 		GLuint id = t->second->tex_id;
-		glDeleteTextures(1, &id);
+		if(id)
+			glDeleteTextures(1, &id);
 		delete t->second;
 	}
 }
 
 TexRef		WED_TexMgr::LookupTexture(const char * path, bool is_absolute, int flags)
 {
-	TexMap::iterator i = mTexes.find(path);
+	string key(path);
+	if(flags & tex_Thumbnail)
+		key += "#thumb";
+
+	TexMap::iterator i = mTexes.find(key);
 	if (i == mTexes.end())
 	{
-		return LoadTexture(path, is_absolute,flags);
+		TexInfo * inf = LoadTexture(path, is_absolute,flags);
+		mTexes[key] = inf;
+		return inf->failed ? NULL : inf;
 	}
-	return i->second;
+
+	TexInfo * inf = i->second;
+	FinishLoad(inf);
+	if(inf->job && !(flags & tex_Async))
+	{
+		// Someone needs this one NOW and the worker hasn't got to it.  Load it ourselves; FinishLoad will throw the
+		// worker's copy away.
+		string fpath = is_absolute ? path : gPackageMgr->ComputePath(mPackage, path);
+		DecodedTexture	tex;
+		if(DecodeTexture(fpath.c_str(), (flags & tex_Thumbnail) ? THUMBNAIL_DIM : 0, &tex))
+		{
+			inf->failed = !UploadTexture(inf, tex);
+			DestroyDecodedTexture(&tex);
+		}
+		else
+			inf->failed = true;
+	}
+	return inf->failed ? NULL : inf;
 }
 
 int			WED_TexMgr::GetTexID(TexRef ref)
 {
+	FinishLoad((TexInfo *) ref);
 	return ((TexInfo *) ref)->tex_id;
 }
 
@@ -72,6 +112,7 @@ void		WED_TexMgr::GetTexInfo(
 						int *	org_y)
 {
 	TexInfo * i = (TexInfo *) ref;
+	FinishLoad(i);
 	if (vis_x) *vis_x = i->vis_x;
 	if (vis_y) *vis_y = i->vis_y;
 	if (act_x) *act_x = i->act_x;
@@ -80,6 +121,12 @@ void		WED_TexMgr::GetTexInfo(
 	if (org_y) *org_y = i->org_y;
 }
 
+int			WED_TexMgr::CountPendingLoads(void)
+{
+	THREAD_Lock	l(mLock);
+	return mPending;
+}
+
 WED_TexMgr::TexInfo *	WED_TexMgr::LoadTexture(const char * path, bool is_absolute, int flags)
 {
 	string fpath;
@@ -87,53 +134,85 @@ WED_TexMgr::TexInfo *	WED_TexMgr::LoadTexture(const char * path, bool is_absolut
 	fpath = is_absolute ? path : gPackageMgr->ComputePath(mPackage, path);
 
 	TexInfo * inf = new TexInfo;
+	memset(inf, 0, sizeof(*inf));
+	inf->flags = flags;
 
-	ImageInfo	im;
+	int max_dim = (flags & tex_Thumbnail) ? THUMBNAIL_DIM : 0;
 
-/*
-	MFMemFile * dds_file;
-	dds_file = MemFile_Open(path);
-	if(dds_file)
+	if(flags & tex_Async)
 	{
-		if (LoadTextureFromDDS((unsigned const char *) MemFile_GetBegin(dds_file),(unsigned const char *) MemFile_GetEnd(dds_file),tn,0,&inf->act_x, &inf->act_y))
+		LoadJob * job = new LoadJob;
+		job->mgr = this;
+		job->path = fpath;
+		job->max_dim = max_dim;
+		job->ok = false;
+		job->done = false;
+		inf->job = job;
 		{
-			inf->tex_id = tn;
-			inf->org_x = inf->vis_x = inf->act_x;
-			inf->org_y = inf->vis_y = inf->act_y;
-			MemFile_Close(dds_file);
-			return inf;
+			THREAD_Lock	l(mLock);
+			++mPending;
 		}
-		MemFile_Close(dds_file);
+		mQueue.Add(DoLoadJob, job);
+		return inf;
 	}
-*/
-	int res = MakeSupportedType(fpath.c_str(),&im);
-	if(res != 0)
+
+	DecodedTexture	tex;
+	if(!DecodeTexture(fpath.c_str(), max_dim, &tex))
 	{
-		delete inf;
-		return NULL;
+		inf->failed = true;
+		return inf;
 	}
+	inf->failed = !UploadTexture(inf, tex);
+	DestroyDecodedTexture(&tex);
+	return inf;
+}
 
+bool		WED_TexMgr::UploadTexture(TexInfo * inf, DecodedTexture& tex)
+{
 	GLuint tn;
 	glGenTextures(1,&tn);
 
-	inf->tex_id = tn;
-	inf->org_x = im.width;
-	inf->org_y = im.height;
-
 	float s,t;
-	if (!LoadTextureFromImage(im, tn, flags, &inf->act_x, &inf->act_y, &s,&t))
+	if (!LoadTextureFromDecoded(tex, tn, inf->flags, &inf->act_x, &inf->act_y, &s,&t))
 	{
-		delete inf;
-		if (im.data) free(im.data);
-		return NULL;
+		glDeleteTextures(1, &tn);
+		return false;
 	}
 
+	inf->tex_id = tn;
+	inf->org_x = tex.org_width;
+	inf->org_y = tex.org_height;
 	inf->vis_x = (float) inf->act_x * s;
 	inf->vis_y = (float) inf->act_y * t;
+	return true;
+}
 
-	mTexes[path] = inf;
-	// janos says: im.data caused a _big_ memory leak :-)
-	if (im.data) free(im.data);
-	return inf;
+void		WED_TexMgr::FinishLoad(TexInfo * inf)
+{
+	if(inf->job == NULL)
+		return;
+	{
+		THREAD_Lock	l(mLock);
+		if(!inf->job->done)
+			return;
+	}
+
+	// If a synchronous lookup beat the worker to it, the texture is already up.
+	if(inf->tex_id == 0 && !inf->failed)
+		inf->failed = !inf->job->ok || !UploadTexture(inf, inf->job->tex);
+
+	DestroyDecodedTexture(&inf->job->tex);
+	delete inf->job;
+	inf->job = NULL;
 }
 
+void		WED_TexMgr::DoLoadJob(void * ref)
+{
+	LoadJob * job = (LoadJob *) ref;
+	bool ok = DecodeTexture(job->path.c_str(), job->max_dim, &job->tex);
+
+	THREAD_Lock	l(job->mgr->mLock);
+	job->ok = ok;
+	job->done = true;
+	--job->mgr->mPending;
+}
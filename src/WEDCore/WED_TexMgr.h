@@ -25,6 +25,25 @@
 #define WED_TexMgr_H
 
 #include "ITexMgr.h"
+#include "TexUtils.h"
+#include "ThreadUtils.h"
+
+/*
+
+	WED_TexMgr - THEORY OF OPERATION
+
+	Textures are loaded on first lookup and kept (by path) until the document closes.  A failed load is remembered
+	too, so a missing texture costs one disk access, not one per redraw.
+
+	With tex_Async, the lookup queues the decode on a worker thread and immediately returns a texture whose ID is 0 -
+	every drawing path already treats that as "draw untextured".  The GL upload has to happen on the main thread, so
+	it is done by the first lookup (or GetTexID) after the worker is finished.  CountPendingLoads tells the map when
+	it is worth redrawing.  Callers that need the size of the texture right away (the TCE, the library preview) just
+	don't pass tex_Async.
+
+	tex_Thumbnail textures are kept separately from full ones, since they may be built from a smaller DDS mip.
+
+*/
 
 class WED_TexMgr : public virtual ITexMgr {
 public:
@@ -43,9 +62,20 @@ public:
 								int *	act_y,
 								int *	org_x,
 								int *	org_y);
+	virtual	int			CountPendingLoads(void);
 
 private:
 
+	// A background decode.  done is set by the worker, under mLock; everything else belongs to whoever holds the job.
+	struct	LoadJob {
+		WED_TexMgr *	mgr;
+		string			path;
+		int				max_dim;
+		DecodedTexture	tex;
+		bool			ok;
+		bool			done;
+	};
+
 	struct	TexInfo {
 		int			tex_id;
 		int			vis_x;
@@ -54,6 +84,9 @@ private:
 		int			act_y;
 		int			org_x;
 		int			org_y;
+		int			flags;
+		bool		failed;
+		LoadJob *	job;		// Decode in progress, or NULL
 	};
 
 	typedef map<string,TexInfo *>	TexMap;
@@ -62,7 +95,15 @@ private:
 
 	string	mPackage;
 
+	THREAD_Mutex	mLock;
+	int				mPending;		// Jobs not yet done - guarded by mLock
+	THREAD_JobQueue	mQueue;
+
 	TexInfo *	LoadTexture(const char * path, bool is_absolute, int flags);
+	bool		UploadTexture(TexInfo * inf, DecodedTexture& tex);
+	void		FinishLoad(TexInfo * inf);
+
+	static void	DoLoadJob(void * ref);
 
 };
 
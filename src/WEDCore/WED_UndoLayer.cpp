@@ -23,26 +23,105 @@
 
 #include "WED_UndoLayer.h"
 #include "WED_Persistent.h"
-#include "WED_Buffer.h"
 #include "WED_Archive.h"
 #include "AssertUtils.h"
-#include "WED_FastBuffer.h"
+#include "IODefs.h"
+#include <zlib.h>
 // NOTE: we could store no turd for created objs
 
+// Grow an image block by at least this much at a time, so most objects' WriteTo runs inside one window.
+#define UNDO_WRITE_SLACK 1024
+
+// Appends to a layer's image block.  While the writer is alive the block has unused slack on the end for the
+// write window; the destructor trims it, so only look at the block's size once the writer is gone.
+class	undo_writer : public IOWriter {
+public:
+
+	undo_writer(vector<char>& data) : mData(data) { }
+	~undo_writer() { mData.resize(used()); }
+
+protected:
+
+	virtual	void	WriteMore(const char * inBuf, int inLength)
+	{
+		size_t u = used();
+		mData.resize(u + inLength + UNDO_WRITE_SLACK);
+		memcpy(&mData[u], inBuf, inLength);
+		mWritePos = &mData[u] + inLength;
+		mWriteEnd = &mData[0] + mData.size();
+	}
+
+private:
+
+	size_t	used(void) const { return mWriteEnd ? mWritePos - &mData[0] : mData.size(); }
+
+	vector<char>&	mData;
+};
+
+// Reads one object's image back out.  The image is the whole window, so needing more is always a bug.
+class	undo_reader : public IOReader {
+public:
+
+	undo_reader(const char * b, const char * e) { mReadPos = b; mReadEnd = e; }
+
+protected:
+
+	virtual	void	ReadMore(char * inBuf, int inLength) { Assert(!"Object read past the end of its undo image."); }
+};
+
+// Pointer to an offset in a block - fine for zero-length images at the very end, which &v[off] is not.
+static const char *	undo_data_at(const vector<char>& v, int off)
+{
+	return v.empty() ? NULL : &v[0] + off;
+}
+
+static unsigned long	undo_checksum(const vector<char>& image)
+{
+	uLong sum = adler32(0L, Z_NULL, 0);
+	if(!image.empty())
+		sum = adler32(sum, (const Bytef *) &image[0], image.size());
+	return sum;
+}
+
 WED_UndoLayer::WED_UndoLayer(WED_Archive * inArchive, const string& inName, const char * inFile, int inLine) :
-	mArchive(inArchive), mName(inName), mChangeMask(0), mFile(inFile), mLine(inLine)
+	mArchive(inArchive), mName(inName), mChangeMask(0), mFile(inFile), mLine(inLine),
+	mIndexOffset(0), mIndexCount(0), mState(state_Recording), mRawSize(0), mSpill(NULL), mSpillSize(0)
 {
-	mStorage = new WED_FastBufferGroup;
 }
 
 WED_UndoLayer::~WED_UndoLayer(void)
 {
-//	for(ObjInfoMap::iterator i = mObjects.begin(); i != mObjects.end(); ++i)
-//	{
-//		if (i->second.buffer)
-//			delete i->second.buffer;
-//	}
-	delete mStorage;
+	if (mSpill)
+		fclose(mSpill);
+}
+
+void	WED_UndoLayer::Record(WED_Persistent * inObject, LayerOp op)
+{
+	DebugAssert(mState == state_Recording);
+	ObjInfo	info;
+	info.the_class = inObject->GetClass();
+	info.op = op;
+	info.id = inObject->GetID();
+	info.dirty = inObject->GetDirty();
+	info.offset = mData.size();
+	{
+		undo_writer	w(mData);
+		inObject->WriteTo(&w);
+	}
+	info.length = mData.size() - info.offset;
+	info.base_length = -1;
+	info.base_sum = 0;
+	mObjects.insert(ObjInfoMap::value_type(inObject->GetID(), info));
+}
+
+void	WED_UndoLayer::Reserve(int count)
+{
+	DebugAssert(mState == state_Recording);
+#if defined(_MSC_VER)
+	mObjects.rehash(mObjects.size() + count);
+#else
+	mObjects.resize(mObjects.size() + count);
+#endif
 }
 
 void 	WED_UndoLayer::ObjectCreated(WED_Persistent * inObject)
@@ -65,7 +144,11 @@ void 	WED_UndoLayer::ObjectCreated(WED_Persistent * inObject)
 		info.the_class = inObject->GetClass();
 		info.op = op_Created;
 		info.id = inObject->GetID();
-		info.buffer = NULL;
+		info.dirty = 0;
+		info.offset = -1;
+		info.length = 0;
+		info.base_length = -1;
+		info.base_sum = 0;
 		mObjects.insert(ObjInfoMap::value_type(inObject->GetID(), info));
 	}
 }
@@ -85,15 +168,7 @@ void	WED_UndoLayer::ObjectChanged(WED_Persistent * inObject, int change_kind)
 
 	} else {
 		// First time changed
-		ObjInfo	info;
-		info.the_class = inObject->GetClass();
-		info.op = op_Changed;
-		info.id = inObject->GetID();
-		info.buffer = mStorage->MakeNewBuffer();
-//		info.buffer = new WED_Buffer;
-		inObject->WriteTo(info.buffer);
-		info.buffer->WriteInt(inObject->GetDirty());
-		mObjects.insert(ObjInfoMap::value_type(inObject->GetID(), info));
+		Record(inObject, op_Changed);
 	}
 }
 
@@ -123,57 +198,245 @@ void	WED_UndoLayer::ObjectDestroyed(WED_Persistent * inObject)
 		}
 	} else {
 		// First time changed
-		ObjInfo	info;
-		info.the_class = inObject->GetClass();
-		info.op = op_Destroyed;
-		info.id = inObject->GetID();
-		info.buffer = mStorage->MakeNewBuffer();
-//		info.buffer = new WED_Buffer;
-		inObject->WriteTo(info.buffer);
-		info.buffer->WriteInt(inObject->GetDirty());
-		mObjects.insert(ObjInfoMap::value_type(inObject->GetID(), info));
+		Record(inObject, op_Destroyed);
 	}
 
 }
 
+void	WED_UndoLayer::Seal(void)
+{
+	if (mState != state_Recording) return;
+
+	// Rebuild the block with only what we keep: deltas for changed objects, whole images for destroyed ones.
+	// A change + destroy inside the command leaves op_Destroyed with its image, so there is no live object for it.
+	vector<char>	packed;
+	vector<char>	base;
+	packed.reserve(mData.size() / 4);
+	for (ObjInfoMap::iterator i = mObjects.begin(); i != mObjects.end(); ++i)
+	{
+		ObjInfo& info(i->second);
+		if (info.offset == -1) continue;
+		const char * image = undo_data_at(mData, info.offset);
+		int new_offset = packed.size();
+
+		if (info.op == op_Changed)
+		{
+			WED_Persistent * obj = mArchive->Fetch(info.id);
+			Assert(obj != NULL);
+			base.clear();
+			{
+				undo_writer	w(base);
+				obj->WriteTo(&w);
+			}
+
+			// Keep what lies between the common prefix and the common suffix.
+			int blen = base.size();
+			int limit = min(info.length, blen);
+			int prefix = 0;
+			while (prefix < limit && image[prefix] == base[prefix])
+				++prefix;
+			int suffix = 0;
+			while (suffix < limit - prefix && image[info.length - 1 - suffix] == base[blen - 1 - suffix])
+				++suffix;
+			int middle = info.length - prefix - suffix;
+			if (middle + 2 * sizeof(int) < info.length)
+			{
+				packed.insert(packed.end(), (const char *) &prefix, (const char *) &prefix + sizeof(int));
+				packed.insert(packed.end(), (const char *) &suffix, (const char *) &suffix + sizeof(int));
+				packed.insert(packed.end(), image + prefix, image + prefix + middle);
+				info.offset = new_offset;
+				info.length = packed.size() - new_offset;
+				info.base_length = blen;
+				info.base_sum = undo_checksum(base);
+				continue;
+			}
+		}
+		packed.insert(packed.end(), image, image + info.length);
+		info.offset = new_offset;
+	}
+
+	mIndexOffset = packed.size();
+	mIndexCount = mObjects.size();
+	for (ObjInfoMap::iterator i = mObjects.begin(); i != mObjects.end(); ++i)
+		packed.insert(packed.end(), (const char *) &i->second, (const char *) &i->second + sizeof(ObjInfo));
+	ObjInfoMap().swap(mObjects);
+
+	mData.swap(packed);
+	mState = state_Sealed;
+}
+
+void	WED_UndoLayer::Compress(void)
+{
+	if (mState != state_Sealed) return;
+	mRawSize = mData.size();
+	if (mRawSize == 0)
+	{
+		mZip.clear();
+		mState = state_Compressed;
+		return;
+	}
+	uLongf zlen = compressBound(mRawSize);
+	mZip.resize(zlen);
+	if (compress2((Bytef *) &mZip[0], &zlen, (const Bytef *) &mData[0], mRawSize, Z_BEST_SPEED) != Z_OK)
+	{
+		mZip.clear();
+		return;
+	}
+	mZip.resize(zlen);
+	vector<char>(mZip).swap(mZip);
+	vector<char>().swap(mData);
+	mState = state_Compressed;
+}
+
+bool	WED_UndoLayer::Spill(void)
+{
+	if (mState == state_Spilled) return true;
+	Compress();
+	if (mState != state_Compressed) return false;
+
+	// tmpfile is deleted by the OS when closed, or when we quit or crash.
+	mSpill = tmpfile();
+	if (mSpill == NULL) return false;
+	if (!mZip.empty() && fwrite(&mZip[0], 1, mZip.size(), mSpill) != mZip.size())
+	{
+		fclose(mSpill);
+		mSpill = NULL;
+		return false;
+	}
+	fflush(mSpill);
+	mSpillSize = mZip.size();
+	vector<char>().swap(mZip);
+	mState = state_Spilled;
+	return true;
+}
+
+size_t	WED_UndoLayer::GetMemorySize(void) const
+{
+	return sizeof(*this) + mObjects.size() * (sizeof(ObjInfo) + 2 * sizeof(void *)) + mData.capacity() + mZip.capacity();
+}
+
+size_t	WED_UndoLayer::GetSpillSize(void) const
+{
+	return mState == state_Spilled ? mSpillSize : 0;
+}
+
+void	WED_UndoLayer::Load(void)
+{
+	if (mState == state_Spilled)
+	{
+		rewind(mSpill);
+		mZip.resize(mSpillSize);
+		if (!mZip.empty() && fread(&mZip[0], 1, mZip.size(), mSpill) != mZip.size())
+			AssertPrintf("Could not read undo step %s back from its temp file.", mName.c_str());
+		fclose(mSpill);
+		mSpill = NULL;
+		mState = state_Compressed;
+	}
+	if (mState == state_Compressed)
+	{
+		mData.resize(mRawSize);
+		uLongf rlen = mRawSize;
+		if (mRawSize > 0)
+		if (uncompress((Bytef *) &mData[0], &rlen, (const Bytef *) &mZip[0], mZip.size()) != Z_OK || rlen != mRawSize)
+			AssertPrintf("Undo step %s is damaged.", mName.c_str());
+		vector<char>().swap(mZip);
+		mState = state_Sealed;
+	}
+}
+
 void	WED_UndoLayer::Execute(void)
 {
+	Load();
+
+	vector<ObjInfo>		objs;
+	if (mState == state_Recording)
+	{
+		for (ObjInfoMap::iterator i = mObjects.begin(); i != mObjects.end(); ++i)
+			objs.push_back(i->second);
+	}
+	else if (mIndexCount > 0)
+	{
+		objs.resize(mIndexCount);
+		memcpy(&objs[0], &mData[mIndexOffset], mIndexCount * sizeof(ObjInfo));
+	}
+
+	// First rebuild the full image of every delta-encoded object.  This has to happen before we restore anything:
+	// the deltas are against the archive as it is right now.
+	vector<char>	full;
+	vector<char>	base;
+	vector<pair<int, int> >	full_span;		// offset and length in full, per object
+	for (vector<ObjInfo>::iterator i = objs.begin(); i != objs.end(); ++i)
+	{
+		full_span.push_back(pair<int, int>(-1, 0));
+		if (i->base_length == -1) continue;
+
+		WED_Persistent * obj = mArchive->Fetch(i->id);
+		Assert(obj != NULL);
+		base.clear();
+		{
+			undo_writer	w(base);
+			obj->WriteTo(&w);
+		}
+		if (base.size() != i->base_length || undo_checksum(base) != i->base_sum)
+			AssertPrintf("Undo step %s can't restore object %d: it is not in the state the step was recorded against.", mName.c_str(), i->id);
+
+		const char * delta = undo_data_at(mData, i->offset);
+		int prefix, suffix;
+		memcpy(&prefix, delta, sizeof(int));
+		memcpy(&suffix, delta + sizeof(int), sizeof(int));
+		full_span.back().first = full.size();
+		full.insert(full.end(), base.begin(), base.begin() + prefix);
+		full.insert(full.end(), delta + 2 * sizeof(int), delta + i->length);
+		full.insert(full.end(), base.end() - suffix, base.end());
+		full_span.back().second = full.size() - full_span.back().first;
+	}
+
 	vector<WED_Persistent *>	needs_post_call;
-	int d;
-	for (ObjInfoMap::iterator i = mObjects.begin(); i != mObjects.end(); ++i)
+	int n = 0;
+	for (vector<ObjInfo>::iterator i = objs.begin(); i != objs.end(); ++i, ++n)
 	{
+		const char * b, * e;
+		if (full_span[n].first != -1)
+		{
+			b = undo_data_at(full, full_span[n].first);
+			e = b + full_span[n].second;
+		}
+		else if (i->offset != -1)
+		{
+			b = undo_data_at(mData, i->offset);
+			e = b + i->length;
+		}
+		else
+			b = e = NULL;
+		undo_reader	r(b, e);
+
 		WED_Persistent * obj;
-		switch(i->second.op) {
+		switch(i->op) {
 		case op_Created:
-			obj = mArchive->Fetch(i->first);
-			DebugAssert(i->second.buffer == NULL);
+			obj = mArchive->Fetch(i->id);
+			DebugAssert(i->offset == -1);
 			Assert(obj != NULL);
 			obj->Delete();
 			break;
 		case op_Changed:
-			obj = mArchive->Fetch(i->first);
+			obj = mArchive->Fetch(i->id);
 			Assert(obj != NULL);
-			DebugAssert(i->second.buffer != NULL);
-			i->second.buffer->ResetRead();
+			DebugAssert(b != NULL);
 			obj->StateChanged();
-			if(obj->ReadFrom(i->second.buffer))
+			if(obj->ReadFrom(&r))
 				needs_post_call.push_back(obj);
-			i->second.buffer->ReadInt(d);
-			obj->SetDirty(d);
+			obj->SetDirty(i->dirty);
 			break;
 		case op_Destroyed:
-			obj = WED_Persistent::CreateByClass(i->second.the_class, mArchive, i->first);
+			obj = WED_Persistent::CreateByClass(i->the_class, mArchive, i->id);
 			DebugAssert(obj != NULL);
-			DebugAssert(i->second.buffer != NULL);
-			i->second.buffer->ResetRead();
-			if(obj->ReadFrom(i->second.buffer))
+			DebugAssert(b != NULL);
+			if(obj->ReadFrom(&r))
 				needs_post_call.push_back(obj);
-			i->second.buffer->ReadInt(d);
-			obj->SetDirty(d);
+			obj->SetDirty(i->dirty);
 			break;
 		}
 	}
 	for(vector<WED_Persistent *>::iterator o = needs_post_call.begin(); o != needs_post_call.end(); ++o)
 		(*o)->PostChangeNotify();
 }
-
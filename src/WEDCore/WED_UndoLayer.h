@@ -24,10 +24,38 @@
 #ifndef WED_UNDOLAYER_H
 #define WED_UNDOLAYER_H
 
+/*
+
+	WED_UndoLayer - THEORY OF OPERATION
+
+	An undo layer records, for every object a command touched, whether it was created, changed or destroyed, and
+	for the last two the object's WriteTo image from before the command.  Executing the layer puts all of those
+	objects back.
+
+	While the command runs the images are just appended to one block of memory.  When the undo manager files the
+	layer away it calls Seal, which shrinks most of them:
+
+	- A CHANGED object still exists, and the layer can only ever be executed when the archive is back in exactly
+	  the state it was in at Seal time (everything after it has been undone).  So we keep only the span of bytes
+	  that differs from the object's image as of Seal - for a moved vertex that's its coordinates - and rebuild the
+	  full image from the live object when we execute.  We keep the length and Adler-32 of the image we diffed
+	  against, and check them before trusting the delta.
+	- A DESTROYED object has nothing to diff against, so its image is kept whole.
+
+	Seal also moves the per-object bookkeeping out of the hash map into a flat array at the end of the same block
+	- for small objects like vertices, the map cost as much as the images.
+
+	Compress zlibs the sealed layer and Spill moves the compressed layer to an anonymous temp file, freeing the
+	memory; both are reversed on demand when the layer is executed.  The undo manager decides which layers to
+	compress and spill - see WED_UndoMgr.h.
+
+	Dirty flags are kept beside the images, not in them, since saving clears them without going through undo.
+
+*/
+
+#include <stdio.h>
+
 class	WED_Archive;
-class	WED_Buffer;
-class	WED_FastBuffer;
-class	WED_FastBufferGroup;
 class	WED_Persistent;
 
 #define 	UNDO_DISCARD	((WED_UndoLayer *) -1)
@@ -42,13 +70,24 @@ public:
 		void 	ObjectCreated(WED_Persistent * inObject);
 		void	ObjectChanged(WED_Persistent * inObject, int change_kind);
 		void	ObjectDestroyed(WED_Persistent * inObject);
+		void	MarkChanged(int change_kind) { mChangeMask |= change_kind; }	// A change with nothing to record - see WED_Archive::StartBulkCreate.
+		void	Reserve(int count);
 
 		void	Execute(void);
 
+		void	Seal(void);						// Done recording - delta-encode against the archive as it is now.
+		void	Compress(void);					// Sealed layers only; no-op if already compressed or spilled.
+		bool	Spill(void);					// Compresses if needed and writes to a temp file.  False if it can't.
+
+		size_t	GetMemorySize(void) const;		// What the layer holds in RAM, roughly.
+		size_t	GetSpillSize(void) const;		// What the layer holds on disk.
+		bool	IsCompressed(void) const { return mState == state_Compressed || mState == state_Spilled; }
+		bool	IsSpilled(void) const { return mState == state_Spilled; }
+
 		string	GetName(void) const { return mName; }
 		const char * GetFile(void) const { return mFile; }
 		int		GetLine(void) const { return mLine; }
-		bool	Empty(void) const { return mObjects.empty(); }
+		bool	Empty(void) const { return mObjects.empty() && mIndexCount == 0; }
 
 		int		GetChangeMask(void) { return mChangeMask; }
 
@@ -60,22 +99,44 @@ private:
 			op_Destroyed
 	};
 
+	enum LayerState {
+			state_Recording,		// mData has full images
+			state_Sealed,			// mData has deltas and full images
+			state_Compressed,		// mZip has mData, deflated
+			state_Spilled			// mSpill has mZip
+	};
+
 	struct ObjInfo {
 		LayerOp				op;
 		int					id;
 		const char *		the_class;
-		WED_FastBuffer *	buffer;
+		int					dirty;
+		int					offset;			// Image or delta in mData, -1 if none
+		int					length;
+		int					base_length;	// -1: full image.  Otherwise a delta against an image this long...
+		unsigned long		base_sum;		// ...with this Adler-32.
 	};
 
 	typedef hash_map<int, ObjInfo>		ObjInfoMap;
 
-	ObjInfoMap				mObjects;
+			void	Load(void);
+			void	Record(WED_Persistent * inObject, LayerOp op);
+
+	ObjInfoMap				mObjects;		// While recording
+	int						mIndexOffset;	// Once sealed: mIndexCount ObjInfos at this offset in mData
+	int						mIndexCount;
 	WED_Archive *			mArchive;
 	string					mName;
 	const char *			mFile;
 	int						mLine;
 	int						mChangeMask;
-	WED_FastBufferGroup *	mStorage;
+
+	LayerState				mState;
+	vector<char>			mData;
+	vector<char>			mZip;
+	size_t					mRawSize;		// mData's size when compressed
+	FILE *					mSpill;
+	size_t					mSpillSize;		// mZip's size when spilled
 
 	// Things we do not allow
 	WED_UndoLayer();
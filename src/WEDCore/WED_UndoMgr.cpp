@@ -36,6 +36,23 @@
 #define WARN_IF_LESS_LEVEL	10
 #define MAX_UNDO_LEVELS 20
 
+// Undo steps this close to the present are not compressed.
+#define UNDO_KEEP_RAW		2
+// Temp files may hold this many times the memory budget.
+#define UNDO_SPILL_RATIO	4
+
+static size_t	sMemoryBudget = 256 * 1024 * 1024;
+
+void	WED_UndoMgr::SetMemoryBudget(size_t bytes)
+{
+	sMemoryBudget = bytes;
+}
+
+size_t	WED_UndoMgr::GetMemoryBudget(void)
+{
+	return sMemoryBudget;
+}
+
 WED_UndoMgr::WED_UndoMgr(WED_Archive * inArchive, WED_UndoFatalErrorHandler * panic_handler) : mCommand(NULL), mArchive(inArchive), mPanicHandler(panic_handler)
 {
 }
@@ -100,9 +117,11 @@ void	WED_UndoMgr::CommitCommand(void)
 		return;
 	}
 	PurgeRedo();
+	mCommand->Seal();
 	mUndo.push_back(mCommand);
 	int change_mask = mCommand->GetChangeMask();
 	mCommand = NULL;
+	Trim();
 	mArchive->BroadcastMessage(msg_ArchiveChanged,change_mask);
 }
 
@@ -148,9 +167,11 @@ void	WED_UndoMgr::Undo(void)
 	int change_mask = undo->GetChangeMask();
 	undo->Execute();
 	mArchive->SetUndo(NULL);
+	redo->Seal();
 	mRedo.push_front(redo);
 	delete undo;
 	mUndo.pop_back();
+	Trim();
 	mArchive->mOpCount--;
 	mArchive->mCacheKey++;
 	mArchive->BroadcastMessage(msg_ArchiveChanged,change_mask);
@@ -165,9 +186,11 @@ void	WED_UndoMgr::Redo(void)
 	int change_mask = redo->GetChangeMask();
 	redo->Execute();
 	mArchive->SetUndo(NULL);
+	undo->Seal();
 	mUndo.push_back(undo);
 	delete redo;
 	mRedo.pop_front();
+	Trim();
 	mArchive->mOpCount++;
 	mArchive->mCacheKey++;
 	mArchive->BroadcastMessage(msg_ArchiveChanged,change_mask);
@@ -187,9 +210,71 @@ void	WED_UndoMgr::PurgeRedo(void)
 	mRedo.clear();
 }
 
+void	WED_UndoMgr::Trim(void)
+{
+	int n = 0;
+	for (LayerList::reverse_iterator l = mUndo.rbegin(); l != mUndo.rend(); ++l, ++n)
+	if (n >= UNDO_KEEP_RAW)
+		(*l)->Compress();
+	n = 0;
+	for (LayerList::iterator l = mRedo.begin(); l != mRedo.end(); ++l, ++n)
+	if (n >= UNDO_KEEP_RAW)
+		(*l)->Compress();
+
+	if (sMemoryBudget == 0) return;
+
+	size_t	mem = 0, disk = 0;
+	for (LayerList::iterator l = mUndo.begin(); l != mUndo.end(); ++l)
+	{
+		mem += (*l)->GetMemorySize();
+		disk += (*l)->GetSpillSize();
+	}
+	for (LayerList::iterator l = mRedo.begin(); l != mRedo.end(); ++l)
+	{
+		mem += (*l)->GetMemorySize();
+		disk += (*l)->GetSpillSize();
+	}
+
+	// Oldest undo first, then furthest redo.
+	vector<WED_UndoLayer *>	order(mUndo.begin(), mUndo.end());
+	order.insert(order.end(), mRedo.rbegin(), mRedo.rend());
+	for (vector<WED_UndoLayer *>::iterator l = order.begin(); l != order.end() && mem > sMemoryBudget; ++l)
+	if (!(*l)->IsSpilled())
+	{
+		size_t was = (*l)->GetMemorySize();
+		if ((*l)->Spill())
+		{
+			mem -= was - (*l)->GetMemorySize();
+			disk += (*l)->GetSpillSize();
+		}
+	}
+
+	while (disk > sMemoryBudget * UNDO_SPILL_RATIO && !mUndo.empty() && mUndo.front()->IsSpilled())
+	{
+		disk -= mUndo.front()->GetSpillSize();
+		delete mUndo.front();
+		mUndo.pop_front();
+	}
+	while (disk > sMemoryBudget * UNDO_SPILL_RATIO && !mRedo.empty() && mRedo.back()->IsSpilled())
+	{
+		disk -= mRedo.back()->GetSpillSize();
+		delete mRedo.back();
+		mRedo.pop_back();
+	}
+}
+
 bool	WED_UndoMgr::ReleaseMemory(void)
 {
 	if (mUndo.empty() && mRedo.empty()) return false;
+
+	// Getting a step out of RAM is better than losing it.
+	for (LayerList::iterator l = mUndo.begin(); l != mUndo.end(); ++l)
+	if (!(*l)->IsSpilled() && (*l)->Spill())
+		return true;
+	for (LayerList::reverse_iterator l = mRedo.rbegin(); l != mRedo.rend(); ++l)
+	if (!(*l)->IsSpilled() && (*l)->Spill())
+		return true;
+
 	if (mUndo.size() > WARN_IF_LESS_LEVEL)
 	{
 		delete mUndo.front();
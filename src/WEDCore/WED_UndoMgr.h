@@ -46,6 +46,20 @@ public:
 	virtual	void	Panic(void)=0;
 };
 
+/*
+	UNDO MEMORY
+
+	Each undo step is sealed (delta-encoded, see WED_UndoLayer.h) as soon as it is filed.  After that:
+
+	- Steps more than UNDO_KEEP_RAW away from the present are zlib'd; the nearest ones are left alone so undoing
+	  them is instant.
+	- If the history is still over the memory budget, steps are moved to temp files, starting with the oldest
+	  undo, then the furthest redo.
+	- If the temp files pass UNDO_SPILL_RATIO times the budget, the oldest spilled steps are thrown away.
+
+	MAX_UNDO_LEVELS still applies on top of that, and GUI_MemoryHog::ReleaseMemory spills before it purges.
+*/
+
 class	WED_UndoMgr : public GUI_MemoryHog {
 public:
 
@@ -70,8 +84,14 @@ public:
 	// From GUI_MemoryHog
 	virtual	bool	ReleaseMemory(void);
 
+	// For all documents.  0 means keep everything in memory.
+	static	void	SetMemoryBudget(size_t bytes);
+	static	size_t	GetMemoryBudget(void);
+
 private:
 
+			void	Trim(void);
+
 	typedef list<WED_UndoLayer *>	LayerList;
 
 	LayerList 		mUndo;
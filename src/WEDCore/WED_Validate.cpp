@@ -81,6 +81,7 @@
 #include "MemFileUtils.h"
 #include "PlatformUtils.h"
 #include "MathUtils.h"
+#include "ThreadUtils.h"
 
 #include "WED_Document.h"
 #include "WED_FileCache.h"
@@ -813,13 +814,15 @@ static void ValidateOneATCRunwayUse(WED_ATCRunwayUse* use, validation_error_vect
 		msgs.push_back(validation_error_t("ATC runway use must support at least one equipment type.", err_rwy_use_must_have_at_least_one_equip, use, apt));
 }
 
-static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_error_vector& msgs, WED_Airport * apt)
+static void TJunctionTest(const vector<WED_TaxiRoute*>& all_taxiroutes, validation_error_vector& msgs, WED_Airport * apt)
 {
-	static CoordTranslator2 translator;
+	CoordTranslator2 translator;
 	Bbox2 box;
 	apt->GetBounds(gis_Geo, box);
 	CreateTranslatorForBounds(box,translator);
 
+	const double TJUNCTION_THRESHOLD = 1.00;
+
 	/*For each edge A
 		for each OTHER edge B
 
@@ -830,20 +833,42 @@ static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_erro
 				if end has a valence of 1
 					if the distance between A and the end node you are testing is < M meters
 						validation failure - that node is too close to a taxiway route but isn't joined.
+
+		Only edges whose boxes come within the threshold of each other can possibly fail, so we find those pairs
+		with a grid first instead of trying every edge against every other edge.  Each edge's neighbors are
+		visited in ascending order, so the messages come out exactly as the brute force loop would make them.
 	*/
 
-	for (vector<WED_TaxiRoute*>::iterator edge_a_itr = all_taxiroutes.begin(); edge_a_itr != all_taxiroutes.end(); ++edge_a_itr)
+	vector<TaxiRouteInfo>	infos;
+	vector<Bbox2>			boxes;
+	infos.reserve(all_taxiroutes.size());
+	boxes.reserve(all_taxiroutes.size());
+	for (vector<WED_TaxiRoute*>::const_iterator e = all_taxiroutes.begin(); e != all_taxiroutes.end(); ++e)
 	{
-		for (vector<WED_TaxiRoute*>::iterator edge_b_itr = all_taxiroutes.begin(); edge_b_itr != all_taxiroutes.end(); ++edge_b_itr)
-		{
-			//Skip over the same ones
-			if (edge_a_itr == edge_b_itr)
-			{
-				continue;
-			}
+		infos.push_back(TaxiRouteInfo(*e,translator));
+		Bbox2 b(infos.back().taxiroute_segment_m.p1, infos.back().taxiroute_segment_m.p2);
+		for (vector<Point2>::iterator n = infos.back().nodes_m.begin(); n != infos.back().nodes_m.end(); ++n)
+			b += *n;
+		b.expand(TJUNCTION_THRESHOLD * 0.5);
+		boxes.push_back(b);
+	}
+
+	vector<pair<int,int> >	pairs;
+	FindOverlappingBoxes(boxes, pairs);
+
+	vector<vector<int> >	near_edges(infos.size());
+	for (vector<pair<int,int> >::iterator p = pairs.begin(); p != pairs.end(); ++p)
+	{
+		near_edges[p->first].push_back(p->second);
+		near_edges[p->second].push_back(p->first);
+	}
 
-			TaxiRouteInfo edge_a(*edge_a_itr,translator);
-			TaxiRouteInfo edge_b(*edge_b_itr,translator);
+	for (int a = 0; a < infos.size(); ++a)
+	{
+		for (vector<int>::iterator b = near_edges[a].begin(); b != near_edges[a].end(); ++b)
+		{
+			const TaxiRouteInfo& edge_a(infos[a]);
+			const TaxiRouteInfo& edge_b(infos[*b]);
  
 			//tmp doesn't matter to us
 			Point2 tmp;
@@ -872,7 +897,6 @@ static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_erro
 				continue;
 			}
 
-			const double TJUNCTION_THRESHOLD = 1.00;
 			for (int i = 0; i < 2; i++)
 			{
 				set<WED_Thing*> node_viewers;
@@ -886,7 +910,7 @@ static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_erro
 					if (dist_b_node_to_a_edge < TJUNCTION_THRESHOLD)
 					{
 						vector<WED_Thing*> problem_children;
-						problem_children.push_back(*edge_a_itr);
+						problem_children.push_back(edge_a.taxiroute_ptr);
 
 						string problem_node_name;
 
@@ -2315,8 +2339,21 @@ static void ValidateOneAirport(WED_Airport* apt, validation_error_vector& msgs,
 	ValidateDSFRecursive(apt, lib_mgr, msgs, apt);
 }
 
+struct	validate_apt_job_t {
+	vector<WED_Airport *> *				apts;
+	vector<validation_error_vector> *	msgs;		// one per airport
+	WED_LibraryMgr *					lib_mgr;
+	WED_ResourceMgr *					res_mgr;
+	MFMemFile *							mf;
+};
+
+static void ValidateOneAirportJob(int item, int worker, void * ref)
+{
+	validate_apt_job_t * job = (validate_apt_job_t *) ref;
+	ValidateOneAirport((*job->apts)[item], (*job->msgs)[item], job->lib_mgr, job->res_mgr, job->mf);
+}
 
-validation_result_t	WED_ValidateApt(WED_Document * resolver, WED_MapPane * pane, WED_Thing * wrl, bool skipErrorDialog)
+validation_result_t	WED_ValidateApt(WED_Document * resolver, WED_MapPane * pane, WED_Thing * wrl, bool skipErrorDialog, validation_error_vector * out_msgs)
 {
 #if DEBUG_VIS_LINES
 	//Clear the previously drawn lines before every validation
@@ -2383,10 +2420,26 @@ validation_result_t	WED_ValidateApt(WED_Document * resolver, WED_MapPane * pane,
 			mf = MemFile_Open(res.out_path.c_str());
 	}
 
+	// Airports are validated in parallel, one airport per work item.  The validators only read the document, with two
+	// exceptions we take care of here: entities build their bounds caches lazily (so build them all now, on this
+	// thread), and the resource manager fills its cache on demand (it locks).  Each airport gets its own message list
+	// and we append them in airport order, so the report reads the same no matter which thread finished first.
 	for(vector<WED_Airport *>::iterator a = apts.begin(); a != apts.end(); ++a)
 	{
-		ValidateOneAirport(*a, msgs, lib_mgr, res_mgr, mf);
+		Bbox2 warm_cache;
+		(*a)->GetBounds(gis_Geo, warm_cache);
 	}
+
+	vector<validation_error_vector>	apt_msgs(apts.size());
+	validate_apt_job_t	job = { &apts, &apt_msgs, lib_mgr, res_mgr, mf };
+#if DEBUG_VIS_LINES
+	THREAD_ParallelFor(apts.size(), ValidateOneAirportJob, &job, 1);		// the debug lines are global - stay on one thread.
+#else
+	THREAD_ParallelFor(apts.size(), ValidateOneAirportJob, &job);
+#endif
+
+	for(vector<validation_error_vector>::iterator m = apt_msgs.begin(); m != apt_msgs.end(); ++m)
+		msgs.insert(msgs.end(), m->begin(), m->end());
 	if (mf) MemFile_Close(mf);
 
 
@@ -2415,9 +2468,13 @@ validation_result_t	WED_ValidateApt(WED_Document * resolver, WED_MapPane * pane,
 
 		if (fi != NULL)
 			fprintf(fi, "%s: %s %s\n", aname.c_str(), v->msg.c_str(), warn);
-		fprintf(stdout, "%s: %s %s\n", aname.c_str(), v->msg.c_str(), warn);
+		if(out_msgs == NULL)
+			fprintf(stdout, "%s: %s %s\n", aname.c_str(), v->msg.c_str(), warn);
 	}
-	fclose(fi);
+	if(fi) fclose(fi);
+
+	if(out_msgs)
+		*out_msgs = msgs;
 
 	if(!msgs.empty())
 	{
@@ -29,8 +29,6 @@
 #include "CompGeomUtils.h"
 #include "GISUtils.h"
 
-static CoordTranslator2 translator;
-
 typedef vector<WED_ATCRunwayUse*>  ATCRunwayUseVec_t;
 typedef vector<WED_ATCFlow*>       FlowVec_t;
 typedef vector<WED_Runway*>        RunwayVec_t;
@@ -47,7 +45,8 @@ typedef vector<TaxiRouteInfo>      TaxiRouteInfoVec_t;
 // - if no taxiway vector is passed, being mentioned in a flow is sufficient to consider it active
 static RunwayInfoVec_t CollectPotentiallyActiveRunways( const TaxiRouteInfoVec_t& all_taxiroutes,
 														validation_error_vector& msgs,
-														WED_Airport* apt)
+														WED_Airport* apt,
+														const CoordTranslator2& translator)
 {
 	FlowVec_t flows;
 	CollectRecursive(apt,back_inserter<FlowVec_t>(flows),WED_ATCFlow::sClass);
@@ -269,7 +268,7 @@ static bool TaxiRouteCenterlineCheck( const RunwayInfo& runway_info,
 	return msgs.size() - original_num_errors == 0 ? true : false;
 }
 
-static vector<TaxiRouteInfo> filter_viewers_by_is_runway(const WED_GISPoint* node, const string& runway_name)
+static vector<TaxiRouteInfo> filter_viewers_by_is_runway(const WED_GISPoint* node, const string& runway_name, const CoordTranslator2& translator)
 {
 	vector<TaxiRouteInfo> matching_routes;
 
@@ -296,7 +295,8 @@ static bool RunwaysTaxiRouteValencesCheck (const RunwayInfo& runway_info,
 										   const TaxiRouteNodeVec_t& all_matching_nodes, //All nodes from taxiroutes matching the runway, these will come in sorted
 										   WED_TaxiRoute*& out_start_taxiroute, //Out parameter, one of the ends of the taxiroute
 										   validation_error_vector& msgs,
-										   WED_Airport* apt)
+										   WED_Airport* apt,
+										   const CoordTranslator2& translator)
 {
 	int original_num_errors = msgs.size();
 	int num_valence_of_1 = 0; //Aka, the tips of the runway, should end up being 2
@@ -313,7 +313,7 @@ static bool RunwaysTaxiRouteValencesCheck (const RunwayInfo& runway_info,
 			{
 				if(out_start_taxiroute == NULL)
 				{
-					TaxiRouteInfoVec_t viewers = filter_viewers_by_is_runway(*node_itr,runway_info.runway_name);
+					TaxiRouteInfoVec_t viewers = filter_viewers_by_is_runway(*node_itr,runway_info.runway_name, translator);
 					out_start_taxiroute = viewers.front().taxiroute_ptr;
 				}
 				++num_valence_of_1;
@@ -348,7 +348,8 @@ static int get_node_valence(const WED_GISPoint* node)
 }
 
 static WED_GISPoint* get_next_node(const WED_GISPoint* current_node,
-							const TaxiRouteInfo& next_taxiroute)
+							const TaxiRouteInfo& next_taxiroute,
+							const CoordTranslator2& translator)
 {
 	WED_GISPoint* next = NULL;
 	if(next_taxiroute.nodes[0] == current_node)
@@ -369,7 +370,7 @@ static WED_GISPoint* get_next_node(const WED_GISPoint* current_node,
 		return NULL; //We don't want to travel there next, its time to end
 	}
 	//Will we have somewhere to go next?
-	else if(filter_viewers_by_is_runway(next, next_taxiroute.taxiroute_name).size() == 0)
+	else if(filter_viewers_by_is_runway(next, next_taxiroute.taxiroute_name, translator).size() == 0)
 	{
 		return NULL;
 	}
@@ -380,9 +381,10 @@ static WED_GISPoint* get_next_node(const WED_GISPoint* current_node,
 }
 
 static WED_TaxiRoute* get_next_taxiroute(const WED_GISPoint* current_node,
-										 const TaxiRouteInfo& current_taxiroute)
+										 const TaxiRouteInfo& current_taxiroute,
+										 const CoordTranslator2& translator)
 {
-	TaxiRouteInfoVec_t viewers = filter_viewers_by_is_runway(current_node, current_taxiroute.taxiroute_name);//The taxiroute name should equal to the runway name
+	TaxiRouteInfoVec_t viewers = filter_viewers_by_is_runway(current_node, current_taxiroute.taxiroute_name, translator);//The taxiroute name should equal to the runway name
 	DebugAssert(viewers.size() == 1 || viewers.size() == 2);
 	
 	if(viewers.size() == 2)
@@ -428,7 +430,8 @@ static pair<bool,bool> get_taxiroute_relationship(const WED_GISPoint* current_no
 static bool TaxiRouteSquishedZCheck( const RunwayInfo& runway_info,
 									 const TaxiRouteInfo& start_taxiroute,//One of the ends of this chain of taxi routes
 									 validation_error_vector& msgs,
-									 WED_Airport* apt)
+									 WED_Airport* apt,
+									 const CoordTranslator2& translator)
 {
 	//We know all the nodes are within threshold of the center and within bounds, the segments are parallel enough,
 	//the route is a complete chain with no 3+-way splits. Now: do any of the segments make a complete 180 unexpectedly?
@@ -447,7 +450,7 @@ static bool TaxiRouteSquishedZCheck( const RunwayInfo& runway_info,
 	//while we have not run out of nodes to traverse
 	while(current_node != NULL)
 	{
-		WED_TaxiRoute* next_route = get_next_taxiroute(current_node,current_taxiroute);
+		WED_TaxiRoute* next_route = get_next_taxiroute(current_node,current_taxiroute, translator);
 		if(next_route == NULL)
 		{
 			break;
@@ -456,7 +459,7 @@ static bool TaxiRouteSquishedZCheck( const RunwayInfo& runway_info,
 		TaxiRouteInfo next_taxiroute(next_route,translator);
 
 		pair<bool,bool> relationship = get_taxiroute_relationship(current_node,current_taxiroute,next_taxiroute);
-		WED_GISPoint* next_node = get_next_node(current_node,next_taxiroute);
+		WED_GISPoint* next_node = get_next_node(current_node,next_taxiroute, translator);
 
 		Point2 current_p1;
 		Point2 current_p2;
@@ -543,7 +546,8 @@ static bool DoTaxiRouteConnectivityChecks( const RunwayInfo& runway_info,
 										   const TaxiRouteInfoVec_t& all_taxiroutes, //All the taxiroutes in the airport, for EnsureRunwayTaxirouteValences
 										   const TaxiRouteInfoVec_t& matching_taxiroutes, //Only the taxiroutes which match the runway in runway_info
 										   validation_error_vector& msgs,
-										   WED_Airport* apt)
+										   WED_Airport* apt,
+										   const CoordTranslator2& translator)
 {
 	int original_num_errors = msgs.size();
 	
@@ -557,14 +561,14 @@ static bool DoTaxiRouteConnectivityChecks( const RunwayInfo& runway_info,
 	sort(matching_nodes.begin(),matching_nodes.end());
 
 	WED_TaxiRoute* out_start_taxiroute = NULL;
-	if(RunwaysTaxiRouteValencesCheck(runway_info, matching_nodes, out_start_taxiroute, msgs, apt))
+	if(RunwaysTaxiRouteValencesCheck(runway_info, matching_nodes, out_start_taxiroute, msgs, apt, translator))
 	{
 		bool has_squished_z = false;
 
 		//The algorithm requires there to be atleast 2 taxiroutes
 		if(all_taxiroutes.size() >= 2 && out_start_taxiroute != NULL)
 		{
-			TaxiRouteSquishedZCheck(runway_info, TaxiRouteInfo(out_start_taxiroute,translator), msgs, apt);
+			TaxiRouteSquishedZCheck(runway_info, TaxiRouteInfo(out_start_taxiroute,translator), msgs, apt, translator);
 		}
 	}
 	
@@ -601,7 +605,8 @@ static bool TaxiRouteParallelCheck( const RunwayInfo& runway_info,
 static bool RunwayHasCorrectCoverage( const RunwayInfo& runway_info,
 									  const TaxiRouteInfoVec_t& all_taxiroutes,
 									  validation_error_vector& msgs,
-									  WED_Airport* apt)
+									  WED_Airport* apt,
+									  const CoordTranslator2& translator)
 {
 	int original_num_errors = msgs.size();
 
@@ -737,7 +742,7 @@ static bool FindIfMarked( const int runway_number,        //enum from ATCRunwayO
 	return !found_marked;
 }
 
-static TaxiRouteInfoVec_t GetTaxiRoutesFromViewers(const WED_GISPoint* node)
+static TaxiRouteInfoVec_t GetTaxiRoutesFromViewers(const WED_GISPoint* node, const CoordTranslator2& translator)
 {
 	set<WED_Thing*> node_viewers = get_all_visible_viewers(node);
 
@@ -848,7 +853,8 @@ static Polygon2 MakeHotZoneHitBox( const RunwayInfo& runway_info, // The relaven
 static bool DoHotZoneChecks( const RunwayInfo& runway_info,
 							 const TaxiRouteInfoVec_t& all_taxiroutes,
 							 validation_error_vector& msgs,
-							 WED_Airport* apt)
+							 WED_Airport* apt,
+							 const CoordTranslator2& translator)
 {
 	int original_num_errors = msgs.size();
 	TaxiRouteNodeVec_t all_nodes;
@@ -868,7 +874,7 @@ static bool DoHotZoneChecks( const RunwayInfo& runway_info,
 			node_itr != all_nodes.end();
 			++node_itr)
 		{
-			TaxiRouteInfoVec_t taxiroutes = GetTaxiRoutesFromViewers(*node_itr);
+			TaxiRouteInfoVec_t taxiroutes = GetTaxiRoutesFromViewers(*node_itr, translator);
 			for(TaxiRouteInfoVec_t::iterator taxiroute_itr = taxiroutes.begin(); taxiroute_itr != taxiroutes.end(); ++taxiroute_itr)
 			{
 				//only maakr THE 	departures boxes
@@ -1007,6 +1013,7 @@ static bool is_aircraft_taxi_route(WED_Thing * r)
 //-----------------------------------------------------------------------------
 void WED_DoATCRunwayChecks(WED_Airport& apt, validation_error_vector& msgs)
 {
+	CoordTranslator2 translator;
 	Bbox2 box;
 	apt.GetBounds(gis_Geo, box);
 	CreateTranslatorForBounds(box,translator);
@@ -1020,7 +1027,7 @@ void WED_DoATCRunwayChecks(WED_Airport& apt, validation_error_vector& msgs)
 		for(TaxiRouteVec_t::const_iterator itr = all_taxiroutes_plain.begin(); itr != all_taxiroutes_plain.end(); ++itr)
 			all_taxiroutes.push_back(TaxiRouteInfo(*itr,translator));
 		
-		RunwayInfoVec_t potentially_active_runways = CollectPotentiallyActiveRunways(all_taxiroutes, msgs, &apt);
+		RunwayInfoVec_t potentially_active_runways = CollectPotentiallyActiveRunways(all_taxiroutes, msgs, &apt, translator);
 		
 		ATCRunwayUseVec_t all_use_rules;
 		CollectRecursive(&apt,back_inserter<ATCRunwayUseVec_t>(all_use_rules), WED_ATCRunwayUse::sClass);
@@ -1042,9 +1049,9 @@ void WED_DoATCRunwayChecks(WED_Airport& apt, validation_error_vector& msgs)
 					{
 						if (TaxiRouteCenterlineCheck(*runway_info_itr, matching_taxiroutes, msgs, &apt))
 						{
-							if (DoTaxiRouteConnectivityChecks(*runway_info_itr, all_taxiroutes, matching_taxiroutes, msgs, &apt))
+							if (DoTaxiRouteConnectivityChecks(*runway_info_itr, all_taxiroutes, matching_taxiroutes, msgs, &apt, translator))
 							{
-								if (RunwayHasCorrectCoverage(*runway_info_itr, all_taxiroutes, msgs, &apt))
+								if (RunwayHasCorrectCoverage(*runway_info_itr, all_taxiroutes, msgs, &apt, translator))
 								{
 									//Add additional checks as needed here
 								}
@@ -1063,7 +1070,7 @@ void WED_DoATCRunwayChecks(WED_Airport& apt, validation_error_vector& msgs)
 			}
 	#endif
 			AssaignRunwayUse(*runway_info_itr, all_use_rules);
-			bool passes_hotzone_checks = DoHotZoneChecks(*runway_info_itr, all_taxiroutes, msgs, &apt);
+			bool passes_hotzone_checks = DoHotZoneChecks(*runway_info_itr, all_taxiroutes, msgs, &apt, translator);
 			//Nothing to do here yet until we have more checks after this
 		}
 	}
@@ -24,251 +24,452 @@
 #include "WED_XMLWriter.h"
 #include "AssertUtils.h"
 #include "GUI_Unicode.h"
-/*
-	PERFORMANCE NOTES:
-
-	We could improve memory management by allocating a big shared block of memory and just pushing a ptr
-	to get memory to stash strings (rather than using STL strings).
-	
-	If we do this we need to know when to purge out the memory...the answer:
-	
-	- Each time an obj starts using a block, add a ref to it.
-	- Each time the obj is nuked, decrease ref count.
-	- each time the current block is filled, start a new one.
-	
-	The result: as we run through the files and purge out the <object> blocks, 
-	filled blocks will be retired for re-use.  We save a million tiny alloc/deallocs for STL strings.	
-
-*/
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define XML_ESCAPE_SSE2 1
+#else
+	#define XML_ESCAPE_SSE2 0
+#endif
 
 #define FIX_EMPTY 0
 
-inline void fi_indent(int n, FILE * fi) { while(n--) fputc(' ', fi); }
+//--------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// STREAMING WRITER
+//--------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+#define XML_WRITE_BUFFER_SIZE	(1024*1024)
 
-inline void fi_escape(const char * str, FILE * fi)
+// Largest thing we ever write without checking the buffer again - one escaped char, a formatted number, etc.
+#define XML_WRITE_MAX_ATOM		64
+
+// A "plain" char is printable ASCII that needs no escaping - the vast majority of what we write.
+inline bool xml_is_plain(UTF8 c)
 {
-	UTF8 * b = (UTF8 *) str;
-	UTF8 * e = b + strlen(str);
-	
-	// This fixes a problem, but not the way I intended, and may be worth some examination.
-	// WED uses UTF8.  Period.  That is all it has ever displayed sanely, and it should be the only thing
-	// you can get INTO it.  (At least, on mac and windows if you get a non-ASCII char in, it DOES come in
-	// as UTF8.  I assume Linux isn't the offender putting ISO-Latin-1 in.)
-	//
-	// But.  Names of airports come straight from apt.dat, and some users encode the apt.dat file 
-	// incorrectly as ISO-Latin-1.  We really only wanted ASCII, and X-Plane never liked ISO, so who knows
-	// what is up.  Anyway: it is conceivable that at run time we have ISO-Latin-1 chars that are not valid 
-	// UTF8 sequences.
-	// This routine writes each invalid 8-bit char as a numeric code reference into the XML.  This has the
-	// wrong effect: on read-in, we interpret what WAS a byte as a Unicode char.
-	// 
-	// And yet, this is actually useful.  It turns out that ISO-Latin-1 128-255 are mostly mapped to
-	// unicode 128-255 (but NOT UTF8 128-255, which are bit encodings).  So for example:
-	//
-	// User wants unicode U+00C5.  In ISO-Latin-1 we have 0xC5.  This displays as a U or something wrong in
-	// WED because the char printer will "muddle through" randomly with invalid input.  But we write it out
-	// as %#xC5.  On read-in, Expat thinsk this is U+00C5 and gives us the correct 2-byte sequence UTF8 valid
-	// sequence 0xC3 0x85.  This is of course what the user ORIGINALLY wanted.
-	 
-	while(b < e)
+	return c >= ' ' && c < 0x80 && c != '<' && c != '>' && c != '"' && c != '&';
+}
+
+// Returns the end of the run of plain chars at the start of [b,e).
+static inline const UTF8 * xml_plain_run(const UTF8 * b, const UTF8 * e)
+{
+#if XML_ESCAPE_SSE2
+	const __m128i lt  = _mm_set1_epi8('<');
+	const __m128i gt  = _mm_set1_epi8('>');
+	const __m128i quo = _mm_set1_epi8('"');
+	const __m128i amp = _mm_set1_epi8('&');
+	const __m128i spc = _mm_set1_epi8(' ');
+	while(e - b >= 16)
 	{
-		const UTF8 * v = UTF8_ValidRange(b,e);
-		while(b < v)
-		{	
-			switch(*b) {
-			case '<':
-				fprintf(fi,"&lt;");
-				break;			
-			case '>':
-				fprintf(fi,"&gt;");
-				break;
-			case '"':
-				fprintf(fi,"&quot;");
-				break;
-			case '&':
-				fprintf(fi,"&amp;");
-				break;
-			default:
-				// This is STILL not ideal - XML disallows anything above #x10FFFF or the surrogate blocks, but 
-				// for now just notice that control chars are bogus.  Drop control chars, there's just no way to
-				// encode them, and frankly they are silly.
-				if(*b >= ' ' || *b == '\t' || *b == '\r' || *b == '\n')
-					fputc(*b,fi);
-				break;
-			}
-			++b;
-		}
-		const UTF8 * iv = UTF8_InvalidRange(b,e);
-		while(b < iv)
+		__m128i c = _mm_loadu_si128((const __m128i *) b);
+		// Compare is signed: bytes >= 0x80 are negative, so this one test catches control chars AND non-ASCII.
+		__m128i bad = _mm_cmplt_epi8(c, spc);
+		bad = _mm_or_si128(bad, _mm_cmpeq_epi8(c, lt));
+		bad = _mm_or_si128(bad, _mm_cmpeq_epi8(c, gt));
+		bad = _mm_or_si128(bad, _mm_cmpeq_epi8(c, quo));
+		bad = _mm_or_si128(bad, _mm_cmpeq_epi8(c, amp));
+		if(_mm_movemask_epi8(bad))
+			break;
+		b += 16;
+	}
+#endif
+	while(b < e && xml_is_plain(*b))
+		++b;
+	return b;
+}
+
+static inline char * xml_fmt_uint(char * p, uint64_t v)
+{
+	char tmp[24];
+	char * t = tmp;
+	do {
+		*t++ = '0' + (char) (v % 10);
+		v /= 10;
+	} while(v);
+	while(t > tmp)
+		*p++ = *--t;
+	return p;
+}
+
+static inline char * xml_fmt_int(char * p, int v)
+{
+	if(v < 0)
+	{
+		*p++ = '-';
+		return xml_fmt_uint(p, (uint64_t) (-(int64_t) v));
+	}
+	return xml_fmt_uint(p, (uint64_t) v);
+}
+
+// Formats v with dec decimals, exactly as sprintf("%.*lf") would.  We scale to an integer and print that,
+// which is exact as long as the scaled value fits in the mantissa.  The one catch is rounding: the scale
+// can be off by an ulp, so values that land within an ulp of a rounding tie go to sprintf, which rounds
+// the exact binary value.  This is rare in practice - lat/lon at 9 digits basically never hit it.
+static char * xml_fmt_double(char * p, double v, int dec)
+{
+	static const double k_pow10[16] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+	static const uint64_t k_ipow10[16] = {
+		1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+		10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL };
+
+	if(dec >= 0 && dec < 16 && v == v)
+	{
+		bool neg = v < 0.0 || (v == 0.0 && 1.0 / v < 0.0);
+		double a = neg ? -v : v;
+		double s = a * k_pow10[dec];
+		if(s < 4503599627370496.0)		// 2^52
 		{
-			// No low-number chars - that blows up the reader.
-			if(*b >= ' ' || *b == '\t' || *b == '\r' || *b == '\n')
-				fprintf(fi,"&#x%02X;",(int) *b);
-			++b;
+			double fl = floor(s);
+			double fr = s - fl;
+			double slop = s * 2.5e-16;
+			if(fabs(fr - 0.5) > slop)
+			{
+				uint64_t r = (uint64_t) fl;
+				if(fr > 0.5) ++r;
+				if(neg) *p++ = '-';
+				p = xml_fmt_uint(p, r / k_ipow10[dec]);
+				if(dec > 0)
+				{
+					*p++ = '.';
+					uint64_t f = r % k_ipow10[dec];
+					for(int d = dec - 1; d >= 0; --d)
+					{
+						p[d] = '0' + (char) (f % 10);
+						f /= 10;
+					}
+					p += dec;
+				}
+				return p;
+			}
 		}
-	}	
+	}
+	int n = snprintf(p, XML_WRITE_MAX_ATOM, "%.*lf", dec, v);
+	if(n < 0 || n >= XML_WRITE_MAX_ATOM)
+	{
+		// Huge values with lots of decimals won't fit an atom - these are garbage anyway.
+		n = snprintf(p, XML_WRITE_MAX_ATOM, "%.*lg", 17, v);
+		if(n < 0 || n >= XML_WRITE_MAX_ATOM) n = 0;
+	}
+	return p + n;
 }
 
-WED_XMLElement::WED_XMLElement(
-									const char *		n,
-									int					i,
-									FILE *				f) : 
-	file(f), indent(i), name(n), flushed(false), parent(NULL)
+WED_XMLWriter::WED_XMLWriter(FILE * destination) :
+	file(destination), tag_open(false), attr_base(0)
 {
+	buf = new char[XML_WRITE_BUFFER_SIZE];
+	cur = buf;
+	end = buf + XML_WRITE_BUFFER_SIZE;
 }
 
-WED_XMLElement::~WED_XMLElement()
+WED_XMLWriter::~WED_XMLWriter()
 {
-	if(!flushed)
-	{
-		fi_indent(indent, file);
-		fprintf(file,"<%s",name.c_str());
+	DebugAssert(stack.empty());
+	while(!stack.empty())
+		close_element();
+	flush();
+	delete [] buf;
+}
+
+inline void WED_XMLWriter::reserve(int bytes)
+{
+	if(end - cur < bytes)
+		make_room(bytes);
+}
 
-		for(map<string,string>::iterator a = attrs.begin(); a != attrs.end(); ++a)
+inline void WED_XMLWriter::put_str(const char * str, int len)
+{
+	if(end - cur < len)
+	{
+		if(!tag_open && len > XML_WRITE_BUFFER_SIZE)
 		{
-			fprintf(file," %s=\"", a->first.c_str());
-			fi_escape(a->second.c_str(), file);
-			fputc('"',file);
+			flush();
+			fwrite(str, 1, len, file);
+			return;
 		}
-		
-		if(children.empty())
-			fprintf(file,"/>\n");
-		else
-			fprintf(file,">\n");
+		make_room(len);
 	}
-	
-	for(vector<WED_XMLElement *>::iterator c = children.begin(); c != children.end(); ++c)
-		delete *c;
-	
-	if(!children.empty() || flushed)
+	memcpy(cur, str, len);
+	cur += len;
+}
+
+// Flushes, and if the attributes of the open tag still don't leave room (they can't be written until they
+// are sorted) grows the buffer.  Only a tag with a megabyte of attributes would ever get here.
+void WED_XMLWriter::make_room(int bytes)
+{
+	flush();
+	if(end - cur < bytes)
 	{
-		fi_indent(indent,file);
-		fprintf(file,"</%s>\n",name.c_str());
+		int used = cur - buf;
+		int cap = max((int) (end - buf) * 2, used + bytes);
+		char * nbuf = new char[cap];
+		memcpy(nbuf, buf, used);
+		delete [] buf;
+		buf = nbuf;
+		cur = buf + used;
+		end = buf + cap;
 	}
 }
 
-void WED_XMLElement::flush()
+// While a start tag is open, its attributes stay behind in the buffer so they can be sorted.
+void WED_XMLWriter::flush(void)
+{
+	char * keep = tag_open ? buf + attr_base : cur;
+	if(keep > buf)
+		fwrite(buf, 1, keep - buf, file);
+	memmove(buf, keep, cur - keep);
+	cur = buf + (cur - keep);
+	attr_base = 0;
+}
+
+void WED_XMLWriter::write_raw(const char * str)
+{
+	put_str(str, strlen(str));
+}
+
+void WED_XMLWriter::put_indent(void)
 {
-	flush_from(NULL);
+	int n = stack.size() * 4;
+	while(n > 0)
+	{
+		int chunk = min(n, XML_WRITE_MAX_ATOM);
+		reserve(chunk);
+		memset(cur, ' ', chunk);
+		cur += chunk;
+		n -= chunk;
+	}
 }
 
-void WED_XMLElement::flush_from(WED_XMLElement * who)
+struct	xml_attr_name_less {
+	bool operator()(const char * a, const char * b) const { return strcmp(a, b) < 0; }
+};
+
+void WED_XMLWriter::sort_attrs(void)
 {
-	if(who == NULL && children.empty())	return;
-	
-	if(parent) 
-		parent->flush_from(this);
-	parent = NULL;
-	
-	if(!flushed)
+	int n = attrs.size();
+	int i;
+	for(i = 1; i < n; ++i)
+	if(strcmp(attrs[i-1].name, attrs[i].name) >= 0)
+		break;
+
+	if(i < n)
 	{
-		fi_indent(indent, file);
-		fprintf(file,"<%s",name.c_str());
+		// Out of order (or a repeat) - stable-sort the spans by name, keep the last of any repeats and
+		// copy them back over the originals.
+		char * base = buf + attr_base;
+		int len = cur - base;
+		multimap<const char *, int, xml_attr_name_less>	order;
+		for(i = 0; i < n; ++i)
+			order.insert(multimap<const char *, int, xml_attr_name_less>::value_type(attrs[i].name, i));
 
-		for(map<string,string>::iterator a = attrs.begin(); a != attrs.end(); ++a)
+		vector<char>	sorted;
+		sorted.reserve(len);
+		for(multimap<const char *, int, xml_attr_name_less>::iterator o = order.begin(); o != order.end(); ++o)
 		{
-			fprintf(file," %s=\"", a->first.c_str());
-			fi_escape(a->second.c_str(), file);
-			fputc('"',file);
+			multimap<const char *, int, xml_attr_name_less>::iterator next(o);
+			++next;
+			if(next != order.end() && strcmp(next->first, o->first) == 0)
+				continue;
+			int k = o->second;
+			int b = attrs[k].offset;
+			int e = k + 1 < n ? attrs[k+1].offset : len;
+			sorted.insert(sorted.end(), base + b, base + e);
 		}
-		
-		fprintf(file,">\n");
+		memcpy(base, &sorted[0], sorted.size());
+		cur = base + sorted.size();
 	}
-	
-	DebugAssert(who == children.back() || who == NULL);
-	
-	for(vector<WED_XMLElement *>::iterator c = children.begin(); c != children.end(); ++c)
-	if(*c != who)
-		delete *c;
-
-	children.clear();
-	if(who)
-		children.push_back(who);
-	flushed = true;
+	attrs.clear();
 }
 
-	
-void					WED_XMLElement::add_attr_int(const char * name, int value)
+void WED_XMLWriter::finish_start_tag(void)
 {
-#if FIX_EMPTY
-	if(name == 0 || *name == 0)	name = "tbd";
-#else
-	DebugAssert(name && *name);	
-#endif
-	DebugAssert(!flushed);
-	char buf[256];
-	sprintf(buf,"%d",value);
-	attrs[name] = buf;
+	if(tag_open)
+	{
+		sort_attrs();
+		tag_open = false;
+		put_str(">\n", 2);
+	}
 }
 
-void					WED_XMLElement::add_attr_double(const char * name, double value, int dec)
+void WED_XMLWriter::open_element(const char * name)
 {
-#if FIX_EMPTY
-	if(name == 0 || *name == 0)	name = "tbd";
-#else
-	DebugAssert(name && *name);	
-#endif
-	DebugAssert(!flushed);
-	char fmt[15], buf[256];
-	sprintf(fmt,"%%.%dlf",dec);
-	sprintf(buf,fmt,value);
-	attrs[name] = buf;
+	DebugAssert(name && *name);
+	finish_start_tag();
+	put_indent();
+	reserve(1);
+	*cur++ = '<';
+	put_str(name, strlen(name));
+	stack.push_back(name);
+	tag_open = true;
+	attr_base = cur - buf;
 }
 
-void					WED_XMLElement::add_attr_c_str(const char * name, const char * str)
+void WED_XMLWriter::close_element(void)
 {
-#if FIX_EMPTY
-	if(name == 0 || *name == 0)	name = "tbd";
-	if(str == 0 || *str == 0) str = name;
-#else
-	DebugAssert(name && *name && str && *str);
-#endif
-	DebugAssert(!flushed);
-	attrs[name] = str;
+	DebugAssert(!stack.empty());
+	if(stack.empty()) return;
+	const char * name = stack.back();
+	stack.pop_back();
+	if(tag_open)
+	{
+		sort_attrs();
+		tag_open = false;
+		put_str("/>\n", 3);
+	}
+	else
+	{
+		put_indent();
+		put_str("</", 2);
+		put_str(name, strlen(name));
+		put_str(">\n", 2);
+	}
 }
 
-void					WED_XMLElement::add_attr_stl_str(const char * name, const string& str)
+void WED_XMLWriter::put_attr_name(const char * name)
 {
 #if FIX_EMPTY
 	if(name == 0 || *name == 0)	name = "tbd";
 #else
-	DebugAssert(name && *name);	
+	DebugAssert(name && *name);
 #endif
-	DebugAssert(!flushed);
-	attrs[name] = str;
+	DebugAssert(tag_open);
+	attr_span a = { name, (int) (cur - buf) - attr_base };
+	attrs.push_back(a);
+	reserve(1);
+	*cur++ = ' ';
+	put_str(name, strlen(name));
+	put_str("=\"", 2);
 }
 
-WED_XMLElement *		WED_XMLElement::add_sub_element(const char * name)
+void WED_XMLWriter::add_attr_int(const char * name, int value)
 {
-#if FIX_EMPTY
-	if(name == 0 || *name == 0)	name = "tbd";
-#else
-	DebugAssert(name && *name);	
-#endif
+	put_attr_name(name);
+	reserve(XML_WRITE_MAX_ATOM);
+	cur = xml_fmt_int(cur, value);
+	*cur++ = '"';
+}
 
-	WED_XMLElement * child = new WED_XMLElement(name, indent + 4, file);
-	children.push_back(child);
-	child->parent = this;
-	return child;
+void WED_XMLWriter::add_attr_double(const char * name, double value, int dec)
+{
+	put_attr_name(name);
+	reserve(XML_WRITE_MAX_ATOM + 1);
+	cur = xml_fmt_double(cur, value, dec);
+	*cur++ = '"';
 }
 
-WED_XMLElement *		WED_XMLElement::add_or_find_sub_element(const char * name)
+void WED_XMLWriter::add_attr_c_str(const char * name, const char * str)
 {
 #if FIX_EMPTY
-	if(name == 0 || *name == 0)	name = "tbd";
+	if(str == 0 || *str == 0) str = name;
 #else
-	DebugAssert(name && *name);	
+	DebugAssert(str && *str);
 #endif
+	put_attr_name(name);
+	put_escaped(str, strlen(str));
+	reserve(1);
+	*cur++ = '"';
+}
+
+void WED_XMLWriter::add_attr_stl_str(const char * name, const string& str)
+{
+	put_attr_name(name);
+	put_escaped(str.c_str(), strlen(str.c_str()));
+	reserve(1);
+	*cur++ = '"';
+}
+
+// This fixes a problem, but not the way I intended, and may be worth some examination.
+// WED uses UTF8.  Period.  That is all it has ever displayed sanely, and it should be the only thing
+// you can get INTO it.  (At least, on mac and windows if you get a non-ASCII char in, it DOES come in
+// as UTF8.  I assume Linux isn't the offender putting ISO-Latin-1 in.)
+//
+// But.  Names of airports come straight from apt.dat, and some users encode the apt.dat file 
+// incorrectly as ISO-Latin-1.  We really only wanted ASCII, and X-Plane never liked ISO, so who knows
+// what is up.  Anyway: it is conceivable that at run time we have ISO-Latin-1 chars that are not valid 
+// UTF8 sequences.
+// This routine writes each invalid 8-bit char as a numeric code reference into the XML.  This has the
+// wrong effect: on read-in, we interpret what WAS a byte as a Unicode char.
+// 
+// And yet, this is actually useful.  It turns out that ISO-Latin-1 128-255 are mostly mapped to
+// unicode 128-255 (but NOT UTF8 128-255, which are bit encodings).  So for example:
+//
+// User wants unicode U+00C5.  In ISO-Latin-1 we have 0xC5.  This displays as a U or something wrong in
+// WED because the char printer will "muddle through" randomly with invalid input.  But we write it out
+// as %#xC5.  On read-in, Expat thinsk this is U+00C5 and gives us the correct 2-byte sequence UTF8 valid
+// sequence 0xC3 0x85.  This is of course what the user ORIGINALLY wanted.
+//
+// Plain runs are found 16 chars at a time and copied in bulk; we only go char-by-char for the (rare) chars
+// that need escaping or UTF8 validation.
+void WED_XMLWriter::put_escaped(const char * str, int len)
+{
+	const UTF8 * b = (const UTF8 *) str;
+	const UTF8 * e = b + len;
+	const UTF8 * valid_end = b;			// [b, valid_end) is known to be valid UTF8.
 
-	DebugAssert(!flushed);
-	string n(name);
-	for(int i = 0; i < children.size(); ++i)
-	if(children[i]->name == n)
-		return children[i];
-		
-	WED_XMLElement * child = new WED_XMLElement(name, indent + 4, file);
-	children.push_back(child);
-	child->parent = this;
-	return child;
-	
+	while(b < e)
+	{
+		const UTF8 * p = xml_plain_run(b,e);
+		// An ASCII char followed by stray continuation bytes is one invalid UTF8 char, so it has to
+		// go through the slow path with them.
+		if(p > b && p < e && (*p & 0xC0) == 0x80)
+			--p;
+		if(p > b)
+		{
+			put_str((const char *) b, p - b);
+			b = p;
+			if(b == e) break;
+		}
+
+		if(*b >= 0x80 || (b + 1 < e && (b[1] & 0xC0) == 0x80))
+		{
+			if(b >= valid_end)
+				valid_end = UTF8_ValidRange(b,e);
+			if(b < valid_end)
+			{
+				p = b;
+				while(p < valid_end && *p >= 0x80)
+					++p;
+				put_str((const char *) b, p - b);
+				b = p;
+			}
+			else
+			{
+				const UTF8 * iv = UTF8_InvalidRange(b,e);
+				static const char hex[] = "0123456789ABCDEF";
+				while(b < iv)
+				{
+					if(*b >= ' ' || *b == '\t' || *b == '\r' || *b == '\n')
+					{
+						reserve(6);
+						*cur++ = '&'; *cur++ = '#'; *cur++ = 'x';
+						*cur++ = hex[*b >> 4];
+						*cur++ = hex[*b & 0xF];
+						*cur++ = ';';
+					}
+					++b;
+				}
+				valid_end = b;
+			}
+		}
+		else
+		{
+			switch(*b) {
+			case '<':	put_str("&lt;",4);		break;
+			case '>':	put_str("&gt;",4);		break;
+			case '"':	put_str("&quot;",6);	break;
+			case '&':	put_str("&amp;",5);		break;
+			default:
+				// This is STILL not ideal - XML disallows anything above #x10FFFF or the surrogate blocks, but
+				// for now just notice that control chars are bogus.  Drop control chars, there's just no way to
+				// encode them, and frankly they are silly.
+				if(*b == '\t' || *b == '\r' || *b == '\n')
+				{
+					reserve(1);
+					*cur++ = *b;
+				}
+				break;
+			}
+			++b;
+		}
+	}
 }
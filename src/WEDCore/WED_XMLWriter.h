@@ -24,51 +24,76 @@
 #ifndef WED_XMLWriter_H
 #define WED_XMLWriter_H
 
-/* 
-	IMPORTANT: const char * name parameters must be "permanent" - that is, they need to remain
-	valid for the duration of the XML element's life.
-	
-	C strings passed to add_attr_c_str are copied - you don't need to retire them.
+/*
+	WED_XMLWriter - a streaming XML writer.
+
+	WED_XMLWriter writes tags and attributes straight into a big output buffer as they are added, rather
+	than building a tree of elements first.  The rules are simple:
+
+	- Attributes always go to the most recently opened element, and must be added before that element
+	  gets any children.
+	- Every open_element must be matched by a close_element.  An element with no children is written as
+	  <name .../>.
+	- const char * names must stay valid until the element is closed; attribute values are copied.
+
+	Doubles are written with the same fixed-decimal result as printf's "%.*lf" would give.
+
+	Attributes come out sorted by name, whatever order they were added in, and if a name is added twice
+	the last value wins.  That is what the old tree writer did (it kept a map per element), so a saved
+	document diffs cleanly against one saved by an older WED.  The attributes of the open tag stay in the
+	buffer until the tag is finished, then get reordered in place - usually they are already in order.
 
  */
 
-class	WED_XMLElement {
+class	WED_XMLWriter {
 public:
 
-				 WED_XMLElement(
-									const char *		name,
-									int					indent,
-									FILE *				destination);
-				~WED_XMLElement();
-		
+				 WED_XMLWriter(FILE * destination);
+				~WED_XMLWriter();
+
+	void					open_element(const char * name);
+	void					close_element(void);
+
 	void					add_attr_int(const char * name, int value);
 	void					add_attr_double(const char * name, double value, int dec);
 	void					add_attr_c_str(const char * name, const char * str);
 	void					add_attr_stl_str(const char * name, const string& str);
-	
-	WED_XMLElement *		add_sub_element(const char * name);
-	WED_XMLElement *		add_or_find_sub_element(const char * name);
-	
-	// Call flush to write out data so far.  In order to do this:
-	// - All attributes must be done for this obj and all parents.  Adding attributes to a flushed obj or its parents is an error!
-	// - You won't try to find existing sub-elements on a flushed element or its parents.  That's an error too!
-	// - No existing older child to this object or any of its parents can be used again.  So my older sibling and my parent's older sibling
-	// are both GONE after we flush!  
-	// We use flush to keep memory bubble down.
+
+	// Writes text verbatim - used for the <?xml?> header.
+	void					write_raw(const char * str);
+
+	// Pushes everything buffered so far to the FILE.  This happens automatically when the buffer
+	// fills and when the writer is destroyed.
 	void					flush(void);
-	
+
 private:
 
-	void					flush_from(WED_XMLElement * child);
+	inline	void			reserve(int bytes);
+	inline	void			put_str(const char * str, int len);
+			void			make_room(int bytes);
+			void			put_indent(void);
+			void			put_attr_name(const char * name);
+			void			put_escaped(const char * str, int len);
+			void			finish_start_tag(void);
+			void			sort_attrs(void);
+
+	struct	attr_span {
+		const char *	name;
+		int				offset;		// From attr_base to the space before the name.
+	};
 
-		bool									flushed;
 		FILE *									file;
-		int										indent;
-		string									name;
-		map<string,string>						attrs;
-		vector<WED_XMLElement *>				children;
-		WED_XMLElement *						parent;
-};	
-	
+		char *									buf;
+		char *									cur;
+		char *									end;
+		vector<const char *>					stack;
+		bool									tag_open;		// "<name" is written but not ">" - attributes still allowed.
+		int										attr_base;		// Offset in buf where the open tag's attributes start.
+		vector<attr_span>						attrs;			// Attributes of the open tag, in the order they were added.
+
+	WED_XMLWriter(const WED_XMLWriter&);
+	WED_XMLWriter& operator=(const WED_XMLWriter&);
+};
+
 #endif /* WED_XMLWriter_H */
 
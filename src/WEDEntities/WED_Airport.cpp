@@ -498,21 +498,22 @@ void 			WED_Airport::WriteTo(IOWriter * writer)
 	}
 }
 
-void 			WED_Airport::AddExtraXML(WED_XMLElement * obj)
+void 			WED_Airport::AddExtraXML(WED_XMLWriter * writer)
 {
-	WED_GISComposite::AddExtraXML(obj);
+	WED_GISComposite::AddExtraXML(writer);
 
-	WED_XMLElement * xml = obj->add_sub_element("meta_data");
+	writer->open_element("meta_data");
 	for(vector<meta_data_entry>::iterator i = meta_data_vec_map.begin(); i != meta_data_vec_map.end(); ++i)
 	{
-		
-		WED_XMLElement * c = xml->add_sub_element("meta_data_entry");
+		writer->open_element("meta_data_entry");
 		
 		//Due to the fact we don't know what meta_data key we're going to have
 		//We have to save it as "pair","FAA,BDL". Sadly, its not a one to one mapping
 		//of Data Structure and Data Format, and is a bit redundant
-		c->add_attr_stl_str("pair", i->first + "," + i->second);
+		writer->add_attr_stl_str("pair", i->first + "," + i->second);
+		writer->close_element();
 	}
+	writer->close_element();
 }
 
 void			WED_Airport::StartElement(
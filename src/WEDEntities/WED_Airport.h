@@ -89,7 +89,7 @@ public:
 	virtual	void 			WriteTo(IOWriter * writer);
 
 	//WED_Thing
-	virtual void			AddExtraXML(WED_XMLElement * obj);
+	virtual void			AddExtraXML(WED_XMLWriter * writer);
 	
 	//IOperation
 	virtual void		StartElement(
@@ -110,10 +110,11 @@ void 			WED_AirportChain::WriteTo(IOWriter * writer)
 	writer->WriteInt(closed);
 }
 
-void	WED_AirportChain::AddExtraXML(WED_XMLElement * obj)
+void	WED_AirportChain::AddExtraXML(WED_XMLWriter * writer)
 {
-	WED_XMLElement * xml = obj->add_sub_element("airport_chain");
-	xml->add_attr_int("closed",closed);
+	writer->open_element("airport_chain");
+	writer->add_attr_int("closed",closed);
+	writer->close_element();
 }
 
 void		WED_AirportChain::StartElement(
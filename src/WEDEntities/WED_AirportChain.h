@@ -44,7 +44,7 @@ public:
 	virtual	bool 			ReadFrom(IOReader * reader);
 	virtual	void 			WriteTo(IOWriter * writer);
 	// WED_Thing
-	virtual	void			AddExtraXML(WED_XMLElement * obj);
+	virtual	void			AddExtraXML(WED_XMLWriter * writer);
 
 	virtual void		StartElement(
 								WED_XMLReader * reader,
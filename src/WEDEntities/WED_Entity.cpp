@@ -102,7 +102,9 @@ void	WED_Entity::CacheInval(int flags)
 int	WED_Entity::CacheBuild(int flags) const
 {
 	int needed_flags = flags & ~cache_valid_;
-	cache_valid_ |= needed_flags;
+	// Don't write if there's nothing to build - once warm, a cache check is a pure read and safe to do from worker threads.
+	if(needed_flags)
+		cache_valid_ |= needed_flags;
 	return needed_flags;
 }
 
@@ -512,3 +512,16 @@ IGISEntity *	WED_GISChain::GetNthEntity  (int n) const
 	RebuildCache(CacheBuild(cache_Topological));
 	return mCachePts[n];
 }
+
+void			WED_GISChain::GetEntitiesNear(const Bbox2& bounds, vector<int>& out_indices) const
+{
+	RebuildCache(CacheBuild(cache_Topological));
+	int n = mCachePts.size();
+	for (int i = 0; i < n; ++i)
+	{
+		Bbox2	pt;
+		mCachePts[i]->GetBounds(gis_Geo, pt);		// Not just the location - bezier nodes include their handles.
+		if (bounds.overlap(pt))
+			out_indices.push_back(i);
+	}
+}
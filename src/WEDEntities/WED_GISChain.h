@@ -61,6 +61,7 @@ public:
 	// IGISComposite
 	virtual	int				GetNumEntities(void ) const;
 	virtual	IGISEntity *	GetNthEntity  (int n) const;
+	virtual	void			GetEntitiesNear(const Bbox2& bounds, vector<int>& out_indices) const;
 
 protected:
 
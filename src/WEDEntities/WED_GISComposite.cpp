@@ -23,12 +23,35 @@
 
 #include "WED_GISComposite.h"
 
+// Below this many children a linear scan beats building and querying a tree.
+#define MIN_INDEXED_ENTITIES 16
+
+// Rebuild the tree once more than 1 in this many children have moved out of it (or MIN_INDEXED_ENTITIES, if more).
+#define MAX_MOVED_FRACTION 8
+
 TRIVIAL_COPY(WED_GISComposite, WED_Entity)
 
-WED_GISComposite::WED_GISComposite(WED_Archive * a, int i) : WED_Entity(a,i)
+WED_GISComposite::WED_GISComposite(WED_Archive * a, int i) : WED_Entity(a,i), mIndexValid(false), mIndexStale(false)
 {
 }
 
+// The bounds we index a child under - its real bounds, grown for the entity types whose Cull() adds slop
+// for art assets (composites and objects) or for geometry outside their bounds (runway shoulders and blast pads).
+static void	GetEntityIndexBounds(IGISEntity * ent, Bbox2& bounds)
+{
+	ent->GetBounds(gis_Geo, bounds);
+	switch(ent->GetGISClass()) {
+	case gis_Composite:
+	case gis_Point_Heading:
+	case gis_Point_HeadingWidthLength:
+	case gis_Line_Width:
+		bounds.expand(GLOBAL_WED_ART_ASSET_FUDGE_FACTOR);
+		break;
+	default:
+		break;
+	}
+}
+
 WED_GISComposite::~WED_GISComposite()
 {
 }
@@ -72,6 +95,17 @@ bool			WED_GISComposite::IntersectsBox	(GISLayer_t l, const Bbox2&  bounds) cons
 	GetBounds(l,me);
 	if (!bounds.overlap(me)) return false;
 
+	if (l == gis_Geo)
+	{
+		vector<int>	near;
+		GetEntitiesNear(bounds, near);
+		for (vector<int>::iterator i = near.begin(); i != near.end(); ++i)
+			if (GetNthEntity(*i)->IntersectsBox(l,bounds))
+			if(!IsWEDLocked(GetNthEntity(*i)))
+				return true;
+		return false;
+	}
+
 	int n = GetNumEntities();
 	for (int i = 0; i < n; ++i)
 		if (GetNthEntity(i)->IntersectsBox(l,bounds)) 
@@ -98,6 +132,17 @@ bool			WED_GISComposite::PtWithin		(GISLayer_t l, const Point2& p	 ) const
 	GetBounds(l, me);
 	if (!me.contains(p)) return false;
 
+	if (l == gis_Geo)
+	{
+		vector<int>	near;
+		GetEntitiesNear(Bbox2(p), near);
+		for (vector<int>::iterator i = near.begin(); i != near.end(); ++i)
+			if (GetNthEntity(*i)->PtWithin(l, p))
+			if(!IsWEDLocked(GetNthEntity(*i)))
+				return true;
+		return false;
+	}
+
 	int n = GetNumEntities();
 	for (int i = 0; i < n; ++i)
 		if (GetNthEntity(i)->PtWithin(l, p)) 
@@ -114,6 +159,17 @@ bool			WED_GISComposite::PtOnFrame		(GISLayer_t l, const Point2& p, double d) co
 	me.p2 += Vector2(d,d);
 	if (!me.contains(p)) return false;
 
+	if (l == gis_Geo)
+	{
+		vector<int>	near;
+		GetEntitiesNear(Bbox2(p.x() - d, p.y() - d, p.x() + d, p.y() + d), near);
+		for (vector<int>::iterator i = near.begin(); i != near.end(); ++i)
+			if (GetNthEntity(*i)->PtOnFrame(l, p, d))
+			if(!IsWEDLocked(GetNthEntity(*i)))
+				return true;
+		return false;
+	}
+
 	int n = GetNumEntities();
 	for (int i = 0; i < n; ++i)
 		if (GetNthEntity(i)->PtOnFrame(l, p, d)) 
@@ -131,9 +187,10 @@ bool WED_GISComposite::Cull(const Bbox2& b) const
 	if(!b.overlap(me))
 		return false;
 	
-	int n = GetNumEntities();
-	for (int i = 0; i < n; ++i)
-		if(GetNthEntity(i)->Cull(b))
+	vector<int>	near;
+	GetEntitiesNear(b, near);
+	for (vector<int>::iterator i = near.begin(); i != near.end(); ++i)
+		if(GetNthEntity(*i)->Cull(b))
 			return true;
 	return false;	
 }
@@ -177,9 +234,94 @@ IGISEntity *	WED_GISComposite::GetNthEntity  (int n) const
 	return mEntities[n];
 }
 
+void			WED_GISComposite::GetEntitiesNear(const Bbox2& bounds, vector<int>& out_indices) const
+{
+	RebuildCache(CacheBuild(cache_Spatial|cache_Topological));
+	int n = mEntities.size();
+	if (n < MIN_INDEXED_ENTITIES)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			Bbox2	child;
+			GetEntityIndexBounds(mEntities[i], child);
+			if (bounds.overlap(child))
+				out_indices.push_back(i);
+		}
+	}
+	else
+	{
+		if (!mIndexValid)
+			RebuildIndex();
+		else if (mIndexStale)
+			RefreshIndex();
+		int first = out_indices.size();
+		mIndex.query_value(bounds, back_inserter(out_indices));
+		if (!mIndexMoved.empty())
+		{
+			int last = first;
+			for (int i = first; i < out_indices.size(); ++i)
+				if (!mIndexIsMoved[out_indices[i]])
+					out_indices[last++] = out_indices[i];
+			out_indices.resize(last);
+			for (vector<int>::const_iterator m = mIndexMoved.begin(); m != mIndexMoved.end(); ++m)
+				if (bounds.overlap(mIndexBounds[*m]))
+					out_indices.push_back(*m);
+		}
+		sort(out_indices.begin() + first, out_indices.end());
+	}
+}
+
+void			WED_GISComposite::RebuildIndex(void) const
+{
+	vector<EntityIndex::item_type>	items;
+	int n = mEntities.size();
+	items.reserve(n);
+	mIndexBounds.resize(n);
+	for (int i = 0; i < n; ++i)
+	{
+		GetEntityIndexBounds(mEntities[i], mIndexBounds[i]);
+		if (!mIndexBounds[i].is_null())
+			items.push_back(EntityIndex::item_type(mIndexBounds[i], i));
+	}
+	mIndex.insert(items.begin(), items.end());
+	mIndexIsMoved.assign(n, 0);
+	mIndexMoved.clear();
+	mIndexValid = true;
+	mIndexStale = false;
+}
+
+// Same children, but some may have moved.  Children whose bounds changed leave the tree for the moved list;
+// if too many have, it's cheaper to start over.
+void			WED_GISComposite::RefreshIndex(void) const
+{
+	int n = mEntities.size();
+	DebugAssert(mIndexBounds.size() == n);
+	for (int i = 0; i < n; ++i)
+	{
+		Bbox2	child;
+		GetEntityIndexBounds(mEntities[i], child);
+		if (child == mIndexBounds[i])
+			continue;
+		mIndexBounds[i] = child;
+		if (!mIndexIsMoved[i])
+		{
+			mIndexIsMoved[i] = 1;
+			mIndexMoved.push_back(i);
+		}
+	}
+	mIndexStale = false;
+	if (mIndexMoved.size() > max(MIN_INDEXED_ENTITIES, n / MAX_MOVED_FRACTION))
+		RebuildIndex();
+}
+
 
 void	WED_GISComposite::RebuildCache(int flags) const
 {
+	if(flags & cache_Topological)
+		mIndexValid = false;
+	if(flags & cache_Spatial)
+		mIndexStale = true;
+
 	if(flags & cache_Topological)
 	{
 		mEntities.clear();
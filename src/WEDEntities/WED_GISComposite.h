@@ -26,6 +26,23 @@
 
 #include "WED_Entity.h"
 #include "IGIS.h"
+#include "RTree2.h"
+
+/*
+	WED_GISComposite - SPATIAL INDEX
+
+	Composites are the backbone of the document tree - the world holds every airport, an airport holds all of its
+	pavement, objects, etc.  Walking every child to cull or hit-test gets expensive with a global airport set
+	or a dense airport, so a composite with enough children keeps an R-tree of them (child index, keyed on the
+	child's bounds, grown by the art-asset slop for children whose Cull() uses it).
+
+	The index rides on the entity cache (see WED_Entity).  A topological change - children added, removed or
+	re-ordered - throws the tree out and it is rebuilt on the next query.  A spatial change is usually one child
+	being dragged around, and rebuilding the whole tree for every mouse move would be slower than no index at
+	all, so we don't: on the next query we re-read the children's bounds and any child whose bounds changed is
+	pulled out of the tree (its tree hits are ignored) and onto a short "moved" list that is checked linearly.
+	Only when that list gets long do we pay for a new tree.
+*/
 
 class	WED_GISComposite : public WED_Entity, public virtual IGISComposite {
 
@@ -48,16 +65,27 @@ public:
 	// IGISComposite
 	virtual	int				GetNumEntities(void ) const;
 	virtual	IGISEntity *	GetNthEntity  (int n) const;
+	virtual	void			GetEntitiesNear(const Bbox2& bounds, vector<int>& out_indices) const;
 
 private:
 
 			void			RebuildCache(int flags) const;
+			void			RebuildIndex(void) const;
+			void			RefreshIndex(void) const;
 
 	mutable	Bbox2					mCacheBounds;
 	mutable	Bbox2					mCacheBoundsUV;
 	mutable	bool					mHasUV;
 	mutable	vector<IGISEntity *>	mEntities;
 
+	typedef RTree2<int, 8>			EntityIndex;
+	mutable	EntityIndex				mIndex;
+	mutable	bool					mIndexValid;		// Tree was built for the current set of children.
+	mutable	bool					mIndexStale;		// Some child's bounds may have changed since RefreshIndex.
+	mutable	vector<Bbox2>			mIndexBounds;		// Per child: its bounds as of the last RefreshIndex.
+	mutable	vector<char>			mIndexIsMoved;		// Per child: bounds differ from the tree - ignore its tree hits.
+	mutable	vector<int>				mIndexMoved;		// Children with mIndexIsMoved set.
+
 };
 
 #endif
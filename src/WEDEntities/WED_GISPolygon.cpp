@@ -330,3 +330,15 @@ IGISEntity *	WED_GISPolygon::GetNthEntity  (int n) const
 {
 	return dynamic_cast<IGISEntity *>(GetNthChild(n));
 }
+
+void			WED_GISPolygon::GetEntitiesNear(const Bbox2& bounds, vector<int>& out_indices) const
+{
+	int n = GetNumEntities();
+	for (int i = 0; i < n; ++i)
+	{
+		Bbox2	ring;
+		GetNthEntity(i)->GetBounds(gis_Geo, ring);
+		if (bounds.overlap(ring))
+			out_indices.push_back(i);
+	}
+}
@@ -101,15 +101,17 @@ void 			WED_KeyObjects::WriteTo(IOWriter * writer)
 	}
 }
 
-void			WED_KeyObjects::AddExtraXML(WED_XMLElement * obj)
+void			WED_KeyObjects::AddExtraXML(WED_XMLWriter * writer)
 {
-	WED_XMLElement * xml = obj->add_sub_element("keys");
+	writer->open_element("keys");
 	for(map<string,int>::iterator i = choices.begin(); i != choices.end(); ++i)
 	{
-		WED_XMLElement * c = xml->add_sub_element("key");
-		c->add_attr_stl_str("name",i->first);
-		c->add_attr_int("id",i->second);
+		writer->open_element("key");
+		writer->add_attr_stl_str("name",i->first);
+		writer->add_attr_int("id",i->second);
+		writer->close_element();
 	}
+	writer->close_element();
 }
 
 void		WED_KeyObjects::StartElement(
@@ -69,14 +69,16 @@ void 			WED_Select::WriteTo(IOWriter * writer)
 
 }
 
-void		WED_Select::AddExtraXML(WED_XMLElement * obj)
+void		WED_Select::AddExtraXML(WED_XMLWriter * writer)
 {
-	WED_XMLElement * selection = obj->add_sub_element("selection");
+	writer->open_element("selection");
 	for(set<int>::iterator i = mSelected.begin(); i != mSelected.end(); ++i)
 	{
-		WED_XMLElement * sel = selection->add_sub_element("sel");
-		sel->add_attr_int("id",*i);
+		writer->open_element("sel");
+		writer->add_attr_int("id",*i);
+		writer->close_element();
 	}
+	writer->close_element();
 }
 
 void		WED_Select::StartElement(
@@ -69,7 +69,7 @@ public:
 	// WED_Persistent
 	virtual		bool 			ReadFrom(IOReader * reader);
 	virtual		void 			WriteTo(IOWriter * writer);
-	virtual		void			AddExtraXML(WED_XMLElement * obj);
+	virtual		void			AddExtraXML(WED_XMLWriter * writer);
 	virtual void		StartElement(
 								WED_XMLReader * reader,
 								const XML_Char *	name,
@@ -128,37 +128,44 @@ void 			WED_Thing::WriteTo(IOWriter * writer)
 	WritePropsTo(writer);
 }
 
-void			WED_Thing::ToXML(WED_XMLElement * parent)
+void			WED_Thing::ToXML(WED_XMLWriter * writer)
 {
-	WED_XMLElement * obj = parent->add_sub_element("object");
+	writer->open_element("object");
 	
-	obj->add_attr_c_str("class",this->GetClass());
-	obj->add_attr_int("id",GetID());
-	obj->add_attr_int("parent_id",parent_id);
+	writer->add_attr_c_str("class",this->GetClass());
+	writer->add_attr_int("id",GetID());
+	writer->add_attr_int("parent_id",parent_id);
 	
-	WED_XMLElement * src = obj->add_sub_element("sources");
+	writer->open_element("sources");
 	for(int n = 0; n < source_id.size(); ++n)
 	{
-		WED_XMLElement * s = src->add_sub_element("source");
-		s->add_attr_int("id",source_id[n]);
+		writer->open_element("source");
+		writer->add_attr_int("id",source_id[n]);
+		writer->close_element();
 	}
+	writer->close_element();
 
-	WED_XMLElement * vwr = obj->add_sub_element("viewers");
+	writer->open_element("viewers");
 	for(set<int>::iterator v = viewer_id.begin(); v != viewer_id.end(); ++v)
 	{
-		WED_XMLElement * vi = vwr->add_sub_element("viewer");
-		vi->add_attr_int("id",*v);
+		writer->open_element("viewer");
+		writer->add_attr_int("id",*v);
+		writer->close_element();
 	}
+	writer->close_element();
 
-	WED_XMLElement * chld = obj->add_sub_element("children");
+	writer->open_element("children");
 	for(int n = 0; n < child_id.size(); ++n)
 	{
-		WED_XMLElement * c = chld->add_sub_element("child");
-		c->add_attr_int("id",child_id[n]);
+		writer->open_element("child");
+		writer->add_attr_int("id",child_id[n]);
+		writer->close_element();
 	}
+	writer->close_element();
 	
-	WED_PropertyHelper::PropsToXML(obj);
-	this->AddExtraXML(obj);
+	WED_PropertyHelper::PropsToXML(writer);
+	this->AddExtraXML(writer);
+	writer->close_element();
 }
 
 void	WED_Thing::FromXML(WED_XMLReader * reader, const XML_Char ** atts)
@@ -492,7 +499,7 @@ void		WED_TypeField::GetPropertyDictItem(int e, string& item)
 void		WED_TypeField::GetProperty(PropertyVal_t& v) const
 {
 	v.prop_kind = prop_String;
-	v.string_val = dynamic_cast<WED_Thing*>(mParent)->HumanReadableType();
+	v.string_val = dynamic_cast<WED_Thing*>(GetParent())->HumanReadableType();
 }
 
 void		WED_TypeField::SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent)
@@ -507,7 +514,7 @@ void 		WED_TypeField::WriteTo(IOWriter * writer)
 {
 }
 
-void		WED_TypeField::ToXML(WED_XMLElement * parent)
+void		WED_TypeField::ToXML(WED_XMLWriter * writer)
 {
 }
 
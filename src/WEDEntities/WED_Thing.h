@@ -67,7 +67,8 @@ public:
 	virtual void		SetProperty(const PropertyVal_t& val, WED_PropertyHelper * parent);
 	virtual	void 		ReadFrom(IOReader * reader);
 	virtual	void 		WriteTo(IOWriter * writer);
-	virtual	void		ToXML(WED_XMLElement * parent);
+	virtual	void		ToXML(WED_XMLWriter * writer);
+	virtual	const char *	XMLElementName(void) const { return NULL; }
 	virtual	bool		WantsAttribute(const char * ele, const char * att_name, const char * att_value);	
 };
 
@@ -102,14 +103,14 @@ public:
 	// WED_Persistent
 	virtual	bool 			ReadFrom(IOReader * reader);
 	virtual	void 			WriteTo(IOWriter * writer);
-	virtual	void			ToXML(WED_XMLElement * parent);
+	virtual	void			ToXML(WED_XMLWriter * writer);
 	virtual	void			FromXML(WED_XMLReader * reader, const XML_Char ** atts);
 	virtual	void			PostChangeNotify(void);
 	virtual	void			Validate(void);
 
 	// This is a template method - sub-classes of things that have to add MORE XML than they would get via the property system and the thing
 	// itself override this method.  This way their extra XML is _inside_ the toplevel obj.
-	virtual	void			AddExtraXML(WED_XMLElement * obj) { }
+	virtual	void			AddExtraXML(WED_XMLWriter * writer) { }
 	
 	// One more template method: all WED things must have a human-readable type!
 	virtual const char *	HumanReadableType(void) const=0;
@@ -11,17 +11,14 @@ CACHE_CacheObject::CACHE_CacheObject()
 	  m_last_error_type(cache_error_type_none),
 	  m_last_time_modified(0),
 	  m_last_url(""),
-	  m_RAII_curl_hndl(NULL)
+	  m_md5_verified(true),
+	  m_download(NULL)
 {
 }
 
 CACHE_CacheObject::~CACHE_CacheObject()
 {
-	if(m_RAII_curl_hndl != NULL)
-	{
-		delete m_RAII_curl_hndl;
-		m_RAII_curl_hndl = NULL;
-	}
+	close_download();
 }
 
 const time_t CACHE_CacheObject::get_cool_down_time() const
@@ -74,35 +71,55 @@ void             CACHE_CacheObject::set_last_time_modified(time_t mtime)
 	m_last_time_modified = mtime;
 }
 
-void CACHE_CacheObject::create_RAII_curl_hndl(const string& url, const string& cert, int buf_reserve_size)
+const string&    CACHE_CacheObject::get_md5() const
+{
+	return m_md5;
+}
+
+void             CACHE_CacheObject::set_md5(const string& md5)
+{
+	m_md5 = md5;
+}
+
+bool             CACHE_CacheObject::is_md5_verified() const
+{
+	return m_md5_verified;
+}
+
+void             CACHE_CacheObject::set_md5_verified(bool verified)
+{
+	m_md5_verified = verified;
+}
+
+void CACHE_CacheObject::create_download(const string& url, const string& cert, const string& dest_path, CACHE_priority priority)
 {
-	//Close off any previous handles to make way for this new one
-	this->close_RAII_curl_hndl();
-	m_RAII_curl_hndl = new RAII_CurlHandle(url, cert, buf_reserve_size);
-	m_last_url = m_RAII_curl_hndl->get_curl_handle().get_url();
+	//Close off any previous download to make way for this new one
+	this->close_download();
+	m_download = CACHE_download_start(url, cert, dest_path, priority);
+	m_last_url = m_download->get_url();
 }
 
-void CACHE_CacheObject::close_RAII_curl_hndl()
+void CACHE_CacheObject::close_download()
 {
-	if(m_RAII_curl_hndl != NULL)
+	if(m_download != NULL)
 	{
-		delete m_RAII_curl_hndl;
-		m_RAII_curl_hndl = NULL;
+		CACHE_download_release(m_download);
+		m_download = NULL;
 	}
 }
 
 WED_file_cache_response CACHE_CacheObject::get_response_from_object_state(CACHE_status status) const
 {
-	return WED_file_cache_response(m_RAII_curl_hndl->get_curl_handle().get_progress(),
+	return WED_file_cache_response(m_download->get_progress(),
 								   "",
 								   get_last_error_type(),
 								   get_disk_location(),
 								   status);
 }
 
-RAII_CurlHandle* const CACHE_CacheObject::get_RAII_curl_hndl()
+CACHE_Download* CACHE_CacheObject::get_download()
 {
-	return m_RAII_curl_hndl;
+	return m_download;
 }
 
 //Trigger the cool down clock to reset and start counting down
@@ -25,7 +25,7 @@
 #define CACHE_CACHEOBJECT_H
 
 #include "WED_FileCache.h"
-#include "curl_http.h"
+#include "CACHE_Downloader.h"
 #include "RAII_Classes.h"
 #include <time.h>
 
@@ -52,14 +52,22 @@ public:
 	time_t           get_last_time_modified() const;
 	void             set_last_time_modified(time_t mtime);
 
-	//Creates and opens a cURL handle to a given url, with a certificate and optional reserve size
-	void             create_RAII_curl_hndl(const string& url, const string& cert, int buf_reserve_size=0);
+	//MD5 of the file on disk, "" if we never knew it
+	const string&    get_md5() const;
+	void             set_md5(const string& md5);
 
-	//Returns the current RAII_CurlHandle object or NULL if there is none
-	RAII_CurlHandle* const get_RAII_curl_hndl();
+	//Has the file on disk been checked against its MD5 this session?
+	bool             is_md5_verified() const;
+	void             set_md5_verified(bool verified);
 
-	//Forces RAII_CurlHandle to close and be destroyed early
-	void             close_RAII_curl_hndl();
+	//Queues a download of url to dest_path through CACHE_Downloader
+	void             create_download(const string& url, const string& cert, const string& dest_path, CACHE_priority priority);
+
+	//Returns the current download or NULL if there is none
+	CACHE_Download*  get_download();
+
+	//Releases the download, canceling it if it is still running
+	void             close_download();
 
 	//We pass in the status because CACHE_CacheObject doesn't have one
 	WED_file_cache_response get_response_from_object_state(CACHE_status status) const;
@@ -91,9 +99,13 @@ private:
 	//The last time the file was modified on disk
 	time_t m_last_time_modified;
 
-	//The curl_http_get_file that is associated with this cache_object
-	//Deleted on curl_http_get_file being done (error or not) and WED_file_cache_shutdown
-	RAII_CurlHandle* m_RAII_curl_hndl;
+	//MD5 of the file on disk, from the download or the .cache_object_info file
+	string m_md5;
+	bool   m_md5_verified;
+
+	//The download that is associated with this cache_object
+	//Released once it is done (error or not) and on WED_file_cache_shutdown
+	CACHE_Download* m_download;
 
 	CACHE_CacheObject(const CACHE_CacheObject& copy);
 	CACHE_CacheObject& operator= (const CACHE_CacheObject& rhs);
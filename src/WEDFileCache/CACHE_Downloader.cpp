@@ -0,0 +1,487 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "CACHE_Downloader.h"
+#include "curl_http.h"
+#include "ThreadUtils.h"
+#include "FileUtils.h"
+#include "AssertUtils.h"
+#include "curl/curl.h"
+
+#define CACHE_MAX_TRANSFERS		6
+#define CACHE_MAX_PER_HOST		4
+#define CACHE_MAX_ERROR_DATA	(64*1024)
+
+//Same as curl_http_get_file - give up on a transfer that has not seen a byte for this long
+static const time_t CACHE_TIMEOUT_SEC = 30;
+
+//Everything below is guarded by s_lock, except the multi handle, which only the worker touches.
+static THREAD_Mutex				s_lock;
+static vector<CACHE_Download *>	s_queue;
+static vector<CACHE_Download *>	s_active;
+static unsigned int				s_seq = 0;
+static bool						s_running = false;
+static CURLM *					s_multi = NULL;
+static THREAD_JobQueue			s_worker(1);
+
+struct	CACHE_DownloadWorker {
+
+	static CACHE_Download *	create(const string& url, const string& cert, const string& dest_path, CACHE_priority priority);
+	static void				destroy(CACHE_Download * dl) { delete dl; }
+	static void				set_priority(CACHE_Download * dl, CACHE_priority priority);
+	static void				release(CACHE_Download * dl);
+	static void				shutdown();
+
+	static void				run(void * ref);
+	static void				begin(CACHE_Download * dl);
+	static void				finish(CACHE_Download * dl, CURLcode res);
+
+	static size_t			write_cb(void * contents, size_t size, size_t nmemb, void * userp);
+	static int				progress_cb(void * ptr, double TotalToDownload, double NowDownloaded, double TotalToUpload, double NowUploaded);
+};
+
+//--CACHE_Download-------------------------------------------------------------
+
+CACHE_Download::CACHE_Download() :
+	m_priority(cache_priority_normal),
+	m_seq(0),
+	m_status(curl_http_get_file::in_progress),
+	m_progress(-1),
+	m_errcode(0),
+	m_cancel(false),
+	m_released(false),
+	m_curl(NULL),
+	m_file(NULL),
+	m_http_code(0),
+	m_disk_fail(false),
+	m_last_dl_amount(0.0),
+	m_last_data_time(0)
+{
+}
+
+CACHE_Download::~CACHE_Download()
+{
+	DebugAssert(m_curl == NULL);
+	DebugAssert(m_file == NULL);
+}
+
+bool	CACHE_Download::is_done(void)
+{
+	THREAD_Lock	l(s_lock);
+	return m_status != curl_http_get_file::in_progress;
+}
+
+bool	CACHE_Download::is_ok(void)
+{
+	THREAD_Lock	l(s_lock);
+	DebugAssert(m_status != curl_http_get_file::in_progress);
+	return m_status == curl_http_get_file::done_OK;
+}
+
+bool	CACHE_Download::is_net_fail(void)
+{
+	THREAD_Lock	l(s_lock);
+	DebugAssert(m_status == curl_http_get_file::done_error);
+	return UTL_http_is_error_bad_net(m_errcode);
+}
+
+float	CACHE_Download::get_progress(void)
+{
+	return m_progress;
+}
+
+int		CACHE_Download::get_error(void)
+{
+	THREAD_Lock	l(s_lock);
+	DebugAssert(m_status == curl_http_get_file::done_error);
+	return m_errcode;
+}
+
+void	CACHE_Download::get_error_data(vector<char>& out_data)
+{
+	THREAD_Lock	l(s_lock);
+	DebugAssert(m_status == curl_http_get_file::done_error);
+	swap(out_data, m_error_data);
+}
+
+const string&	CACHE_Download::get_url() const
+{
+	return m_url;
+}
+
+const string&	CACHE_Download::get_md5() const
+{
+	return m_md5;
+}
+
+//--Client API-----------------------------------------------------------------
+
+void	CACHE_download_set_priority(CACHE_Download * dl, CACHE_priority priority)	{ CACHE_DownloadWorker::set_priority(dl, priority); }
+void	CACHE_download_release(CACHE_Download * dl)								{ CACHE_DownloadWorker::release(dl); }
+void	CACHE_download_shutdown()													{ CACHE_DownloadWorker::shutdown(); }
+
+CACHE_Download *	CACHE_download_start(const string& url, const string& cert, const string& dest_path, CACHE_priority priority)
+{
+	CACHE_Download * dl = CACHE_DownloadWorker::create(url, cert, dest_path, priority);
+
+	THREAD_Lock	l(s_lock);
+	s_queue.push_back(dl);
+	if(!s_running)
+	{
+		// The last worker has said it is done, but may not have returned yet - join it so we never pile up threads.
+		s_worker.Wait();
+		s_running = true;
+		s_worker.Add(CACHE_DownloadWorker::run, NULL);
+	}
+	return dl;
+}
+
+void	CACHE_DownloadWorker::set_priority(CACHE_Download * dl, CACHE_priority priority)
+{
+	THREAD_Lock	l(s_lock);
+	if(priority < dl->m_priority)
+		dl->m_priority = priority;
+}
+
+void	CACHE_DownloadWorker::release(CACHE_Download * dl)
+{
+	THREAD_Lock	l(s_lock);
+	DebugAssert(!dl->m_released);
+	dl->m_released = true;
+
+	vector<CACHE_Download *>::iterator q = find(s_queue.begin(), s_queue.end(), dl);
+	if(q != s_queue.end())
+	{
+		s_queue.erase(q);
+		destroy(dl);
+	}
+	else if(dl->m_status != curl_http_get_file::in_progress)
+		destroy(dl);
+	else
+		dl->m_cancel = true;		// The worker deletes it once cURL lets go.
+}
+
+void	CACHE_DownloadWorker::shutdown()
+{
+	{
+		THREAD_Lock	l(s_lock);
+		for(vector<CACHE_Download *>::iterator q = s_queue.begin(); q != s_queue.end(); ++q)
+		{
+			if((*q)->m_released)
+				destroy(*q);
+			else
+			{
+				(*q)->m_errcode = CURLE_ABORTED_BY_CALLBACK;
+				(*q)->m_status = curl_http_get_file::done_error;
+			}
+		}
+		s_queue.clear();
+		for(vector<CACHE_Download *>::iterator a = s_active.begin(); a != s_active.end(); ++a)
+			(*a)->m_cancel = true;
+	}
+
+	s_worker.Wait();
+
+	if(s_multi)
+	{
+		curl_multi_cleanup(s_multi);
+		s_multi = NULL;
+	}
+}
+
+string	CACHE_file_md5(const string& path)
+{
+	FILE * fi = fopen(path.c_str(), "rb");
+	if(fi == NULL)
+		return string();
+
+	MD5_CTX	ctx;
+	MD5Init(&ctx);
+	unsigned char	buf[32768];
+	size_t			n;
+	while((n = fread(buf, 1, sizeof(buf), fi)) > 0)
+		MD5Update(&ctx, buf, n);
+	bool ok = ferror(fi) == 0;
+	fclose(fi);
+	if(!ok)
+		return string();
+
+	MD5Final(&ctx);
+	char hex[33];
+	for(int i = 0; i < 16; ++i)
+		sprintf(hex + i * 2, "%02x", ctx.digest[i]);
+	return string(hex, 32);
+}
+
+//--Worker---------------------------------------------------------------------
+
+CACHE_Download *	CACHE_DownloadWorker::create(const string& url, const string& cert, const string& dest_path, CACHE_priority priority)
+{
+	CACHE_Download * dl = new CACHE_Download;
+	dl->m_url = url;
+	UTL_http_encode_url(dl->m_url);
+	dl->m_cert = cert;
+	dl->m_dest_path = dest_path;
+	dl->m_priority = priority;
+
+	THREAD_Lock	l(s_lock);
+	dl->m_seq = s_seq++;
+	return dl;
+}
+
+void	CACHE_DownloadWorker::run(void * ref)
+{
+	if(s_multi == NULL)
+	{
+		// The multi handle - and with it the connection cache - outlives this worker, so the next burst of requests
+		// to the same host picks up the connections we leave open.
+		s_multi = curl_multi_init();
+		#if LIBCURL_VERSION_NUM >= 0x071e00
+		curl_multi_setopt(s_multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long) CACHE_MAX_PER_HOST);
+		#endif
+		#ifdef CURLPIPE_MULTIPLEX
+		curl_multi_setopt(s_multi, CURLMOPT_PIPELINING, (long) CURLPIPE_MULTIPLEX);
+		#endif
+	}
+
+	while(1)
+	{
+		{
+			THREAD_Lock	l(s_lock);
+
+			for(int n = s_active.size() - 1; n >= 0; --n)
+			if(s_active[n]->m_cancel)
+				finish(s_active[n], CURLE_ABORTED_BY_CALLBACK);
+
+			while(s_active.size() < CACHE_MAX_TRANSFERS && !s_queue.empty())
+			{
+				// Best priority class first, then first come first served.
+				vector<CACHE_Download *>::iterator best = s_queue.begin();
+				for(vector<CACHE_Download *>::iterator q = s_queue.begin(); q != s_queue.end(); ++q)
+				if((*q)->m_priority < (*best)->m_priority ||
+				  ((*q)->m_priority == (*best)->m_priority && (*q)->m_seq < (*best)->m_seq))
+					best = q;
+				CACHE_Download * dl = *best;
+				s_queue.erase(best);
+				begin(dl);
+			}
+
+			if(s_active.empty())
+			{
+				s_running = false;
+				return;
+			}
+		}
+
+		int still_running = 0;
+		curl_multi_perform(s_multi, &still_running);
+
+		CURLMsg *	msg;
+		int			msgs_left;
+		while((msg = curl_multi_info_read(s_multi, &msgs_left)) != NULL)
+		if(msg->msg == CURLMSG_DONE)
+		{
+			// msg dies when the handle is removed, so grab what we need first.
+			CURLcode	res = msg->data.result;
+			char *		who = NULL;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &who);
+
+			THREAD_Lock	l(s_lock);
+			finish((CACHE_Download *) who, res);
+		}
+
+		curl_multi_wait(s_multi, NULL, 0, 100, NULL);
+	}
+}
+
+//Called with s_lock held.
+void	CACHE_DownloadWorker::begin(CACHE_Download * dl)
+{
+	s_active.push_back(dl);
+
+	CURL * curl = curl_easy_init();
+	if(curl == NULL)
+	{
+		finish(dl, CURLE_FAILED_INIT);
+		return;
+	}
+	dl->m_curl = curl;
+	dl->m_last_data_time = time(NULL);
+	MD5Init(&dl->m_md5_ctx);
+
+	curl_easy_setopt(curl, CURLOPT_URL, dl->m_url.c_str());
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, dl);
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, dl);
+
+	curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, progress_cb);
+	curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, dl);
+	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 60L);
+
+	if(!dl->m_cert.empty())
+		curl_easy_setopt(curl, CURLOPT_CAINFO, dl->m_cert.c_str());
+
+	curl_multi_add_handle(s_multi, curl);
+}
+
+//Called with s_lock held.  Takes the download out of the active list and frees it if its owner already let go.
+void	CACHE_DownloadWorker::finish(CACHE_Download * dl, CURLcode res)
+{
+	if(dl->m_curl)
+	{
+		curl_easy_getinfo(dl->m_curl, CURLINFO_RESPONSE_CODE, &dl->m_http_code);
+		curl_multi_remove_handle(s_multi, dl->m_curl);
+		curl_easy_cleanup(dl->m_curl);
+		dl->m_curl = NULL;
+	}
+
+	string part_path = dl->m_dest_path + ".part";
+	bool had_file = dl->m_file != NULL;
+	if(dl->m_file)
+	{
+		if(fclose(dl->m_file) != 0)
+			dl->m_disk_fail = true;
+		dl->m_file = NULL;
+	}
+
+	// Same conventions as curl_http_get_file: a callback abort counts as a time-out, anything but a 200 is the HTTP code.
+	if(dl->m_disk_fail)
+		res = CURLE_WRITE_ERROR;
+	if(res == CURLE_ABORTED_BY_CALLBACK)
+		res = CURLE_OPERATION_TIMEDOUT;
+
+	int status = curl_http_get_file::done_error;
+	if(res != CURLE_OK)
+		dl->m_errcode = res;
+	else if(dl->m_http_code != 200)
+		dl->m_errcode = dl->m_http_code;
+	else
+	{
+		if(!had_file)
+		{
+			// Empty body - still a file.
+			FILE * fi = fopen(part_path.c_str(), "wb");
+			if(fi) fclose(fi);
+		}
+
+		MD5Final(&dl->m_md5_ctx);
+		char hex[33];
+		for(int i = 0; i < 16; ++i)
+			sprintf(hex + i * 2, "%02x", dl->m_md5_ctx.digest[i]);
+		dl->m_md5 = string(hex, 32);
+
+		if(FILE_exists(dl->m_dest_path.c_str()))
+			FILE_delete_file(dl->m_dest_path.c_str(), false);
+		if(FILE_rename_file(part_path.c_str(), dl->m_dest_path.c_str()) == 0)
+			status = curl_http_get_file::done_OK;
+		else
+			dl->m_errcode = CURLE_WRITE_ERROR;
+	}
+
+	if(status != curl_http_get_file::done_OK && FILE_exists(part_path.c_str()))
+		FILE_delete_file(part_path.c_str(), false);
+
+	s_active.erase(find(s_active.begin(), s_active.end(), dl));
+	dl->m_status = status;
+
+	if(dl->m_released)
+		destroy(dl);
+}
+
+size_t	CACHE_DownloadWorker::write_cb(void * contents, size_t size, size_t nmemb, void * userp)
+{
+	CACHE_Download * dl = (CACHE_Download *) userp;
+	size_t bytes = size * nmemb;
+	unsigned char * p = (unsigned char *) contents;
+
+	dl->m_last_data_time = time(NULL);
+
+	// Redirect bodies never reach us, so the first write tells us what the final response is.
+	if(dl->m_http_code == 0)
+		curl_easy_getinfo(dl->m_curl, CURLINFO_RESPONSE_CODE, &dl->m_http_code);
+
+	if(dl->m_http_code != 200)
+	{
+		// Keep the start of an error page for the message; the owner can't read it until we are done.
+		size_t keep = min(bytes, (size_t) max(0, CACHE_MAX_ERROR_DATA - (int) dl->m_error_data.size()));
+		dl->m_error_data.insert(dl->m_error_data.end(), p, p + keep);
+		return bytes;
+	}
+
+	if(dl->m_file == NULL)
+	{
+		dl->m_file = fopen((dl->m_dest_path + ".part").c_str(), "wb");
+		if(dl->m_file == NULL)
+		{
+			dl->m_disk_fail = true;
+			return 0;
+		}
+	}
+
+	if(fwrite(p, 1, bytes, dl->m_file) != bytes)
+	{
+		dl->m_disk_fail = true;
+		return 0;
+	}
+
+	// MD5Update takes an unsigned short length.
+	for(size_t done = 0; done < bytes; )
+	{
+		size_t n = min(bytes - done, (size_t) 32768);
+		MD5Update(&dl->m_md5_ctx, p + done, n);
+		done += n;
+	}
+	return bytes;
+}
+
+int		CACHE_DownloadWorker::progress_cb(void * ptr, double TotalToDownload, double NowDownloaded, double TotalToUpload, double NowUploaded)
+{
+	CACHE_Download * dl = (CACHE_Download *) ptr;
+
+	if(dl->m_cancel)
+		return 1;
+
+	time_t now = time(NULL);
+
+	if(NowDownloaded > dl->m_last_dl_amount)
+	{
+		dl->m_last_dl_amount = NowDownloaded;
+		dl->m_last_data_time = now;
+	}
+	else if(now - dl->m_last_data_time > CACHE_TIMEOUT_SEC)
+	{
+		return 1;
+	}
+
+	if(TotalToDownload > 0.0)
+		dl->m_progress = NowDownloaded * 100.0 / TotalToDownload;
+	else	// gzipped transfers dont know the total transfer size ahead of time, so we report in kB, as a *negative* number
+		dl->m_progress = (int) -NowDownloaded / 1024.0;
+
+	return 0;
+}
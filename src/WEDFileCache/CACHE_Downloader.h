@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef CACHE_DOWNLOADER_H
+#define CACHE_DOWNLOADER_H
+
+#include "WED_FileCache.h"
+#include "md5.h"
+#include <time.h>
+
+/*
+	CACHE_Downloader - THEORY OF OPERATION
+
+	curl_http_get_file spawns a thread and a fresh connection per URL, and keeps the whole body in memory until the
+	end.  That is fine for one JSON file, but a gateway import pulling hundreds of scenery packs paid a TLS handshake
+	for every one of them and went strictly one at a time.
+
+	The downloader runs every cache transfer on ONE worker thread driving a cURL multi handle:
+
+	- At most CACHE_MAX_TRANSFERS transfers run at once (and at most CACHE_MAX_PER_HOST against any one host); the
+	  rest wait in a queue.  The queue is ordered by priority class, then by the order requests came in, so a file
+	  the user is staring at a progress bar for jumps ahead of prefetches.
+	- The multi handle lives as long as the app, and so does its connection cache - back-to-back requests to the
+	  gateway reuse one connection (and HTTP/2 multiplexes them when the server and libcurl can).
+	- The body is streamed straight to dest_path + ".part" while we run MD5 over it; only a complete 200 response is
+	  renamed into place, so the cache never sees a half-written file.  Error bodies stay in memory, for messages.
+
+	The worker starts when there is work and exits when there is none, like THREAD_JobQueue workers.
+
+	A download belongs to whoever started it until they call CACHE_download_release - that cancels it if it is still
+	running.  All of the CACHE_Download accessors are safe to call from the main thread while the transfer runs.
+*/
+
+class	CACHE_Download;
+
+//Queues a download of url into dest_path.  The folder must already exist.
+CACHE_Download *	CACHE_download_start(const string& url, const string& cert, const string& dest_path, CACHE_priority priority);
+
+//Moves a download that has not started yet up to a more urgent priority class; never moves it down.
+void				CACHE_download_set_priority(CACHE_Download * dl, CACHE_priority priority);
+
+//Hands the download back; cancels it if it is not done.  dl is invalid after this.
+void				CACHE_download_release(CACHE_Download * dl);
+
+//Cancels everything and waits for the worker to quit.  Called once at the end of the program.
+void				CACHE_download_shutdown();
+
+//MD5 of a file on disk as 32 hex digits, or "" if the file can't be read.
+string				CACHE_file_md5(const string& path);
+
+class	CACHE_Download {
+public:
+
+	bool			is_done(void);
+	bool			is_ok(void);			// IF done, did it finish without error?
+	bool			is_net_fail(void);		// IF failed, does the error look like our network's fault?
+	float			get_progress(void);		// Percent, or minus kB received if the server did not send a size, -1 before it starts.
+	int				get_error(void);		// If failed: a CURLcode, or the HTTP status if 100 or more.
+	void			get_error_data(vector<char>& out_data);	// If failed, whatever the server sent us.
+	const string&	get_url() const;
+	const string&	get_md5() const;		// If OK, MD5 of the file we wrote.
+
+private:
+
+	friend struct	CACHE_DownloadWorker;
+
+					 CACHE_Download();
+					~CACHE_Download();
+					 CACHE_Download(const CACHE_Download&);
+	CACHE_Download&	 operator=(const CACHE_Download&);
+
+	string			m_url;
+	string			m_cert;
+	string			m_dest_path;
+	CACHE_priority	m_priority;
+	unsigned int	m_seq;					// Arrival order within a priority class
+
+	// Shared with the main thread; written only under the downloader's lock.
+	volatile int	m_status;				// curl_http_get_file's in_progress/done_OK/done_error
+	volatile int	m_progress;
+	int				m_errcode;
+	vector<char>	m_error_data;
+	string			m_md5;
+	bool			m_cancel;
+	bool			m_released;
+
+	// Worker thread only
+	void *			m_curl;
+	FILE *			m_file;
+	MD5_CTX			m_md5_ctx;
+	long			m_http_code;
+	bool			m_disk_fail;
+	double			m_last_dl_amount;
+	time_t			m_last_data_time;
+
+};
+
+#endif
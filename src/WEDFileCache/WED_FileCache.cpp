@@ -39,7 +39,8 @@ WED_file_cache_request::WED_file_cache_request()
 	: in_cert(""),
 	  in_domain(cache_domain_none),
 	  in_folder_prefix(""),
-	  in_url("")
+	  in_url(""),
+	  in_priority(cache_priority_interactive)
 {
 }
 //---------------------------------------------------------------------------//
@@ -181,11 +182,21 @@ void CACHE_FileCacheInitializer::init()
 				
 				bool json_parse_result = reader.parse(content, root);
 
-				if(json_parse_result == true)
+				//A file that isn't the size we saved is a partial write from a crash or someone else's doing - drop it
+				struct stat meta_data;
+				if(json_parse_result == true &&
+					(!root.isMember("size") || (FILE_get_file_meta_data(paired_files[i].first, meta_data) == 0 && meta_data.st_size == root["size"].asInt64())))
 				{
 					CACHE_file_cache.back()->m_last_time_modified = root["last_time_modified"].asInt();
 					CACHE_file_cache.back()->m_domain = static_cast<CACHE_domain>(root["domain"].asInt());
 					CACHE_file_cache.back()->set_disk_location(paired_files[i].first);
+
+					//Files from older WEDs have no MD5 and are taken on trust
+					if(root.isMember("md5"))
+					{
+						CACHE_file_cache.back()->set_md5(root["md5"].asString());
+						CACHE_file_cache.back()->set_md5_verified(false);
+					}
 					info_read_success = true;
 				}
 			}
@@ -193,9 +204,10 @@ void CACHE_FileCacheInitializer::init()
 			if(info_read_success == false)
 			{
 				delete CACHE_file_cache.back();
+				CACHE_file_cache.pop_back();
 
 				FILE_delete_file(paired_files[i].first.c_str(), false);
-				FILE_delete_file(paired_files[i+1].second.c_str(), false);
+				FILE_delete_file(paired_files[i].second.c_str(), false);
 				continue;
 			}
 		}
@@ -220,7 +232,7 @@ void WED_file_cache_init()
 }
 
 //returns an error string if there is one
-static void interpret_error(curl_http_get_file& mCurl, string& out_error_human, CACHE_error_type& out_error_type)
+static void interpret_error(CACHE_Download& mCurl, string& out_error_human, CACHE_error_type& out_error_type)
 {
 	out_error_human = "";
 	out_error_type = cache_error_type_unknown;
@@ -230,7 +242,12 @@ static void interpret_error(curl_http_get_file& mCurl, string& out_error_human,
 
 	stringstream ss;
 	ss.str() = "";
-	if(err <= CURL_LAST)
+	if(err == CURLE_WRITE_ERROR)
+	{
+		ss << "Download failed: could not write to the file cache. (" << err << ")";
+		out_error_type = cache_error_type_disk_write;
+	}
+	else if(err <= CURL_LAST)
 	{
 		string msg = curl_easy_strerror((CURLcode) err);
 		ss << "Download failed: " << msg << ". (" << err << ")";
@@ -284,14 +301,21 @@ static void interpret_error(curl_http_get_file& mCurl, string& out_error_human,
 	out_error_human = ss.str();
 }
 
+//Where a request's file lives in the cache
+static string cache_path_for_request(const WED_file_cache_request& req)
+{
+	return CACHE_folder + DIR_STR + req.in_folder_prefix + DIR_STR + FILE_get_file_name(req.in_url);
+}
+
 static WED_file_cache_response start_new_cache_object(WED_file_cache_request req)
 {
 	CACHE_file_cache.push_back(new CACHE_CacheObject());
 	CACHE_CacheObject& co = *CACHE_file_cache.back();
 	
-	co.create_RAII_curl_hndl(req.in_url, req.in_cert);
+	FILE_make_dir_exist(string(CACHE_folder + DIR_STR + req.in_folder_prefix).c_str());
+	co.create_download(req.in_url, req.in_cert, cache_path_for_request(req), req.in_priority);
 	
-	return WED_file_cache_response(co.get_RAII_curl_hndl()->get_curl_handle().get_progress(),
+	return WED_file_cache_response(co.get_download()->get_progress(),
 								   "",
 								   co.get_last_error_type(),
 								   co.get_disk_location(),
@@ -358,9 +382,9 @@ WED_file_cache_response WED_file_cache_request_file(const WED_file_cache_request
 	CACHE_CacheObject & co = **itr;
 
 	//2. In CACHE_file_cache with active cURL_handle?
-	if((**itr).get_RAII_curl_hndl() != NULL)
+	if((**itr).get_download() != NULL)
 	{
-		curl_http_get_file & hndl = co.get_RAII_curl_hndl()->get_curl_handle();
+		CACHE_Download & hndl = *co.get_download();
 		
 		if(hndl.is_done())
 		{
@@ -375,48 +399,30 @@ WED_file_cache_response WED_file_cache_request_file(const WED_file_cache_request
 
 #if SAVE_TO_DISK //Testing cooldown
 				/*
-				1. Create if prefixed dir does not exist
-				2. Attempt to save the file itself
-				3. Attempt to save the cache_object_info json
-				
-				Either it all is saved perfectly or we delete it all and report an error. This is an all or nothing situation.
+				The downloader has already streamed the file into place (or failed, and we would not be here).
+				All that is left is the cache_object_info json - if we can't write that we delete both and report an error,
+				it is all or nothing.
 				*/
 
-				res.out_path = CACHE_folder + DIR_STR + req.in_folder_prefix + DIR_STR + FILE_get_file_name(req.in_url);
-				FILE_make_dir_exist(string(CACHE_folder + DIR_STR + req.in_folder_prefix).c_str());
-
-				//We test if file and cache_file_info file save PERFECECTLY, with NO issues
-				//If anything went wrong we call it an error
-				bool good_file_save = false;
-
-				//Attempt to save the file content
-				RAII_FileHandle f(res.out_path,"w");
-				
-				if(f() != NULL)
-				{
-					const vector<char>& buf = co.get_RAII_curl_hndl()->get_dest_buffer();
-					for(vector<char>::const_iterator itr = buf.begin(); itr != buf.end(); ++itr)
-					{
-						fprintf(f(),"%c",*itr);
-					}
-
-					good_file_save = ferror(f()) == 0 ? true : false;
-				}
+				res.out_path = cache_path_for_request(req);
 
 				bool good_info_save = false;
 
 				RAII_FileHandle cache_object_info(string(res.out_path).append(CACHE_INFO_FILE_EXT), "w");
-				if(cache_object_info() != NULL && good_file_save == true)
+				if(cache_object_info() != NULL)
 				{
 					Json::Value root(Json::objectValue);
 
 					root["domain"] = Json::Value(static_cast<int>(req.in_domain));
+					root["md5"] = Json::Value(hndl.get_md5());
 
 					struct stat meta_data;
 					if(FILE_get_file_meta_data(res.out_path, meta_data) == 0)
 					{
 						root["last_time_modified"] = Json::Value((Json::Value::Int64)meta_data.st_mtime);
+						root["size"] = Json::Value((Json::Value::Int64)meta_data.st_size);
 						co.set_last_time_modified(meta_data.st_mtime);
+						co.set_md5(hndl.get_md5());
 
 						fprintf(cache_object_info(),"%s", Json::FastWriter().write(root).c_str());
 
@@ -424,9 +430,10 @@ WED_file_cache_response WED_file_cache_request_file(const WED_file_cache_request
 					}
 				}
 
-				if(good_file_save == false || good_info_save == false)
+				if(good_info_save == false)
 				{
-					FILE_delete_file(f.path().c_str(), false);
+					cache_object_info.close();
+					FILE_delete_file(res.out_path.c_str(), false);
 					FILE_delete_file(cache_object_info.path().c_str(), false);
 					res.out_error_human = res.out_path + " could not be saved, check if the folder or file is in use or if you have sufficient privaleges";
 					co.set_last_error_type(cache_error_type_disk_write);
@@ -434,7 +441,7 @@ WED_file_cache_response WED_file_cache_request_file(const WED_file_cache_request
 #endif
 				res.out_error_type = co.get_last_error_type();
 				co.set_disk_location(res.out_path);
-				co.close_RAII_curl_hndl();
+				co.close_download();
 
 				return res;
 			}
@@ -447,7 +454,7 @@ WED_file_cache_response WED_file_cache_request_file(const WED_file_cache_request
 
 				co.set_last_error_type(res.out_error_type);
 
-				co.close_RAII_curl_hndl();
+				co.close_download();
 				return res;
 			}//end if(hndl.is_ok())
 		}
@@ -457,9 +464,12 @@ WED_file_cache_response WED_file_cache_request_file(const WED_file_cache_request
 			// so between the time we call co.get_response_from_object_state() and the time we call hndl.get_progress(), the progress has increased by, say, 1%.
 			// Thus, I'm turning it off, but leaving it commented out for the sake of posterity.
 			// DebugAssert(co.get_response_from_object_state(cache_status_downloading) == WED_file_cache_response(hndl.get_progress(), "", cache_error_type_none, "", cache_status_downloading));
+
+			//A prefetch that someone is now asking for for real jumps the queue
+			CACHE_download_set_priority(&hndl, req.in_priority);
 			return co.get_response_from_object_state(cache_status_downloading);
 		}//end if(hndl.is_done())
-	}//end if((**itr).get_RAII_curl_hndl() != NULL)
+	}//end if((**itr).get_download() != NULL)
 	else
 	{
 		const CACHE_domain_policy pol = GetDomainPolicy(req.in_domain);
@@ -470,6 +480,22 @@ WED_file_cache_response WED_file_cache_request_file(const WED_file_cache_request
 		}
 		else if(FILE_exists((*itr)->get_disk_location().c_str()) == true) //Check if file was deleted between requests
 		{
+			//A file from a previous session gets checked against its MD5 once before we trust it
+			if(co.needs_refresh(pol) == false && !co.is_md5_verified())
+			{
+				if(CACHE_file_md5(co.get_disk_location()) == co.get_md5())
+				{
+					co.set_md5_verified(true);
+				}
+				else
+				{
+					FILE_delete_file(co.get_disk_location().c_str(), false);
+					FILE_delete_file(string(co.get_disk_location() + CACHE_INFO_FILE_EXT).c_str(), false);
+					remove_cache_object(itr);
+					return start_new_cache_object(req);
+				}
+			}
+
 			if(co.needs_refresh(pol) == false)
 			{
 				DebugAssert((*itr)->get_disk_location() != "");
@@ -498,5 +524,7 @@ void WED_file_cache_shutdown()
 		delete *co;
 	}
 	CACHE_file_cache.clear();
+
+	CACHE_download_shutdown();
 }
 //---------------------------------------------------------------------------//
@@ -31,6 +31,11 @@
 
 	The file cache is a black box: clients call WED_file_cache_request_file repeatedly on a timer, passing in a request struct, receiving a response struct.
 	
+	- Downloads run in the background through CACHE_Downloader: a few at a time, reusing connections, streamed to disk with an MD5 that
+	  is kept with the file and checked again the first time we hand out a file from a previous session
+	- The first request for a URL queues it; a client that knows what it will want next can request it early at cache_priority_prefetch
+	  and poll it later at the default priority, which moves it up the queue if it has not started yet
+	
 	- The request contains information about the URL to connect to and other data
 	- The response contains error data, download progress, and (potentially) a path where the file successfully downloaded
 		* After an error a url is placed on a cool down timer, preventing WED DDOS'ing the server
@@ -47,6 +52,14 @@ enum CACHE_status
 	cache_status_error        //File has had some kind of error, see CACHE_error_type
 };
 
+//Which downloads go first when more are queued than we run at once
+enum CACHE_priority
+{
+	cache_priority_interactive, //Someone is watching a progress bar for this
+	cache_priority_normal,
+	cache_priority_prefetch     //We will want it soon, but anything else comes first
+};
+
 //What type of cache error
 enum CACHE_error_type
 {
@@ -72,6 +85,9 @@ struct WED_file_cache_request
 
 	//The URL to request from, cached inside CACHE_CacheObject
 	string in_url;
+
+	//Queue position if this has to be downloaded, defaults to interactive
+	CACHE_priority in_priority;
 };
 
 struct WED_file_cache_response
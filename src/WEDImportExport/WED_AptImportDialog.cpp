@@ -197,6 +197,8 @@ void WED_AptImportDialog::DoIt(void)
 	set<int>	selected;
 	mAptTable.GetSelection(selected);
 	
+	// Growing a vector of airports copies every airport in it, each time - a global apt.dat is far too big for that.
+	apts.reserve(selected.size());
 	for(int n = 0; n < mApts.size(); ++n)
 	if(selected.count(n))
 		apts.push_back(mApts[n]);
@@ -58,6 +58,9 @@
 #include <time.h>
 #include "STLUtils.h"
 #include "WED_RoadEdge.h"
+#include "MemFileUtils.h"
+#include "ThreadUtils.h"
+#include "TraceUtils.h"
 
 #if DEV
 #include "PerfUtils.h"
@@ -1147,6 +1150,147 @@ static void ExportPOL(const char * relativeDDSP, const char * relativePOLP, WED_
 	rmgr->MakePol(relativePOLP,out_info);
 }
 
+//---------------------------------------------------------------------------------------------------------------------------------------
+// ORTHOPHOTO CONVERSION
+//---------------------------------------------------------------------------------------------------------------------------------------
+/*
+	Turning an orthophoto into a DDS (decode, resample, mipmap, DXT) takes seconds per image, and export used to sit
+	and wait for every one of them.  Now the export walk only queues a job per image and carries on writing DSFs
+	while a thread per core does the conversion; the export waits for the queue at the very end and writes the .pol
+	files (which need the resource manager, so they are written on the main thread).  A conversion failure is
+	reported then, rather than aborting the walk on the spot.
+
+	An image that spans several tiles (or is used by several orthophotos) is queued once - jobs are keyed by DDS path.
+
+	Each DDS we write is tagged (in the reserved bytes of its header) with a hash of the source image's bytes and the
+	conversion settings.  If the DDS on disk carries the tag we would write, the conversion is skipped no matter what
+	the file dates say - touching or re-copying the source no longer costs a recompress, and changing the encoder
+	setting does force one.  A DDS without our tag (made by hand, or by an older WED) is left alone if it is newer
+	than the source, same as always.
+*/
+
+#define ORTHO_MAX_DIM			2048
+#define ORTHO_SETTINGS_VERSION	1		// Bump this if the conversion changes, to invalidate existing DDS files.
+
+struct	ortho_job_t {
+	string					abs_img;
+	string					abs_dds;
+	string					rel_dds;
+	string					rel_pol;
+	WED_DrapedOrthophoto *	orth;
+	int						quality;
+	bool					dds_is_old;		// The DDS is older than the image (or the same age) by the file dates.
+
+	bool					write_pol;		// Results
+	bool					failed;
+	int						height;
+};
+
+struct	ortho_queue_t {
+						 ortho_queue_t() : failed(false) { }
+						~ortho_queue_t() { queue.Wait(); for(map<string, ortho_job_t *>::iterator j = jobs.begin(); j != jobs.end(); ++j) delete j->second; }
+
+	THREAD_JobQueue				queue;
+	map<string, ortho_job_t *>	jobs;
+	bool						failed;
+};
+
+// FNV-1a of the source image plus everything that changes what we would write.
+static unsigned long long	ortho_tag_for_job(const ortho_job_t * job)
+{
+	MFMemFile * f = MemFile_Open(job->abs_img.c_str());
+	if(f == NULL)
+		return 0;
+	unsigned long long h = 14695981039346656037ULL;
+	for(const unsigned char * p = (const unsigned char *) MemFile_GetBegin(f); p != (const unsigned char *) MemFile_GetEnd(f); ++p)
+		h = (h ^ *p) * 1099511628211ULL;
+	MemFile_Close(f);
+
+	int settings[3] = { ORTHO_MAX_DIM, job->quality, ORTHO_SETTINGS_VERSION };
+	for(int i = 0; i < 3; ++i)
+		h = (h ^ (unsigned long long) settings[i]) * 1099511628211ULL;
+	return h ? h : 1;		// 0 means "no tag" to WriteBitmapToDDSEx.
+}
+
+static void	ortho_convert_job(void * ref)
+{
+	TRACE_ZONE("Orthophoto conversion")
+	ortho_job_t * job = (ortho_job_t *) ref;
+	job->write_pol = false;
+	job->failed = false;
+	job->height = 1;
+
+	unsigned long long old_tag;
+	int old_width, old_height;
+	bool has_tag = ReadDDSTag(job->abs_dds.c_str(), &old_tag, &old_width, &old_height);
+
+	// Hand-made (or old) DDS that is newer than the image - not ours to replace.
+	if(!has_tag && !job->dds_is_old)
+		return;
+
+	unsigned long long tag = ortho_tag_for_job(job);
+	if(has_tag && tag == old_tag)
+	{
+		job->height = old_height;
+		job->write_pol = true;
+		return;
+	}
+
+	ImageInfo imgInfo;
+	if(MakeSupportedType(job->abs_img.c_str(),&imgInfo) != 0)
+	{
+		job->failed = true;
+		return;
+	}
+
+	int DXTMethod = 5;
+	//If only RGB
+	if(imgInfo.channels == 3)
+	{
+		ConvertBitmapToAlpha(&imgInfo,false);
+		DXTMethod = 1;
+	}
+
+	int inWidth = 1;
+	int inHeight = 1;
+	while(inWidth < imgInfo.width && inWidth < ORTHO_MAX_DIM) inWidth <<= 1;
+	while(inHeight < imgInfo.height && inHeight < ORTHO_MAX_DIM) inHeight <<= 1;
+
+	ImageInfo smaller;
+	if (CreateNewBitmap(inWidth,inHeight, 4, &smaller) == 0)
+	{
+		CopyBitmapSection(&imgInfo,&smaller, 0,0,imgInfo.width,imgInfo.height, 0, 0, smaller.width,smaller.height);
+		MakeMipmapStack(&smaller);
+		if(WriteBitmapToDDSEx(smaller, DXTMethod, job->abs_dds.c_str(), 1, job->quality, tag, 1) != 0)
+			job->failed = true;
+		DestroyBitmap(&smaller);
+	}
+	DestroyBitmap(&imgInfo);
+
+	job->height = inHeight;
+	job->write_pol = !job->failed;
+}
+
+// Waits for all queued conversions and writes the .pol files.  Returns false (after telling the user) if any image failed.
+static bool	ortho_finish_jobs(ortho_queue_t& q, IResolver * resolver)
+{
+	q.queue.Wait();
+	WED_ResourceMgr * rmgr = WED_GetResourceMgr(resolver);
+	for(map<string, ortho_job_t *>::iterator j = q.jobs.begin(); j != q.jobs.end(); ++j)
+	{
+		ortho_job_t * job = j->second;
+		if(job->failed)
+		{
+			string msg = string("Unable to convert the image file '") + job->abs_img + string("'to a DDS file.");
+			DoUserAlert(msg.c_str());
+			return false;
+		}
+		if(job->write_pol)
+			ExportPOL(job->rel_dds.c_str(),job->rel_pol.c_str(),job->orth,job->height,rmgr);
+	}
+	return true;
+}
+
 //Returns -1 for abort, or n where n > 0 for the number of 
 static int	DSF_ExportTileRecursive(
 						WED_Thing *					what,
@@ -1158,7 +1302,8 @@ static int	DSF_ExportTileRecursive(
 						const DSFCallbacks_t *		cbs, 
 						void *						writer,
 						set<WED_Thing *>&			problem_children,
-						int							show_level)
+						int							show_level,
+						ortho_queue_t&				orthos)
 {
 	int real_thingies = 0;
 	
@@ -1813,58 +1958,25 @@ static int	DSF_ExportTileRecursive(
 			*/
 			//File extenstion
 
-			if(date_cmpr_res == dcr_firstIsNew || date_cmpr_res == dcr_same)
-			{
-				WED_ResourceMgr * rmgr = WED_GetResourceMgr(resolver);
-				ImageInfo imgInfo;
-				ImageInfo smaller;
-				int inWidth = 1;
-				int inHeight = 1;
-				
-				int DXTMethod = 0;
-				
-				int res = MakeSupportedType(absPathIMG.c_str(),&imgInfo);
-				if(res != 0)
-				{
-					string msg = string("Unable to convert the image file '") + absPathIMG + string("'to a DDS file.");
-					DoUserAlert(msg.c_str());
-					return -1;
-				}
-				
-				//If only RGB
-				if(imgInfo.channels == 3)
-				{
-					ConvertBitmapToAlpha(&imgInfo,false);
-					DXTMethod = 1;
-				}
-				else
-				{
-					DXTMethod = 5;
-				}
-				while(inWidth < imgInfo.width && inWidth < 2048) inWidth <<= 1;
-				
-				while(inHeight < imgInfo.height && inHeight < 2048) inHeight <<= 1;
-
-				if (CreateNewBitmap(inWidth,inHeight, 4, &smaller) == 0)
-				{
-					int isize = 2048;
-					isize = max(smaller.width,smaller.height);
-
-					CopyBitmapSection(&imgInfo,&smaller, 0,0,imgInfo.width,imgInfo.height, 0, 0, smaller.width,smaller.height);    
-		 
-					MakeMipmapStack(&smaller);
-					WriteBitmapToDDS(smaller, DXTMethod, absPathDDS.c_str(), 1);
-					DestroyBitmap(&smaller);
-				}
-				DestroyBitmap(&imgInfo);
-				ExportPOL(relativePathDDS.c_str(),relativePathPOL.c_str(),orth,inHeight,rmgr);
-			}
-			else if(date_cmpr_res == dcr_error)
+			if(date_cmpr_res == dcr_error)
 			{
 				string msg = string("The file '") + absPathIMG + string("' is missing.");
 				DoUserAlert(msg.c_str());
 				return -1;
 			}
+			else if(orthos.jobs.count(absPathDDS) == 0)
+			{
+				ortho_job_t * job = new ortho_job_t;
+				job->abs_img = absPathIMG;
+				job->abs_dds = absPathDDS;
+				job->rel_dds = relativePathDDS;
+				job->rel_pol = relativePathPOL;
+				job->orth = orth;
+				job->quality = gOrthoFastDXT ? dxt_quality_fast : dxt_quality_best;
+				job->dds_is_old = date_cmpr_res == dcr_firstIsNew || date_cmpr_res == dcr_same;
+				orthos.jobs[absPathDDS] = job;
+				orthos.queue.Add(ortho_convert_job, job);
+			}
 		}
 
 		idx = io_table.accum_pol(r,show_level);
@@ -1933,7 +2045,7 @@ static int	DSF_ExportTileRecursive(
 	int cc = what->CountChildren();
 	for (int c = 0; c < cc; ++c)
 	{
-		int result = DSF_ExportTileRecursive(what->GetNthChild(c), resolver, pkg, cull_bounds, safe_bounds, io_table, cbs, writer, problem_children, show_level);
+		int result = DSF_ExportTileRecursive(what->GetNthChild(c), resolver, pkg, cull_bounds, safe_bounds, io_table, cbs, writer, problem_children, show_level, orthos);
 		if (result == -1)
 		{
 			real_thingies = -1; //Abort!
@@ -1954,8 +2066,9 @@ static int	DSF_ExportTileRecursive(
 	return real_thingies;
 }
 
-static int DSF_ExportTile(WED_Thing * base, IResolver * resolver, const string& pkg, int x, int y, set <WED_Thing *>& problem_children)
+static int DSF_ExportTile(WED_Thing * base, IResolver * resolver, const string& pkg, int x, int y, set <WED_Thing *>& problem_children, ortho_queue_t& orthos)
 {
+	TRACE_ZONE("DSF_ExportTile")
 	void *			writer;
 	DSFCallbacks_t	cbs;
 	char	prop_buf[256];
@@ -2003,7 +2116,7 @@ static int DSF_ExportTile(WED_Thing * base, IResolver * resolver, const string&
 	int entities = 0;
 	for (int show_level = 6; show_level >= 1; --show_level)
 	{
-		int result = DSF_ExportTileRecursive(base, resolver, pkg, cull_bounds, safe_bounds, rsrc, &cbs, writer, problem_children, show_level);
+		int result = DSF_ExportTileRecursive(base, resolver, pkg, cull_bounds, safe_bounds, rsrc, &cbs, writer, problem_children, show_level, orthos);
 		if (result == -1)
 		{
 			DSFDestroyWriter(writer);
@@ -2045,6 +2158,7 @@ static int DSF_ExportTile(WED_Thing * base, IResolver * resolver, const string&
 
 int DSF_Export(WED_Thing * base, IResolver * resolver, const string& package, set<WED_Thing *>& problem_children)
 {
+	TRACE_ZONE("DSF_Export")
 #if DEV
 	StElapsedTime	etime("Export time");
 #endif
@@ -2062,12 +2176,13 @@ int DSF_Export(WED_Thing * base, IResolver * resolver, const string& package, se
 	int tile_south = floor(wrl_bounds.p1.y());
 	int tile_north = ceil (wrl_bounds.p2.y());
 
+	ortho_queue_t	orthos;
 	int DSF_export_tile_res = 0;
 	for (int y = tile_south; y < tile_north; ++y)
 	{
 		for (int x = tile_west; x < tile_east; ++x)
 		{
-			DSF_export_tile_res = DSF_ExportTile(base, resolver, package, x, y, problem_children);
+			DSF_export_tile_res = DSF_ExportTile(base, resolver, package, x, y, problem_children, orthos);
 			if (DSF_export_tile_res == -1)
 			{
 				break;
@@ -2080,6 +2195,10 @@ int DSF_Export(WED_Thing * base, IResolver * resolver, const string& package, se
 		}
 	}
 
+	// On abort we still let the queue drain (in its destructor) but don't bother with the .pol files.
+	if (DSF_export_tile_res != -1 && !ortho_finish_jobs(orthos, resolver))
+		return -1;
+
 	if (g_dropped_pts)
 	{
 		DoUserAlert("Warning: you have bezier curves that cross a DSF tile boundary.  X-Plane 9 cannot handle this case.  To fix this, only use non-curved polygons to cross a tile boundary.");
@@ -2125,15 +2244,16 @@ int DSF_ExportAirportOverlay(IResolver * resolver, WED_Airport  * apt, const str
 		cbs.AcceptProperty_f("sim/overlay", "1", writer);
 
 		DSF_ResourceTable	rsrc;
+		ortho_queue_t		orthos;
 		
 		int entities = 0;
 		for(int show_level = 6; show_level >= 1; --show_level)	
-			entities += DSF_ExportTileRecursive(apt, resolver, package, cull_bounds, safe_bounds, rsrc, &cbs, writer,problem_children,show_level);
+			entities += DSF_ExportTileRecursive(apt, resolver, package, cull_bounds, safe_bounds, rsrc, &cbs, writer,problem_children,show_level,orthos);
 
 		rsrc.write_tables(cbs,writer);
 
 		fclose(dsf);
-		return 1;
+		return ortho_finish_jobs(orthos, resolver) ? 1 : 0;
 	}
 	else
 		return 0;
@@ -252,7 +252,7 @@ const char * k_dsf_classes[] = {
 
 static bool has_3d(WED_Airport * who) { return has_any_of_class(who, k_3d_classes); }
 
-static bool has_dsf(WED_Airport * who) { return has_any_of_class(who, k_dsf_classes); }
+bool WED_AirportHasDSFContent(WED_Airport * who) { return has_any_of_class(who, k_dsf_classes); }
 
 //------------------------------------------------------------------------------------------------------------
 #pragma mark -
@@ -599,7 +599,7 @@ void WED_GatewayExportDialog::Submit()
 			FILE_delete_file(targ_folder_zip.c_str(), false);
 		}
 
-		if(has_dsf(apt))
+		if(WED_AirportHasDSFContent(apt))
 		if(DSF_ExportAirportOverlay(mResolver, apt, targ_folder, mProblemChildren))
 		{
 			// success.	
@@ -27,10 +27,14 @@
 #if HAS_GATEWAY
 class	IResolver;
 class	WED_Document;
+class	WED_Airport;
 
 int		WED_CanExportToGateway(IResolver * resolver);
 void	WED_DoExportToGateway(WED_Document * resolver);
 
+// True if the airport has anything that goes into the overlay DSF of a gateway upload, rather than the apt.dat.
+bool	WED_AirportHasDSFContent(WED_Airport * apt);
+
 #endif
 
 #endif
@@ -935,17 +935,23 @@ bool WED_GatewayImportDialog::StartVersionsDownload()
 	return true;
 }
 
-void WED_GatewayImportDialog::StartSpecificVersionDownload(int id, const string& icao)
+static void fill_specific_version_request(int id, const string& icao, WED_file_cache_request& req)
 {
 	stringstream url; 
 	url << WED_URL_GATEWAY_API << "scenery/" << id;
-	mCacheRequest.in_url = url.str();
+	req.in_url = url.str();
 
-	mCacheRequest.in_domain = cache_domain_scenery_pack;
+	req.in_domain = cache_domain_scenery_pack;
 	
 	stringstream ss;
 	ss << "scenery_packs" << DIR_STR << "GatewayImport" << DIR_STR << icao;
-	mCacheRequest.in_folder_prefix = ss.str();
+	req.in_folder_prefix = ss.str();
+}
+
+void WED_GatewayImportDialog::StartSpecificVersionDownload(int id, const string& icao)
+{
+	fill_specific_version_request(id, icao, mCacheRequest);
+	mCacheRequest.in_priority = cache_priority_interactive;
 
 	mRequestCount = 0;
 
@@ -967,6 +973,19 @@ bool WED_GatewayImportDialog::NextVersionsDownload()
 	//Start the download
 	StartSpecificVersionDownload(id,mVersions_Vers[*index].icao);
 
+	//First time through, queue up all the other packs too - the file cache fetches a few at once over one connection
+	//while we wait on this one, and each gets bumped up the queue when its turn comes.
+	if(mSpecificBufs.empty())
+	{
+		for(std::set<int>::iterator next = ++index; next != mVersions_VersionsSelected.end(); ++next)
+		{
+			WED_file_cache_request prefetch(mCacheRequest);
+			fill_specific_version_request(mVersions_Vers[*next].sceneryId, mVersions_Vers[*next].icao, prefetch);
+			prefetch.in_priority = cache_priority_prefetch;
+			WED_file_cache_request_file(prefetch);
+		}
+	}
+
 	//Erase that one off the queue
 	mVersions_VersionsSelected.erase(mVersions_VersionsSelected.begin());
 	return true;
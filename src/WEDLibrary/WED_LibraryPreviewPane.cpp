@@ -116,7 +116,7 @@ void WED_LibraryPreviewPane::SetResource(const string& r, int res_type)
 		pol_info_t pol;
 
 		mResMgr->GetPol(mRes,pol);
-		TexRef	tref = mTexMgr->LookupTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap) : tex_Compress_Ok);
+		TexRef	tref = mTexMgr->LookupTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap|tex_Thumbnail) : tex_Compress_Ok|tex_Thumbnail);
 		if (tref)
 		{
 			mTexMgr->GetTexInfo(tref,&tex_x,&tex_y,NULL, NULL, NULL, NULL);
@@ -257,7 +257,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 		case res_Polygon:
 			if(mResMgr->GetPol(mRes,pol))
 			{
-				TexRef	tref = mTexMgr->LookupTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap) : tex_Compress_Ok);
+				TexRef	tref = mTexMgr->LookupTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap|tex_Thumbnail) : tex_Compress_Ok|tex_Thumbnail);
 				if(tref != NULL)
 				{
 					int tex_id = mTexMgr->GetTexID(tref);
@@ -311,7 +311,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 		case res_Line:
 			if(mResMgr->GetLin(mRes,lin))
 			{
-				TexRef	tref = mTexMgr->LookupTexture(lin.base_tex.c_str(),true, tex_Compress_Ok);
+				TexRef	tref = mTexMgr->LookupTexture(lin.base_tex.c_str(),true, tex_Compress_Ok|tex_Thumbnail);
 				if(tref != NULL)
 				{
 					int tex_id = mTexMgr->GetTexID(tref);
@@ -454,7 +454,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 							(max_xy[1]+min_xy[1]) * 0.5);
 
 					g->SetState(false,1,false,true,true,false,false);
-					TexRef	ref = mTexMgr->LookupTexture(agp.base_tex.c_str() ,true, tex_Linear|tex_Mipmap|tex_Compress_Ok);			
+					TexRef	ref = mTexMgr->LookupTexture(agp.base_tex.c_str() ,true, tex_Linear|tex_Mipmap|tex_Compress_Ok|tex_Thumbnail);			
 					int id1 = ref  ? mTexMgr->GetTexID(ref ) : 0;
 					if(id1)g->BindTex(id1,0);
 
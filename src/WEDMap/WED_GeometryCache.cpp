@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "WED_GeometryCache.h"
+#include "WED_GISPolygon.h"
+#include "WED_MapZoomerNew.h"
+#include "WED_UIDefs.h"
+#include "MathUtils.h"
+#include <list>
+#if APL
+#include <OpenGL/gl.h>
+#include <OpenGL/glu.h>
+#else
+#include <GL/gl.h>
+#include <GL/glu.h>
+#endif
+
+#if !IBM
+#define CALLBACK
+#endif
+
+// Entries not drawn for this many frames get dropped.
+#define	MAX_IDLE_FRAMES		120
+
+/***************************************************************************************************************************************************
+ * KEYS
+ ***************************************************************************************************************************************************/
+
+// Half-octave buckets of pixels per meter.  Flattening is done for the top of the bucket so we never under-sample.
+static int		zoom_bucket(WED_MapZoomerNew * z)
+{
+	double ppm = z->GetPPM();
+	return ppm > 0.0 ? (int) floor(log(ppm) / log(2.0) * 2.0) : -1000;
+}
+
+static double	zoom_bucket_scale(WED_MapZoomerNew * z, int bucket)
+{
+	double ppm = z->GetPPM();
+	return ppm > 0.0 ? pow(2.0, (double) (bucket + 1) * 0.5) / ppm : 1.0;
+}
+
+static inline void	hash_bytes(unsigned long long& h, const void * p, int n)
+{
+	const unsigned char * c = (const unsigned char *) p;
+	while(n--)
+	{
+		h ^= *c++;
+		h *= 1099511628211ULL;
+	}
+}
+
+static inline void	hash_bezier(unsigned long long& h, const Bezier2& b, bool is_bez)
+{
+	hash_bytes(h, &is_bez, sizeof(is_bez));
+	hash_bytes(h, &b.p1, sizeof(Point2));
+	hash_bytes(h, &b.p2, sizeof(Point2));
+	if(is_bez)
+	{
+		hash_bytes(h, &b.c1, sizeof(Point2));
+		hash_bytes(h, &b.c2, sizeof(Point2));
+	}
+}
+
+static void	hash_ring(unsigned long long& h, IGISPointSequence * ps, bool has_uv)
+{
+	int n = ps->GetNumSides();
+	bool closed = ps->IsClosed();
+	hash_bytes(h, &n, sizeof(n));
+	hash_bytes(h, &closed, sizeof(closed));
+	for(int i = 0; i < n; ++i)
+	{
+		Bezier2 b;
+		bool is_bez = ps->GetSide(gis_Geo, i, b);
+		hash_bezier(h, b, is_bez);
+		if(has_uv)
+		{
+			is_bez = ps->GetSide(gis_UV, i, b);
+			hash_bezier(h, b, is_bez);
+		}
+	}
+}
+
+static unsigned long long	hash_polygon(WED_GISPolygon * poly, bool has_uv)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	int holes = poly->GetNumHoles();
+	hash_bytes(h, &holes, sizeof(holes));
+	hash_ring(h, poly->GetOuterRing(), has_uv);
+	for(int i = 0; i < holes; ++i)
+		hash_ring(h, poly->GetNthHole(i), has_uv);
+	return h;
+}
+
+/***************************************************************************************************************************************************
+ * BUILDING
+ ***************************************************************************************************************************************************/
+
+// This is PointSequenceToVector, but in LL, and with a fixed flattening density for the whole zoom bucket - we do not
+// drop detail from off-screen beziers since the result has to be good for any pan.
+static void	flatten_ring(IGISPointSequence * ps, WED_MapZoomerNew * z, double bucket_scale, bool has_uv, vector<Point2>& pts, vector<int>& contours, int is_hole)
+{
+	int n = ps->GetNumSides();
+	for (int i = 0; i < n; ++i)
+	{
+		Bezier2		b, buv;
+		if(has_uv) ps->GetSide(gis_UV,i,buv);
+		if (ps->GetSide(gis_Geo,i,b))
+		{
+			Point2 p1 = z->LLToPixel(b.p1), c1 = z->LLToPixel(b.c1), c2 = z->LLToPixel(b.c2), p2 = z->LLToPixel(b.p2);
+			double pixels_approx = (sqrt(Vector2(p1,c1).squared_length()) +
+									sqrt(Vector2(c1,c2).squared_length()) +
+									sqrt(Vector2(c2,p2).squared_length())) * bucket_scale;
+			int point_count = intlim(pixels_approx / BEZ_PIX_PER_SEG, BEZ_MIN_SEGS, BEZ_MAX_SEGS);
+
+			for (int k = 0; k < point_count; ++k)
+			{
+							pts.push_back(b.midpoint((float) k / (float) point_count));
+				if(has_uv)	pts.push_back(buv.midpoint((float) k / (float) point_count));
+				contours.push_back((k == 0 && i == 0) ? is_hole : 0);
+			}
+		}
+		else
+		{
+						pts.push_back(b.p1);
+			if(has_uv)	pts.push_back(buv.p1);
+			contours.push_back(i == 0 ? is_hole : 0);
+		}
+
+		if (i == n-1 && !ps->IsClosed())
+		{
+						pts.push_back(b.p2);
+			if(has_uv)	pts.push_back(buv.p2);
+			contours.push_back(0);
+		}
+	}
+}
+
+struct	tess_vert {
+	Point2	v[2];		// position, UV
+};
+
+struct	tess_collector {
+	vector<Point2> *	out;
+	bool				has_uv;
+	Point2				origin;
+	list<tess_vert>		made;		// vertices made up by the tessellator at crossings - list so pointers stay good.
+};
+
+// With an edge-flag callback installed, GLU only ever hands us independent triangles, which is exactly what we want.
+static void CALLBACK TessEdgeFlag(GLboolean flag, void * ref)	{ }
+static void CALLBACK TessVertex(void * vert, void * ref)
+{
+	tess_collector * c = (tess_collector *) ref;
+	const Point2 * p = (const Point2 *) vert;
+				c->out->push_back(p[0]);
+	if(c->has_uv)	c->out->push_back(p[1]);
+}
+
+static void CALLBACK TessCombine(GLdouble coords[3], void * vert[4], GLfloat weight[4], void ** out, void * ref)
+{
+	tess_collector * c = (tess_collector *) ref;
+	c->made.push_back(tess_vert());
+	tess_vert& nv = c->made.back();
+	nv.v[0] = Point2(coords[0] + c->origin.x(), coords[1] + c->origin.y());
+	if(c->has_uv)
+	for(int i = 0; i < 4; ++i)
+	if(vert[i])
+	{
+		const Point2 * uv = ((const Point2 *) vert[i]) + 1;
+		nv.v[1].x_ += weight[i] * uv->x();
+		nv.v[1].y_ += weight[i] * uv->y();
+	}
+	*out = nv.v;
+}
+
+static void	tessellate(const vector<Point2>& pts, const vector<int>& contours, bool has_uv, vector<Point2>& out_tris)
+{
+	int stride = has_uv ? 2 : 1;
+	int n = contours.size();
+
+	tess_collector c;
+	c.out = &out_tris;
+	c.has_uv = has_uv;
+	c.origin = pts[0];
+
+	GLUtesselator * tess = gluNewTess();
+
+	gluTessCallback(tess, GLU_TESS_EDGE_FLAG_DATA,	(void (CALLBACK *)(void))TessEdgeFlag);
+	gluTessCallback(tess, GLU_TESS_VERTEX_DATA,		(void (CALLBACK *)(void))TessVertex);
+	gluTessCallback(tess, GLU_TESS_COMBINE_DATA,	(void (CALLBACK *)(void))TessCombine);
+
+	// Feed the tessellator offsets from the first point - lat/lon differences at airport scale are tiny
+	// next to the coordinates themselves.
+	gluTessBeginPolygon(tess, &c);
+	for(int i = 0; i < n; ++i)
+	{
+		if(i == 0 || contours[i])
+		{
+			if(i) gluTessEndContour(tess);
+			gluTessBeginContour(tess);
+		}
+		const Point2 * p = &pts[i * stride];
+		double	xyz[3] = { p->x() - c.origin.x(), p->y() - c.origin.y(), 0 };
+		gluTessVertex(tess, xyz, (void *) p);
+	}
+	gluTessEndContour(tess);
+	gluTessEndPolygon(tess);
+	gluDeleteTess(tess);
+}
+
+/***************************************************************************************************************************************************
+ * CACHE
+ ***************************************************************************************************************************************************/
+
+WED_GeometryCache::WED_GeometryCache() : mFrame(0)
+{
+}
+
+WED_GeometryCache::~WED_GeometryCache()
+{
+}
+
+bool		WED_GeometryCache::GetPolygon(WED_GISPolygon * poly, bool has_uv, WED_MapZoomerNew * zoomer, int * out_handle, Point2 * out_centroid)
+{
+	int			id = poly->GetID();
+	long long	key = poly->GetArchive()->CacheKey();
+	int			bucket = zoom_bucket(zoomer);
+
+	poly_map::iterator e = mPolys.find(id);
+	bool	ok = false;
+	unsigned long long	h = 0;
+	bool	have_hash = false;
+
+	if(e != mPolys.end() && e->second.zoom_bucket == bucket && e->second.has_uv == has_uv)
+	{
+		if(e->second.archive_key == key)
+			ok = true;
+		else
+		{
+			h = hash_polygon(poly, has_uv);
+			have_hash = true;
+			ok = (h == e->second.geo_hash);
+		}
+	}
+
+	if(!ok)
+	{
+		if(!have_hash)
+			h = hash_polygon(poly, has_uv);
+		poly_entry& ne = mPolys[id];
+		ne.geo_hash = h;
+		ne.zoom_bucket = bucket;
+		ne.has_uv = has_uv;
+		ne.centroid = Point2();
+		ne.tris.clear();
+
+		vector<Point2>	pts;
+		vector<int>		contours;
+		double			bucket_scale = zoom_bucket_scale(zoomer, bucket);
+		flatten_ring(poly->GetOuterRing(), zoomer, bucket_scale, has_uv, pts, contours, 0);
+		int nh = poly->GetNumHoles();
+		for(int i = 0; i < nh; ++i)
+			flatten_ring(poly->GetNthHole(i), zoomer, bucket_scale, has_uv, pts, contours, 1);
+
+		if(!contours.empty())
+		{
+			int stride = has_uv ? 2 : 1;
+			for(int i = 0; i < pts.size(); i += stride)
+			{
+				ne.centroid.x_ += pts[i].x();
+				ne.centroid.y_ += pts[i].y();
+			}
+			ne.centroid.x_ /= (double) contours.size();
+			ne.centroid.y_ /= (double) contours.size();
+
+			tessellate(pts, contours, has_uv, ne.tris);
+		}
+		e = mPolys.find(id);
+	}
+
+	e->second.archive_key = key;
+	e->second.last_frame = mFrame;
+
+	if(e->second.tris.empty())
+		return false;
+
+	*out_handle = id;
+	if(out_centroid)
+		*out_centroid = zoomer->LLToPixel(e->second.centroid);
+	return true;
+}
+
+void		WED_GeometryCache::DrawPolygon(int handle, WED_MapZoomerNew * zoomer)
+{
+	poly_map::iterator e = mPolys.find(handle);
+	if(e == mPolys.end())
+		return;
+
+	// The zoomer is affine, so find its scale and offset once rather than calling it per vertex.
+	double	x0 = zoomer->LonToXPixel(0.0), xs = zoomer->LonToXPixel(1.0) - x0;
+	double	y0 = zoomer->LatToYPixel(0.0), ys = zoomer->LatToYPixel(1.0) - y0;
+
+	const vector<Point2>& src = e->second.tris;
+	bool has_uv = e->second.has_uv;
+	int stride = has_uv ? 2 : 1;
+
+	mScratch.resize(src.size());
+	for(int i = 0; i < src.size(); i += stride)
+	{
+		mScratch[i].x_ = x0 + src[i].x() * xs;
+		mScratch[i].y_ = y0 + src[i].y() * ys;
+		if(has_uv)
+			mScratch[i+1] = src[i+1];
+	}
+
+	glVertexPointer(2, GL_DOUBLE, sizeof(Point2) * stride, &mScratch[0]);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	if(has_uv)
+	{
+		glTexCoordPointer(2, GL_DOUBLE, sizeof(Point2) * 2, &mScratch[1]);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	}
+	else
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	glDrawArrays(GL_TRIANGLES, 0, src.size() / stride);
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+}
+
+void		WED_GeometryCache::EndFrame(void)
+{
+	++mFrame;
+	if(mFrame % MAX_IDLE_FRAMES) return;
+
+	for(poly_map::iterator e = mPolys.begin(); e != mPolys.end(); )
+	{
+		if(mFrame - e->second.last_frame > MAX_IDLE_FRAMES)
+			mPolys.erase(e++);
+		else
+			++e;
+	}
+}
+
+void		WED_GeometryCache::Purge(void)
+{
+	mPolys.clear();
+}
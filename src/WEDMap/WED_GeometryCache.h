@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef WED_GeometryCache_H
+#define WED_GeometryCache_H
+
+#include "CompGeomDefs2.h"
+
+class	WED_GISPolygon;
+class	WED_MapZoomerNew;
+
+/*
+
+	WED_GeometryCache - THEORY OF OPERATION
+
+	The preview layer used to flatten every bezier and run every pavement polygon through the GLU tessellator
+	on every single frame, then push the triangles out one glVertex at a time.  For a big airport that is most
+	of the frame time, and none of it changes when you pan.
+
+	The cache keeps, per polygon entity, the flattened outline and the tessellated triangles in LAT/LON.  The
+	zoomer's LL->pixel mapping is affine (a scale and offset on each axis), so flattening and tessellating in
+	LL gives the same triangles we would get in pixels - we just run the cached vertices through the current
+	mapping into a scratch array and hand that to glDrawArrays.  Panning never rebuilds anything.
+
+	Bezier flattening does depend on zoom (we want ~BEZ_PIX_PER_SEG pixels per segment), so entries are built
+	for a zoom bucket (half an octave of pixels-per-meter) and rebuilt when we change buckets.
+
+	WED has no per-object edit counter (and a polygon's geometry lives in its child nodes anyway), so an entry
+	is validated like this: if the archive hasn't changed at all since we last looked, the entry is good.  If it
+	has, we hash the polygon's control points and compare to the hash we built with - much cheaper than
+	rebuilding, and it catches undo/redo too.
+
+	Entries that haven't been drawn for a while are dropped, which also takes care of deleted entities.
+
+	We use client-side vertex arrays rather than VBOs - WED only requires GL 1.1 and we do not load the buffer
+	object entry points on Windows; the cost that matters here was the rebuilding, not the bus.
+
+*/
+
+class	WED_GeometryCache {
+public:
+
+						 WED_GeometryCache();
+						~WED_GeometryCache();
+
+	// Fetch the polygon's geometry, building it if needed.  Returns false if the polygon has nothing to draw.
+	// centroid (optional) gets the pixel-space average of the outline, which is what pavement texturing aligns to.
+	// The returned handle is valid until the next call to EndFrame.
+			bool		GetPolygon(WED_GISPolygon * poly, bool has_uv, WED_MapZoomerNew * zoomer, int * out_handle, Point2 * out_centroid);
+
+	// Fill the polygon's triangles with the current GL state.
+			void		DrawPolygon(int handle, WED_MapZoomerNew * zoomer);
+
+	// Call once per redraw, after all drawing; ages out entries we haven't used lately.
+			void		EndFrame(void);
+
+			void		Purge(void);
+
+private:
+
+	struct	poly_entry {
+		long long			archive_key;		// Archive cache key the last time we checked this entry.
+		unsigned long long	geo_hash;			// Hash of the control points we built from.
+		int					zoom_bucket;
+		bool				has_uv;
+		int					last_frame;
+		Point2				centroid;			// LL
+		vector<Point2>		tris;				// LL, 3 per triangle, each followed by its UV if has_uv.
+	};
+
+	typedef hash_map<int, poly_entry>	poly_map;
+
+	poly_map			mPolys;
+	vector<Point2>		mScratch;
+	int					mFrame;
+
+};
+
+#endif /* WED_GeometryCache_H */
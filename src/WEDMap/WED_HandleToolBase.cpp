@@ -586,6 +586,11 @@ void WED_HandleToolBase::ProcessSelectionRecursive(
 	Point2	psel; if(pt_sel) psel = bounds.centroid();
 	double	frame_dist  = icon_dist_v/2;
 
+	// The area in which a child's (unexpanded) bounds must fall to pass the reach test below - we hand this to big composites
+	// so they can skip children from their spatial index rather than us recursing into each one.
+	Bbox2	reach(pt_sel ? Bbox2(psel) : bounds);
+	reach.expand(icon_dist_h,icon_dist_v);
+
 	{   //  speedup: do not traverse into entities which have their own bounding box already out of reach
 		Bbox2	ent_bounds;
 		entity->GetBounds(gis_Geo,ent_bounds);
@@ -626,9 +631,10 @@ void WED_HandleToolBase::ProcessSelectionRecursive(
 
 		if (com)
 		{
-			int count = com->GetNumEntities();
-			for (int n = 0; n < count; ++n)
-				ProcessSelectionRecursive(com->GetNthEntity(n),bounds,pt_sel, icon_dist_h, icon_dist_v, result);
+			vector<int> near;
+			com->GetEntitiesNear(reach, near);
+			for (vector<int>::iterator n = near.begin(); n != near.end(); ++n)
+				ProcessSelectionRecursive(com->GetNthEntity(*n),bounds,pt_sel, icon_dist_h, icon_dist_v, result);
 		}
 		else if (seq)
 		{
@@ -649,9 +655,10 @@ void WED_HandleToolBase::ProcessSelectionRecursive(
 			result.insert(entity); 
 		else if (com)
 		{
-			int count = com->GetNumEntities();
-			for (int n = 0; n < count; ++n)
-				ProcessSelectionRecursive(com->GetNthEntity(n),bounds,pt_sel, icon_dist_h, icon_dist_v, result);
+			vector<int> near;
+			com->GetEntitiesNear(reach, near);
+			for (vector<int>::iterator n = near.begin(); n != near.end(); ++n)
+				ProcessSelectionRecursive(com->GetNthEntity(*n),bounds,pt_sel, icon_dist_h, icon_dist_v, result);
 		}
 		else if (seq)
 		{
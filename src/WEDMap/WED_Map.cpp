@@ -329,9 +329,10 @@ void		WED_Map::DrawVisFor(WED_MapLayer * layer, int current, const Bbox2& bounds
 		Vector2 span(p1,p2);
 		if(max(span.dx, span.dy) > TOO_SMALL_TO_GO_IN || (p1 == p2) || depth == 0)		// Why p1 == p2?  If the composite contains ONLY ONE POINT it is zero-size.  We'd LOD out.  But if it contains one thing
 		{																				// then we might as well ALWAYS draw it - it's relatively cheap!
-			int t = c->GetNumEntities();												// Depth == 0 means we draw ALL top level objects -- good for airports.
-			for (int n = t-1; n >= 0; --n)
-				DrawVisFor(layer, current, bounds, c->GetNthEntity(n), g, sel, depth+1);
+			vector<int> near;															// Depth == 0 means we draw ALL top level objects -- good for airports.
+			c->GetEntitiesNear(bounds, near);											// Only visit kids the composite's index says might be on screen.
+			for (vector<int>::reverse_iterator n = near.rbegin(); n != near.rend(); ++n)
+				DrawVisFor(layer, current, bounds, c->GetNthEntity(*n), g, sel, depth+1);
 		}
 	}
 }
@@ -355,9 +356,10 @@ void		WED_Map::DrawStrFor(WED_MapLayer * layer, int current, const Bbox2& bounds
 		Vector2 span(p1,p2);
 		if(max(span.dx, span.dy) > TOO_SMALL_TO_GO_IN || (p1 == p2) || depth == 0)
 		{
-			int t = c->GetNumEntities();
-			for (int n = t-1; n >= 0; --n)
-				DrawStrFor(layer, current, bounds, c->GetNthEntity(n), g, sel, depth+1);
+			vector<int> near;
+			c->GetEntitiesNear(bounds, near);
+			for (vector<int>::reverse_iterator n = near.rbegin(); n != near.rend(); ++n)
+				DrawStrFor(layer, current, bounds, c->GetNthEntity(*n), g, sel, depth+1);
 		}
 	}
 }
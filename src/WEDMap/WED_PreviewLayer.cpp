@@ -34,6 +34,7 @@
 #include "WED_ToolUtils.h"
 #include "WED_MapZoomerNew.h"
 #include "WED_DrawUtils.h"
+#include "WED_GeometryCache.h"
 #include "WED_Runway.h"
 #include "WED_Taxiway.h"
 #include "WED_Sealane.h"
@@ -138,7 +139,7 @@ static void kill_taxi_texture(void)
 
 static bool setup_pol_texture(ITexMgr * tman, pol_info_t& pol, double heading, bool no_proj, const Point2& centroid, GUI_GraphState * g, WED_MapZoomerNew * z, float alpha)
 {
-	TexRef	ref = tman->LookupTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap|tex_Always_Pad) : tex_Compress_Ok|tex_Always_Pad);
+	TexRef	ref = tman->LookupTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap|tex_Always_Pad|tex_Async) : tex_Compress_Ok|tex_Always_Pad|tex_Async);
 	if(ref == NULL) return false;
 	int tex_id = tman->GetTexID(ref);
 
@@ -272,8 +273,8 @@ static ObjDrawFuncs10_t kFuncs  = { Obj_SetupPoly, Obj_SetupLine, Obj_SetupLight
 
 void draw_obj_at_ll(ITexMgr * tman, XObj8 * o, const Point2& loc, float r, GUI_GraphState * g, WED_MapZoomerNew * zoomer)
 {
-	TexRef	ref = tman->LookupTexture(o->texture.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);			
-	TexRef	ref2 = o->texture_draped.empty() ? ref : tman->LookupTexture(o->texture_draped.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);
+	TexRef	ref = tman->LookupTexture(o->texture.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad|tex_Async);			
+	TexRef	ref2 = o->texture_draped.empty() ? ref : tman->LookupTexture(o->texture_draped.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad|tex_Async);
 	int id1 = ref  ? tman->GetTexID(ref ) : 0;
 	int id2 = ref2 ? tman->GetTexID(ref2) : 0;
 	g->SetTexUnits(1);
@@ -435,38 +436,24 @@ struct	preview_sealane : public WED_PreviewItem {
 
 struct	preview_taxiway : public WED_PreviewItem {
 	WED_Taxiway * taxi;	
-	preview_taxiway(WED_Taxiway * t, int l) : WED_PreviewItem(l), taxi(t) { }
+	WED_GeometryCache * cache;
+	preview_taxiway(WED_Taxiway * t, int l, WED_GeometryCache * c) : WED_PreviewItem(l), taxi(t), cache(c) { }
 	virtual void draw_it(WED_MapZoomerNew * zoomer, GUI_GraphState * g, float mPavementAlpha)
 	{
 		// I tried "LODing" out the solid pavement, but the margin between when the pavement can disappear and when the whole
 		// airport can is tiny...most pavement is, while visually insignificant, still sprawling, so a bbox-sizes test is poor.
 		// Any other test is too expensive, and for the small pavement squares that would get wiped out, the cost of drawing them
 		// is negligable anyway.
-		vector<Point2>	pts;
-		vector<int>		is_hole_start;
-
-		PointSequenceToVector(taxi->GetOuterRing(), zoomer, pts, false, is_hole_start, 0);
-		int n = taxi->GetNumHoles();
-		for (int i = 0; i < n; ++i)
-			PointSequenceToVector(taxi->GetNthHole(i), zoomer, pts, false, is_hole_start, 1);
-
-		if (!pts.empty())
+		int		geo;
+		Point2	centroid;
+		if (cache->GetPolygon(taxi, false, zoomer, &geo, &centroid))
 		{
-			Point2 centroid(0,0);
-			for (int i = 0; i < pts.size(); ++i)
-			{
-				centroid.x_ += pts[i].x();
-				centroid.y_ += pts[i].y();
-			}
-			centroid.x_ /= (double) pts.size();
-			centroid.y_ /= (double) pts.size();
-
 //					glColor4fv(WED_Color_Surface(taxi->GetSurface(), mPavementAlpha, storage));
 			if (setup_taxi_texture(taxi->GetSurface(), taxi->GetHeading(), centroid, g, zoomer, mPavementAlpha))
 			{
 //						glDisable(GL_CULL_FACE);
 				glFrontFace(GL_CCW);
-				glPolygon2(&*pts.begin(),false,  &*is_hole_start.begin(), pts.size());
+				cache->DrawPolygon(geo, zoomer);
 				glFrontFace(GL_CW);
 //						glEnable(GL_CULL_FACE);
 			}
@@ -479,30 +466,15 @@ struct	preview_taxiway : public WED_PreviewItem {
 struct	preview_polygon : public WED_PreviewItem {
 	WED_GISPolygon * pol;
  	bool has_uv;
-	preview_polygon(WED_GISPolygon * p, int l, bool uv) : WED_PreviewItem(l), pol(p), has_uv(uv) { }
+	WED_GeometryCache * cache;
+	preview_polygon(WED_GISPolygon * p, int l, bool uv, WED_GeometryCache * c) : WED_PreviewItem(l), pol(p), has_uv(uv), cache(c) { }
 	virtual void draw_it(WED_MapZoomerNew * zoomer, GUI_GraphState * g, float mPavementAlpha)
 	{
-			vector<Point2>	pts;
-			vector<int>		is_hole_start;
-
-		PointSequenceToVector(pol->GetOuterRing(), zoomer, pts, has_uv, is_hole_start, 0);
-		int n = pol->GetNumHoles();
-		for (int i = 0; i < n; ++i)
-			PointSequenceToVector(pol->GetNthHole(i), zoomer, pts, has_uv, is_hole_start, 1);
-
-		if (!pts.empty())
+		int geo;
+		if (cache->GetPolygon(pol, has_uv, zoomer, &geo, NULL))
 		{
-			Point2 centroid(0,0);
-			for (int i = 0; i < pts.size(); ++i)
-			{
-				centroid.x_ += pts[i].x();
-				centroid.y_ += pts[i].y();
-			}
-			centroid.x_ /= (double) pts.size();
-			centroid.y_ /= (double) pts.size();
-
 			glFrontFace(GL_CCW);
-			glPolygon2(&*pts.begin(), has_uv, &*is_hole_start.begin(), pts.size() / (has_uv ? 2 : 1));
+			cache->DrawPolygon(geo, zoomer);
 			glFrontFace(GL_CW);
 		}
 	}
@@ -510,7 +482,7 @@ struct	preview_polygon : public WED_PreviewItem {
 
 struct	preview_forest : public preview_polygon {
 	WED_ForestPlacement * fst;	
-	preview_forest(WED_ForestPlacement * f, int l) : preview_polygon(f,l,false), fst(f) { }
+	preview_forest(WED_ForestPlacement * f, int l, WED_GeometryCache * c) : preview_polygon(f,l,false,c), fst(f) { }
 	virtual void draw_it(WED_MapZoomerNew * zoomer, GUI_GraphState * g, float mPavementAlpha)
 	{
 		g->SetState(false,0,false,false,false,false,false);
@@ -589,7 +561,7 @@ struct	preview_line : WED_PreviewItem {
 		if (!rmgr->GetLin(vpath,linfo)) return;
 
 		ITexMgr *	tman = WED_GetTexMgr(resolver);
-		TexRef tref = tman->LookupTexture(linfo.base_tex.c_str(),true,tex_Compress_Ok);
+		TexRef tref = tman->LookupTexture(linfo.base_tex.c_str(),true,tex_Compress_Ok|tex_Async);
 		int tex_id = 0;
 		if(tref) tex_id = tman->GetTexID(tref);
 
@@ -764,7 +736,7 @@ struct	preview_airportlines : WED_PreviewItem {
 			if (lmgr->GetLineVpath(t, vpath))
 				if (rmgr->GetLin(vpath, linfo))
 				{
-					TexRef tref = tman->LookupTexture(linfo.base_tex.c_str(),true,tex_Compress_Ok);
+					TexRef tref = tman->LookupTexture(linfo.base_tex.c_str(),true,tex_Compress_Ok|tex_Async);
 					if(tref) tex_id = tman->GetTexID(tref);
 				}
 			
@@ -889,7 +861,7 @@ struct	preview_airportlights : WED_PreviewItem {
 
 struct	preview_facade : public preview_polygon {
 	WED_FacadePlacement * fac;	
-	preview_facade(WED_FacadePlacement * f, int l) : preview_polygon(f,l,false), fac(f) { }
+	preview_facade(WED_FacadePlacement * f, int l, WED_GeometryCache * c) : preview_polygon(f,l,false,c), fac(f) { }
 	virtual void draw_it(WED_MapZoomerNew * zoomer, GUI_GraphState * g, float mPavementAlpha)
 	{
 		g->SetState(false,0,false,false, false,false,false);
@@ -950,7 +922,7 @@ struct	preview_facade : public preview_polygon {
 struct	preview_pol : public preview_polygon {
 	WED_PolygonPlacement * pol;
 	IResolver * resolver;
-	preview_pol(WED_PolygonPlacement * p, int l, IResolver * r) : preview_polygon(p,l,false), pol(p), resolver(r) { }
+	preview_pol(WED_PolygonPlacement * p, int l, IResolver * r, WED_GeometryCache * c) : preview_polygon(p,l,false,c), pol(p), resolver(r) { }
 	virtual void draw_it(WED_MapZoomerNew * zoomer, GUI_GraphState * g, float mPavementAlpha)
 	{
 		WED_ResourceMgr * rmgr = WED_GetResourceMgr(resolver);
@@ -977,7 +949,7 @@ struct	preview_pol : public preview_polygon {
 struct	preview_ortho : public preview_polygon {
 	WED_DrapedOrthophoto * orth;	
 	IResolver * resolver;
-	preview_ortho(WED_DrapedOrthophoto * o, int l, IResolver * r) : preview_polygon(o,l,true), orth(o), resolver(r) { }
+	preview_ortho(WED_DrapedOrthophoto * o, int l, IResolver * r, WED_GeometryCache * c) : preview_polygon(o,l,true,c), orth(o), resolver(r) { }
 	virtual void draw_it(WED_MapZoomerNew * zoomer, GUI_GraphState * g, float mPavementAlpha)
 	{
 		WED_ResourceMgr * rmgr = WED_GetResourceMgr(resolver);
@@ -990,15 +962,11 @@ struct	preview_ortho : public preview_polygon {
 		{
 			//Set the graph state to default
 			g->SetState(false,0,false,false,false,false,false);
-			//Get the ring's points
-			vector<Point2> pts;
-			vector<int> is_hole_start;
-			PointSequenceToVector(orth->GetOuterRing(), zoomer, pts, has_uv, is_hole_start, 0);
 
 			//Get the resource string and look it up
 			string tempResource = "";
 			orth->GetResource(tempResource);
-			TexRef ref = tman->LookupTexture(tempResource.c_str(),false,tex_Linear|tex_Mipmap|tex_Rescale);
+			TexRef ref = tman->LookupTexture(tempResource.c_str(),false,tex_Linear|tex_Mipmap|tex_Rescale|tex_Async);
 			
 			//If there is no texture exit early
 			if(ref == NULL) 
@@ -1162,7 +1130,7 @@ struct	preview_object : public WED_PreviewItem {
 			if(!cull_agp(zoomer, &agp, loc, obj->GetHeading()))
 			{
 				g->SetState(false,1,false,true,true,false,false);
-				TexRef	ref = tman->LookupTexture(agp.base_tex.c_str() ,true, tex_Linear|tex_Mipmap|tex_Compress_Ok|tex_Always_Pad);			
+				TexRef	ref = tman->LookupTexture(agp.base_tex.c_str() ,true, tex_Linear|tex_Mipmap|tex_Compress_Ok|tex_Always_Pad|tex_Async);			
 				int id1 = ref  ? tman->GetTexID(ref ) : 0;
 				if(id1)g->BindTex(id1,0);
 				glMatrixMode(GL_MODELVIEW);
@@ -1324,12 +1292,16 @@ WED_PreviewLayer::WED_PreviewLayer(GUI_Pane * host, WED_MapZoomerNew * zoomer, I
 	mObjDensity(6),
 	mRunwayLayer(group_RunwaysBegin),
 	mTaxiLayer(group_TaxiwaysBegin),
-	mShoulderLayer(group_ShouldersBegin)
+	mShoulderLayer(group_ShouldersBegin),
+	mPendingTextures(0),
+	mTextureTimer(false)
 {
+	mGeometryCache = new WED_GeometryCache;
 }
 
 WED_PreviewLayer::~WED_PreviewLayer()
 {
+	delete mGeometryCache;
 }
 
 void		WED_PreviewLayer::GetCaps						(bool& draw_ent_v, bool& draw_ent_s, bool& cares_about_sel, bool& wants_clicks)
@@ -1377,7 +1349,7 @@ bool		WED_PreviewLayer::DrawEntityVisualization		(bool inCurrent, IGISEntity * e
 	if(sea)		mPreviewItems.push_back(new preview_sealane(sea,mRunwayLayer++));
 	if(taxi)	
 	{
-		mPreviewItems.push_back(new preview_taxiway(taxi,mTaxiLayer++));
+		mPreviewItems.push_back(new preview_taxiway(taxi,mTaxiLayer++,mGeometryCache));
 		
 		double ppm = GetZoomer()->GetPPM();       // there can be so many, make visibility decision here already for performance
 
@@ -1415,13 +1387,13 @@ bool		WED_PreviewLayer::DrawEntityVisualization		(bool inCurrent, IGISEntity * e
 	if(!vpath.empty() && rmgr->GetPol(vpath,pol_info) && !pol_info.group.empty())
 			lg = layer_group_for_string(pol_info.group.c_str(),pol_info.group_offset, lg);
 	if(pol)
-		mPreviewItems.push_back(new preview_pol(pol,lg, GetResolver()));
+		mPreviewItems.push_back(new preview_pol(pol,lg, GetResolver(), mGeometryCache));
 	if(orth)
-		mPreviewItems.push_back(new preview_ortho(orth,lg, GetResolver()));
+		mPreviewItems.push_back(new preview_ortho(orth,lg, GetResolver(), mGeometryCache));
 	if(fac && fac->GetShowLevel() <= mObjDensity)
-		mPreviewItems.push_back(new preview_facade(fac,group_Objects));
+		mPreviewItems.push_back(new preview_facade(fac,group_Objects,mGeometryCache));
 	if(forst)
-		mPreviewItems.push_back(new preview_forest(forst, group_Objects));
+		mPreviewItems.push_back(new preview_forest(forst, group_Objects, mGeometryCache));
 
 	if(sub_class == WED_LinePlacement::sClass)
 	{
@@ -1474,10 +1446,31 @@ void		WED_PreviewLayer::DrawVisualization			(bool inCurent, GUI_GraphState * g)
 		delete *i;
 	}
 	mPreviewItems.clear();
+	mGeometryCache->EndFrame();
 	mRunwayLayer=	group_RunwaysBegin;
 	mTaxiLayer=		group_TaxiwaysBegin;
 	mShoulderLayer=	group_ShouldersBegin;
-	
+
+	mPendingTextures = WED_GetTexMgr(GetResolver())->CountPendingLoads();
+	if(mPendingTextures && !mTextureTimer)
+	{
+		Start(0.1);
+		mTextureTimer = true;
+	}
+}
+
+void		WED_PreviewLayer::TimerFired(void)
+{
+	// Textures that finished decoding get uploaded the next time they are drawn, so redraw whenever some came in.
+	int pending = WED_GetTexMgr(GetResolver())->CountPendingLoads();
+	if(pending != mPendingTextures)
+		GetHost()->Refresh();
+	mPendingTextures = pending;
+	if(pending == 0)
+	{
+		Stop();
+		mTextureTimer = false;
+	}
 }
 
 void		WED_PreviewLayer::SetPavementTransparency(float alpha)
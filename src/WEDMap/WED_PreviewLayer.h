@@ -25,9 +25,11 @@
 #define WED_PreviewLayer_H
 
 #include "WED_MapLayer.h"
+#include "GUI_Timer.h"
 
 struct	XObj8;
 class	ITexMgr;
+class	WED_GeometryCache;
 
 // We need int values for layer groups - these weird numbers actually came out of X-Plane's internal engine...who knew.
 // The important thing is that the spacing is enough to ensure separation even when we have lots of runways or taxiways.
@@ -64,7 +66,7 @@ struct	WED_PreviewItem {
 };
 
 
-class WED_PreviewLayer  : public WED_MapLayer {
+class WED_PreviewLayer  : public WED_MapLayer, public GUI_Timer {
 public:
 
 						 WED_PreviewLayer(GUI_Pane * host, WED_MapZoomerNew * zoomer, IResolver * resolver);
@@ -79,10 +81,19 @@ public:
 	virtual	void		GetCaps						(bool& draw_ent_v, bool& draw_ent_s, bool& cares_about_sel, bool& wants_clicks);
 	virtual	void		DrawVisualization			(bool inCurent, GUI_GraphState * g);
 
+	virtual	void		TimerFired(void);
+
 private:
 
 	float							mPavementAlpha;
 	int								mObjDensity;
+
+	// Flattened/tessellated polygons, kept across redraws.
+	WED_GeometryCache *				mGeometryCache;
+
+	// Textures are loaded in the background; while any are pending we poll and redraw as they come in.
+	int								mPendingTextures;
+	bool							mTextureTimer;
 	
 	// This stuff is built temporarily between the entity and final draw.
 	vector<WED_PreviewItem *>	mPreviewItems;
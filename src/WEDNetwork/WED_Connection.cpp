@@ -29,7 +29,7 @@
 
 WED_Connection::WED_Connection(PCSBSocket* inSocket) :
 
-	mWaitCntr(0),HasClient(false) ,mSocket(inSocket)
+	mWaitCntr(0),HasClient(false),frame_version(0),mSocket(inSocket)
 {
 
 }
@@ -50,6 +50,7 @@ private:
 
 		int			ident;
 		int			rev;
+		int			frame_version;		// 0 = text only
 		string		name;
 
 	vector<char>	mOutBuf;			// Outgoing buffer
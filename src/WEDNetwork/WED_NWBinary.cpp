@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#if WITHNWLINK
+
+#include "WED_NWBinary.h"
+
+static inline unsigned long long	zig(long long v)			{ return ((unsigned long long) v << 1) ^ (unsigned long long) (v >> 63); }
+static inline long long				zag(unsigned long long v)	{ return (long long) (v >> 1) ^ -(long long) (v & 1); }
+
+//--Writer---------------------------------------------------------------------
+
+WED_NWFrameWriter::WED_NWFrameWriter() : mLastId(0), mLastX(0), mLastY(0)
+{
+	mPayload.reserve(4096);
+}
+
+void	WED_NWFrameWriter::Record(int rec, int objtype)
+{
+	mPayload.push_back((char) (rec | (objtype << 4)));
+}
+
+void	WED_NWFrameWriter::Id(int id)
+{
+	Int((long long) id - mLastId);
+	mLastId = id;
+}
+
+void	WED_NWFrameWriter::Point(long long x, long long y)
+{
+	Int(x - mLastX);
+	Int(y - mLastY);
+	mLastX = x;
+	mLastY = y;
+}
+
+void	WED_NWFrameWriter::UInt(unsigned long long v)
+{
+	while(v >= 0x80)
+	{
+		mPayload.push_back((char) (v | 0x80));
+		v >>= 7;
+	}
+	mPayload.push_back((char) v);
+}
+
+void	WED_NWFrameWriter::Int(long long v)
+{
+	UInt(zig(v));
+}
+
+void	WED_NWFrameWriter::Str(const string& s)
+{
+	UInt(s.size());
+	mPayload.insert(mPayload.end(), s.begin(), s.end());
+}
+
+void	WED_NWFrameWriter::Finish(vector<char>& out)
+{
+	unsigned int len = mPayload.size();
+	char hdr[NW_FRAME_HDR_SIZE] = { (char) NW_FRAME_MAGIC, NW_FRAME_VERSION,
+		(char) len, (char) (len >> 8), (char) (len >> 16), (char) (len >> 24) };
+	out.insert(out.end(), hdr, hdr + NW_FRAME_HDR_SIZE);
+	out.insert(out.end(), mPayload.begin(), mPayload.end());
+
+	mPayload.clear();
+	mLastId = 0;
+	mLastX = mLastY = 0;
+}
+
+//--Reader---------------------------------------------------------------------
+
+int		WED_NWFrameReader::FrameSize(const char * buf, int len)
+{
+	if(len < 1) return 0;
+	if((unsigned char) buf[0] != NW_FRAME_MAGIC) return -1;
+	if(len < NW_FRAME_HDR_SIZE) return 0;
+	const unsigned char * p = (const unsigned char *) buf;
+	unsigned int payload = p[2] | (p[3] << 8) | (p[4] << 16) | ((unsigned int) p[5] << 24);
+	if(payload > len - NW_FRAME_HDR_SIZE) return 0;
+	return payload + NW_FRAME_HDR_SIZE;
+}
+
+WED_NWFrameReader::WED_NWFrameReader(const char * frame, int len) :
+	mPos((const unsigned char *) frame + NW_FRAME_HDR_SIZE),
+	mEnd((const unsigned char *) frame + len),
+	mOk(len >= NW_FRAME_HDR_SIZE && frame[1] == NW_FRAME_VERSION),
+	mLastId(0), mLastX(0), mLastY(0)
+{
+	if(!mOk) mPos = mEnd;
+}
+
+int		WED_NWFrameReader::Record(int& out_objtype)
+{
+	if(mPos >= mEnd) { mOk = false; return 0; }
+	int tag = *mPos++;
+	out_objtype = tag >> 4;
+	return tag & 0x0F;
+}
+
+int		WED_NWFrameReader::Id(void)
+{
+	mLastId += (int) Int();
+	return mLastId;
+}
+
+void	WED_NWFrameReader::Point(long long& out_x, long long& out_y)
+{
+	out_x = mLastX += Int();
+	out_y = mLastY += Int();
+}
+
+unsigned long long	WED_NWFrameReader::UInt(void)
+{
+	unsigned long long v = 0;
+	for(int shift = 0; shift < 64; shift += 7)
+	{
+		if(mPos >= mEnd) break;
+		unsigned char c = *mPos++;
+		v |= (unsigned long long) (c & 0x7F) << shift;
+		if(!(c & 0x80))
+			return v;
+	}
+	// Ran off the end of the frame or the varint is too long - the frame is garbage.
+	mOk = false;
+	mPos = mEnd;
+	return 0;
+}
+
+long long	WED_NWFrameReader::Int(void)
+{
+	return zag(UInt());
+}
+
+string	WED_NWFrameReader::Str(void)
+{
+	unsigned long long len = UInt();
+	if(len > (unsigned long long) (mEnd - mPos))
+	{
+		mOk = false;
+		mPos = mEnd;
+		return string();
+	}
+	string s((const char *) mPos, (const char *) mPos + len);
+	mPos += len;
+	return s;
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef WED_NWBINARY_H
+#define WED_NWBINARY_H
+
+#include "WED_NWDefs.h"
+#include <math.h>
+
+/*
+	WED_NWBinary - THEORY OF OPERATION
+
+	The text protocol spends ~60 bytes and a handful of sprintfs on every object that changes.  Drag a selection of a few
+	hundred objects and every timer tick sends a few hundred of those lines, and the sim side spends its frame in sscanf.
+
+	A binary frame carries everything one DoSendData has to say.  Inside a frame:
+
+	- Numbers are varints, so small numbers are small.  Signed numbers are zig-zag coded first.
+	- Ids are written as the difference to the previous id in the frame; we write records in id order, so a run of
+	  objects costs a byte or two per id.
+	- Coordinates are fixed point (NW_COORD_SCALE, the precision the text lines print) and written as the difference
+	  to the previous coordinate on the same axis in the frame, so a cluster of objects costs a few bytes per point.
+	- A move record says "these ids all moved by dx,dy" - that is what a drag of a selection is, and it costs one byte
+	  or so per object no matter how large the selection is.
+
+	Both the id and the coordinate "pen" start at 0 at the top of each frame, so frames decode on their own.
+
+	Record layouts, after the tag byte (see WED_NWDefs.h).  [] is present if the flag is set:
+
+	add/chg nw_obj_Object		id flags x y [msl] hdg [name resource]				flags: 1 = msl, 2 = names
+	add/chg nw_obj_Facade		id flags height [name resource]						flags: 2 = names
+	add/chg nw_obj_FacadeRing	id parent pos name
+	add/chg nw_obj_FacadeNode	id flags x y [hi.x hi.y lo.x lo.y] [parent pos name]	flags: 2 = names, 4 = handles
+	del							count id...
+	move						dx dy count id...		each object and its handles shift by dx,dy (NOT pen coded)
+	cam							lat lon alt pitch roll hdg	(absolute, NOT pen coded)
+
+	x/y are lon/lat in NW_COORD_SCALE units, parent is a plain id; hdg, height and the camera fields are in hundredths,
+	msl in thousandths.
+*/
+
+#define NW_COORD_SCALE		1e8
+#define NW_HUNDREDTHS		1e2
+#define NW_THOUSANDTHS		1e3
+
+#define NW_OBJ_FLAG_MSL		1
+#define NW_OBJ_FLAG_NAMES	2
+#define NW_OBJ_FLAG_HANDLES	4
+
+// Largest payload we put in one frame before starting a new one - keeps the sim side's per-frame work bounded.
+#define NW_MAX_PAYLOAD		65536
+
+inline long long	WED_NWFixed(double v, double scale) { return (long long) floor(v * scale + 0.5); }
+
+class	WED_NWFrameWriter {
+public:
+					WED_NWFrameWriter();
+
+		void		Record(int rec, int objtype);
+		void		Id(int id);
+		void		Point(long long x, long long y);
+		void		UInt(unsigned long long v);
+		void		Int(long long v);
+		void		Str(const string& s);
+
+		bool		Empty(void) const { return mPayload.empty(); }
+		int			Size(void) const { return mPayload.size(); }
+
+		// Appends the frame to out and starts the next one.
+		void		Finish(vector<char>& out);
+
+private:
+	vector<char>	mPayload;
+	int				mLastId;
+	long long		mLastX;
+	long long		mLastY;
+};
+
+// The reading side - the sim plugin's half of the protocol, kept here so both halves live in one place.
+class	WED_NWFrameReader {
+public:
+
+	// If buf starts with a complete frame, returns its total size; 0 if it needs more bytes, -1 if it is not a frame.
+	static int		FrameSize(const char * buf, int len);
+
+					WED_NWFrameReader(const char * frame, int len);		// A complete frame, header and all.
+
+		bool		Done(void) const { return mPos >= mEnd; }
+		bool		Ok(void) const { return mOk; }
+
+		int			Record(int& out_objtype);
+		int			Id(void);
+		void		Point(long long& out_x, long long& out_y);
+		unsigned long long	UInt(void);
+		long long	Int(void);
+		string		Str(void);
+
+private:
+	const unsigned char *	mPos;
+	const unsigned char *	mEnd;
+	bool					mOk;
+	int						mLastId;
+	long long				mLastX;
+	long long				mLastY;
+};
+
+#endif /* WED_NWBINARY_H */
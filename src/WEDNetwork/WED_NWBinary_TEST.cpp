@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+
+#if WITHNWLINK
+
+#include "WED_NWBinary.h"
+#include "WED_NWLinkAdapter.h"
+#include "WED_Archive.h"
+#include "WED_UndoLayer.h"
+#include "WED_Group.h"
+#include "WED_ObjPlacement.h"
+#include "WED_FacadePlacement.h"
+#include "WED_FacadeRing.h"
+#include "WED_FacadeNode.h"
+#include "PerfUtils.h"
+#include "AssertUtils.h"
+
+/*
+	Loopback tests for the binary frame protocol: everything WED_NWFrameWriter writes must come back out of
+	WED_NWFrameReader, frames must be found in a stream shared with text lines, and garbage must be caught rather
+	than read past.  The drag test runs a real WED_NWLinkAdapter over a scratch archive through a live-preview
+	session, applies every tick it writes the way a sim plugin would, and checks the sim's copy against the archive.
+	Each tick's size and time go to stdout.
+*/
+
+static unsigned int	sSeed = 1;
+
+static int	test_rand(int n)
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return (sSeed >> 8) % n;
+}
+
+static void	TEST_NWNumbers(void)
+{
+	static const long long	ints[] = { 0, 1, -1, 63, -64, 64, -65, 8191, -8192, 1LL << 40, -(1LL << 40),
+									   0x7FFFFFFFFFFFFFFFLL, -0x7FFFFFFFFFFFFFFFLL - 1 };
+	static const unsigned long long	uints[] = { 0, 1, 127, 128, 16383, 16384, 0xFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL };
+	static const int		ids[] = { 5, 6, 7, 1000, 3, 3, 0x7FFFFFFF, 0 };
+	const int ni = sizeof(ints) / sizeof(ints[0]);
+	const int nu = sizeof(uints) / sizeof(uints[0]);
+	const int nd = sizeof(ids) / sizeof(ids[0]);
+
+	WED_NWFrameWriter	w;
+	vector<long long>	xs, ys;
+	for(int i = 0; i < ni; ++i)	w.Int(ints[i]);
+	for(int i = 0; i < nu; ++i)	w.UInt(uints[i]);
+	for(int i = 0; i < nd; ++i)	w.Id(ids[i]);
+	for(int i = 0; i < 100; ++i)
+	{
+		xs.push_back((long long) test_rand(36000) * 1000000LL - 18000000000LL + test_rand(1000));
+		ys.push_back((long long) test_rand(18000) * 1000000LL - 9000000000LL + test_rand(1000));
+		w.Point(xs.back(), ys.back());
+	}
+	w.Str(string());
+	w.Str("KSEA Terminal \"A\"");
+	w.Str(string(100000, 'x'));
+	w.Record(nw_rec_chg, nw_obj_FacadeNode);
+
+	vector<char>	out;
+	w.Finish(out);
+	TEST_Run(w.Empty());
+	TEST_Run(WED_NWFrameReader::FrameSize(&out[0], out.size()) == out.size());
+
+	WED_NWFrameReader	r(&out[0], out.size());
+	bool ok = true;
+	for(int i = 0; i < ni; ++i)	ok &= r.Int() == ints[i];
+	for(int i = 0; i < nu; ++i)	ok &= r.UInt() == uints[i];
+	for(int i = 0; i < nd; ++i)	ok &= r.Id() == ids[i];
+	for(int i = 0; i < 100; ++i)
+	{
+		long long x, y;
+		r.Point(x, y);
+		ok &= x == xs[i] && y == ys[i];
+	}
+	TEST_Run(ok);
+	TEST_Run(r.Str().empty());
+	TEST_Run(r.Str() == "KSEA Terminal \"A\"");
+	TEST_Run(r.Str() == string(100000, 'x'));
+	int objtype;
+	TEST_Run(r.Record(objtype) == nw_rec_chg);
+	TEST_Run(objtype == nw_obj_FacadeNode);
+	TEST_Run(r.Done());
+	TEST_Run(r.Ok());
+}
+
+// Frames share the stream with text lines, so the reader has to tell them apart and wait for a whole frame.
+static void	TEST_NWFraming(void)
+{
+	vector<char>		out;
+	WED_NWFrameWriter	w;
+
+	const char * text = "sel:0:12:\r\n";
+	TEST_Run(WED_NWFrameReader::FrameSize(text, strlen(text)) == -1);
+	TEST_Run(WED_NWFrameReader::FrameSize(text, 0) == 0);
+
+	// Every frame starts its pens over, so the second frame decodes without the first.
+	w.Id(100);	w.Point(500, -500);	w.Finish(out);
+	int first = out.size();
+	w.Id(100);	w.Point(500, -500);	w.Finish(out);
+	TEST_Run(out.size() == 2 * first);
+
+	for(int len = 0; len < first; ++len)
+		TEST_Run(WED_NWFrameReader::FrameSize(&out[0], len) == 0);
+	TEST_Run(WED_NWFrameReader::FrameSize(&out[0], out.size()) == first);
+
+	WED_NWFrameReader	r(&out[first], out.size() - first);
+	long long x, y;
+	TEST_Run(r.Id() == 100);
+	r.Point(x, y);
+	TEST_Run(x == 500 && y == -500);
+	TEST_Run(r.Done() && r.Ok());
+}
+
+static void	TEST_NWGarbage(void)
+{
+	// A varint that runs off the end of the frame.
+	vector<char>		out;
+	WED_NWFrameWriter	w;
+	w.UInt(1ULL << 40);
+	w.Finish(out);
+	out[2] = 3;
+	out.resize(NW_FRAME_HDR_SIZE + 3);
+	{
+		WED_NWFrameReader	r(&out[0], out.size());
+		r.UInt();
+		TEST_Run(!r.Ok());
+		TEST_Run(r.Done());
+	}
+
+	// A string longer than what is left.
+	out.clear();
+	w.UInt(50);
+	w.Finish(out);
+	{
+		WED_NWFrameReader	r(&out[0], out.size());
+		TEST_Run(r.Str().empty());
+		TEST_Run(!r.Ok());
+	}
+
+	// A version we don't know.
+	out.clear();
+	w.UInt(1);
+	w.Finish(out);
+	out[1] = NW_FRAME_VERSION + 1;
+	{
+		WED_NWFrameReader	r(&out[0], out.size());
+		TEST_Run(!r.Ok());
+		TEST_Run(r.Done());
+	}
+}
+
+// The sim's copy of an object, facade, ring or node, in wire units.
+struct	test_nw_obj {
+	int			objtype;
+	int			flags;
+	long long	x[3], y[3];
+	long long	hdg, msl, height;
+	int			parent, pos;
+	string		name, resource;
+
+	test_nw_obj() : objtype(nw_obj_none), flags(0), hdg(0), msl(0), height(0), parent(0), pos(0) { for(int k = 0; k < 3; ++k) x[k] = y[k] = 0; }
+	int		points(void) const { return objtype == nw_obj_Object ? 1 : (objtype == nw_obj_FacadeNode ? ((flags & NW_OBJ_FLAG_HANDLES) ? 3 : 1) : 0); }
+	bool operator==(const test_nw_obj& rhs) const
+	{
+		if(objtype != rhs.objtype || flags != rhs.flags || hdg != rhs.hdg || msl != rhs.msl || height != rhs.height ||
+		   parent != rhs.parent || pos != rhs.pos || name != rhs.name || resource != rhs.resource)
+			return false;
+		for(int k = 0; k < points(); ++k)
+		if(x[k] != rhs.x[k] || y[k] != rhs.y[k])
+			return false;
+		return true;
+	}
+};
+
+// The sim side: apply every frame in the stream to its copy of the objects.
+static bool	test_apply_frames(const vector<char>& stream, map<int, test_nw_obj>& sim)
+{
+	int pos = 0;
+	while(pos < stream.size())
+	{
+		int len = WED_NWFrameReader::FrameSize(&stream[pos], stream.size() - pos);
+		if(len <= 0)
+			return false;
+		WED_NWFrameReader	r(&stream[pos], len);
+		while(!r.Done())
+		{
+			int objtype;
+			int rec = r.Record(objtype);
+			if(rec == nw_rec_add || rec == nw_rec_chg)
+			{
+				test_nw_obj& o(sim[r.Id()]);
+				o.objtype = objtype;
+				int flags = objtype == nw_obj_FacadeRing ? NW_OBJ_FLAG_NAMES : r.UInt();
+				o.flags = flags & ~NW_OBJ_FLAG_NAMES;
+				switch(objtype) {
+				case nw_obj_Object:
+					r.Point(o.x[0], o.y[0]);
+					if(flags & NW_OBJ_FLAG_MSL)
+						o.msl = r.Int();
+					o.hdg = r.Int();
+					if(flags & NW_OBJ_FLAG_NAMES)
+					{
+						o.name = r.Str();
+						o.resource = r.Str();
+					}
+					break;
+				case nw_obj_Facade:
+					o.height = r.Int();
+					if(flags & NW_OBJ_FLAG_NAMES)
+					{
+						o.name = r.Str();
+						o.resource = r.Str();
+					}
+					break;
+				case nw_obj_FacadeRing:
+					o.parent = r.UInt();
+					o.pos = r.UInt();
+					o.name = r.Str();
+					break;
+				case nw_obj_FacadeNode:
+					for(int k = 0; k < o.points(); ++k)
+						r.Point(o.x[k], o.y[k]);
+					if(flags & NW_OBJ_FLAG_NAMES)
+					{
+						o.parent = r.UInt();
+						o.pos = r.UInt();
+						o.name = r.Str();
+					}
+					break;
+				default:
+					return false;
+				}
+			}
+			else if(rec == nw_rec_move)
+			{
+				long long dx = r.Int();
+				long long dy = r.Int();
+				int count = r.UInt();
+				while(count-- > 0 && r.Ok())
+				{
+					map<int, test_nw_obj>::iterator o = sim.find(r.Id());
+					if(o == sim.end())
+						return false;
+					for(int k = 0; k < o->second.points(); ++k)
+					{
+						o->second.x[k] += dx;
+						o->second.y[k] += dy;
+					}
+				}
+			}
+			else if(rec == nw_rec_del)
+			{
+				int count = r.UInt();
+				while(count-- > 0 && r.Ok())
+					sim.erase(r.Id());
+			}
+			else
+				return false;
+		}
+		if(!r.Ok())
+			return false;
+		pos += len;
+	}
+	return true;
+}
+
+// What the sim should have for everything in the archive - straight from the objects, not from anything the
+// adapter remembers.
+static void	test_wed_state(const vector<WED_Thing *>& things, map<int, test_nw_obj>& wed)
+{
+	wed.clear();
+	for(vector<WED_Thing *>::const_iterator t = things.begin(); t != things.end(); ++t)
+	{
+		test_nw_obj& o(wed[(*t)->GetID()]);
+		(*t)->GetName(o.name);
+		if(WED_ObjPlacement * obj = dynamic_cast<WED_ObjPlacement *>(*t))
+		{
+			Point2 p;
+			obj->GetLocation(gis_Geo, p);
+			o.objtype = nw_obj_Object;
+			o.x[0] = WED_NWFixed(p.x(), NW_COORD_SCALE);
+			o.y[0] = WED_NWFixed(p.y(), NW_COORD_SCALE);
+			double hdg = obj->GetHeading();
+			while(hdg < 0) hdg += 360.0;
+			while(hdg >= 360.0) hdg -= 360.0;
+			o.hdg = WED_NWFixed(hdg, NW_HUNDREDTHS);
+			obj->GetResource(o.resource);
+		}
+		else if(WED_FacadePlacement * fac = dynamic_cast<WED_FacadePlacement *>(*t))
+		{
+			o.objtype = nw_obj_Facade;
+			o.height = WED_NWFixed(fac->GetHeight(), NW_HUNDREDTHS);
+			fac->GetResource(o.resource);
+		}
+		else if(dynamic_cast<WED_FacadeRing *>(*t))
+		{
+			o.objtype = nw_obj_FacadeRing;
+			o.parent = (*t)->GetParent()->GetID();
+			o.pos = (*t)->GetMyPosition();
+		}
+		else if(WED_FacadeNode * node = dynamic_cast<WED_FacadeNode *>(*t))
+		{
+			BezierPoint2 bp;
+			node->GetBezierLocation(gis_Geo, bp);
+			o.objtype = nw_obj_FacadeNode;
+			o.flags = (bp.has_lo() || bp.has_hi()) ? NW_OBJ_FLAG_HANDLES : 0;
+			o.x[0] = WED_NWFixed(bp.pt.x(), NW_COORD_SCALE);
+			o.y[0] = WED_NWFixed(bp.pt.y(), NW_COORD_SCALE);
+			o.x[1] = WED_NWFixed(bp.hi.x(), NW_COORD_SCALE);
+			o.y[1] = WED_NWFixed(bp.hi.y(), NW_COORD_SCALE);
+			o.x[2] = WED_NWFixed(bp.lo.x(), NW_COORD_SCALE);
+			o.y[2] = WED_NWFixed(bp.lo.y(), NW_COORD_SCALE);
+			o.parent = node->GetParent()->GetID();
+			o.pos = node->GetMyPosition();
+		}
+	}
+}
+
+// One live-preview tick: let the adapter write what changed, apply it on the sim side, and check the sim now
+// matches the archive.  Prints what the tick cost.
+static int	test_tick(const char * edit, int changed, WED_NWLinkAdapter& adapter, const vector<WED_Thing *>& things, map<int, test_nw_obj>& sim)
+{
+	vector<char>	stream;
+	unsigned long long start = query_hpc();
+	adapter.WriteFrames(stream);
+	bool applied = test_apply_frames(stream, sim);
+	double usec = hpc_to_microseconds(query_hpc() - start);
+	printf("Live preview %-12s %5d changed, %7d bytes, %8.3lf ms.\n", edit, changed, (int) stream.size(), usec / 1000.0);
+
+	map<int, test_nw_obj>	wed;
+	test_wed_state(things, wed);
+	TEST_Run(applied);
+	TEST_Run(sim == wed);
+	return stream.size();
+}
+
+static void	test_shift_node(WED_FacadeNode * node, const Vector2& v)
+{
+	BezierPoint2 bp;
+	node->GetBezierLocation(gis_Geo, bp);
+	bp.pt += v;
+	bp.hi += v;
+	bp.lo += v;
+	node->SetBezierLocation(gis_Geo, bp);
+}
+
+// A real adapter over a scratch archive: an airport's worth of objects and a few facades go out in full, then
+// the edits a user makes in a session - dragging the whole selection, dragging part of it, rotating, renaming,
+// deleting - each sent as the adapter would on its next timer tick.
+static void	TEST_NWDragLoopback(void)
+{
+	const int			count = 500;
+	const int			facades = 10;
+	WED_Archive			arch(NULL);
+	WED_NWLinkAdapter	adapter(NULL, &arch);
+	arch.SetUndo(UNDO_DISCARD);
+	arch.SetNWLinkAdapter(&adapter);
+
+	WED_Group *						root = WED_Group::CreateTyped(&arch);
+	vector<WED_Thing *>				things;
+	vector<WED_ObjPlacement *>		objs;
+	vector<WED_FacadeNode *>		nodes;
+	map<int, test_nw_obj>			sim;
+
+	for(int i = 0; i < count; ++i)
+	{
+		WED_ObjPlacement * obj = WED_ObjPlacement::CreateTyped(&arch);
+		obj->SetParent(root, root->CountChildren());
+		obj->SetName("Object");
+		obj->SetResource("lib/airport/vehicles/pushback/tug.obj");
+		obj->SetLocation(gis_Geo, Point2(-122.3 + test_rand(10000) * 1e-6, 47.4 + test_rand(10000) * 1e-6));
+		obj->SetHeading(test_rand(36000) * 0.01);
+		objs.push_back(obj);
+		things.push_back(obj);
+	}
+	for(int i = 0; i < facades; ++i)
+	{
+		WED_FacadePlacement * fac = WED_FacadePlacement::CreateTyped(&arch);
+		WED_FacadeRing * ring = WED_FacadeRing::CreateTyped(&arch);
+		fac->SetParent(root, root->CountChildren());
+		fac->SetName("Hangar");
+		fac->SetResource("lib/airport/buildings/hangar.fac");
+		fac->SetHeight(10 + i);
+		ring->SetParent(fac, 0);
+		ring->SetName("Ring");
+		things.push_back(fac);
+		things.push_back(ring);
+		Point2 c(-122.3 + test_rand(10000) * 1e-6, 47.4 + test_rand(10000) * 1e-6);
+		for(int k = 0; k < 4; ++k)
+		{
+			WED_FacadeNode * node = WED_FacadeNode::CreateTyped(&arch);
+			node->SetParent(ring, k);
+			node->SetName("Node");
+			BezierPoint2 bp;
+			bp.pt = bp.lo = bp.hi = c + Vector2((k == 1 || k == 2) ? 1e-4 : 0, k >= 2 ? 1e-4 : 0);
+			if(k == 3)
+			{
+				bp.hi += Vector2(3e-5, 1e-5);
+				bp.lo -= Vector2(3e-5, 1e-5);
+			}
+			node->SetBezierLocation(gis_Geo, bp);
+			nodes.push_back(node);
+			things.push_back(node);
+		}
+	}
+	test_tick("add", things.size(), adapter, things, sim);
+	TEST_Run(sim.size() == things.size());
+
+	// Drag everything: the objects and facade nodes all go out as moves, about a byte each.
+	Vector2	v(3.7e-6, -1.9e-6);
+	for(int i = 0; i < objs.size(); ++i)
+	{
+		Point2 p;
+		objs[i]->GetLocation(gis_Geo, p);
+		objs[i]->SetLocation(gis_Geo, p + v);
+	}
+	for(int i = 0; i < nodes.size(); ++i)
+		test_shift_node(nodes[i], v);
+	int moved = objs.size() + nodes.size();
+	TEST_Run(test_tick("drag all", moved, adapter, things, sim) < 3 * moved + 100);
+
+	// Drag every other object, the rest stay put.
+	for(int i = 0; i < objs.size(); i += 2)
+	{
+		Point2 p;
+		objs[i]->GetLocation(gis_Geo, p);
+		objs[i]->SetLocation(gis_Geo, p - v * 5.0);
+	}
+	TEST_Run(test_tick("drag half", count / 2, adapter, things, sim) < 3 * count / 2 + 100);
+
+	// Rotating isn't a move - those go out in full, but without their names.
+	for(int i = 0; i < 10; ++i)
+		objs[i * 7]->SetHeading(objs[i * 7]->GetHeading() + 90.0);
+	test_tick("rotate", 10, adapter, things, sim);
+
+	objs[3]->SetName("Renamed");
+	objs[4]->SetResource("lib/airport/vehicles/baggage_handling/tractor.obj");
+	nodes[5]->SetName("Corner");
+	test_tick("rename", 3, adapter, things, sim);
+
+	for(int i = 0; i < 5; ++i)
+	{
+		WED_ObjPlacement * obj = objs.back();
+		things.erase(find(things.begin(), things.end(), obj));
+		objs.pop_back();
+		obj->SetParent(NULL, 0);
+		obj->Delete();
+	}
+	test_tick("delete", 5, adapter, things, sim);
+
+	TEST_Run(test_tick("idle", 0, adapter, things, sim) == 0);
+
+	arch.SetNWLinkAdapter(NULL);
+	arch.ClearAll();
+	arch.SetUndo(NULL);
+}
+
+void	TEST_NWBinary(void)
+{
+	TEST_NWNumbers();
+	TEST_NWFraming();
+	TEST_NWGarbage();
+	TEST_NWDragLoopback();
+}
+
+#endif
@@ -45,6 +45,8 @@
 // con:con_leave:id:crlf						(from client if intend to leave)
 // con:con_go_on:id:"pkgname"crlf				(from server if accepted)
 // con:con_refused:id:crlf					    (from server if refused)
+// con:con_binary:id:version crlf				(from client after go_on: it can read binary frames up to version)
+// con:con_binary:id:version crlf				(answer from server: frames of this version follow; 0 = stay with text)
 
 enum wed_nw_con {
 
@@ -53,6 +55,7 @@ enum wed_nw_con {
 	nw_con_leave 		= 2	,
 	nw_con_go_on  		= 3	,
 	nw_con_refused		= 4	,
+	nw_con_binary		= 5	,
 };
 
 // commands
@@ -127,5 +130,28 @@ enum wed_nw_obj{
 #define WED_NWP_SEL "sel"
 //sel:nw_obj_none:id:crlf
 
+// binary frames
+/////////////////////////
+// After con_binary the server sends add/chg/del/cam as binary frames; everything else stays text.  A frame
+// starts with a byte that no text line starts with, so a reader can tell them apart on the same stream:
+//
+// NW_FRAME_MAGIC:u8 version:u8 payload_len:u32le payload
+//
+// The payload is a list of records, each a tag byte (wed_nw_rec | wed_nw_obj << 4) followed by varints
+// (LEB128; signed values zig-zag coded) and strings (varint length, then the bytes).  See WED_NWBinary.h.
+
+#define NW_FRAME_MAGIC		0xFE
+#define NW_FRAME_VERSION	1
+#define NW_FRAME_HDR_SIZE	6
+
+enum wed_nw_rec {
+
+	nw_rec_add   		= 1	,
+	nw_rec_chg	 		= 2	,
+	nw_rec_del	 		= 3	,
+	nw_rec_move  		= 4	,
+	nw_rec_cam	 		= 5	,
+};
+
 
 #endif // WED_NWDEFS_H_INCLUDED
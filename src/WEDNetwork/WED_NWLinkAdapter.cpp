@@ -29,6 +29,7 @@
 #include "WED_Thing.h"
 #include "WED_Archive.h"
 #include "WED_NWDefs.h"
+#include "WED_NWBinary.h"
 #include "WED_ObjPlacement.h"
 #include "WED_FacadePlacement.h"
 #include "WED_FacadeNode.h"
@@ -63,8 +64,20 @@ void  	WED_NWLinkAdapter::TimerFired()
     }
 }
 
+// The only kinds of things the sim is told about.  Everything else would just sit in mObjCache until the next
+// send skipped it - after an apt.dat import that is millions of objects.
+static bool is_linked(WED_Persistent * inObject)
+{
+    const char * c = inObject->GetClass();
+    return  c == WED_ObjPlacement::sClass 	||
+            c == WED_FacadePlacement::sClass	||
+            c == WED_FacadeRing::sClass		||
+            c == WED_FacadeNode::sClass;
+}
+
 void 	WED_NWLinkAdapter::ObjectCreated(WED_Persistent * inObject)
 {
+    if (!is_linked(inObject)) return;
     mObjCache[inObject] = wed_Change_CreateDestroy ;
     if (mTimerIsStarted) return;
     GUI_Timer::Start(0);
@@ -75,6 +88,7 @@ void	WED_NWLinkAdapter::ObjectChanged(WED_Persistent * inObject, int chgkind)
 {
     if (chgkind == wed_Change_Selection) return;
     if (chgkind == wed_Change_Topology) return;
+    if (!is_linked(inObject)) return;
     if (chgkind == wed_Change_Any)
         mObjCache[inObject] |= wed_Change_Any_Ex;
     else
@@ -87,14 +101,9 @@ void	WED_NWLinkAdapter::ObjectChanged(WED_Persistent * inObject, int chgkind)
 
 void 	WED_NWLinkAdapter::ObjectDestroyed(WED_Persistent * inObject)
 {
+    if (!is_linked(inObject)) return;
     mObjCache.erase(inObject);
-    if(	inObject->GetClass() == WED_ObjPlacement::sClass 	||
-            inObject->GetClass() == WED_FacadePlacement::sClass	||
-            inObject->GetClass() == WED_FacadeRing::sClass		||
-            inObject->GetClass() == WED_FacadeNode::sClass 		 )
-    {
-        mDelList.insert(inObject->GetID());
-    }
+    mDelList.insert(inObject->GetID());
 
     if (mTimerIsStarted) return;
     GUI_Timer::Start(0);
@@ -110,6 +119,14 @@ void	WED_NWLinkAdapter::SendCamData()
 }
 
 void 	WED_NWLinkAdapter::DoSendData()
+{
+    if(mServer->GetFrameVersion() > 0)
+        DoSendFrames();
+    else
+        DoSendText();
+}
+
+void 	WED_NWLinkAdapter::DoSendText()
 {
     char buf[256];
     Point2 p;
@@ -234,6 +251,220 @@ void 	WED_NWLinkAdapter::DoSendData()
     }
 }
 
+static bool same_shape(const WED_NWWireState_t& a, const WED_NWWireState_t& b)
+{
+    return a.objtype == b.objtype && a.flags == b.flags && a.hdg == b.hdg && a.msl == b.msl;
+}
+
+static int num_points(const WED_NWWireState_t& s)
+{
+    return (s.flags & NW_OBJ_FLAG_HANDLES) ? 3 : 1;
+}
+
+static bool sort_by_id(const pair<int,pair<WED_Persistent *,int> >& a, const pair<int,pair<WED_Persistent *,int> >& b)
+{
+    return a.first < b.first;
+}
+
+void 	WED_NWLinkAdapter::DoSendFrames()
+{
+    vector<char>        out;
+    WriteFrames(out);
+    mServer->SendData(out);
+}
+
+// Same content as DoSendText, but batched into frames.  Objects and facade nodes whose only change is that every
+// point moved by the same amount go out as move records, grouped by that amount - a dragged selection is one record.
+void 	WED_NWLinkAdapter::WriteFrames(vector<char>& out)
+{
+    WED_NWFrameWriter   frame;
+    Point2              p;
+    BezierPoint2        bp;
+
+    WED_ObjPlacement *		obj;
+    WED_FacadePlacement *	fac;
+    WED_FacadeNode *		facnode;
+    WED_FacadeRing *		facring;
+
+    // Id order keeps the id deltas small.
+    vector<pair<int,pair<WED_Persistent *,int> > > todo;
+    todo.reserve(mObjCache.size());
+    for(map<WED_Persistent *,int >::iterator it = mObjCache.begin(); it != mObjCache.end(); ++it)
+        todo.push_back(make_pair(it->first->GetID(),*it));
+    sort(todo.begin(),todo.end(),sort_by_id);
+    mObjCache.clear();
+
+    map<pair<long long,long long>,vector<int> > moves;
+
+    for(int i = 0; i < todo.size(); ++i)
+    {
+        int id          = todo[i].first;
+        int chg         = todo[i].second.second;
+        int rec         = (chg & wed_Change_CreateDestroy) ? nw_rec_add : nw_rec_chg;
+        bool names      = (chg & wed_Change_CreateDestroy) || chg == wed_Change_Properties;
+        string n,r      = "unkown";
+
+        WED_NWWireState_t cur;
+        cur.flags = 0;
+        cur.hdg = cur.msl = 0;
+
+        if((obj = dynamic_cast<WED_ObjPlacement *>(todo[i].second.first)) != NULL)
+        {
+            cur.objtype = nw_obj_Object;
+            obj->GetLocation(gis_Geo,p);
+            cur.x[0] = WED_NWFixed(p.x(),NW_COORD_SCALE);
+            cur.y[0] = WED_NWFixed(p.y(),NW_COORD_SCALE);
+
+            float hdg = obj->GetHeading();
+            while(hdg < 0) hdg += 360.0;
+            while(hdg >= 360.0) hdg -= 360.0;
+            cur.hdg = WED_NWFixed(hdg,NW_HUNDREDTHS);
+#if AIRPORT_ROUTING
+            if(obj->HasCustomMSL())
+            {
+                cur.flags |= NW_OBJ_FLAG_MSL;
+                cur.msl = WED_NWFixed(obj->GetCustomMSL(),NW_THOUSANDTHS);
+            }
+#endif
+        }
+        else if((facnode = dynamic_cast<WED_FacadeNode*>(todo[i].second.first)) != NULL)
+        {
+            cur.objtype = nw_obj_FacadeNode;
+            facnode->GetBezierLocation(gis_Geo,bp);
+            cur.x[0] = WED_NWFixed(bp.pt.x(),NW_COORD_SCALE);
+            cur.y[0] = WED_NWFixed(bp.pt.y(),NW_COORD_SCALE);
+            if (bp.has_lo()||bp.has_hi())
+            {
+                cur.flags |= NW_OBJ_FLAG_HANDLES;
+                cur.x[1] = WED_NWFixed(bp.hi.x(),NW_COORD_SCALE);
+                cur.y[1] = WED_NWFixed(bp.hi.y(),NW_COORD_SCALE);
+                cur.x[2] = WED_NWFixed(bp.lo.x(),NW_COORD_SCALE);
+                cur.y[2] = WED_NWFixed(bp.lo.y(),NW_COORD_SCALE);
+            }
+        }
+        else if((fac = dynamic_cast<WED_FacadePlacement *>(todo[i].second.first)) != NULL)
+        {
+            frame.Record(rec,nw_obj_Facade);
+            frame.Id(id);
+            frame.UInt(names ? NW_OBJ_FLAG_NAMES : 0);
+            frame.Int(WED_NWFixed(fac->GetHeight(),NW_HUNDREDTHS));
+            if(names)
+            {
+                fac->GetName(n);
+                fac->GetResource(r);
+                frame.Str(n);
+                frame.Str(r);
+            }
+            if(frame.Size() > NW_MAX_PAYLOAD) frame.Finish(out);
+            continue;
+        }
+        else if((facring = dynamic_cast<WED_FacadeRing *>(todo[i].second.first)) != NULL)
+        {
+            frame.Record(rec,nw_obj_FacadeRing);
+            frame.Id(id);
+            frame.UInt(facring->GetParent()->GetID());
+            frame.UInt(facring->GetMyPosition());
+            facring->GetName(n);
+            frame.Str(n);
+            if(frame.Size() > NW_MAX_PAYLOAD) frame.Finish(out);
+            continue;
+        }
+        else
+            continue;
+
+        // An object or node.  If the sim already has it and all that happened is a shift, it is a move.
+        map<int,WED_NWWireState_t>::iterator last = mSent.find(id);
+        if(rec == nw_rec_chg && !names && last != mSent.end() && same_shape(last->second,cur))
+        {
+            long long dx = cur.x[0] - last->second.x[0];
+            long long dy = cur.y[0] - last->second.y[0];
+            int np = num_points(cur);
+            int k = 1;
+            while(k < np && cur.x[k] - last->second.x[k] == dx && cur.y[k] - last->second.y[k] == dy)
+                ++k;
+            if(k == np)
+            {
+                // Nothing the sim can see changed - e.g. a property it does not know about.
+                if(dx != 0 || dy != 0)
+                    moves[make_pair(dx,dy)].push_back(id);
+                last->second = cur;
+                continue;
+            }
+        }
+
+        frame.Record(rec,cur.objtype);
+        frame.Id(id);
+        if(cur.objtype == nw_obj_Object)
+        {
+            frame.UInt(cur.flags | (names ? NW_OBJ_FLAG_NAMES : 0));
+            frame.Point(cur.x[0],cur.y[0]);
+            if(cur.flags & NW_OBJ_FLAG_MSL)
+                frame.Int(cur.msl);
+            frame.Int(cur.hdg);
+            if(names)
+            {
+                obj->GetName(n);
+                obj->GetResource(r);
+                frame.Str(n);
+                frame.Str(r);
+            }
+        }
+        else
+        {
+            frame.UInt(cur.flags | (names ? NW_OBJ_FLAG_NAMES : 0));
+            for(int k = 0; k < num_points(cur); ++k)
+                frame.Point(cur.x[k],cur.y[k]);
+            if(names)
+            {
+                frame.UInt(facnode->GetParent()->GetID());
+                frame.UInt(facnode->GetMyPosition());
+                facnode->GetName(n);
+                frame.Str(n);
+            }
+        }
+        mSent[id] = cur;
+        if(frame.Size() > NW_MAX_PAYLOAD) frame.Finish(out);
+    }
+
+    for(map<pair<long long,long long>,vector<int> >::iterator m = moves.begin(); m != moves.end(); ++m)
+    {
+        frame.Record(nw_rec_move,nw_obj_none);
+        frame.Int(m->first.first);
+        frame.Int(m->first.second);
+        frame.UInt(m->second.size());
+        for(vector<int>::iterator id = m->second.begin(); id != m->second.end(); ++id)
+            frame.Id(*id);
+        if(frame.Size() > NW_MAX_PAYLOAD) frame.Finish(out);
+    }
+
+    if(!mDelList.empty())
+    {
+        frame.Record(nw_rec_del,nw_obj_none);
+        frame.UInt(mDelList.size());
+        for (set<int >::iterator sit = mDelList.begin(); sit != mDelList.end(); ++sit)
+        {
+            frame.Id(*sit);
+            mSent.erase(*sit);
+        }
+        mDelList.clear();
+    }
+
+    if(mCamera.enabled && mCamera.changed)
+    {
+        frame.Record(nw_rec_cam,nw_obj_none);
+        frame.Int(WED_NWFixed(mCamera.lat,NW_COORD_SCALE));
+        frame.Int(WED_NWFixed(mCamera.lon,NW_COORD_SCALE));
+        frame.Int(WED_NWFixed(mCamera.alt,NW_HUNDREDTHS));
+        frame.Int(WED_NWFixed(mCamera.pitch,NW_HUNDREDTHS));
+        frame.Int(WED_NWFixed(mCamera.roll,NW_HUNDREDTHS));
+        frame.Int(WED_NWFixed(mCamera.heading,NW_HUNDREDTHS));
+        mCamera.changed=false;
+    }
+
+    if(!frame.Empty())
+        frame.Finish(out);
+}
+
 void	WED_NWLinkAdapter::DoReadData()
 {
     if(!mServer||!mArchive) return;
@@ -259,11 +490,7 @@ void	WED_NWLinkAdapter::DoReadData()
             default :
             {
                 WED_Persistent * entity = mArchive->Fetch(id);
-                if(entity && (
-                            entity->GetClass() == WED_ObjPlacement::sClass 		||
-                            entity->GetClass() == WED_FacadePlacement::sClass	||
-                            entity->GetClass() == WED_FacadeRing::sClass		||
-                            entity->GetClass() == WED_FacadeNode::sClass 		))
+                if(entity && is_linked(entity))
                 {
                     mObjCache[entity] = wed_Change_CreateDestroy;
                 }
@@ -322,6 +549,8 @@ void	WED_NWLinkAdapter::ReceiveMessage(GUI_Broadcaster * inSrc,intptr_t inMsg,in
         case WED_Server::s_stopped :
         case WED_Server::s_changed :
             {
+                // New client, or it switched protocols - it has to hear about everything in full again.
+                mSent.clear();
                 if(!IsReady()) mCamera.enabled = false;
 				BroadcastMessage(inMsg,inParam);
             }
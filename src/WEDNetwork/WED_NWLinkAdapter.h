@@ -54,6 +54,17 @@ struct WED_NWCamera_t
     {}
 };
 
+// What the sim was last told about an object or facade node, in wire units - lets us send a drag as a move.
+struct WED_NWWireState_t
+{
+    int         objtype;
+    int         flags;          // NW_OBJ_FLAG_MSL, NW_OBJ_FLAG_HANDLES
+    long long   x[3];           // point, then hi and lo handles if flags has NW_OBJ_FLAG_HANDLES
+    long long   y[3];
+    long long   hdg;
+    long long   msl;
+};
+
 class	WED_NWLinkAdapter :public GUI_Broadcaster,public GUI_Listener,public GUI_Timer  {
 public:
 
@@ -80,12 +91,18 @@ public:
                 int     IsReady(void);
 				void    DoReadData();
 				void    DoSendData();
+				// Appends frames for everything that changed since the last call, and forgets the changes - what
+				// DoSendData sends when the client speaks frames.
+				void	WriteFrames(vector<char>& out);
 
 				void   	TimerFired();
 
 				void	ReceiveMessage(	GUI_Broadcaster * inSrc,intptr_t inMsg,intptr_t inParam);
 
 private:
+
+				void    DoSendText();
+				void    DoSendFrames();
 				//ToDo:mroe privat for now,should merged with the other changeflags
 				// found in WED_Archive.h ,WED_Thing.h
 				enum {
@@ -97,6 +114,7 @@ private:
 
 				set<int>		 mDelList;
 	map<WED_Persistent *,int>	 mObjCache;
+	map<int,WED_NWWireState_t>	 mSent;				// binary frames only
 
 			WED_Archive *		 mArchive;
 			WED_Server * 		 mServer;
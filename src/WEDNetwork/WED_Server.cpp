@@ -105,6 +105,12 @@ int  WED_Server::IsReady()
 	return (mConnection->HasClient);
 }
 
+int  WED_Server::GetFrameVersion()
+{
+	if (!IsReady()) return 0;
+	return mConnection->frame_version;
+}
+
 int WED_Server::SendData(const char* hdr,int type,int id,const string& args )
 {
 	char buf[256];
@@ -120,6 +126,12 @@ int WED_Server::SendData(const char * inBuf ,int inSize)
 	return false;
 }
 
+int WED_Server::SendData(const vector<char>& inBuffer)
+{
+	if (inBuffer.empty()) return true;
+	return SendData(&*inBuffer.begin(),inBuffer.size());
+}
+
 int WED_Server::GetData(vector<string>& outData)
 {
 	if(mQueue.empty()) return 0;
@@ -155,6 +167,19 @@ void WED_Server::DoConnection(vector<string>& inList)
 		case nw_con_leave :
 		{
 			//not implemented
+			break;
+		}
+		case nw_con_binary :
+		{
+			// The client tells us the newest frame version it reads; we answer with what we will send.
+			if (inList.size() != 4 || !mConnection->HasClient) return;
+			int vers = atoi(inList[3].c_str());
+			mConnection->frame_version = vers >= NW_FRAME_VERSION ? NW_FRAME_VERSION : 0;
+			char buf[16];
+			sprintf(buf,"%d",mConnection->frame_version);
+			SendData(WED_NWP_CON,nw_con_binary,mIdent,buf);
+			BroadcastMessage(msg_NetworkStatusInfo,s_changed);
+			break;
 		}
 	}
 }
@@ -38,6 +38,7 @@ public:
 			virtual	~WED_Server();
 
 				int		IsReady();
+				int		GetFrameVersion();		// binary frame version the client agreed to, 0 for text
 				int 	DoStart();
 				int 	IsStarted(){return  mStarted;}
 				void 	DoStop();
@@ -47,6 +48,7 @@ public:
 
 				int 	DoProcessing(void);
 				int 	SendData(const char * inBuffer ,int inSize);
+				int		SendData(const vector<char>& inBuffer);
 				int		SendData(const char* hdr,int type,int id,const string& args);
 				int	 	GetData(vector<string>& outData);
 
@@ -51,6 +51,12 @@
 
 inline int count_strs(const char ** p) { if (!p) return 0; int n = 0; while(*p) ++p, ++n; return n; }
 
+inline WED_Archive * GetArchive(IResolver * resolver)
+{
+	WED_Thing * root = WED_GetWorld(resolver);
+	return root ? root->GetArchive() : NULL;
+}
+
 inline bool AnyLocked(WED_Thing * t)
 {
 	if (t == NULL) return false;
@@ -85,7 +91,9 @@ WED_PropertyTable::WED_PropertyTable(
 	mDynamicCols(dynamic_cols),
 	mSelOnly(sel_only),
 	mResolver(resolver),
-	mCacheValid(false)
+	mCacheValid(false),
+	mThingSync(-1),
+	mFilterSync(-1)
 {
 	RebuildCache();
 
@@ -392,7 +400,12 @@ void	WED_PropertyTable::ToggleDisclose(
 	WED_Thing * t = FetchNth(mVertical ? cell_x : cell_y);
 	if (t)
 		ToggleOpen(t->GetID());
-	mCacheValid = false;
+
+	// Only t's subtree can change - FetchNth just validated the cache, so patch it.
+	if (t && mSearchFilter.empty() && CanUpdateIncrementally())
+		ReplaceSubtree(mThingCache.size() - cell_y - 1, t, WED_GetSelect(mResolver));
+	else
+		InvalidateRows();
 	BroadcastMessage(GUI_TABLE_CONTENT_RESIZED,0);
 }
 
@@ -567,7 +580,7 @@ int		WED_PropertyTable::SelectDisclose(
 			}
 		}
 	}
-	mCacheValid = false;
+	InvalidateRows();
 	BroadcastMessage(GUI_TABLE_CONTENT_RESIZED,0);
 	return 1;
 }
@@ -808,21 +821,26 @@ GUI_DragOperation		WED_PropertyTable::DoDropBetweenRows(
 #pragma mark -
 
 
-void WED_PropertyTable::RebuildCacheRecursive(WED_Thing * e, ISelection * sel, set<WED_Thing *> * sel_and_friends)
+void WED_PropertyTable::RebuildCacheRecursive(WED_Thing * e, ISelection * sel, set<WED_Thing *> * sel_and_friends, int depth,
+									vector<WED_Thing *>& out_things, vector<ThingRow>& out_rows)
 {
 	if (e == NULL) return;
 	int vis,kids,can_disclose,is_disclose;
 	GetFilterStatus(e,sel,vis,kids,can_disclose, is_disclose);
 
 	if (vis)
-		mThingCache.push_back(e);
+	{
+		ThingRow r = { e->GetID(), depth };
+		out_things.push_back(e);
+		out_rows.push_back(r);
+	}
 
 	if (sel_and_friends)
 	if (sel_and_friends->count(e) == 0)
 		return;
 
 	for (int n = 0; n < kids; ++n)
-		RebuildCacheRecursive(e->GetNthChild(n), sel, sel_and_friends);
+		RebuildCacheRecursive(e->GetNthChild(n), sel, sel_and_friends, depth+1, out_things, out_rows);
 }
 
 // Selection iterator: ref is a ptr to a set.  Accumulate the selected thing and all of its parents.
@@ -839,10 +857,30 @@ static int SelectAndParents(ISelectable * what, void * ref)
 	return 0;
 }
 
+void WED_PropertyTable::ValidateCache(void)
+{
+	if (mCacheValid)
+		return;
+	if (!mSearchFilter.empty())
+		Resort();
+	else if (!UpdateCache())
+		RebuildCache();
+}
+
+// For disclosure changes: they aren't in the archive's change log, so UpdateCache would never see them - rebuild from scratch.
+void WED_PropertyTable::InvalidateRows(void)
+{
+	mCacheValid = false;
+	mThingSync = -1;
+}
+
 void WED_PropertyTable::RebuildCache(void)
 {
 	mThingCache.clear();
+	mThingRows.clear();
 	mCacheValid = true;
+	WED_Archive * arch = GetArchive(mResolver);
+	mThingSync = arch ? arch->ChangeLogEnd() : -1;
 	set<WED_Thing*> all_sel;
 
 	// Performance note: the "selection" hierarchy (all selected entities) is effectively ALWAYS fully disclosed, because we must iterate
@@ -860,22 +898,80 @@ void WED_PropertyTable::RebuildCache(void)
 	if (mSelOnly)
 		sel->IterateSelectionOr(SelectAndParents,&all_sel);
 	if (root)
-		RebuildCacheRecursive(root,sel,mSelOnly ? &all_sel : NULL);
+		RebuildCacheRecursive(root,sel,mSelOnly ? &all_sel : NULL, 0, mThingCache, mThingRows);
 }
 
-WED_Thing *	WED_PropertyTable::FetchNth(int row)
+// Everything after idx that is deeper than it is its subtree.
+int WED_PropertyTable::SubtreeEnd(int idx) const
 {
-	if (!mCacheValid)
+	int depth = mThingRows[idx].depth;
+	int end = idx + 1;
+	while (end < mThingRows.size() && mThingRows[end].depth > depth)
+		++end;
+	return end;
+}
+
+// Re-walks the thing at row idx in place.  t is what lives at that ID now, NULL if it's gone.
+void WED_PropertyTable::ReplaceSubtree(int idx, WED_Thing * t, ISelection * sel)
+{
+	int end = SubtreeEnd(idx);
+	vector<WED_Thing *> things;
+	vector<ThingRow>	rows;
+	if (t)
+		RebuildCacheRecursive(t, sel, NULL, mThingRows[idx].depth, things, rows);
+	mThingCache.erase(mThingCache.begin() + idx, mThingCache.begin() + end);
+	mThingRows.erase(mThingRows.begin() + idx, mThingRows.begin() + end);
+	mThingCache.insert(mThingCache.begin() + idx, things.begin(), things.end());
+	mThingRows.insert(mThingRows.begin() + idx, rows.begin(), rows.end());
+}
+
+// Brings the hierarchy rows up to date with the archive by re-walking only the touched things.  Anything added, removed or moved
+// touches its parent (old and new) too, and a parent's row always comes before its kids', so one pass in row order that re-walks
+// touched rows and skips their old subtrees gets everything.  Rows we copy are never dereferenced - their thing might be gone, but
+// then some ancestor row was touched and we skipped it.  Returns false if we can't, and the caller must rebuild.
+bool WED_PropertyTable::UpdateCache(void)
+{
+	if (!CanUpdateIncrementally() || mThingSync < 0)
+		return false;
+	WED_Archive * arch = GetArchive(mResolver);
+	vector<int>	touched;
+	if (arch == NULL || !arch->GetChangesSince(mThingSync, touched))
+		return false;
+	sort(touched.begin(), touched.end());
+	touched.erase(unique(touched.begin(), touched.end()), touched.end());
+
+	ISelection * sel = WED_GetSelect(mResolver);
+	vector<WED_Thing *> things;
+	vector<ThingRow>	rows;
+	things.reserve(mThingCache.size());
+	rows.reserve(mThingRows.size());
+	int n = 0;
+	while (n < mThingRows.size())
 	{
-		if (mSearchFilter.empty() == true)
+		if (binary_search(touched.begin(), touched.end(), mThingRows[n].id))
 		{
-			RebuildCache();
+			WED_Thing * t = dynamic_cast<WED_Thing *>(arch->Fetch(mThingRows[n].id));
+			if (t)
+				RebuildCacheRecursive(t, sel, NULL, mThingRows[n].depth, things, rows);
+			n = SubtreeEnd(n);
 		}
 		else
 		{
-			Resort();
+			things.push_back(mThingCache[n]);
+			rows.push_back(mThingRows[n]);
+			++n;
 		}
 	}
+	mThingCache.swap(things);
+	mThingRows.swap(rows);
+	mThingSync = arch->ChangeLogEnd();
+	mCacheValid = true;
+	return true;
+}
+
+WED_Thing *	WED_PropertyTable::FetchNth(int row)
+{
+	ValidateCache();
 
 	vector<WED_Thing*>& current_cache = mSearchFilter.empty() ? mThingCache : mSortedCache;
 	if (!mVertical)
@@ -907,17 +1003,7 @@ int			WED_PropertyTable::GetColCount(void)
 	if (!mVertical)
 		return mColNames.size();
 
-	if (!mCacheValid)
-	{
-		if (mSearchFilter.empty() == true)
-		{
-			RebuildCache();
-		}
-		else
-		{
-			Resort();
-		}
-	}
+	ValidateCache();
 
 	vector<WED_Thing*>& current_cache = mSearchFilter.empty() ? mThingCache : mSortedCache;
 	return current_cache.size();
@@ -935,17 +1021,7 @@ int			WED_PropertyTable::GetRowCount(void)
 	if (mVertical)
 		return mColNames.size();
 
-	if (!mCacheValid)
-	{
-		if (mSearchFilter.empty() == true)
-		{
-			RebuildCache();
-		}
-		else
-		{
-			Resort();
-		}
-	}
+	ValidateCache();
 
 	vector<WED_Thing*>& current_cache = mSearchFilter.empty() ? mThingCache : mSortedCache;
 	return current_cache.size();
@@ -966,6 +1042,13 @@ void	WED_PropertyTable::ReceiveMessage(
 		if (mSelOnly && (inParam & wed_Change_Selection))
 			mCacheValid = false;
 
+		// Nothing that changes rows happened - don't make the next update sift through these changes.
+		if (mCacheValid && mSearchFilter.empty() && mThingSync >= 0)
+		{
+			WED_Archive * arch = GetArchive(mResolver);
+			if (arch) mThingSync = arch->ChangeLogEnd();
+		}
+
 		if (mDynamicCols)
 		{
 			set<string>	cols;
@@ -1021,7 +1104,7 @@ void WED_PropertyTable::SetClosed(const set<int>& closed_list)
 	{
 	    SetOpen(*it,0);
 	}
-	mCacheValid = false;
+	InvalidateRows();
 	BroadcastMessage(GUI_TABLE_CONTENT_RESIZED,0);
 }
 
@@ -1043,58 +1126,86 @@ void WED_PropertyTable::GetClosed(set<int>& closed_list)
 //--IFilterable----------------------------------------------------------------
 void WED_PropertyTable::SetFilter(const string & filter)
 {
+	mSearchFilter = filter;
 	if(filter.empty())
 	{
-		RebuildCache();  // rebuild mCache, so any changes of the hierachy list get recognized
+		mCacheValid = false;
+		ValidateCache();  // update mCache, so any changes of the hierachy list get recognized
 	}
 
-	mSearchFilter = filter;
 	Resort();            // this only rebuilds the mSortedCache, not the mCache
 
 	BroadcastMessage(GUI_TABLE_CONTENT_RESIZED, 0);
 }
 
-//parameters
-//thing - the current thing
-//search_filter - the search filter
-//sorted_cache - the sorted_cache of wed things we're building up
-//sorted_open_ids - the hash map of id and true false if its open or not
-//returns number of bad leafs
-int collect_recusive(WED_Thing * thing, const ci_string& isearch_filter, vector<WED_Thing*>& sorted_cache)
+static int append_lower(vector<char>& text, const string& s)
 {
-	DebugAssert(thing != NULL);
+	int r = text.size();
+	for (string::const_iterator c = s.begin(); c != s.end(); ++c)
+		text.push_back(tolower((unsigned char) *c));
+	text.push_back(0);
+	return r;
+}
 
-	bool is_group_like = thing->GetClass() == WED_Group::sClass   ||
-						 thing->GetClass() == WED_Airport::sClass ||
-						 thing->GetClass() == WED_ATCFlow::sClass;
+void WED_PropertyTable::AddToFilterIndex(WED_Thing * thing)
+{
+	int me = mFilterIndex.size();
+	FilterEntry e;
+	e.thing = thing;
+	e.group_like = thing->GetClass() == WED_Group::sClass   ||
+				   thing->GetClass() == WED_Airport::sClass ||
+				   thing->GetClass() == WED_ATCFlow::sClass;
 
 	string thing_name;
 	thing->GetName(thing_name);
-	ci_string ithing_name(thing_name.begin(),thing_name.end());
-	bool is_match = ithing_name.find(isearch_filter) != ci_string::npos;
-	IHasResourceOrAttr * has_resource_thing = NULL;
+	e.name = append_lower(mFilterText, thing_name);
 
-	if (is_match == false)
+	IHasResourceOrAttr * has_resource_thing = dynamic_cast<IHasResourceOrAttr*>(thing);
+	e.res = -1;
+	if (has_resource_thing)
 	{
-		has_resource_thing = dynamic_cast<IHasResourceOrAttr*>(thing);
-		if (has_resource_thing)
-		{
-			string res;
-			has_resource_thing->GetResource(res);
-//			string n; thing->GetName(n);
-//			printf("%s: r=%s\n",n.c_str(), res.c_str());
-			res = string ("^") + res + "$";       // Adding ^ and $ are to emulate regex-style line start/end makers, so to
-			                                      // allow macthing one of "Red Line", "Red Line (Black)" or "Wide Red Line"
-			is_match |= ci_string(res.begin(), res.end()).find(isearch_filter) != ci_string::npos;
-		}
+		string res;
+		has_resource_thing->GetResource(res);
+		e.res = append_lower(mFilterText, string ("^") + res + "$");	// Adding ^ and $ are to emulate regex-style line start/end makers, so to
+																		// allow macthing one of "Red Line", "Red Line (Black)" or "Wide Red Line"
 	}
+	e.kids = thing->CountChildren();
+	mFilterIndex.push_back(e);
+
+	for (int n = 0; n < e.kids; ++n)
+		AddToFilterIndex(thing->GetNthChild(n));
+	mFilterIndex[me].end = mFilterIndex.size();
+}
+
+void WED_PropertyTable::BuildFilterIndex(void)
+{
+	mFilterIndex.clear();
+	mFilterText.clear();
+	WED_Archive * arch = GetArchive(mResolver);
+	mFilterSync = arch ? arch->ChangeLogEnd() : -1;
+	WED_Thing * root = WED_GetWorld(mResolver);
+	if (root)
+		AddToFilterIndex(root);
+}
+
+//parameters
+//idx - the current thing's entry in the filter index
+//filter - the lower-cased search filter
+//returns number of bad leafs
+int WED_PropertyTable::CollectFiltered(int idx, const char * filter)
+{
+	const FilterEntry& e = mFilterIndex[idx];
+	const char * text = &*mFilterText.begin();
 
-	int nc = thing->CountChildren();
-	if (nc == 0 || (has_resource_thing && is_match))    // prevent showing nodes for uniformly set taxilines or taxiways
+	bool name_match = strstr(text + e.name, filter) != NULL;
+	bool res_match = !name_match && e.res >= 0 && strstr(text + e.res, filter) != NULL;
+	bool is_match = name_match || res_match;
+
+	if (e.kids == 0 || res_match)    // prevent showing nodes for uniformly set taxilines or taxiways
 	{
 		if (is_match)
 		{
-			sorted_cache.push_back(thing);
+			mSortedCache.push_back(e.thing);
 			return 0; //No bad leafs here!
 		}
 		else
@@ -1104,18 +1215,18 @@ int collect_recusive(WED_Thing * thing, const ci_string& isearch_filter, vector<
 	}
 	else
 	{
-		int current_end_pos = sorted_cache.size();
+		int current_end_pos = mSortedCache.size();
 		int bad_leafs = 0;
-		for (int n = 0; n < nc; ++n)
+		for (int n = idx + 1; n < e.end; n = mFilterIndex[n].end)
 		{
-			bad_leafs += collect_recusive(thing->GetNthChild(n), isearch_filter, sorted_cache);
+			bad_leafs += CollectFiltered(n, filter);
 		}
 
 		//If bad_leafs is less than the number of kids it means that there is at least some reason to keep this group
 		//Or if the group name exactly matches
-		if ((bad_leafs < nc && is_group_like) || is_match)
+		if ((bad_leafs < e.kids && e.group_like) || is_match)
 		{
-			sorted_cache.insert(sorted_cache.begin() + current_end_pos, thing);
+			mSortedCache.insert(mSortedCache.begin() + current_end_pos, e.thing);
 			return 0;
 		}
 		else
@@ -1130,9 +1241,26 @@ void WED_PropertyTable::Resort()
 	mSortedCache.clear();
 	if (mSearchFilter.empty() == false)
 	{
-		mSortedCache.reserve(mThingCache.size());
-		ci_string isearch_filter(mSearchFilter.begin(), mSearchFilter.end());
-		collect_recusive(WED_GetWorld(mResolver), isearch_filter, mSortedCache);
+		// The index only goes stale when something other than the selection changes - clicking on search results is free.
+		WED_Archive * arch = GetArchive(mResolver);
+		vector<int>	changed;
+		bool stale = mFilterSync < 0 || arch == NULL || !arch->GetChangesSince(mFilterSync, changed);
+		WED_Thing * sel = dynamic_cast<WED_Thing *>(WED_GetSelect(mResolver));
+		for (vector<int>::iterator c = changed.begin(); c != changed.end() && !stale; ++c)
+			if (sel == NULL || *c != sel->GetID())
+				stale = true;
+		if (stale)
+			BuildFilterIndex();
+		else
+			mFilterSync = arch->ChangeLogEnd();
+
+		string lower_filter;
+		for (string::iterator c = mSearchFilter.begin(); c != mSearchFilter.end(); ++c)
+			lower_filter += tolower((unsigned char) *c);
+
+		mSortedCache.reserve(mFilterIndex.size());
+		if (!mFilterIndex.empty())
+			CollectFiltered(0, lower_filter.c_str());
 	}
 	mCacheValid = true;
 }
@@ -35,6 +35,22 @@ class	WED_Thing;
 class	WED_Archive;
 class	WED_Select;
 
+/*
+	WED_PropertyTable - THEORY OF OPERATION
+
+	The table shows a flattened list of things - in hierarchy order, or the things matching the search filter.  It keeps that list
+	cached (mThingCache, or mSortedCache while filtering) and only re-walks the document when the list may have changed.
+
+	The hierarchy list is updated in place where we can: rows carry their depth in the tree, so a thing's subtree is the run of rows
+	after it that are deeper than it is.  When the archive changes structurally, we ask it which objects were touched since we last
+	synced and regenerate just the subtrees of the touched things that have rows - the parent of anything added or removed is always
+	among them.  Disclosing or closing a row regenerates only that row's subtree.  Vertical, selection-only and class-filtered tables
+	are selection-sized or special, and just rebuild.
+
+	Searching walks a flat index of the whole document holding lower-cased names and resources, built the first time the filter is
+	used after the document changed.  Typing in the filter bar then costs a string scan per thing, with no calls into the things.
+*/
+
 class	WED_PropertyTable : public GUI_TextTableProvider, public GUI_SimpleTableGeometry, public GUI_Listener, public GUI_TextTableHeaderProvider, public GUI_Broadcaster {
 public:
 
@@ -172,8 +188,20 @@ public:
 
 private:
 
+	struct ThingRow {
+		int				id;				// So we can tell a row is dead without touching its thing
+		int				depth;			// Below the world
+	};
+
+			void			ValidateCache(void);
+			void			InvalidateRows(void);
 			void			RebuildCache(void);
-			void			RebuildCacheRecursive(WED_Thing * e, ISelection * sel, set<WED_Thing *> * sel_and_friends);
+			void			RebuildCacheRecursive(WED_Thing * e, ISelection * sel, set<WED_Thing *> * sel_and_friends, int depth,
+									vector<WED_Thing *>& out_things, vector<ThingRow>& out_rows);
+			bool			CanUpdateIncrementally(void) const { return !mVertical && !mSelOnly && mFilter.empty(); }
+			bool			UpdateCache(void);
+			int				SubtreeEnd(int idx) const;
+			void			ReplaceSubtree(int idx, WED_Thing * t, ISelection * sel);
 			WED_Thing *		FetchNth(int row);
 			int				GetThingDepth(WED_Thing * d);
 
@@ -187,10 +215,27 @@ private:
 									int&	is_disclose);
 
 			void	Resort();
+			void	BuildFilterIndex(void);
+			void	AddToFilterIndex(WED_Thing * t);
+			int		CollectFiltered(int idx, const char * filter);
 
 	vector<WED_Thing *>			mThingCache;
+	vector<ThingRow>			mThingRows;			// Parallel to mThingCache
+	long long					mThingSync;			// Archive change log position mThingCache is up to date with, -1 if none
 	vector<WED_Thing *>			mSortedCache;
 
+	struct FilterEntry {
+		WED_Thing *		thing;
+		int				end;			// Index past our subtree
+		int				kids;
+		int				name;			// Lower-cased name in mFilterText
+		int				res;			// Lower-cased "^resource$" in mFilterText, -1 if we have no resource
+		bool			group_like;
+	};
+	vector<FilterEntry>			mFilterIndex;
+	vector<char>				mFilterText;
+	long long					mFilterSync;		// Archive change log position the filter index is up to date with, -1 if none
+
 	string						mSearchFilter;
 
 	bool						mCacheValid;
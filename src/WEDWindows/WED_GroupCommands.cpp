@@ -1091,28 +1091,35 @@ set<WED_Thing *> WED_select_doubles(WED_Thing * t)
 			pts.push_back(*s);
 	}
 
-	set<WED_Thing *> doubles;
-	
-	// Ben says: yes this totally sucks - replace it someday?
+	// Only points within DOUBLE_PT_DIST on both axes can be doubles, so let the grid find those pairs rather than
+	// trying every point against every other.  Pairs come sorted, so for each i we still stop at its first double,
+	// same as a plain i/j loop.
+	vector<Point2>	locs(pts.size());
+	vector<Bbox2>	boxes(pts.size());
 	for(int i = 0; i < pts.size(); ++i)
 	{
-		for(int j = i + 1; j < pts.size(); ++j)
+		IGISPoint * ii = dynamic_cast<IGISPoint *>(pts[i]);
+		DebugAssert(ii);
+		ii->GetLocation(gis_Geo, locs[i]);
+		boxes[i] = Bbox2(locs[i]);
+		boxes[i].expand(DOUBLE_PT_DIST * 0.5);
+	}
+
+	vector<pair<int,int> >	pairs;
+	FindOverlappingBoxes(boxes, pairs);
+
+	set<WED_Thing *> doubles;
+
+	int last_i = -1;
+	for(vector<pair<int,int> >::iterator p = pairs.begin(); p != pairs.end(); ++p)
+	{
+		if(p->first == last_i)
+			continue;
+		if(locs[p->first].squared_distance(locs[p->second]) < (DOUBLE_PT_DIST*DOUBLE_PT_DIST))
 		{
-			IGISPoint * ii = dynamic_cast<IGISPoint *>(pts[i]);
-			IGISPoint * jj = dynamic_cast<IGISPoint *>(pts[j]);
-			DebugAssert(ii != jj);
-			DebugAssert(ii);
-			DebugAssert(jj);
-			Point2 p1, p2;
-			ii->GetLocation(gis_Geo, p1);
-			jj->GetLocation(gis_Geo, p2);
-			
-			if(p1.squared_distance(p2) < (DOUBLE_PT_DIST*DOUBLE_PT_DIST))
-			{
-				doubles.insert(pts[i]);
-				doubles.insert(pts[j]);
-				break;
-			}			
+			doubles.insert(pts[p->first]);
+			doubles.insert(pts[p->second]);
+			last_i = p->first;
 		}
 	}
 	return doubles;
@@ -1151,46 +1158,54 @@ set<WED_GISEdge *> WED_do_select_crossing(WED_Thing * t)
 
 set<WED_GISEdge *> WED_do_select_crossing(const vector<WED_GISEdge *> edges)
 {
-	set<WED_GISEdge*> crossed_edges;
-	// Ben says: yes this totally sucks - replace it someday?
+	// Two edges can only cross if their bounding boxes overlap - let the grid find those pairs instead of testing
+	// every edge against every other.
+	vector<Bezier2>	sides(edges.size());
+	vector<bool>	is_bez(edges.size());
+	vector<Bbox2>	boxes(edges.size());
 	for (int i = 0; i < edges.size(); ++i)
 	{
-		for (int j = i + 1; j < edges.size(); ++j)
+		DebugAssert(edges[i]);
+		is_bez[i] = edges[i]->GetSide(gis_Geo, 0, sides[i]);
+		if (is_bez[i])
+			sides[i].bounds_fast(boxes[i]);
+		else
+			boxes[i] = Bbox2(sides[i].p1, sides[i].p2);
+	}
+
+	vector<pair<int,int> >	pairs;
+	FindOverlappingBoxes(boxes, pairs);
+
+	set<WED_GISEdge*> crossed_edges;
+	for (vector<pair<int,int> >::iterator p = pairs.begin(); p != pairs.end(); ++p)
+	{
+		int i = p->first;
+		int j = p->second;
+		const Bezier2& b1(sides[i]);
+		const Bezier2& b2(sides[j]);
+
+		if (is_bez[i] || is_bez[j])
+		{   // should never get here, as edges (used for ATC routes only) are not supposed to have bezier segments
+			if (b1.intersect(b2, 10))
+			{
+				crossed_edges.insert(edges[i]);
+				crossed_edges.insert(edges[j]);
+			}
+		}
+		else 
 		{
-			IGISEdge * ii = edges[i];
-			IGISEdge * jj = edges[j];
-			DebugAssert(ii != jj);
-			DebugAssert(ii);
-			DebugAssert(jj);
-			Bezier2 b1, b2;
-			bool isb1, isb2;
-
-			isb1 = ii->GetSide(gis_Geo, 0, b1);
-			isb2 = jj->GetSide(gis_Geo, 0, b2);
-			
-			if (isb1 || isb2)
-			{   // should never get here, as edges (used for ATC routes only) are not supposed to have bezier segments
-				if (b1.intersect(b2, 10))
+			Point2 x;
+			if (b1.p1 != b2.p1 &&
+				b1.p2 != b2.p2 &&
+				b1.p1 != b2.p2 &&
+				b1.p2 != b2.p1)
+			{
+				if (b1.as_segment().intersect(b2.as_segment(), x))
 				{
 					crossed_edges.insert(edges[i]);
 					crossed_edges.insert(edges[j]);
 				}
 			}
-			else 
-			{
-				Point2 x;
-				if (b1.p1 != b2.p1 &&
-					b1.p2 != b2.p2 &&
-					b1.p1 != b2.p2 &&
-					b1.p2 != b2.p1)
-				{
-					if (b1.as_segment().intersect(b2.as_segment(), x))
-					{
-						crossed_edges.insert(edges[i]);
-						crossed_edges.insert(edges[j]);
-					}
-				}
-			}
 		}
 	}
 
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "WED_GroupCommands.h"
+#include "WED_Archive.h"
+#include "WED_UndoLayer.h"
+#include "WED_Group.h"
+#include "WED_TaxiRoute.h"
+#include "WED_TaxiRouteNode.h"
+#include "XESConstants.h"
+#include "PerfUtils.h"
+#include "AssertUtils.h"
+
+/*
+	These run the real select-doubles and select-crossing passes over a scratch archive of taxi routes.  The
+	routes are a jittered grid of nodes joined by edges, so nothing crosses and nothing is doubled until we plant
+	it: a node stacked next to a grid node, a cell with both diagonals.  What we planted is exactly what the
+	passes must find.
+
+	The last case is a 20k edge airport, timed, so the cost of the passes on a big airport shows up in the
+	self-test output.
+*/
+
+static unsigned int	sSeed = 1;
+
+static double	test_rand(double lo, double hi)
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return lo + (hi - lo) * (double) ((sSeed >> 8) & 0xFFFFFF) / (double) 0xFFFFFF;
+}
+
+// About 50 meters between grid nodes, jittered by up to 10 - the cells stay convex, so a cell's diagonals never
+// cross its sides.
+#define	TEST_GRID	(50.0 * MTR_TO_DEG_LAT)
+#define	TEST_JITTER	(10.0 * MTR_TO_DEG_LAT)
+
+struct	test_routes {
+	WED_Group *						root;
+	int								dim;
+	vector<WED_TaxiRouteNode *>		nodes;
+	set<WED_Thing *>				doubles;		// What select-doubles must find
+	set<WED_GISEdge *>				crossed;		// What select-crossing must find
+	vector<WED_GISEdge *>			edges;
+};
+
+static WED_TaxiRouteNode *	test_node(WED_Thing * parent, const Point2& p)
+{
+	WED_TaxiRouteNode * n = WED_TaxiRouteNode::CreateTyped(parent->GetArchive());
+	n->SetLocation(gis_Geo, p);
+	n->SetParent(parent, parent->CountChildren());
+	return n;
+}
+
+static WED_TaxiRoute *	test_edge(WED_Thing * parent, WED_Thing * src, WED_Thing * dst, test_routes& r)
+{
+	WED_TaxiRoute * e = WED_TaxiRoute::CreateTyped(parent->GetArchive());
+	e->AddSource(src, 0);
+	e->AddSource(dst, 1);
+	e->SetParent(parent, parent->CountChildren());
+	r.edges.push_back(e);
+	return e;
+}
+
+// A dim x dim grid of nodes, joined along the rows and columns.  Every few cells gets one diagonal, which crosses
+// nothing, or both, which cross each other.  Every few nodes gets a second node stacked within a meter, joined
+// to it by a short edge - anything longer would cross the grid node's own edges.  Half the grid goes into a
+// sub-group, so the passes have to look down the hierarchy.
+static void	make_test_routes(WED_Archive * arch, int dim, test_routes& r)
+{
+	r.root = WED_Group::CreateTyped(arch);
+	r.dim = dim;
+	r.nodes.clear();
+	r.doubles.clear();
+	r.crossed.clear();
+	r.edges.clear();
+
+	WED_Group * sub = WED_Group::CreateTyped(arch);
+	sub->SetParent(r.root, 0);
+
+	Point2	origin(-122.0, 37.0);
+	for(int y = 0; y < dim; ++y)
+	for(int x = 0; x < dim; ++x)
+		r.nodes.push_back(test_node(y < dim / 2 ? sub : r.root, origin + Vector2(
+							x * TEST_GRID + test_rand(-TEST_JITTER, TEST_JITTER),
+							y * TEST_GRID + test_rand(-TEST_JITTER, TEST_JITTER))));
+
+	for(int y = 0; y < dim; ++y)
+	for(int x = 0; x < dim; ++x)
+	{
+		WED_Thing * parent = y < dim / 2 ? sub : r.root;
+		WED_TaxiRouteNode * n = r.nodes[y * dim + x];
+		if(x + 1 < dim)	test_edge(parent, n, r.nodes[y * dim + x + 1], r);
+		if(y + 1 < dim)	test_edge(parent, n, r.nodes[(y + 1) * dim + x], r);
+
+		if(x + 1 < dim && y + 1 < dim)
+		{
+			double k = test_rand(0, 1);
+			if(k < 0.05)
+				test_edge(parent, n, r.nodes[(y + 1) * dim + x + 1], r);
+			else if(k < 0.08)
+			{
+				r.crossed.insert(test_edge(parent, n, r.nodes[(y + 1) * dim + x + 1], r));
+				r.crossed.insert(test_edge(parent, r.nodes[y * dim + x + 1], r.nodes[(y + 1) * dim + x], r));
+			}
+		}
+
+		if(test_rand(0, 1) < 0.03)
+		{
+			Point2 p;
+			n->GetLocation(gis_Geo, p);
+			WED_TaxiRouteNode * d = test_node(parent, p + Vector2(test_rand(-0.5, 0.5), test_rand(-0.5, 0.5)) * MTR_TO_DEG_LAT);
+			test_edge(parent, d, n, r);
+			r.doubles.insert(n);
+			r.doubles.insert(d);
+		}
+	}
+
+	// A node stacked on a grid node but not used by any edge doesn't count.
+	Point2 p;
+	r.nodes[0]->GetLocation(gis_Geo, p);
+	test_node(r.root, p);
+}
+
+static void	TEST_SelectDoubles(WED_Archive * arch)
+{
+	test_routes	r;
+	make_test_routes(arch, 20, r);
+
+	set<WED_Thing *> doubles = WED_select_doubles(r.root);
+	TEST_Run(!r.doubles.empty());
+	TEST_Run(doubles == r.doubles);
+
+	// Nodes stacked exactly on top of each other are doubles too.
+	WED_Thing * a = r.nodes[r.dim + 1];
+	Point2 p;
+	dynamic_cast<IGISPoint *>(a)->GetLocation(gis_Geo, p);
+	test_edge(r.root, test_node(r.root, p), r.nodes[r.dim + 2], r);
+	doubles = WED_select_doubles(r.root);
+	TEST_Run(doubles.size() == r.doubles.size() + (r.doubles.count(a) ? 1 : 2));
+	TEST_Run(doubles.count(a));
+}
+
+static void	TEST_SelectCrossing(WED_Archive * arch)
+{
+	test_routes	r;
+	make_test_routes(arch, 20, r);
+
+	set<WED_GISEdge *> crossed = WED_do_select_crossing(r.root);
+	TEST_Run(!r.crossed.empty());
+	TEST_Run(crossed == r.crossed);
+	TEST_Run(WED_do_select_crossing(r.edges) == r.crossed);
+
+	// An edge clear across the grid crosses a couple of edges per row, and the planted crossings are still found.
+	WED_GISEdge * across = test_edge(r.root, r.nodes[1], r.nodes[r.dim * r.dim - 2], r);
+	crossed = WED_do_select_crossing(r.root);
+	TEST_Run(crossed.count(across));
+	TEST_Run(crossed.size() > r.crossed.size() + r.dim);
+	for(set<WED_GISEdge *>::iterator c = r.crossed.begin(); c != r.crossed.end(); ++c)
+		TEST_Run(crossed.count(*c));
+}
+
+static void	TEST_SelectLarge(WED_Archive * arch)
+{
+	test_routes	r;
+	make_test_routes(arch, 100, r);
+	printf("Taxi routes: %d edges.\n", (int) r.edges.size());
+	TEST_Run(r.edges.size() >= 20000);
+
+	set<WED_Thing *> doubles;
+	set<WED_GISEdge *> crossed;
+	{
+		StElapsedTime	timer("Select doubles");
+		doubles = WED_select_doubles(r.root);
+	}
+	{
+		StElapsedTime	timer("Select crossing");
+		crossed = WED_do_select_crossing(r.root);
+	}
+	TEST_Run(doubles == r.doubles);
+	TEST_Run(crossed == r.crossed);
+}
+
+void	TEST_GroupCommands(void)
+{
+	WED_Archive	arch(NULL);
+	arch.SetUndo(UNDO_DISCARD);
+
+	TEST_SelectDoubles(&arch);
+	TEST_SelectCrossing(&arch);
+	TEST_SelectLarge(&arch);
+
+	arch.ClearAll();
+	arch.SetUndo(NULL);
+}
@@ -526,6 +526,7 @@ void ProcessAirports(const AptVector& apts, Pmwx& ioMap, DEMGeo& elevation, DEMG
 	{
 		transport_src.copy_geo_from(transport);
 		transport_src = 1.0;
+		working = DEM_NO_DATA;
 	}
 
 	PROGRESS_START(prog, 0, 1, "Burning in airports...")
@@ -595,7 +596,9 @@ void ProcessAirports(const AptVector& apts, Pmwx& ioMap, DEMGeo& elevation, DEMG
 			SimplifyAirportAreasAndSplat(ioMap, foo, apts[n].boundaries.empty(), simple_faces, fill_dirt2apt, NULL);
 			if (dems)
 			{
-				working = DEM_NO_DATA;
+				// working is all DEM_NO_DATA outside the box we touch for this airport - so we only need to buffer,
+				// copy back and clean up that box instead of the whole DEM, once per airport.
+				int dx1 = 0, dy1 = 0, dx2 = 0, dy2 = 0;
 				if (ClipDEMToFaceSet(simple_faces, elevation, working, x1, y1, x2, y2))
 				{
 					working.copy_geo_from(elevation);
@@ -611,8 +614,12 @@ void ProcessAirports(const AptVector& apts, Pmwx& ioMap, DEMGeo& elevation, DEMG
 						++x2;
 						++y2;
 //						SpreadDEMValues(working, 1, x1, y1, x2, y2);
-						dem_copy_buffer_one(elevation, working, DEM_NO_DATA);
+						dem_copy_buffer_one(elevation, working, DEM_NO_DATA, x1, y1, x2, y2);
 					#endif
+					dx1 = max(x1, 0);
+					dy1 = max(y1, 0);
+					dx2 = min(x2, working.mWidth);
+					dy2 = min(y2, working.mHeight);
 					DEMGeo		airport_area;
 					working.subset(airport_area, x1, y1, x2-1,y2-1);
 					
@@ -659,7 +666,13 @@ void ProcessAirports(const AptVector& apts, Pmwx& ioMap, DEMGeo& elevation, DEMG
 							working(x,y) = airport_area(x-x1,y-y1);
 					}
 				}
-				elevation.overlay(working);
+				for (y = dy1; y < dy2; ++y)
+				for (x = dx1; x < dx2; ++x)
+				if (working(x,y) != DEM_NO_DATA)
+				{
+					elevation(x,y) = working(x,y);
+					working(x,y) = DEM_NO_DATA;
+				}
 				ClipDEMToFaceSet(simple_faces, transport_src, transport, x1, y1, x2, y2);
 			}
 		}
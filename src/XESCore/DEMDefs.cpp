@@ -694,6 +694,36 @@ void dem_copy_buffer_one(const DEMGeo& orig_src, DEMGeo& io_dst, float null_valu
 	}
 }
 
+void dem_copy_buffer_one(const DEMGeo& orig_src, DEMGeo& io_dst, float null_value, int x1, int y1, int x2, int y2)
+{
+	x1 = max(x1, 0);
+	y1 = max(y1, 0);
+	x2 = min(x2, io_dst.mWidth);
+	y2 = min(y2, io_dst.mHeight);
+
+	vector<DEMGeo::address>	fill;
+	for(int y = y1; y < y2; ++y)
+	for(int x = x1; x < x2; ++x)
+	if(io_dst(x,y) == null_value)
+	{
+		const int x_off[8] = { -1, 1, 0, 0, -1, -1, 1, 1 };
+		const int y_off[8] = { 0, 0, -1, 1, -1, 1, -1, 1 };
+
+		for(int n = 0; n < 8; ++n)
+		{
+			DEMGeo::coordinates nn(x + x_off[n], y + y_off[n]);
+			if(io_dst.valid(nn) && io_dst[nn] != null_value)
+			{
+				fill.push_back(io_dst.to_address(DEMGeo::coordinates(x,y)));
+				break;
+			}
+		}
+	}
+
+	for(vector<DEMGeo::address>::iterator a = fill.begin(); a != fill.end(); ++a)
+		io_dst[*a] = orig_src[*a];
+}
+
 void		dem_erode(DEMGeo& dem, int steps, float null_value)
 {
 	address_fifo fifo(dem.mWidth * dem.mHeight);
@@ -1183,6 +1213,165 @@ float	DEMGeo_LocalMinMaxWithCache(
 	return maxh - minh;
 }
 
+/*
+ * DEMGeoSummary
+ *
+ */
+DEMGeoSummary::DEMGeoSummary(const DEMGeo& inDEM) : mDEM(inDEM), mSumsW(-1), mSumsH(-1), mExtremaW(-1), mExtremaH(-1)
+{
+}
+
+void	DEMGeoSummary::invalidate(void)
+{
+	mSumsW = mSumsH = mExtremaW = mExtremaH = -1;
+	mSum.clear();
+	mCount.clear();
+	mLevelWidth.clear();
+	mMin.clear();
+	mMax.clear();
+}
+
+bool	DEMGeoSummary::clip(int& x1, int& y1, int& x2, int& y2) const
+{
+	if (x1 < 0) x1 = 0;
+	if (y1 < 0) y1 = 0;
+	if (x2 > mDEM.mWidth) x2 = mDEM.mWidth;
+	if (y2 > mDEM.mHeight) y2 = mDEM.mHeight;
+	return x1 < x2 && y1 < y2;
+}
+
+void	DEMGeoSummary::build_sums(void) const
+{
+	if (mSumsW == mDEM.mWidth && mSumsH == mDEM.mHeight) return;
+	int w = mDEM.mWidth, h = mDEM.mHeight, stride = w + 1;
+	mSum.assign(stride * (h + 1), 0.0);
+	mCount.assign(stride * (h + 1), 0);
+	for (int y = 0; y < h; ++y)
+	{
+		const float * src = mDEM.mData + y * w;
+		const double * sum_below = &mSum[y * stride];
+		const int * count_below = &mCount[y * stride];
+		double * sum_row = &mSum[(y+1) * stride];
+		int * count_row = &mCount[(y+1) * stride];
+		double	row_sum = 0.0;
+		int		row_count = 0;
+		for (int x = 0; x < w; ++x)
+		{
+			if (src[x] != DEM_NO_DATA)
+			{
+				row_sum += src[x];
+				++row_count;
+			}
+			sum_row[x+1] = sum_below[x+1] + row_sum;
+			count_row[x+1] = count_below[x+1] + row_count;
+		}
+	}
+	mSumsW = w;
+	mSumsH = h;
+}
+
+void	DEMGeoSummary::build_extrema(void) const
+{
+	if (mExtremaW == mDEM.mWidth && mExtremaH == mDEM.mHeight) return;
+	int h = mDEM.mHeight;
+	mLevelWidth.clear();
+	mMin.clear();
+	mMax.clear();
+
+	int lw = mDEM.mWidth;
+	while (lw > 1)
+	{
+		int nw = (lw + 1) / 2;
+		mLevelWidth.push_back(nw);
+		mMin.push_back(vector<float>(nw * h));
+		mMax.push_back(vector<float>(nw * h));
+		vector<float>& omin(mMin.back());
+		vector<float>& omax(mMax.back());
+
+		bool first = mMin.size() == 1;
+		const float * imin = first ? mDEM.mData : &*mMin[mMin.size()-2].begin();
+		const float * imax = first ? mDEM.mData : &*mMax[mMax.size()-2].begin();
+		for (int y = 0; y < h; ++y)
+		for (int x = 0; x < nw; ++x)
+		{
+			int i = y * lw + x * 2;
+			if (x * 2 + 1 < lw)
+			{
+				omin[y * nw + x] = MIN_NODATA(imin[i], imin[i+1]);
+				omax[y * nw + x] = MAX_NODATA(imax[i], imax[i+1]);
+			}
+			else
+			{
+				omin[y * nw + x] = imin[i];
+				omax[y * nw + x] = imax[i];
+			}
+		}
+		lw = nw;
+	}
+	mExtremaW = mDEM.mWidth;
+	mExtremaH = mDEM.mHeight;
+}
+
+int		DEMGeoSummary::count(int x1, int y1, int x2, int y2) const
+{
+	if (!clip(x1, y1, x2, y2)) return 0;
+	build_sums();
+	int stride = mDEM.mWidth + 1;
+	return mCount[y2 * stride + x2] - mCount[y1 * stride + x2] - mCount[y2 * stride + x1] + mCount[y1 * stride + x1];
+}
+
+double	DEMGeoSummary::sum(int x1, int y1, int x2, int y2) const
+{
+	if (!clip(x1, y1, x2, y2)) return 0.0;
+	build_sums();
+	int stride = mDEM.mWidth + 1;
+	return mSum[y2 * stride + x2] - mSum[y1 * stride + x2] - mSum[y2 * stride + x1] + mSum[y1 * stride + x1];
+}
+
+float	DEMGeoSummary::average(int x1, int y1, int x2, int y2) const
+{
+	int c = count(x1, y1, x2, y2);
+	if (c == 0) return DEM_NO_DATA;
+	return sum(x1, y1, x2, y2) / (double) c;
+}
+
+void	DEMGeoSummary::min_max(int x1, int y1, int x2, int y2, float& io_min, float& io_max) const
+{
+	if (!clip(x1, y1, x2, y2)) return;
+	for (int y = y1; y < y2; ++y)
+		run_min_max(x1, x2, y, io_min, io_max);
+}
+
+void	DEMGeoSummary::run_min_max(int x1, int x2, int y, float& io_min, float& io_max) const
+{
+	int y2 = y + 1;
+	if (!clip(x1, y, x2, y2)) return;
+	build_extrema();
+
+	// Classic bottom-up segment walk: peel off the odd pixel at either end, then go up a level where each pixel
+	// covers twice as much.  Level 0 is the DEM itself.
+	const float * row = mDEM.mData + y * mDEM.mWidth;
+	for (int level = 0; x1 < x2; ++level)
+	{
+		const float * rmin = level ? &mMin[level-1][y * mLevelWidth[level-1]] : row;
+		const float * rmax = level ? &mMax[level-1][y * mLevelWidth[level-1]] : row;
+		if (x1 & 1)
+		{
+			io_min = MIN_NODATA(io_min, rmin[x1]);
+			io_max = MAX_NODATA(io_max, rmax[x1]);
+			++x1;
+		}
+		if (x2 & 1)
+		{
+			--x2;
+			io_min = MIN_NODATA(io_min, rmin[x2]);
+			io_max = MAX_NODATA(io_max, rmax[x2]);
+		}
+		x1 >>= 1;
+		x2 >>= 1;
+	}
+}
+
 DEMMask::DEMMask() :
 	mWest(-180), mEast(180), mSouth(-90), mNorth(90),
 	mWidth(0),mHeight(0), mPost(1)
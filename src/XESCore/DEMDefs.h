@@ -378,6 +378,8 @@ void		dem_coverage_nearest(const DEMGeo& d, double lon1, double lat1, double lon
 
 // IMPORTANT: the original values must ALL be filled in in orig_src - io_dst should have the voids!
 void		dem_copy_buffer_one(const DEMGeo& orig_src, DEMGeo& io_dst, float null_value);
+// Same, but only looks at pixels in [x1,x2) x [y1,y2) - for when all of io_dst's data is well inside that box.
+void		dem_copy_buffer_one(const DEMGeo& orig_src, DEMGeo& io_dst, float null_value, int x1, int y1, int x2, int y2);
 void		dem_erode(DEMGeo& io_dem, int steps, float null_value);
 
 // Given two DEMs that represent the minimum and maximum possible values for various
@@ -442,6 +444,70 @@ float	DEMGeo_LocalMinMaxWithCache(
 			float& 					minh,
 			float& 					maxh);
 
+/*************************************************************************************
+ * DEMGeoSummary - FAST SUMS, AVERAGES AND EXTREMA OVER RUNS AND BOXES
+ *************************************************************************************
+
+	A summary answers "how many valid pixels, what do they add up to, what is the lowest and highest" for a run of
+	pixels or a box without visiting every pixel:
+
+	- A summed-area table of the values and of the count of valid pixels gives counts, sums and averages of any
+	  box in O(1).  A run is just a box one pixel tall.
+	- A min/max pyramid - like DEMGeo_BuildMinMax, but each level halves only the width - gives the min and max
+	  of a run in O(log n).  A box costs one run per row.
+
+	The pyramid halves rows rather than squares because almost every caller asks about polygons, which
+	PolyRasterizer hands us as one run per scanline - a square pyramid cannot answer a one-pixel-tall question any
+	faster than looking at the pixels.
+
+	The summary keeps a reference to the DEM and builds each half (sums, extrema) the first time it is needed, so
+	build it once outside a per-face loop.  DEMGeo hands out raw pixel pointers, so the summary cannot see writes -
+	call invalidate() after changing pixels.  (It does notice the DEM being resized.)  Because of the lazy build, a
+	summary shared between threads must be built up front with build() - after that it is read-only.
+
+	Coordinates are pixels: runs are [x1,x2) on row y, boxes [x1,x2) x [y1,y2).  Pixels off the DEM and pixels that
+	are DEM_NO_DATA are skipped, like DEMGeo::get.  min_max folds into io_min and io_max with MIN_NODATA/MAX_NODATA,
+	so start them at DEM_NO_DATA; they stay DEM_NO_DATA if nothing valid was found.
+
+ *************************************************************************************/
+
+class	DEMGeoSummary {
+public:
+	explicit	DEMGeoSummary(const DEMGeo& inDEM);
+
+	void		invalidate(void);
+	void		build(void) const { build_sums(); build_extrema(); }
+
+	int			count(int x1, int y1, int x2, int y2) const;
+	double		sum(int x1, int y1, int x2, int y2) const;
+	float		average(int x1, int y1, int x2, int y2) const;			// DEM_NO_DATA if no valid pixels
+	void		min_max(int x1, int y1, int x2, int y2, float& io_min, float& io_max) const;
+
+	int			run_count(int x1, int x2, int y) const { return count(x1, y, x2, y+1); }
+	double		run_sum(int x1, int x2, int y) const { return sum(x1, y, x2, y+1); }
+	void		run_min_max(int x1, int x2, int y, float& io_min, float& io_max) const;
+
+	const DEMGeo&	dem(void) const { return mDEM; }
+
+private:
+
+	bool		clip(int& x1, int& y1, int& x2, int& y2) const;
+	void		build_sums(void) const;
+	void		build_extrema(void) const;
+
+	const DEMGeo&				mDEM;
+
+	// Built lazily - remember the DEM's dimensions at build time so a resize is caught.
+	mutable int					mSumsW, mSumsH;
+	mutable vector<double>		mSum;			// (w+1) x (h+1), entry x,y is the total of [0,x) x [0,y)
+	mutable vector<int>			mCount;
+
+	mutable int					mExtremaW, mExtremaH;
+	mutable vector<int>			mLevelWidth;	// width of level k+1; level 0 is the DEM itself
+	mutable vector<vector<float> >	mMin;		// level k+1 pixel x,y = min of level k pixels 2x, 2x+1 on row y
+	mutable vector<vector<float> >	mMax;
+};
+
 
 /*************************************************************************************
  * DEMGeoMap - MULTIPLE RASTER LAYERS BY CODE
@@ -69,9 +69,9 @@ void	WriteDEM(DEMGeo& inMap, IOWriter * inWriter)
 	inWriter->WriteDouble(inMap.mEast);
 	inWriter->WriteDouble(inMap.mNorth);
 
-	EndianSwapArray(platform_Native, platform_LittleEndian, inMap.mWidth *inMap.mHeight, sizeof(float), inMap.mData);
-	inWriter->WriteBulk((const char *) inMap.mData, inMap.mWidth * inMap.mHeight * sizeof(float), false);
-	EndianSwapArray(platform_LittleEndian, platform_Native, inMap.mWidth *inMap.mHeight, sizeof(float), inMap.mData);
+	// The samples go in the stream's byte order like everything else - for XES files that is little endian,
+	// which is what they always were.
+	inWriter->WriteFloats(inMap.mData, inMap.mWidth * inMap.mHeight);
 }
 
 void	ReadDEM (		DEMGeo& inMap, IOReader * inReader)
@@ -89,8 +89,7 @@ void	ReadDEM (		DEMGeo& inMap, IOReader * inReader)
 
 	if (inMap.mData)
 	{
-		inReader->ReadBulk((char *) inMap.mData, inMap.mWidth * inMap.mHeight * sizeof(float), false);
-		EndianSwapArray(platform_LittleEndian, platform_Native, inMap.mWidth * inMap.mHeight, sizeof(float), inMap.mData);
+		inReader->ReadFloats(inMap.mData, inMap.mWidth * inMap.mHeight);
 	}
 }
 
@@ -437,14 +436,17 @@ bool	WriteFloatHGT(const DEMGeo& inMap, const char * inFileName)
 {
 	FILE * fi = fopen(inFileName, "wb");
 	if (!fi) return false;
-	FileWriter	writer(fi, platform_BigEndian);
-	char header[5] = { 'a', 0, 0, 0, 1 };
-	writer.WriteBulk(header, sizeof(header), false);
-	for (int x = 0; x < inMap.mWidth; ++x)
-	for (int y = 0; y < inMap.mHeight; ++y)
 	{
-		float v = inMap.mData[x + y * inMap.mWidth];
-		writer.WriteFloat(v);
+		// The writer buffers, and only flushes when it goes away - so it has to go away before the file does.
+		FileWriter	writer(fi, platform_BigEndian);
+		char header[5] = { 'a', 0, 0, 0, 1 };
+		writer.WriteBulk(header, sizeof(header), false);
+		for (int x = 0; x < inMap.mWidth; ++x)
+		for (int y = 0; y < inMap.mHeight; ++y)
+		{
+			float v = inMap.mData[x + y * inMap.mWidth];
+			writer.WriteFloat(v);
+		}
 	}
 	fclose(fi);
 	return true;
@@ -943,6 +943,8 @@ void	LoadDEMTables(void)
 	if(gNaturalTerrainRules[n].terrain == terrain_Airport)
 		sAirports.insert(gNaturalTerrainRules[n].name);
 
+	IndexNaturalTerrainRules();
+
 	/*
 	printf("---forests---\n");
 	for (set<int>::iterator f = sForests.begin(); f != sForests.end(); ++f)
@@ -953,6 +955,232 @@ void	LoadDEMTables(void)
 
 #pragma mark -
 
+/************************************************************************
+ * NATURAL TERRAIN RULE INDEX
+ ************************************************************************/
+
+bool	gNaturalTerrainCheckIndex = false;
+
+// Everything FindNaturalTerrain looks at, in one place.
+struct	nt_query_t {
+	int		terrain;
+	int		zoning;
+	int		landuse;
+	int		soil_style;
+	int		agri_style;
+	int		clim_style;
+	float	range[11];		// indexed by nt_range_t
+	int		water;
+	int		urban_square;
+};
+
+// The first NT_FILTERED_RANGES get stabbing tables; the rest are only used for memo keys.
+enum nt_range_t {
+	nt_slope_tri, nt_temp, nt_rain, nt_lat,
+	nt_temp_rng, nt_slope_heading, nt_rel_elev, nt_elev_range, nt_urban_density, nt_urban_trans, nt_urban_radial,
+	nt_range_count
+};
+#define NT_FILTERED_RANGES 4
+
+typedef float NaturalTerrainRule_t::*	nt_float_field;
+typedef int NaturalTerrainRule_t::*		nt_int_field;
+
+static const nt_float_field	kRangeMin[nt_range_count] = {
+	&NaturalTerrainRule_t::slope_min, &NaturalTerrainRule_t::temp_min, &NaturalTerrainRule_t::rain_min, &NaturalTerrainRule_t::lat_min,
+	&NaturalTerrainRule_t::temp_rng_min, &NaturalTerrainRule_t::slope_heading_min, &NaturalTerrainRule_t::rel_elev_min,
+	&NaturalTerrainRule_t::elev_range_min, &NaturalTerrainRule_t::urban_density_min, &NaturalTerrainRule_t::urban_trans_min,
+	&NaturalTerrainRule_t::urban_radial_min };
+static const nt_float_field	kRangeMax[nt_range_count] = {
+	&NaturalTerrainRule_t::slope_max, &NaturalTerrainRule_t::temp_max, &NaturalTerrainRule_t::rain_max, &NaturalTerrainRule_t::lat_max,
+	&NaturalTerrainRule_t::temp_rng_max, &NaturalTerrainRule_t::slope_heading_max, &NaturalTerrainRule_t::rel_elev_max,
+	&NaturalTerrainRule_t::elev_range_max, &NaturalTerrainRule_t::urban_density_max, &NaturalTerrainRule_t::urban_trans_max,
+	&NaturalTerrainRule_t::urban_radial_max };
+
+#define NT_ENUM_COUNT 4
+static const nt_int_field	kEnumField[NT_ENUM_COUNT] = {
+	&NaturalTerrainRule_t::landuse, &NaturalTerrainRule_t::clim_style, &NaturalTerrainRule_t::terrain, &NaturalTerrainRule_t::zoning };
+
+typedef vector<unsigned int>	nt_bits;		// bit n = rule n
+
+struct	nt_enum_index_t {
+	hash_map<int, nt_bits>		by_value;		// rules that take exactly this value, plus the wildcards
+	nt_bits						wild;			// rules that take anything
+};
+
+struct	nt_range_index_t {
+	vector<float>				ends;			// every min and max that is not a wildcard, sorted, no dupes
+	vector<nt_bits>				stab;			// one per elementary interval - see nt_interval
+};
+
+static struct {
+	int					rules;					// rule count when built, -1 if never
+	int					words;
+	int					generation;				// bumped per build, so old memo entries go stale
+	nt_enum_index_t		enums[NT_ENUM_COUNT];
+	nt_range_index_t	ranges[nt_range_count];
+} sNTIndex = { -1, 0, 0 };
+
+// The elementary interval x falls in: 2i+1 is exactly ends[i], 2i is the open stretch below ends[i] (2*size is
+// above all of them).  NaN lands in 0, which no bounded range accepts - nor does it accept NaN.
+static int	nt_interval(const vector<float>& ends, float x)
+{
+	int i = lower_bound(ends.begin(), ends.end(), x) - ends.begin();
+	return (i < ends.size() && ends[i] == x) ? 2 * i + 1 : 2 * i;
+}
+
+// This is THE rule test - the linear scan and the index both come down to it.
+static bool	nt_rule_matches(const NaturalTerrainRule_t& rec, const nt_query_t& q)
+{
+	for (int r = 0; r < nt_range_count; ++r)
+	{
+		float vmin = rec.*kRangeMin[r];
+		float vmax = rec.*kRangeMax[r];
+		if (vmin != vmax && !(vmin <= q.range[r] && q.range[r] <= vmax))
+			return false;
+	}
+
+	#define MATCH_ENUM(x,field) if(rec.field != NO_VALUE && x != rec.field) return false;
+
+	MATCH_ENUM(q.landuse,landuse)
+	MATCH_ENUM(q.soil_style,soil_style)
+	MATCH_ENUM(q.agri_style,agri_style)
+	MATCH_ENUM(q.clim_style,clim_style)
+	MATCH_ENUM(q.terrain,terrain)
+	MATCH_ENUM(q.zoning,zoning)
+
+	#undef MATCH_ENUM
+
+	if (!(rec.urban_square == 0 || q.urban_square == DEM_NO_DATA || rec.urban_square == q.urban_square))
+		return false;
+	if (rec.near_water && !q.water)
+		return false;
+	return true;
+}
+
+static int	nt_find_linear(const nt_query_t& q)
+{
+	for (int rec_num = 0; rec_num < gNaturalTerrainRules.size(); ++rec_num)
+	if (nt_rule_matches(gNaturalTerrainRules[rec_num], q))
+		return gNaturalTerrainRules[rec_num].name;
+	return -1;
+}
+
+static int	nt_find_indexed(const nt_query_t& q)
+{
+	if (sNTIndex.words == 0)
+		return -1;
+
+	const int	values[NT_ENUM_COUNT] = { q.landuse, q.clim_style, q.terrain, q.zoning };		// same order as kEnumField
+	const unsigned int * sets[NT_ENUM_COUNT + NT_FILTERED_RANGES];
+	int n = 0;
+	for (int e = 0; e < NT_ENUM_COUNT; ++e)
+	{
+		const nt_enum_index_t& idx(sNTIndex.enums[e]);
+		hash_map<int, nt_bits>::const_iterator i = idx.by_value.find(values[e]);
+		sets[n++] = &*(i == idx.by_value.end() ? idx.wild : i->second).begin();
+	}
+	for (int r = 0; r < NT_FILTERED_RANGES; ++r)
+	{
+		const nt_range_index_t& idx(sNTIndex.ranges[r]);
+		sets[n++] = &*idx.stab[nt_interval(idx.ends, q.range[r])].begin();
+	}
+
+	for (int w = 0; w < sNTIndex.words; ++w)
+	{
+		unsigned int bits = sets[0][w];
+		for (int s = 1; s < n && bits; ++s)
+			bits &= sets[s][w];
+		for (int b = 0; bits; ++b, bits >>= 1)
+		if (bits & 1)
+		{
+			const NaturalTerrainRule_t& rec(gNaturalTerrainRules[w * 32 + b]);
+			if (nt_rule_matches(rec, q))
+				return rec.name;
+		}
+	}
+	return -1;
+}
+
+static void	nt_set_bit(nt_bits& bits, int n)
+{
+	bits[n / 32] |= (1u << (n % 32));
+}
+
+void	IndexNaturalTerrainRules(void)
+{
+	int count = gNaturalTerrainRules.size();
+	sNTIndex.rules = count;
+	sNTIndex.words = (count + 31) / 32;
+	++sNTIndex.generation;
+
+	for (int e = 0; e < NT_ENUM_COUNT; ++e)
+	{
+		nt_enum_index_t& idx(sNTIndex.enums[e]);
+		idx.by_value.clear();
+		idx.wild.assign(sNTIndex.words, 0);
+		for (int n = 0; n < count; ++n)
+		if (gNaturalTerrainRules[n].*kEnumField[e] == NO_VALUE)
+			nt_set_bit(idx.wild, n);
+
+		for (int n = 0; n < count; ++n)
+		{
+			int v = gNaturalTerrainRules[n].*kEnumField[e];
+			if (v == NO_VALUE) continue;
+			if (idx.by_value.count(v) == 0)
+				idx.by_value[v] = idx.wild;
+			nt_set_bit(idx.by_value[v], n);
+		}
+	}
+
+	for (int r = 0; r < nt_range_count; ++r)
+	{
+		nt_range_index_t& idx(sNTIndex.ranges[r]);
+		idx.ends.clear();
+		idx.stab.clear();
+		for (int n = 0; n < count; ++n)
+		{
+			float vmin = gNaturalTerrainRules[n].*kRangeMin[r];
+			float vmax = gNaturalTerrainRules[n].*kRangeMax[r];
+			if (vmin != vmax)
+			{
+				idx.ends.push_back(vmin);
+				idx.ends.push_back(vmax);
+			}
+		}
+		sort(idx.ends.begin(), idx.ends.end());
+		idx.ends.erase(unique(idx.ends.begin(), idx.ends.end()), idx.ends.end());
+
+		if (r >= NT_FILTERED_RANGES)
+			continue;
+
+		// A bounded rule's ends are both in ends, so it takes the point intervals from its min to its max and the
+		// open stretches in between - never half of one.
+		int k = idx.ends.size();
+		idx.stab.resize(2 * k + 1, nt_bits(sNTIndex.words, 0));
+		for (int n = 0; n < count; ++n)
+		{
+			float vmin = gNaturalTerrainRules[n].*kRangeMin[r];
+			float vmax = gNaturalTerrainRules[n].*kRangeMax[r];
+			if (vmin == vmax)
+			{
+				for (int s = 0; s < idx.stab.size(); ++s)
+					nt_set_bit(idx.stab[s], n);
+			}
+			else
+			{
+				int lo = nt_interval(idx.ends, vmin);
+				int hi = nt_interval(idx.ends, vmax);
+				for (int s = lo; s <= hi; ++s)
+					nt_set_bit(idx.stab[s], n);
+			}
+		}
+	}
+}
+
+#define NT_MEMO_SLOTS	4096
+#define NT_MEMO_KEY		(6 + nt_range_count + 2)
+#define NT_MEMO_STRIDE	(NT_MEMO_KEY + 2)		// key, generation, answer
+
 int	FindNaturalTerrain(
 				int		terrain,
 				int		zoning,
@@ -975,9 +1203,10 @@ int	FindNaturalTerrain(
 				float	urban_radial,
 				float	urban_trans,
 				int		urban_square,
-				float	lat)
+				float	lat,
 //				int		variant_blob,
-//				int		variant_head)
+//				int		variant_head,
+				NaturalTerrainMemo * memo)
 {
 	// Check for no data in the continuous floating point inputs!
 //	DebugAssert(DEM_NO_DATA !=  	elevation);
@@ -994,44 +1223,83 @@ int	FindNaturalTerrain(
 	DebugAssert(DEM_NO_DATA != 	urban_trans);
 	DebugAssert(DEM_NO_DATA != 	lat);
 
-	// OPTIMIZE - figure out what the major keys should be.
-
-	for (int rec_num = 0; rec_num < gNaturalTerrainRules.size(); ++rec_num)
+	// The rules never look at the DEM slope - the triangle's own slope is what counts.
+	nt_query_t	q;
+	q.terrain = terrain;
+	q.zoning = zoning;
+	q.landuse = landuse;
+	q.soil_style = soil_style;
+	q.agri_style = agri_style;
+	q.clim_style = clim_style;
+	q.range[nt_slope_tri] = slope_tri;
+	q.range[nt_temp] = temp;
+	q.range[nt_rain] = rain;
+	q.range[nt_temp_rng] = temp_rng;
+	q.range[nt_slope_heading] = slopeheading;
+	q.range[nt_rel_elev] = relelevation;
+	q.range[nt_elev_range] = elevrange;
+	q.range[nt_urban_density] = urban_density;
+	q.range[nt_urban_trans] = urban_trans;
+	q.range[nt_urban_radial] = urban_radial;
+	q.range[nt_lat] = lat;
+	q.water = water;
+	q.urban_square = urban_square;
+
+	// Someone edited the rules without reindexing?  Stay correct, if slow - but say so, this is every triangle.
+	DebugAssert(sNTIndex.rules == gNaturalTerrainRules.size());
+	if (sNTIndex.rules != gNaturalTerrainRules.size())
+		return nt_find_linear(q);
+
+	int * slot = NULL;
+	int key[NT_MEMO_KEY];
+	int result;
+	if (memo)
 	{
-		NaturalTerrainRule_t& rec = gNaturalTerrainRules[rec_num];
+		key[0] = terrain;
+		key[1] = zoning;
+		key[2] = landuse;
+		key[3] = soil_style;
+		key[4] = agri_style;
+		key[5] = clim_style;
+		for (int r = 0; r < nt_range_count; ++r)
+			key[6 + r] = nt_interval(sNTIndex.ranges[r].ends, q.range[r]);
+		key[6 + nt_range_count] = water != 0;
+		key[7 + nt_range_count] = urban_square;
+
+		unsigned int h = 2166136261u;
+		for (int k = 0; k < NT_MEMO_KEY; ++k)
+			h = (h ^ (unsigned int) key[k]) * 16777619u;
+
+		if (memo->slots.empty())
+			memo->slots.resize(NT_MEMO_SLOTS * NT_MEMO_STRIDE, 0);
+		slot = &memo->slots[(h % NT_MEMO_SLOTS) * NT_MEMO_STRIDE];
+	}
 
-//		float slope_to_use = rec.proj_angle == proj_Down ? slope : slope_tri;
-		float slope_to_use = slope_tri;
-		
-		#define MATCH_RANGE(x,vmin,vmax)	if(rec.vmin == rec.vmax || (rec.vmin <= x && x <= rec.vmax))
-		#define MATCH_ENUM(x,field) if(rec.field == NO_VALUE || x == rec.field)
-		
-		MATCH_RANGE(temp,temp_min,temp_max)
-		MATCH_RANGE(slope_to_use,slope_min,slope_max)
-		MATCH_RANGE(rain,rain_min,rain_max)
-		MATCH_RANGE(temp_rng,temp_rng_min,temp_rng_max)
-		MATCH_RANGE(slopeheading,slope_heading_min,slope_heading_max)
-//		if (rec.variant == 0 || rec.variant == variant_blob || rec.variant == variant_head)
-		MATCH_ENUM(landuse,landuse)
-		MATCH_ENUM(soil_style,soil_style)
-		MATCH_ENUM(agri_style,agri_style)
-		MATCH_ENUM(clim_style,clim_style)
-		MATCH_ENUM(terrain,terrain)
-		MATCH_ENUM(zoning,zoning)
-		MATCH_RANGE(relelevation,rel_elev_min,rel_elev_max)
-		MATCH_RANGE(elevrange,elev_range_min,elev_range_max)
-		MATCH_RANGE(urban_density,urban_density_min,urban_density_max)
-		MATCH_RANGE(urban_trans,urban_trans_min,urban_trans_max)
-		if (rec.urban_square == 0 || urban_square == DEM_NO_DATA || rec.urban_square == urban_square)
-		MATCH_RANGE(lat,lat_min,lat_max)
-		if (!rec.near_water || water)
-		MATCH_RANGE(urban_radial,urban_radial_min,urban_radial_max)		
+	if (slot && slot[NT_MEMO_KEY] == sNTIndex.generation && memcmp(slot, key, sizeof(key)) == 0)
+	{
+		++memo->hits;
+		result = slot[NT_MEMO_KEY + 1];
+	}
+	else
+	{
+		result = nt_find_indexed(q);
+		if (slot)
 		{
-			return rec.name;
+			++memo->misses;
+			memcpy(slot, key, sizeof(key));
+			slot[NT_MEMO_KEY] = sNTIndex.generation;
+			slot[NT_MEMO_KEY + 1] = result;
 		}
 	}
 
-	return -1;
+	if (gNaturalTerrainCheckIndex)
+	{
+		int linear = nt_find_linear(q);
+		if (linear != result)
+			AssertPrintf("Terrain rule index picked %s, linear scan picked %s.\n",
+				result == -1 ? "nothing" : FetchTokenString(result), linear == -1 ? "nothing" : FetchTokenString(linear));
+	}
+	return result;
 }
 
 #pragma mark -
@@ -1352,5 +1620,6 @@ void MakeDirectRules(void)
 		rule.name = all_names->first;
 		gNaturalTerrainRules.insert(gNaturalTerrainRules.begin(), rule);
 	}	
+	IndexNaturalTerrainRules();
 }
 
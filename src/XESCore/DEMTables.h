@@ -185,6 +185,41 @@ extern	RegionalizationVector			gRegionalizations;
 extern	NaturalTerrainRuleVector		gNaturalTerrainRules;
 extern	NaturalTerrainInfoMap			gNaturalTerrainInfo;
 
+/*
+	FINDING A NATURAL TERRAIN - THEORY OF OPERATION
+
+	The rules are ordered by priority and the first rule that matches wins.  A global tile runs millions of
+	triangles past thousands of rules, so rather than scan, FindNaturalTerrain uses an index that
+	IndexNaturalTerrainRules builds from gNaturalTerrainRules:
+
+	- Bit sets over rule numbers.  Landuse, climate style, terrain and zoning each get one set per value that
+	  lists the rules that accept it (rules with NO_VALUE accept everything).
+	- Temperature, slope, rain and latitude get a stabbing table.  All the range ends in the rules cut the axis into
+	  elementary intervals - every end point, and the open stretches between them.  Every rule either accepts a
+	  whole interval or none of it, so each interval gets a bit set of the rules that accept it.
+	- A lookup ANDs those eight sets and tries the set bits in order with the full rule test.  The lowest bit that
+	  passes is the same rule the linear scan would pick.
+
+	Because every range test only depends on which elementary interval an input falls in, the interval numbers of
+	all range inputs plus the enum inputs are an exact key for the answer.  A NaturalTerrainMemo caches answers by
+	that key, so similar triangles skip the lookup.  Memos are not thread safe - give each thread its own.
+
+	LoadDEMTables and MakeDirectRules build the index.  Call IndexNaturalTerrainRules again after editing
+	gNaturalTerrainRules by hand.  Set gNaturalTerrainCheckIndex to run the linear scan on every lookup too and
+	complain about any difference.
+*/
+
+struct	NaturalTerrainMemo {
+	NaturalTerrainMemo() : hits(0), misses(0) { }
+	vector<int>		slots;		// Owned by FindNaturalTerrain
+	int				hits;
+	int				misses;
+};
+
+void	IndexNaturalTerrainRules(void);
+
+extern	bool							gNaturalTerrainCheckIndex;
+
 // This returns a rule NAME
 int		FindNaturalTerrain(
 				int		terrain,
@@ -208,9 +243,10 @@ int		FindNaturalTerrain(
 				float	urban_radial,
 				float	urban_trans,
 				int		urban_square,	// use 1=square, 2=irregulra NO_DATA
-				float	lat);			// use NO_DATA!
+				float	lat,			// use NO_DATA!
 //				int		variant_blob,
-//				int		variant_head);	// use 0
+//				int		variant_head,	// use 0
+				NaturalTerrainMemo * memo = NULL);
 
 // This routine creates a rule whereby if the "terrain" input type matches a real .ter file, we simply use it, period.
 // This allows MeshTool to allow authors to direct-select final x-plane terrain types.  This is an optional init so we 
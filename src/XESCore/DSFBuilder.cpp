@@ -36,6 +36,7 @@
 #include "AssertUtils.h"
 #include "MathUtils.h"
 #include "PerfUtils.h"
+#include "TraceUtils.h"
 #include "GISTool_Globals.h"
 
 /*
@@ -48,7 +49,7 @@
 #if PROFILE_PERFORMANCE
 #define TIMER(x)	StElapsedTime	__PerfTimer##x(#x);
 #else
-#define TIMER(x)
+#define TIMER(x)	TRACE_Zone	__TraceZone##x(#x);
 #endif
 
 DSFBuildPrefs_t	gDSFBuildPrefs = { 1 };
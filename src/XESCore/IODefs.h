@@ -23,25 +23,181 @@
 #ifndef IODEFS_H
 #define IODEFS_H
 
+/*
+	IODefs - THEORY OF OPERATION
+
+	IOReader and IOWriter are the binary streams the XES, DEM and WED serializers talk to.  Those serializers move
+	one number at a time - tens of millions of them for a big map - so the per-number calls are not virtual.  Each
+	stream has a window of memory (mReadPos to mReadEnd, mWritePos to mWriteEnd) that numbers are copied straight
+	out of or into, and ReadInt, WriteDouble and friends are inline memcpys against that window.  Only when a
+	number doesn't fit do we make a virtual call: the subclass's ReadMore/WriteMore moves the bytes some other way
+	and usually moves the window along - refills or flushes a buffer, steps to the next block, grows a vector.
+	A subclass that never sets up a window (both ends NULL) simply gets every call - always right, just not fast.
+
+	Byte order lives here too: if the subclass sets mReadSwap/mWriteSwap, numbers are byte-swapped on the way
+	through.  The run calls (ReadInts, WriteDoubles...) copy a whole array at once and swap it in one pass; use
+	them for big POD arrays like DEM samples.  ReadBulk/WriteBulk move raw bytes and never swap.  Their zip flag
+	was never implemented by anyone and is ignored.
+*/
+
+#include <string.h>
+#include <stdint.h>
+
+// Reverses the bytes of each of n items of the given size, in place.  The shift-and-mask forms are what compilers
+// recognize and turn into byte-swap instructions.
+inline void	IO_SwapRun(void * p, int item_size, int n)
+{
+	char * b = (char *) p;
+	switch(item_size) {
+	case 2:
+		for (int i = 0; i < n; ++i, b += 2)
+		{
+			uint16_t v;
+			memcpy(&v, b, 2);
+			v = (uint16_t) ((v >> 8) | (v << 8));
+			memcpy(b, &v, 2);
+		}
+		break;
+	case 4:
+		for (int i = 0; i < n; ++i, b += 4)
+		{
+			uint32_t v;
+			memcpy(&v, b, 4);
+			v = (v >> 24) | ((v >> 8) & 0x0000FF00) | ((v << 8) & 0x00FF0000) | (v << 24);
+			memcpy(b, &v, 4);
+		}
+		break;
+	case 8:
+		for (int i = 0; i < n; ++i, b += 8)
+		{
+			uint32_t lo, hi;
+			memcpy(&lo, b, 4);
+			memcpy(&hi, b + 4, 4);
+			IO_SwapRun(&lo, 4, 1);
+			IO_SwapRun(&hi, 4, 1);
+			memcpy(b, &hi, 4);
+			memcpy(b + 4, &lo, 4);
+		}
+		break;
+	default:
+		for (int i = 0; i < n; ++i, b += item_size)
+		for (int lo = 0, hi = item_size - 1; lo < hi; ++lo, --hi)
+		{
+			char t = b[lo];
+			b[lo] = b[hi];
+			b[hi] = t;
+		}
+	}
+}
+
 class	IOReader {
 public:
 
-	virtual	void	ReadShort(short&)=0;
-	virtual	void	ReadInt(int&)=0;
-	virtual	void	ReadFloat(float&)=0;
-	virtual	void	ReadDouble(double&)=0;
-	virtual	void	ReadBulk(char * inBuf, int inLength, bool inZip)=0;
+					IOReader() : mReadPos(NULL), mReadEnd(NULL), mReadSwap(false) { }
+
+	inline	void	ReadShort(short& v)		{ read_run(&v, sizeof(v), 1); }
+	inline	void	ReadInt(int& v)			{ read_run(&v, sizeof(v), 1); }
+	inline	void	ReadFloat(float& v)		{ read_run(&v, sizeof(v), 1); }
+	inline	void	ReadDouble(double& v)	{ read_run(&v, sizeof(v), 1); }
+	inline	void	ReadBulk(char * inBuf, int inLength, bool inZip) { read_bytes(inBuf, inLength); }
+
+	inline	void	ReadShorts(short * v, int n)	{ read_run(v, sizeof(short), n); }
+	inline	void	ReadInts(int * v, int n)		{ read_run(v, sizeof(int), n); }
+	inline	void	ReadFloats(float * v, int n)	{ read_run(v, sizeof(float), n); }
+	inline	void	ReadDoubles(double * v, int n)	{ read_run(v, sizeof(double), n); }
+
+protected:
+
+	// Called when the window holds fewer than inLength bytes: copy them to inBuf however this reader can, using up
+	// what is left in the window first.
+	virtual	void	ReadMore(char * inBuf, int inLength)=0;
+
+	const char *	mReadPos;
+	const char *	mReadEnd;
+	bool			mReadSwap;
+
+private:
+
+	inline	void	read_bytes(void * p, int l)
+	{
+		if (l <= mReadEnd - mReadPos)
+		{
+			memcpy(p, mReadPos, l);
+			mReadPos += l;
+		}
+		else
+			ReadMore((char *) p, l);
+	}
+
+	inline	void	read_run(void * p, int item_size, int n)
+	{
+		read_bytes(p, item_size * n);
+		if (mReadSwap)
+			IO_SwapRun(p, item_size, n);
+	}
 
 };
 
 class	IOWriter {
 public:
 
-	virtual	void	WriteShort(short)=0;
-	virtual	void	WriteInt(int)=0;
-	virtual	void	WriteFloat(float)=0;
-	virtual	void	WriteDouble(double)=0;
-	virtual	void	WriteBulk(const char * inBuf, int inLength, bool inZip)=0;
+					IOWriter() : mWritePos(NULL), mWriteEnd(NULL), mWriteSwap(false) { }
+
+	inline	void	WriteShort(short v)		{ write_run(&v, sizeof(v), 1); }
+	inline	void	WriteInt(int v)			{ write_run(&v, sizeof(v), 1); }
+	inline	void	WriteFloat(float v)		{ write_run(&v, sizeof(v), 1); }
+	inline	void	WriteDouble(double v)	{ write_run(&v, sizeof(v), 1); }
+	inline	void	WriteBulk(const char * inBuf, int inLength, bool inZip) { write_bytes(inBuf, inLength); }
+
+	inline	void	WriteShorts(const short * v, int n)		{ write_run(v, sizeof(short), n); }
+	inline	void	WriteInts(const int * v, int n)			{ write_run(v, sizeof(int), n); }
+	inline	void	WriteFloats(const float * v, int n)		{ write_run(v, sizeof(float), n); }
+	inline	void	WriteDoubles(const double * v, int n)	{ write_run(v, sizeof(double), n); }
+
+protected:
+
+	// Called when the window has room for fewer than inLength bytes: take them however this writer can, filling
+	// what is left of the window first.
+	virtual	void	WriteMore(const char * inBuf, int inLength)=0;
+
+	char *			mWritePos;
+	char *			mWriteEnd;
+	bool			mWriteSwap;
+
+private:
+
+	inline	void	write_bytes(const void * p, int l)
+	{
+		if (l <= mWriteEnd - mWritePos)
+		{
+			memcpy(mWritePos, p, l);
+			mWritePos += l;
+		}
+		else
+			WriteMore((const char *) p, l);
+	}
+
+	inline	void	write_run(const void * p, int item_size, int n)
+	{
+		if (!mWriteSwap)
+		{
+			write_bytes(p, item_size * n);
+			return;
+		}
+		// Swap a stack-sized piece at a time - the caller's data is const.
+		char			buf[512];
+		const char *	src = (const char *) p;
+		int				per = sizeof(buf) / item_size;
+		while (n > 0)
+		{
+			int c = n < per ? n : per;
+			memcpy(buf, src, c * item_size);
+			IO_SwapRun(buf, item_size, c);
+			write_bytes(buf, c * item_size);
+			src += c * item_size;
+			n -= c;
+		}
+	}
 
 };
 
@@ -2481,6 +2481,10 @@ int KillSlopedWater(Pmwx& pmwx,
 	
 	dem_erode(water_up, max_horizontal_err_pix, 1);
 	//gDem[dem_Wizard] = water_up;
+
+	// Every face rasterizes against the same two DEMs, so summarize them once.
+	DEMGeoSummary	water_stats(water_up);
+	DEMGeoSummary	elev_stats(elev);
 	
 	for(Pmwx::Face_iterator f = pmwx.faces_begin(); f != pmwx.faces_end(); ++f, ++ctr)
 	if(!f->is_unbounded())
@@ -2508,7 +2512,6 @@ int KillSlopedWater(Pmwx& pmwx,
 	
 		PolyRasterizer<double>	raster;
 		int y = SetupRasterizerForDEM(f, elev, raster);
-		int x;
 		int water = 0;
 		int total = 0;
 		while(!raster.DoneScan())
@@ -2519,24 +2522,20 @@ int KillSlopedWater(Pmwx& pmwx,
 			DebugAssert(l.size() % 2== 0);
 			for(int i = 0; i < l.size(); i += 2)
 			{
-				double xs = l[i];
-				double xe = l[i+1];
-				
-				for(x = ceil(xs); x <= floor(xe); ++x)
+				int xs = ceil(l[i]);
+				int xe = floor(l[i+1]) + 1;
+				if(xs >= xe)
+					continue;
+
+				float lo = DEM_NO_DATA, hi = DEM_NO_DATA;
+				elev_stats.run_min_max(xs, xe, y, lo, hi);
+				if (lo != DEM_NO_DATA)
 				{
-					int wet = water_up.get(x,y);
-					float e = elev.get(x,y);
-
-					if (e != DEM_NO_DATA)
-					{
-						//debug_mesh_point(Point2(water_up.x_to_lon(x), water_up.y_to_lat(y)),1,1,0);
-						zmin = min(zmin,e);
-						zmax = max(zmax,e);
-					}
-					++total;
-					if(wet == 1)
-						++water;
+					zmin = min(zmin,lo);
+					zmax = max(zmax,hi);
 				}
+				total += xe - xs;
+				water += (int) water_stats.run_sum(xs, xe, y);	// water_up is all 0s and 1s
 			}
 			++y;
 			raster.AdvanceScanline(y);
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "MapCompact.h"
+
+static NT	compact_nt(const NT& n, compact_stats_t& s)
+{
+	++s.coords;
+	// Asking for the exact value is what makes CGAL drop the DAG; after this we only need the result.
+	const NT::ET& e = n.exact();
+	double d = CGAL::to_double(e);
+	if(NT::ET(d) == e)
+	{
+		++s.doubles;
+		return NT(d);
+	}
+	++s.rationals;
+	return NT(e);
+}
+
+static Point_2	compact_pt(const Point_2& p, compact_stats_t& s)
+{
+	NT x(compact_nt(p.x(), s));
+	NT y(compact_nt(p.y(), s));
+	return Point_2(x, y);
+}
+
+static void	compact_polygon(Polygon_2& p, compact_stats_t& s)
+{
+	for(Polygon_2::Container::iterator v = p.container().begin(); v != p.container().end(); ++v)
+		*v = compact_pt(*v, s);
+}
+
+void	CompactMapNumbers(Pmwx& io_map, compact_stats_t * out_stats)
+{
+	compact_stats_t	s;
+
+	for(Pmwx::Vertex_iterator v = io_map.vertices_begin(); v != io_map.vertices_end(); ++v)
+		io_map.modify_vertex(v, compact_pt(v->point(), s));
+
+	// The curves have their own copies of their end points, so until they are rebuilt they still hold the old
+	// numbers.  Build them from the (now compacted) vertices, keeping each curve's direction and keys.  Both
+	// halfedges share one curve, so once per edge is enough.
+	for(Pmwx::Edge_iterator e = io_map.edges_begin(); e != io_map.edges_end(); ++e)
+	{
+		const X_monotone_curve_2& cv(e->curve());
+		bool	same_way = cv.is_directed_right() == (e->direction() == CGAL::ARR_LEFT_TO_RIGHT);
+		Segment_2	seg(same_way ? Segment_2(e->source()->point(), e->target()->point()) :
+							   Segment_2(e->target()->point(), e->source()->point()));
+		io_map.modify_edge(e, X_monotone_curve_2(seg, cv.data()));
+	}
+
+	for(Pmwx::Face_iterator f = io_map.faces_begin(); f != io_map.faces_end(); ++f)
+	{
+		GISPointFeatureVector& pts(f->data().mPointFeatures);
+		for(GISPointFeatureVector::iterator p = pts.begin(); p != pts.end(); ++p)
+			p->mLocation = compact_pt(p->mLocation, s);
+
+		GISPolygonFeatureVector& polys(f->data().mPolygonFeatures);
+		for(GISPolygonFeatureVector::iterator p = polys.begin(); p != polys.end(); ++p)
+		{
+			compact_polygon(p->mShape.outer_boundary(), s);
+			for(Polygon_with_holes_2::Hole_iterator h = p->mShape.holes_begin(); h != p->mShape.holes_end(); ++h)
+				compact_polygon(*h, s);
+		}
+	}
+
+	if(out_stats) *out_stats = s;
+}
+
+void	CompactMeshNumbers(CDT& io_mesh, compact_stats_t * out_stats)
+{
+	compact_stats_t	s;
+
+	// The triangulation doesn't cache anything derived from its points, so the vertices are all there is.
+	for(CDT::Finite_vertices_iterator v = io_mesh.finite_vertices_begin(); v != io_mesh.finite_vertices_end(); ++v)
+		v->set_point(compact_pt(v->point(), s));
+
+	if(out_stats) *out_stats = s;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef MapCompact_H
+#define MapCompact_H
+
+/*
+	MapCompact - THEORY OF OPERATION
+
+	Our number type is a Lazy_exact_nt: every coordinate carries a double interval plus a recipe (a DAG of the
+	operations that made it) for computing its exact rational if a predicate ever can't decide from the interval.
+	After a long chain of overlays, merges and crops, a vertex made by intersecting two segments that were
+	themselves cut from other segments can hang onto a surprisingly large tree of old numbers, and once something
+	has asked for the exact value, a GMP rational as well.  All of that stays alive as long as the map does, and
+	any predicate that falls off the filter has to walk it.
+
+	Compaction rebuilds every coordinate as a leaf.  We force the exact value (which lets CGAL prune the DAG under
+	it) and then:
+
+	- if the exact value is a double - true for everything that came from a file and for a good chunk of what
+	  comes out of the overlays - we store just that double.  Its interval is a single point, so the filters never
+	  fail on it, and no rational is kept.
+	- otherwise we store a fresh leaf holding only the exact rational, with none of its history.
+
+	Every coordinate keeps its exact value, so the map or mesh is the same geometry, bit for bit, and all of the
+	topology and GIS data stays put.  For the arrangement we re-point the vertices and rebuild each edge's curve
+	from the compacted end points (keeping its keys); the point and polygon features on the faces get the same
+	treatment.  For the mesh only vertices carry coordinates.
+
+	Forcing exact values costs time proportional to the size of the DAGs being thrown out, so this is a pass to
+	run between big operations on big maps, not after every edit.
+*/
+
+#include "MapDefs.h"
+#include "MeshDefs.h"
+
+struct	compact_stats_t {
+	compact_stats_t() : coords(0), doubles(0), rationals(0) { }
+	int		coords;			// How many coordinates we looked at
+	int		doubles;		// ...of those, how many are now stored as plain doubles
+	int		rationals;		// ...and how many needed to keep an exact rational
+};
+
+void	CompactMapNumbers(Pmwx& io_map, compact_stats_t * out_stats = NULL);
+void	CompactMeshNumbers(CDT& io_mesh, compact_stats_t * out_stats = NULL);
+
+#endif /* MapCompact_H */
@@ -269,13 +269,13 @@ void WriteCoordinate(IOWriter& inWriter, const NT& c)
 	
 	inWriter.WriteDouble(num.exp);
 	inWriter.WriteInt(num.v.size());
-	for(int n = 0; n < num.v.size(); ++n)
-		inWriter.WriteShort(num.v[n]);
+	if(!num.v.empty())
+		inWriter.WriteShorts(&num.v[0], num.v.size());
 
 	inWriter.WriteDouble(den.exp);
 	inWriter.WriteInt(den.v.size());
-	for(int n = 0; n < den.v.size(); ++n)
-		inWriter.WriteShort(den.v[n]);
+	if(!den.v.empty())
+		inWriter.WriteShorts(&den.v[0], den.v.size());
 #endif		
 }
 
@@ -289,21 +289,15 @@ void ReadCoordinate(IOReader& inReader, NT& c)
 	
 	inReader.ReadDouble(et.num.exp);
 	inReader.ReadInt(n);
-	et.num.v.clear();
-	while(n--)
-	{
-		et.num.v.push_back(short());
-		inReader.ReadShort(et.num.v.back());
-	}
+	et.num.v.resize(n);
+	if(n > 0)
+		inReader.ReadShorts(&et.num.v[0], n);
 
 	inReader.ReadDouble(et.den.exp);
 	inReader.ReadInt(n);
-	et.den.v.clear();
-	while(n--)
-	{
-		et.den.v.push_back(short());
-		inReader.ReadShort(et.den.v.back());
-	}
+	et.den.v.resize(n);
+	if(n > 0)
+		inReader.ReadShorts(&et.den.v[0], n);
 	
 	c = et;
 #endif	
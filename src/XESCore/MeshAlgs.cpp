@@ -33,6 +33,7 @@
 #include "AssertUtils.h"
 #include "PlatformUtils.h"
 #include "PerfUtils.h"
+#include "TraceUtils.h"
 #include "MapAlgs.h"
 #include "DEMAlgs.h"
 #include "DEMGrid.h"
@@ -43,9 +44,8 @@
 #include "MeshSimplify.h"
 #include "NetHelpers.h"
 #include "Zoning.h"	// for urban cheat table.
-#if OPENGL_MAP
 #include "GISTool_Globals.h"
-#endif
+#include "ThreadUtils.h"
 
 //typedef CGAL::Mesh_2::Is_locally_conforming_Delaunay<CDT>	LCP;
 
@@ -134,7 +134,7 @@
 #if PROFILE_PERFORMANCE
 #define TIMER(x)	StElapsedTime	__PerfTimer##x(#x);
 #else
-#define TIMER(x)
+#define TIMER(x)	TRACE_Zone	__TraceZone##x(#x);
 #endif
 
 #ifndef PHONE
@@ -814,6 +814,7 @@ CDT::Vertex_handle InsertDEMPoint(
 	CDT::Point	p(in_orig.x_to_lon(CGAL::to_double(x)),in_orig.y_to_lat(CGAL::to_double(y)));
 
 	CDT::Vertex_handle np = io_mesh.insert(p, hint);
+	TRACE_COUNT("mesh points inserted", 1)
 	np->info().height = h;
 	hint = np->face();
 	
@@ -840,6 +841,7 @@ CDT::Vertex_handle InsertAnyPoint(
 	DebugAssert(e != DEM_NO_DATA);
 
 	CDT::Vertex_handle v = io_mesh.insert(p, hint);
+	TRACE_COUNT("mesh points inserted", 1)
 	hint = v->face();
 	v->info().height = e;
 	
@@ -1951,7 +1953,7 @@ void	TriangulateMesh(Pmwx& inMap, CDT& outMesh, DEMGeoMap& inDEMs, const char *
 		on all but water through the spreadsheet.
 */
 
-float enum_sample_tri(DEMGeo& d, double x0, double y0, double x1, double y1, double x2, double y2, double center_x, double center_y)
+float enum_sample_tri(const DEMGeo& d, double x0, double y0, double x1, double y1, double x2, double y2, double center_x, double center_y)
 {
 /*
 	float lu0  = d.search_nearest(center_x, center_y);
@@ -2009,8 +2011,11 @@ float enum_sample_tri(DEMGeo& d, double x0, double y0, double x1, double y1, dou
 		if(best->second < l->second)
 			best = l;
 		if(town == histo.end() || town->second < l->second)
-		if(gLandClassInfo.count(l->first) && gLandClassInfo[l->first].urban_density > 0.0)
-			town = l;
+		{
+			LandClassInfoTable::const_iterator lc = gLandClassInfo.find(l->first);		// not [] - runs on worker threads
+			if(lc != gLandClassInfo.end() && lc->second.urban_density > 0.0)
+				town = l;
+		}
 	}
 	
 	if(town != histo.end())
@@ -2021,6 +2026,218 @@ float enum_sample_tri(DEMGeo& d, double x0, double y0, double x1, double y1, dou
 	return best->first;
 }
 
+/*
+	PARALLEL LANDUSE ASSIGNMENT
+
+	Picking a natural terrain for a triangle means a land use histogram under it plus a dozen DEM lookups and a pass
+	over the rules table - and it depends only on that triangle, its neighbors' (water or not) terrain and the DEMs.
+	So AssignLandusesToMesh does it in two phases: THREAD_ParallelFor works out every triangle's terrain into its own
+	landuse_tri_t, then the main thread writes the results into the mesh in face order.  Nothing is written to the mesh
+	while the workers run, so the answer does not depend on the thread count.  (The old single loop read neighbors
+	that might already have been assigned, but an assigned terrain is never water, so near_water comes out the same.)
+
+	The workers may not touch CGAL numbers - the lazy exact type caches its exact value on first use and is
+	ref-counted without a lock - so the triangle corners are copied out to doubles on the main thread.  Each work
+	item makes its own rasterizer in enum_sample_tri, and the DEMs are looked up once up front, since DEMGeoMap's []
+	can insert.  Each worker gets its own NaturalTerrainMemo.
+*/
+
+struct	landuse_tri_t {
+	CDT::Face_handle	tri;
+	double				x0, y0, x1, y1, x2, y2;		// corners, copied on the main thread
+
+	int					terrain;
+	int					near_water;
+	float				lu, sl, sl_tri, tm, tmr, rn, sh_tri, re, er;
+};
+
+struct	landuse_job_t {
+	const DEMGeo *				inClimStyle;
+	const DEMGeo *				inAgriStyle;
+	const DEMGeo *				inSoilStyle;
+	const DEMGeo *				inSlope;
+	const DEMGeo *				inRelElev;
+	const DEMGeo *				inRelElevRange;
+	const DEMGeo *				inTemp;
+	const DEMGeo *				inTempRng;
+	const DEMGeo *				inRain;
+	const DEMGeo *				inUrbanDensity;
+	const DEMGeo *				inUrbanRadial;
+	const DEMGeo *				inUrbanTransport;
+	const DEMGeo *				usquare;
+	const DEMGeo *				landuse;
+	const CDT *					mesh;
+	vector<landuse_tri_t> *		tris;
+	NaturalTerrainMemo *		memos;			// one per worker
+};
+
+static void	assign_landuse_tri(int item, int worker, void * ref)
+{
+	landuse_job_t * job = (landuse_job_t *) ref;
+	landuse_tri_t& me((*job->tris)[item]);
+	CDT::Face_handle tri = me.tri;
+	const CDT& ioMesh(*job->mesh);
+
+	const DEMGeo&	inClimStyle(*job->inClimStyle);
+	const DEMGeo&	inAgriStyle(*job->inAgriStyle);
+	const DEMGeo&	inSoilStyle(*job->inSoilStyle);
+	const DEMGeo&	inSlope(*job->inSlope);
+	const DEMGeo&	inRelElev(*job->inRelElev);
+	const DEMGeo&	inRelElevRange(*job->inRelElevRange);
+	const DEMGeo&	inTemp(*job->inTemp);
+	const DEMGeo&	inTempRng(*job->inTempRng);
+	const DEMGeo&	inRain(*job->inRain);
+	const DEMGeo&	inUrbanDensity(*job->inUrbanDensity);
+	const DEMGeo&	inUrbanRadial(*job->inUrbanRadial);
+	const DEMGeo&	inUrbanTransport(*job->inUrbanTransport);
+	const DEMGeo&	usquare(*job->usquare);
+	const DEMGeo&	landuse(*job->landuse);
+
+	double x0 = me.x0, y0 = me.y0;
+	double x1 = me.x1, y1 = me.y1;
+	double x2 = me.x2, y2 = me.y2;
+	double	center_x = (x0 + x1 + x2) / 3.0;
+	double	center_y = (y0 + y1 + y2) / 3.0;
+
+	float lu = enum_sample_tri(landuse, x0,y0,x1,y1,x2,y2, center_x, center_y);
+
+	float cs0 = inClimStyle.search_nearest(center_x, center_y);
+	float cs1 = inClimStyle.search_nearest(x0,y0);
+	float cs2 = inClimStyle.search_nearest(x1,y1);
+	float cs3 = inClimStyle.search_nearest(x2,y2);
+	float cs = MAJORITY_RULES(cs0,cs1,cs2,cs3);
+
+	float as0 = inAgriStyle.search_nearest(center_x, center_y);
+	float as1 = inAgriStyle.search_nearest(x0,y0);
+	float as2 = inAgriStyle.search_nearest(x1,y1);
+	float as3 = inAgriStyle.search_nearest(x2,y2);
+	float as = MAJORITY_RULES(as0,as1,as2,as3);
+
+	float ss0 = inSoilStyle.search_nearest(center_x, center_y);
+	float ss1 = inSoilStyle.search_nearest(x0,y0);
+	float ss2 = inSoilStyle.search_nearest(x1,y1);
+	float ss3 = inSoilStyle.search_nearest(x2,y2);
+	float ss = MAJORITY_RULES(ss0,ss1,ss2,ss3);
+	
+
+//	float cl  = inClimate.search_nearest(center_x, center_y);
+//	float cl1 = inClimate.search_nearest(x0,y0);
+//	float cl2 = inClimate.search_nearest(x1,y1);
+//	float cl3 = inClimate.search_nearest(x2,y2);
+
+	// Ben sez: tiny island in the middle of nowhere - do NOT expect LU.  That's okay - Sergio doesn't need it.
+//	if (lu == DEM_NO_DATA)
+//		fprintf(stderr, "NO data anywhere near %f, %f\n", center_x, center_y);
+//	cl = MAJORITY_RULES(cl, cl1, cl2, cl3);
+
+//	float	el1 = inElevation.value_linear(x0,y0);
+//	float	el2 = inElevation.value_linear(x1,y1);
+//	float	el3 = inElevation.value_linear(x2,y2);
+//	float	el = SAFE_AVERAGE(el1, el2, el3);
+
+	float	sl1 = inSlope.value_linear(x0,y0);
+	float	sl2 = inSlope.value_linear(x1,y1);
+	float	sl3 = inSlope.value_linear(x2,y2);
+	float	sl = SAFE_MAX	 (sl1, sl2, sl3);	// Could be safe max.
+	if (sl<0.0) sl=0.0;
+
+	float	tm1 = inTemp.value_linear(x0,y0);
+	float	tm2 = inTemp.value_linear(x1,y1);
+	float	tm3 = inTemp.value_linear(x2,y2);
+	float	tm = SAFE_AVERAGE(tm1, tm2, tm3);	// Could be safe max.
+
+	float	tmr1 = inTempRng.value_linear(x0,y0);
+	float	tmr2 = inTempRng.value_linear(x1,y1);
+	float	tmr3 = inTempRng.value_linear(x2,y2);
+	float	tmr = SAFE_AVERAGE(tmr1, tmr2, tmr3);	// Could be safe max.
+
+	float	rn1 = inRain.value_linear(x0,y0);
+	float	rn2 = inRain.value_linear(x1,y1);
+	float	rn3 = inRain.value_linear(x2,y2);
+	float	rn = SAFE_AVERAGE(rn1, rn2, rn3);	// Could be safe max.
+
+//	float	sh1 = inSlopeHeading.value_linear(x0,y0);
+//	float	sh2 = inSlopeHeading.value_linear(x1,y1);
+///	float	sh3 = inSlopeHeading.value_linear(x2,y2);
+//	float	sh = SAFE_AVERAGE(sh1, sh2, sh3);	// Could be safe max.
+
+	float	re1 = inRelElev.value_linear(x0,y0);
+	float	re2 = inRelElev.value_linear(x1,y1);
+	float	re3 = inRelElev.value_linear(x2,y2);
+	float	re = SAFE_AVERAGE(re1, re2, re3);	// Could be safe max.
+
+	float	er1 = inRelElevRange.value_linear(x0,y0);
+	float	er2 = inRelElevRange.value_linear(x1,y1);
+	float	er3 = inRelElevRange.value_linear(x2,y2);
+	float	er = SAFE_AVERAGE(er1, er2, er3);	// Could be safe max.
+
+	int		near_water =(tri->neighbor(0)->info().terrain == terrain_Water && !ioMesh.is_infinite(tri->neighbor(0))) ||
+						(tri->neighbor(1)->info().terrain == terrain_Water && !ioMesh.is_infinite(tri->neighbor(1))) ||
+						(tri->neighbor(2)->info().terrain == terrain_Water && !ioMesh.is_infinite(tri->neighbor(2)));
+
+	float	uden1 = inUrbanDensity.value_linear(x0,y0);
+	float	uden2 = inUrbanDensity.value_linear(x1,y1);
+	float	uden3 = inUrbanDensity.value_linear(x2,y2);
+	float	uden = SAFE_AVERAGE(uden1, uden2, uden3);	// Could be safe max.
+
+	float	urad1 = inUrbanRadial.value_linear(x0,y0);
+	float	urad2 = inUrbanRadial.value_linear(x1,y1);
+	float	urad3 = inUrbanRadial.value_linear(x2,y2);
+	float	urad = SAFE_AVERAGE(urad1, urad2, urad3);	// Could be safe max.
+
+	float	utrn1 = inUrbanTransport.value_linear(x0,y0);
+	float	utrn2 = inUrbanTransport.value_linear(x1,y1);
+	float	utrn3 = inUrbanTransport.value_linear(x2,y2);
+	float	utrn = SAFE_AVERAGE(utrn1, utrn2, utrn3);	// Could be safe max.
+
+	float usq  = usquare.search_nearest(center_x, center_y);
+	float usq1 = usquare.search_nearest(x0,y0);
+	float usq2 = usquare.search_nearest(x1,y1);
+	float usq3 = usquare.search_nearest(x2,y2);
+	usq = MAJORITY_RULES(usq, usq1, usq2, usq3);
+
+//	float	el1 = tri->vertex(0)->info().height;
+//	float	el2 = tri->vertex(1)->info().height;
+//	float	el3 = tri->vertex(2)->info().height;
+//	float	el_tri = (el1 + el2 + el3) / 3.0;
+
+	float	sl_tri = 1.0 - tri->info().normal[2];
+	float	flat_len = sqrt(tri->info().normal[1] * tri->info().normal[1] + tri->info().normal[0] * tri->info().normal[0]);
+	float	sh_tri = tri->info().normal[1];
+	if (flat_len != 0.0)
+	{
+		sh_tri /= flat_len;
+		sh_tri = max(-1.0f, min(sh_tri, 1.0f));
+	}
+
+	float	patches = (gMeshPrefs.rep_switch_m == 0.0) ? 100.0 : (60.0 * NM_TO_MTR / gMeshPrefs.rep_switch_m);
+	int x_variant = fabs(center_x /*+ RandRange(-0.03, 0.03)*/) * patches; // 25.0;
+	int y_variant = fabs(center_y /*+ RandRange(-0.03, 0.03)*/) * patches; // 25.0;
+//	int variant_blob = ((x_variant + y_variant * 2) % 4) + 1;
+//	int variant_head = (tri->info().normal[0] > 0.0) ? 6 : 8;
+//
+//	if (sh_tri < -0.7)	variant_head = 7;
+//	if (sh_tri >  0.7)	variant_head = 5;
+
+	//fprintf(stderr, " %d", tri->info().feature);
+	int zoning = NO_VALUE;//(tri->info().orig_face == Pmwx::Face_handle()) ? NO_VALUE : tri->info().orig_face->data().GetZoning();
+	if(zoning == NO_VALUE && tri->info().orig_face != Pmwx::Face_handle())
+		zoning = tri->info().orig_face->data().GetParam(af_Variant,-1.0) + 1.0;
+	int terrain = FindNaturalTerrain(tri->info().feature, zoning, lu, ss, as,cs, sl, sl_tri, tm, tmr, rn, near_water, sh_tri, re, er, uden, urad, utrn, usq, fabs((float) center_y)/*, variant_blob, variant_head*/, job->memos + worker);
+
+	me.terrain = terrain;
+	me.near_water = near_water;
+	me.lu = lu;
+	me.sl = sl;
+	me.sl_tri = sl_tri;
+	me.tm = tm;
+	me.tmr = tmr;
+	me.rn = rn;
+	me.sh_tri = sh_tri;
+	me.re = re;
+	me.er = er;
+}
+
 void	AssignLandusesToMesh(	DEMGeoMap& inDEMs,
 								CDT& ioMesh,
 								const char * mesh_folder,
@@ -2075,179 +2292,67 @@ void	AssignLandusesToMesh(	DEMGeoMap& inDEMs,
 	 ***********************************************************************************************/
 
 	if (inProg) inProg(0, 1, "Assigning Landuses", 0.1);
+
+	// Hires - take from DEM if we don't have one.
+	vector<landuse_tri_t>	tris;
 	for (tri = ioMesh.finite_faces_begin(); tri != ioMesh.finite_faces_end(); ++tri)
 	{
-		// First assign a basic land use type.
+		tri->info().flag = 0;
+		if (tri->info().terrain != terrain_Water)
 		{
-			tri->info().flag = 0;
-			// Hires - take from DEM if we don't have one.
-			if (tri->info().terrain != terrain_Water)
-			{
-				double x0 = CGAL::to_double(tri->vertex(0)->point().x());
-				double y0 = CGAL::to_double(tri->vertex(0)->point().y());
-				double x1 = CGAL::to_double(tri->vertex(1)->point().x());
-				double y1 = CGAL::to_double(tri->vertex(1)->point().y());
-				double x2 = CGAL::to_double(tri->vertex(2)->point().x());
-				double y2 = CGAL::to_double(tri->vertex(2)->point().y());
-				double	center_x = (x0 + x1 + x2) / 3.0;
-				double	center_y = (y0 + y1 + y2) / 3.0;
-
-				float lu = enum_sample_tri(landuse, x0,y0,x1,y1,x2,y2, center_x, center_y);
-
-				float cs0 = inClimStyle.search_nearest(center_x, center_y);
-				float cs1 = inClimStyle.search_nearest(x0,y0);
-				float cs2 = inClimStyle.search_nearest(x1,y1);
-				float cs3 = inClimStyle.search_nearest(x2,y2);
-				float cs = MAJORITY_RULES(cs0,cs1,cs2,cs3);
-
-				float as0 = inAgriStyle.search_nearest(center_x, center_y);
-				float as1 = inAgriStyle.search_nearest(x0,y0);
-				float as2 = inAgriStyle.search_nearest(x1,y1);
-				float as3 = inAgriStyle.search_nearest(x2,y2);
-				float as = MAJORITY_RULES(as0,as1,as2,as3);
-
-				float ss0 = inSoilStyle.search_nearest(center_x, center_y);
-				float ss1 = inSoilStyle.search_nearest(x0,y0);
-				float ss2 = inSoilStyle.search_nearest(x1,y1);
-				float ss3 = inSoilStyle.search_nearest(x2,y2);
-				float ss = MAJORITY_RULES(ss0,ss1,ss2,ss3);
-				
-
-//				float cl  = inClimate.search_nearest(center_x, center_y);
-//				float cl1 = inClimate.search_nearest(x0,y0);
-//				float cl2 = inClimate.search_nearest(x1,y1);
-//				float cl3 = inClimate.search_nearest(x2,y2);
-
-				// Ben sez: tiny island in the middle of nowhere - do NOT expect LU.  That's okay - Sergio doesn't need it.
-//				if (lu == DEM_NO_DATA)
-//					fprintf(stderr, "NO data anywhere near %f, %f\n", center_x, center_y);
-//				cl = MAJORITY_RULES(cl, cl1, cl2, cl3);
-
-//				float	el1 = inElevation.value_linear(x0,y0);
-//				float	el2 = inElevation.value_linear(x1,y1);
-//				float	el3 = inElevation.value_linear(x2,y2);
-//				float	el = SAFE_AVERAGE(el1, el2, el3);
-
-				float	sl1 = inSlope.value_linear(x0,y0);
-				float	sl2 = inSlope.value_linear(x1,y1);
-				float	sl3 = inSlope.value_linear(x2,y2);
-				float	sl = SAFE_MAX	 (sl1, sl2, sl3);	// Could be safe max.
-				if (sl<0.0) sl=0.0;
-
-				float	tm1 = inTemp.value_linear(x0,y0);
-				float	tm2 = inTemp.value_linear(x1,y1);
-				float	tm3 = inTemp.value_linear(x2,y2);
-				float	tm = SAFE_AVERAGE(tm1, tm2, tm3);	// Could be safe max.
-
-				float	tmr1 = inTempRng.value_linear(x0,y0);
-				float	tmr2 = inTempRng.value_linear(x1,y1);
-				float	tmr3 = inTempRng.value_linear(x2,y2);
-				float	tmr = SAFE_AVERAGE(tmr1, tmr2, tmr3);	// Could be safe max.
-
-				float	rn1 = inRain.value_linear(x0,y0);
-				float	rn2 = inRain.value_linear(x1,y1);
-				float	rn3 = inRain.value_linear(x2,y2);
-				float	rn = SAFE_AVERAGE(rn1, rn2, rn3);	// Could be safe max.
-
-//				float	sh1 = inSlopeHeading.value_linear(x0,y0);
-//				float	sh2 = inSlopeHeading.value_linear(x1,y1);
-///				float	sh3 = inSlopeHeading.value_linear(x2,y2);
-//				float	sh = SAFE_AVERAGE(sh1, sh2, sh3);	// Could be safe max.
-
-				float	re1 = inRelElev.value_linear(x0,y0);
-				float	re2 = inRelElev.value_linear(x1,y1);
-				float	re3 = inRelElev.value_linear(x2,y2);
-				float	re = SAFE_AVERAGE(re1, re2, re3);	// Could be safe max.
-
-				float	er1 = inRelElevRange.value_linear(x0,y0);
-				float	er2 = inRelElevRange.value_linear(x1,y1);
-				float	er3 = inRelElevRange.value_linear(x2,y2);
-				float	er = SAFE_AVERAGE(er1, er2, er3);	// Could be safe max.
-
-				int		near_water =(tri->neighbor(0)->info().terrain == terrain_Water && !ioMesh.is_infinite(tri->neighbor(0))) ||
-									(tri->neighbor(1)->info().terrain == terrain_Water && !ioMesh.is_infinite(tri->neighbor(1))) ||
-									(tri->neighbor(2)->info().terrain == terrain_Water && !ioMesh.is_infinite(tri->neighbor(2)));
-
-				float	uden1 = inUrbanDensity.value_linear(x0,y0);
-				float	uden2 = inUrbanDensity.value_linear(x1,y1);
-				float	uden3 = inUrbanDensity.value_linear(x2,y2);
-				float	uden = SAFE_AVERAGE(uden1, uden2, uden3);	// Could be safe max.
-
-				float	urad1 = inUrbanRadial.value_linear(x0,y0);
-				float	urad2 = inUrbanRadial.value_linear(x1,y1);
-				float	urad3 = inUrbanRadial.value_linear(x2,y2);
-				float	urad = SAFE_AVERAGE(urad1, urad2, urad3);	// Could be safe max.
-
-				float	utrn1 = inUrbanTransport.value_linear(x0,y0);
-				float	utrn2 = inUrbanTransport.value_linear(x1,y1);
-				float	utrn3 = inUrbanTransport.value_linear(x2,y2);
-				float	utrn = SAFE_AVERAGE(utrn1, utrn2, utrn3);	// Could be safe max.
-
-				float usq  = usquare.search_nearest(center_x, center_y);
-				float usq1 = usquare.search_nearest(x0,y0);
-				float usq2 = usquare.search_nearest(x1,y1);
-				float usq3 = usquare.search_nearest(x2,y2);
-				usq = MAJORITY_RULES(usq, usq1, usq2, usq3);
-
-//				float	el1 = tri->vertex(0)->info().height;
-//				float	el2 = tri->vertex(1)->info().height;
-//				float	el3 = tri->vertex(2)->info().height;
-//				float	el_tri = (el1 + el2 + el3) / 3.0;
-
-				float	sl_tri = 1.0 - tri->info().normal[2];
-				float	flat_len = sqrt(tri->info().normal[1] * tri->info().normal[1] + tri->info().normal[0] * tri->info().normal[0]);
-				float	sh_tri = tri->info().normal[1];
-				if (flat_len != 0.0)
-				{
-					sh_tri /= flat_len;
-					sh_tri = max(-1.0f, min(sh_tri, 1.0f));
-				}
-
-				float	patches = (gMeshPrefs.rep_switch_m == 0.0) ? 100.0 : (60.0 * NM_TO_MTR / gMeshPrefs.rep_switch_m);
-				int x_variant = fabs(center_x /*+ RandRange(-0.03, 0.03)*/) * patches; // 25.0;
-				int y_variant = fabs(center_y /*+ RandRange(-0.03, 0.03)*/) * patches; // 25.0;
-//				int variant_blob = ((x_variant + y_variant * 2) % 4) + 1;
-//				int variant_head = (tri->info().normal[0] > 0.0) ? 6 : 8;
-//
-//				if (sh_tri < -0.7)	variant_head = 7;
-//				if (sh_tri >  0.7)	variant_head = 5;
-
-				//fprintf(stderr, " %d", tri->info().feature);
-				int zoning = NO_VALUE;//(tri->info().orig_face == Pmwx::Face_handle()) ? NO_VALUE : tri->info().orig_face->data().GetZoning();
-				if(zoning == NO_VALUE && tri->info().orig_face != Pmwx::Face_handle())
-					zoning = tri->info().orig_face->data().GetParam(af_Variant,-1.0) + 1.0;
-				int terrain = FindNaturalTerrain(tri->info().feature, zoning, lu, ss, as,cs, sl, sl_tri, tm, tmr, rn, near_water, sh_tri, re, er, uden, urad, utrn, usq, fabs((float) center_y)/*, variant_blob, variant_head*/);
-				if (terrain == -1)
-					AssertPrintf("Cannot find terrain for: %s, %f\n", FetchTokenString(lu), /*FetchTokenString(cl), el, */ sl);
-
-				tri->info().mesh_temp = tm;
-				tri->info().mesh_rain = rn;
-			#if OPENGL_MAP
-				tri->info().debug_terrain_orig = terrain;
-				tri->info().debug_slope_dem = sl;
-				tri->info().debug_slope_tri = sl_tri;
-				tri->info().debug_temp_range = tmr;
-				tri->info().debug_heading = sh_tri;
-				tri->info().debug_re = re;
-				tri->info().debug_er = er;				
-				tri->info().debug_lu[0] = lu;
-				tri->info().debug_lu[1] = lu;
-				tri->info().debug_lu[2] = lu;
-				tri->info().debug_lu[3] = lu;
-				tri->info().debug_lu[4] = lu ;
-			#endif
-				if (terrain == -1)
-				{
-					AssertPrintf("No rule. lu=%s, slope=%f, trislope=%f, temp=%f, temprange=%f, rain=%f, water=%d, heading=%f, lat=%f\n",
-						FetchTokenString(lu), /*el,*/ acos(1-sl)*RAD_TO_DEG, acos(1-sl_tri)*RAD_TO_DEG, tm, tmr, rn, near_water, sh_tri, center_y);
-				}
-				//fprintf(stderr, "->%d", terrain);
-
-				tri->info().terrain = terrain;
-
-			}
+			landuse_tri_t t;
+			t.tri = tri;
+			t.x0 = CGAL::to_double(tri->vertex(0)->point().x());
+			t.y0 = CGAL::to_double(tri->vertex(0)->point().y());
+			t.x1 = CGAL::to_double(tri->vertex(1)->point().x());
+			t.y1 = CGAL::to_double(tri->vertex(1)->point().y());
+			t.x2 = CGAL::to_double(tri->vertex(2)->point().x());
+			t.y2 = CGAL::to_double(tri->vertex(2)->point().y());
+			tris.push_back(t);
+		}
+	}
 
+	landuse_job_t job = {
+		&inClimStyle, &inAgriStyle, &inSoilStyle, &inSlope, &inRelElev, &inRelElevRange,
+		&inTemp, &inTempRng, &inRain, &inUrbanDensity, &inUrbanRadial, &inUrbanTransport, &usquare,
+		&landuse, &ioMesh, &tris, NULL };
+	vector<NaturalTerrainMemo>	memos(THREAD_WorkerCount(gThreads));
+	job.memos = &memos[0];
+	{
+		TRACE_ZONE("Landuse triangles")
+		THREAD_ParallelFor(tris.size(), assign_landuse_tri, &job, gThreads);
+	}
+	TRACE_COUNT("landuse triangles", tris.size())
+
+	for (vector<landuse_tri_t>::iterator t = tris.begin(); t != tris.end(); ++t)
+	{
+		CDT::Face_handle tri = t->tri;
+		if (t->terrain == -1)
+			AssertPrintf("Cannot find terrain for: %s, %f\n", FetchTokenString(t->lu), /*FetchTokenString(cl), el, */ t->sl);
+
+		tri->info().mesh_temp = t->tm;
+		tri->info().mesh_rain = t->rn;
+	#if OPENGL_MAP
+		tri->info().debug_terrain_orig = t->terrain;
+		tri->info().debug_slope_dem = t->sl;
+		tri->info().debug_slope_tri = t->sl_tri;
+		tri->info().debug_temp_range = t->tmr;
+		tri->info().debug_heading = t->sh_tri;
+		tri->info().debug_re = t->re;
+		tri->info().debug_er = t->er;
+		tri->info().debug_lu[0] = t->lu;
+		tri->info().debug_lu[1] = t->lu;
+		tri->info().debug_lu[2] = t->lu;
+		tri->info().debug_lu[3] = t->lu;
+		tri->info().debug_lu[4] = t->lu;
+	#endif
+		if (t->terrain == -1)
+		{
+			AssertPrintf("No rule. lu=%s, slope=%f, trislope=%f, temp=%f, temprange=%f, rain=%f, water=%d, heading=%f, lat=%f\n",
+				FetchTokenString(t->lu), /*el,*/ acos(1-t->sl)*RAD_TO_DEG, acos(1-t->sl_tri)*RAD_TO_DEG, t->tm, t->tmr, t->rn, t->near_water, t->sh_tri, (t->y0 + t->y1 + t->y2) / 3.0);
 		}
+
+		tri->info().terrain = t->terrain;
 	}
 
 	/***********************************************************************************************
@@ -2823,112 +2928,317 @@ double	MeshHeightAtPoint(CDT& inMesh, double inLon, double inLat, int hint_id)
 	}
 }
 
+/************************************************************************************************************************
+ * MESH HEIGHT INDEX
+ ************************************************************************************************************************/
+
+// How far outside a triangle (in degrees, about 0.1 mm) a point may be and still count as on its edge.
+#define MESH_INDEX_EDGE_TOL	1.0e-9
+
+MeshHeightIndex::MeshHeightIndex(CDT& inMesh, int inTrisPerCell) :
+	mCellsX(0), mCellsY(0), mWest(0), mSouth(0), mEast(0), mNorth(0), mCellsPerLon(0), mCellsPerLat(0)
+{
+	mTris.reserve(inMesh.number_of_faces());
+	for(CDT::Finite_faces_iterator f = inMesh.finite_faces_begin(); f != inMesh.finite_faces_end(); ++f)
+	{
+		tri_t	t;
+		double	h[3];
+		t.face = f;
+		for(int v = 0; v < 3; ++v)
+		{
+			t.x[v] = CGAL::to_double(f->vertex(v)->point().x());
+			t.y[v] = CGAL::to_double(f->vertex(v)->point().y());
+			h[v] = f->vertex(v)->info().height;
+		}
+
+		double	dx1 = t.x[1] - t.x[0], dy1 = t.y[1] - t.y[0], dh1 = h[1] - h[0];
+		double	dx2 = t.x[2] - t.x[0], dy2 = t.y[2] - t.y[0], dh2 = h[2] - h[0];
+		double	det = dx1 * dy2 - dx2 * dy1;
+		t.z0 = h[0];
+		if(det != 0.0)
+		{
+			t.a = (dh1 * dy2 - dh2 * dy1) / det;
+			t.b = (dx1 * dh2 - dx2 * dh1) / det;
+		}
+		else
+		{
+			// Sliver that rounded flat - nothing will land strictly inside it anyway.
+			t.a = t.b = 0.0;
+			t.z0 = (h[0] + h[1] + h[2]) / 3.0;
+		}
+
+		if(mTris.empty())
+		{
+			mWest = mEast = t.x[0];
+			mSouth = mNorth = t.y[0];
+		}
+		for(int v = 0; v < 3; ++v)
+		{
+			mWest = min(mWest, t.x[v]);		mEast = max(mEast, t.x[v]);
+			mSouth = min(mSouth, t.y[v]);	mNorth = max(mNorth, t.y[v]);
+		}
+		mTris.push_back(t);
+	}
+
+	if(mTris.empty() || mEast <= mWest || mNorth <= mSouth)
+		return;
+
+	// Aim for inTrisPerCell triangles per cell with roughly square cells.
+	double	cells = max(1.0, (double) mTris.size() / (double) max(inTrisPerCell, 1));
+	double	aspect = (mEast - mWest) / (mNorth - mSouth);
+	mCellsX = max(1, (int) sqrt(cells * aspect));
+	mCellsY = max(1, (int) (cells / (double) mCellsX));
+	mCellsPerLon = (double) mCellsX / (mEast - mWest);
+	mCellsPerLat = (double) mCellsY / (mNorth - mSouth);
+
+	// Two passes: count each cell's triangles, then fill.  The cell range for a triangle comes from the same
+	// floor() a query uses, so a point inside a triangle always finds it listed in the point's cell.
+	int					cell_count = mCellsX * mCellsY;
+	vector<int>			ranges(mTris.size() * 4);
+	mCellStart.assign(cell_count + 1, 0);
+	for(int n = 0; n < mTris.size(); ++n)
+	{
+		const tri_t& t(mTris[n]);
+		int * r = &ranges[n * 4];
+		r[0] = intlim((int) floor((min(t.x[0], min(t.x[1], t.x[2])) - mWest) * mCellsPerLon), 0, mCellsX - 1);
+		r[1] = intlim((int) floor((max(t.x[0], max(t.x[1], t.x[2])) - mWest) * mCellsPerLon), 0, mCellsX - 1);
+		r[2] = intlim((int) floor((min(t.y[0], min(t.y[1], t.y[2])) - mSouth) * mCellsPerLat), 0, mCellsY - 1);
+		r[3] = intlim((int) floor((max(t.y[0], max(t.y[1], t.y[2])) - mSouth) * mCellsPerLat), 0, mCellsY - 1);
+		for(int cy = r[2]; cy <= r[3]; ++cy)
+		for(int cx = r[0]; cx <= r[1]; ++cx)
+			++mCellStart[cy * mCellsX + cx + 1];
+	}
+	for(int c = 0; c < cell_count; ++c)
+		mCellStart[c + 1] += mCellStart[c];
+
+	mCellTris.resize(mCellStart[cell_count]);
+	vector<int>	cursor(mCellStart.begin(), mCellStart.end() - 1);
+	for(int n = 0; n < mTris.size(); ++n)
+	{
+		const int * r = &ranges[n * 4];
+		for(int cy = r[2]; cy <= r[3]; ++cy)
+		for(int cx = r[0]; cx <= r[1]; ++cx)
+			mCellTris[cursor[cy * mCellsX + cx]++] = n;
+	}
+}
+
+bool	MeshHeightIndex::tri_contains(const tri_t& t, double lon, double lat)
+{
+	return	(t.x[1] - t.x[0]) * (lat - t.y[0]) - (t.y[1] - t.y[0]) * (lon - t.x[0]) >= 0.0 &&
+			(t.x[2] - t.x[1]) * (lat - t.y[1]) - (t.y[2] - t.y[1]) * (lon - t.x[1]) >= 0.0 &&
+			(t.x[0] - t.x[2]) * (lat - t.y[2]) - (t.y[0] - t.y[2]) * (lon - t.x[2]) >= 0.0;
+}
+
+int		MeshHeightIndex::find_in_cell(double lon, double lat) const
+{
+	if(mCellsX == 0 || lon < mWest || lon > mEast || lat < mSouth || lat > mNorth)
+		return -1;
+
+	int	cx = intlim((int) floor((lon - mWest) * mCellsPerLon), 0, mCellsX - 1);
+	int	cy = intlim((int) floor((lat - mSouth) * mCellsPerLat), 0, mCellsY - 1);
+	int	c = cy * mCellsX + cx;
+
+	int		best = -1;
+	double	best_miss = -MESH_INDEX_EDGE_TOL;
+	for(int i = mCellStart[c]; i < mCellStart[c + 1]; ++i)
+	{
+		const tri_t& t(mTris[mCellTris[i]]);
+		if(tri_contains(t, lon, lat))
+			return mCellTris[i];
+
+		// Not strictly inside - how far outside is it?  Only worth it if it is already inside the bounding box.
+		if(lon < min(t.x[0], min(t.x[1], t.x[2])) - MESH_INDEX_EDGE_TOL || lon > max(t.x[0], max(t.x[1], t.x[2])) + MESH_INDEX_EDGE_TOL ||
+		   lat < min(t.y[0], min(t.y[1], t.y[2])) - MESH_INDEX_EDGE_TOL || lat > max(t.y[0], max(t.y[1], t.y[2])) + MESH_INDEX_EDGE_TOL)
+			continue;
+		double	miss = 0.0;
+		for(int v = 0; v < 3; ++v)
+		{
+			int		w = (v + 1) % 3;
+			double	ex = t.x[w] - t.x[v], ey = t.y[w] - t.y[v];
+			double	len = sqrt(ex * ex + ey * ey);
+			if(len > 0.0)
+				miss = min(miss, (ex * (lat - t.y[v]) - ey * (lon - t.x[v])) / len);
+		}
+		if(miss >= best_miss)
+		{
+			best_miss = miss;
+			best = mCellTris[i];
+		}
+	}
+	return best;
+}
+
+int		MeshHeightIndex::find(double lon, double lat) const
+{
+	return find_in_cell(lon, lat);
+}
+
+double	MeshHeightIndex::height(double lon, double lat) const
+{
+	int n = find_in_cell(lon, lat);
+	return n == -1 ? DEM_NO_DATA : tri_height(mTris[n], lon, lat);
+}
+
+struct	mesh_heights_job_t {
+	const MeshHeightIndex *	index;
+	const double *			lonlat;
+	double *				heights;
+	int						count;
+};
+
+// Points per work item when a batch is split over threads - big enough that the hand-out lock is noise.
+#define MESH_HEIGHTS_CHUNK 4096
+
+static void	mesh_heights_chunk(const MeshHeightIndex& index, const double * lonlat, double * out_heights, int count)
+{
+	int	last = -1;
+	for(int i = 0; i < count; ++i, lonlat += 2)
+	{
+		if(last == -1 || !MeshHeightIndex::tri_contains(index.tri(last), lonlat[0], lonlat[1]))
+			last = index.find(lonlat[0], lonlat[1]);
+		out_heights[i] = last == -1 ? DEM_NO_DATA : MeshHeightIndex::tri_height(index.tri(last), lonlat[0], lonlat[1]);
+	}
+}
+
+static void	mesh_heights_work(int item, int worker, void * ref)
+{
+	mesh_heights_job_t * job = (mesh_heights_job_t *) ref;
+	int first = item * MESH_HEIGHTS_CHUNK;
+	mesh_heights_chunk(*job->index, job->lonlat + 2 * first, job->heights + first, min(MESH_HEIGHTS_CHUNK, job->count - first));
+}
+
+void	MeshHeightIndex::heights(int count, const double * lonlat, double * out_heights, int max_workers) const
+{
+	if(count <= MESH_HEIGHTS_CHUNK || THREAD_WorkerCount(max_workers) == 1)
+	{
+		mesh_heights_chunk(*this, lonlat, out_heights, count);
+		return;
+	}
+	mesh_heights_job_t job = { this, lonlat, out_heights, count };
+	THREAD_ParallelFor((count + MESH_HEIGHTS_CHUNK - 1) / MESH_HEIGHTS_CHUNK, mesh_heights_work, &job, max_workers);
+}
+
+/*
+	CalcMeshError runs every DEM row as a separate work item against a MeshHeightIndex and keeps its stats in the
+	row's own slot; the rows are then merged top to bottom, so the totals and the "worst" points come out the same
+	no matter how many threads ran.  Off-mesh pixels are skipped.
+*/
+
+struct	mesh_error_row_t {
+	int		ctr;
+	float	min_err, max_err;
+	double	sum, sum2;
+	float	worst_pos, worst_neg;
+	int		worst_pos_x, worst_neg_x;
+};
+
+struct	mesh_error_job_t {
+	const MeshHeightIndex *		index;
+	const DEMGeo *				elev;
+	mesh_error_row_t *			rows;
+	int							first_row;
+};
+
+static void	mesh_error_row(int item, int worker, void * ref)
+{
+	mesh_error_job_t * job = (mesh_error_job_t *) ref;
+	const DEMGeo& elev(*job->elev);
+	int y = job->first_row + item;
+	mesh_error_row_t& r(job->rows[y]);
+
+	r.ctr = 0;
+	r.min_err = 9.9e9;
+	r.max_err = 0.0;
+	r.sum = r.sum2 = 0.0;
+	r.worst_pos = r.worst_neg = 0.0;
+	r.worst_pos_x = r.worst_neg_x = -1;
+
+	int last = -1;
+	for (int x = 0; x < elev.mWidth ; ++x)
+	{
+		float ideal = elev.get(x,y);
+		if (ideal == DEM_NO_DATA)
+			continue;
+		double lon = elev.x_to_lon(x);
+		double lat = elev.y_to_lat(y);
+		if(last == -1 || !MeshHeightIndex::tri_contains(job->index->tri(last), lon, lat))
+			last = job->index->find(lon, lat);
+		if(last == -1)
+			continue;
+
+		// Distance from the pixel to the triangle's plane, measured along its normal - in mixed degree/meter
+		// units, same as the old Plane3-based code.
+		const MeshHeightIndex::tri_t& t(job->index->tri(last));
+		double	real = MeshHeightIndex::tri_height(t, lon, lat);
+		float	derr = (ideal - real) / sqrt(1.0 + t.a * t.a + t.b * t.b);
+
+		if(derr > r.worst_pos)
+		{
+			r.worst_pos = derr;
+			r.worst_pos_x = x;
+		}
+		if(derr < r.worst_neg)
+		{
+			r.worst_neg = derr;
+			r.worst_neg_x = x;
+		}
+		r.min_err = min(r.min_err, derr);
+		r.max_err = max(r.max_err, derr);
+		r.sum += derr;
+		r.sum2 += (derr*derr);
+		++r.ctr;
+	}
+}
+
 int	CalcMeshError(CDT& mesh, DEMGeo& elev, float& out_min, float& out_max, float& out_ave, float& std_dev, ProgressFunc inFunc)
 {
 	if (inFunc) inFunc(0, 1, "Calculating Error", 0.0);
 	int ctr = 0;
-	
+
 	out_max = 0.0;
 	out_ave = 0.0;
 	std_dev = 0.0;
 	out_min = 9.9e9;
-	
-	CDT::Face_handle	last_tri;
-	Plane3				last_plane;
-	Point2				last_tri_loc[3];
-	double				DEG_TO_NM_LON = DEG_TO_NM_LAT;
 
 	float				worst_pos = 0.0;
 	float				worst_neg = 0.0;
 	Point2				worst_pos_p;
 	Point2				worst_neg_p;
-	
+	double				sum = 0.0, sum2 = 0.0;
+
 	if(mesh.number_of_faces() >= 1)
-	for (int y = 0; y < elev.mHeight; ++y)
 	{
-		if (inFunc && (y % 20) == 0) inFunc(0, 1, "Calculating Error", (float) y / (float) elev.mHeight);
+		MeshHeightIndex				index(mesh);
+		vector<mesh_error_row_t>	rows(elev.mHeight);
+		mesh_error_job_t			job = { &index, &elev, rows.empty() ? NULL : &rows[0], 0 };
 
-		for (int x = 0; x < elev.mWidth ; ++x)
+		// Hand the rows out in bands so we can still report progress from this thread.
+		for (job.first_row = 0; job.first_row < elev.mHeight; job.first_row += 256)
 		{
-			float ideal = elev.get(x,y);
-			if (ideal != DEM_NO_DATA)
-			{
-				Point2	ll(elev.x_to_lon(x), elev.y_to_lat(y));
-				if(last_tri == CDT::Face_handle() ||
-				   Segment2(last_tri_loc[0],last_tri_loc[1]).on_right_side(ll) ||
-				   Segment2(last_tri_loc[1],last_tri_loc[2]).on_right_side(ll) ||
-				   Segment2(last_tri_loc[2],last_tri_loc[0]).on_right_side(ll))
-				{
-
-					CDT::Face_handle	f = CDT::Face_handle();
-					int	n;
-					CDT::Locate_type lt;
-					f = mesh.locate(CDT::Point(ll.x(), ll.y()), lt, n, last_tri);
-					if (lt == CDT::EDGE && mesh.is_infinite(f))
-					{
-						f = f->neighbor(n);
-					}
-					
-					if(!mesh.is_infinite(f))
-					{
-						last_tri = f;
-
-						last_tri_loc[0] = cgal2ben(f->vertex(0)->point());
-						last_tri_loc[1] = cgal2ben(f->vertex(1)->point());
-						last_tri_loc[2] = cgal2ben(f->vertex(2)->point());
-						
-
-						DEG_TO_NM_LON = DEG_TO_NM_LAT * cos(CGAL::to_double(ll.y()) * DEG_TO_RAD);
-
-						Point3	p1((last_tri_loc[0].x()),// * (DEG_TO_NM_LON * NM_TO_MTR)),
-								   (last_tri_loc[0].y()),// * (DEG_TO_NM_LAT * NM_TO_MTR)),
-								   (last_tri->vertex(0)->info().height));
-
-						Point3	p2((last_tri_loc[1].x()),// * (DEG_TO_NM_LON * NM_TO_MTR)),
-								   (last_tri_loc[1].y()),// * (DEG_TO_NM_LAT * NM_TO_MTR)),
-								   (last_tri->vertex(1)->info().height));
-
-						Point3	p3((last_tri_loc[2].x()),// * (DEG_TO_NM_LON * NM_TO_MTR)),
-								   (last_tri_loc[2].y()),// * (DEG_TO_NM_LAT * NM_TO_MTR)),
-								   (last_tri->vertex(2)->info().height));
+			if (inFunc) inFunc(0, 1, "Calculating Error", (float) job.first_row / (float) elev.mHeight);
+			THREAD_ParallelFor(min(256, elev.mHeight - job.first_row), mesh_error_row, &job, gThreads);
+		}
 
-						Vector3	s1(p2, p3);
-						Vector3	s2(p2, p1);
-						Vector3	n = s1.cross(s2);
-						n.normalize();
-						last_plane = Plane3(p1,n);
-					}
-				}
-				
-				if(last_tri != CDT::Face_handle())
-				{
-					double real = (last_plane.n.dx * ll.x() +
-								   last_plane.n.dy * ll.y() -
-								   last_plane.ndotp) / -last_plane.n.dz;
-					
-					double	close = last_plane.distance_denormaled(Point3(ll.x(),ll.y(),ideal));
-					float derr = real - ideal;
-					derr = close;
-
-					Point2	me(elev.x_to_lon(x), elev.y_to_lat(y));
-					if(derr > worst_pos)
-					{
-						worst_pos = derr;
-						worst_pos_p = me;
-					}
-					if(derr < worst_neg)
-					{
-						worst_neg = derr;
-						worst_neg_p = me;
-					}
-					
-					out_min = min(out_min,derr);
-					out_max = max(out_max,derr);
-					out_ave += derr;
-					std_dev += (derr*derr);
-					++ctr;
-				}
+		for (int y = 0; y < elev.mHeight; ++y)
+		{
+			const mesh_error_row_t& r(rows[y]);
+			if (r.ctr == 0)
+				continue;
+			if(r.worst_pos > worst_pos)
+			{
+				worst_pos = r.worst_pos;
+				worst_pos_p = Point2(elev.x_to_lon(r.worst_pos_x), elev.y_to_lat(y));
+			}
+			if(r.worst_neg < worst_neg)
+			{
+				worst_neg = r.worst_neg;
+				worst_neg_p = Point2(elev.x_to_lon(r.worst_neg_x), elev.y_to_lat(y));
 			}
+			out_min = min(out_min, r.min_err);
+			out_max = max(out_max, r.max_err);
+			sum += r.sum;
+			sum2 += r.sum2;
+			ctr += r.ctr;
 		}
 	}
 	if(worst_pos > 0.0)
@@ -2944,8 +3254,8 @@ int	CalcMeshError(CDT& mesh, DEMGeo& elev, float& out_min, float& out_max, float
 	
 	if(ctr > 0)
 	{
-		out_ave /= (float) ctr;
-		std_dev = sqrt(std_dev / float(ctr));
+		out_ave = sum / (double) ctr;
+		std_dev = sqrt(sum2 / (double) ctr);
 	}
 	
 	if (inFunc) inFunc(0, 1, "Calculating Error", 1.0);
@@ -65,6 +65,61 @@ void	Calc2ndDerivative(DEMGeo& ioDEM);
 int		CalcMeshError(CDT& mesh, DEMGeo& elev, float& out_min, float& out_max, float& out_ave, float& std_dev, ProgressFunc inFunc);
 int		CalcMeshTextures(CDT& inMesh, map<int, int>& out_lus);
 
+/*
+	MeshHeightIndex - THEORY OF OPERATION
+
+	MeshHeightAtPoint walks the CDT from a hint face in exact arithmetic for every query, and the CDT can't be read
+	from two threads at once (see the note above AssignLandusesToMesh).  Once the mesh is done and its heights are
+	set, a MeshHeightIndex takes a snapshot of it: every finite triangle's corners as doubles, the plane through
+	them, and a uniform grid over the mesh's bounding box where each cell lists the triangles whose bounding box
+	touches it.  A lookup goes straight to the point's cell and tests the handful of triangles listed there, so the
+	cost doesn't depend on the size of the mesh or on where the last query was.
+
+	The index never changes after it is built and never looks at the CDT again, so any number of threads can query
+	it at once without locking.  If the mesh changes, build a new one.
+
+	Heights are linear in lon/lat.  HeightWithinTri scales lon by cos(lat) first, but that scale is the same for the
+	corners and the query point, so the plane gives the same height to rounding.
+
+	A point right on a shared edge can fail the double-precision inside test of both triangles; in that case we take
+	the candidate it misses by the least, if the miss is within rounding.  Points off the mesh are DEM_NO_DATA.
+*/
+class	MeshHeightIndex {
+public:
+
+	struct	tri_t {
+		CDT::Face_handle	face;
+		double				x[3], y[3];		// corners, counter-clockwise
+		double				z0, a, b;		// height = z0 + a * (lon - x[0]) + b * (lat - y[0])
+	};
+
+	explicit		MeshHeightIndex(CDT& inMesh, int inTrisPerCell = 2);
+
+	int				find(double lon, double lat) const;			// triangle under the point, or -1 if off mesh
+	const tri_t&	tri(int n) const { return mTris[n]; }
+	int				tri_count(void) const { return mTris.size(); }
+
+	double			height(double lon, double lat) const;		// DEM_NO_DATA if off mesh
+
+	// out_heights[i] = height(lonlat[2*i], lonlat[2*i+1]).  Neighboring points are assumed to be near each other
+	// (road shape points, DEM rows), so the last hit is tried first.  Runs on up to max_workers threads, 0 = one per core.
+	void			heights(int count, const double * lonlat, double * out_heights, int max_workers = 1) const;
+
+	static double	tri_height(const tri_t& t, double lon, double lat) { return t.z0 + t.a * (lon - t.x[0]) + t.b * (lat - t.y[0]); }
+	static bool		tri_contains(const tri_t& t, double lon, double lat);
+
+private:
+
+	int				find_in_cell(double lon, double lat) const;
+
+	vector<tri_t>	mTris;
+	vector<int>		mCellStart;			// cell c lists mCellTris[mCellStart[c]] .. mCellTris[mCellStart[c+1]-1]
+	vector<int>		mCellTris;
+	int				mCellsX, mCellsY;
+	double			mWest, mSouth, mEast, mNorth;
+	double			mCellsPerLon, mCellsPerLat;
+};
+
 
 // This routine is inline because we need a semi-global definition of what a "real" edge of the pmwx is.
 
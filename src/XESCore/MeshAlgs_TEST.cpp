@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2018, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+
+#include "MeshAlgs.h"
+#include "DEMDefs.h"
+#include "AssertUtils.h"
+#include <math.h>
+
+// These check MeshHeightIndex's grid lookups against a brute force scan of every triangle, and its heights against
+// MeshHeightAtPoint's exact walk of the CDT, on a jittered one-degree tile with a couple of constraints through it.
+// HeightWithinTri works in meters with cos(lat) folded in, so it only agrees with the plane to about a millimeter.
+
+#define	EXACT_TOL	1.0e-3
+
+static unsigned int	sSeed = 1;
+
+static double	test_rand(double lo, double hi)
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return lo + (hi - lo) * (double) ((sSeed >> 8) & 0xFFFFFF) / (double) 0xFFFFFF;
+}
+
+static double	test_terrain(double lon, double lat)
+{
+	return 100.0 + 400.0 * sin(lon * 7.0) * cos(lat * 5.0) + 50.0 * (lat - 47.0);
+}
+
+static void	make_test_mesh(CDT& mesh, int dim)
+{
+	for(int y = 0; y <= dim; ++y)
+	for(int x = 0; x <= dim; ++x)
+	{
+		double lon = -122.0 + (double) x / dim, lat = 47.0 + (double) y / dim;
+		if(x > 0 && x < dim) lon += test_rand(-0.3, 0.3) / dim;
+		if(y > 0 && y < dim) lat += test_rand(-0.3, 0.3) / dim;
+		CDT::Vertex_handle v = mesh.insert(CDT::Point(lon, lat));
+		v->info().height = test_terrain(lon, lat);
+	}
+
+	// Two constraints that don't cross, so the CDT adds no vertices of its own, but does keep some non-Delaunay
+	// slivers along them.
+	CDT::Vertex_handle	v[4];
+	v[0] = mesh.insert(CDT::Point(-121.91, 47.13));		v[1] = mesh.insert(CDT::Point(-121.07, 47.81));
+	v[2] = mesh.insert(CDT::Point(-121.93, 47.17));		v[3] = mesh.insert(CDT::Point(-121.09, 47.85));
+	for(int n = 0; n < 4; ++n)
+		v[n]->info().height = test_terrain(CGAL::to_double(v[n]->point().x()), CGAL::to_double(v[n]->point().y()));
+	mesh.insert_constraint(v[0], v[1]);
+	mesh.insert_constraint(v[2], v[3]);
+}
+
+// The first triangle that strictly contains the point, or -1.
+static int	brute_force_find(const MeshHeightIndex& index, double lon, double lat)
+{
+	for(int n = 0; n < index.tri_count(); ++n)
+	if(MeshHeightIndex::tri_contains(index.tri(n), lon, lat))
+		return n;
+	return -1;
+}
+
+// Random points over the tile and a margin around it: the grid has to agree with the brute force scan on whether
+// the point is on the mesh, and on its height - a point on a shared edge may legitimately pick either triangle.
+static void	TEST_MeshHeightIndexRandom(CDT& mesh, const MeshHeightIndex& index)
+{
+	int	hint = CDT::gen_cache_key();
+	int	found_bad = 0, height_bad = 0, exact_bad = 0;
+	for(int n = 0; n < 20000; ++n)
+	{
+		double	lon = test_rand(-122.1, -120.9), lat = test_rand(46.9, 48.1);
+		int		brute = brute_force_find(index, lon, lat);
+		int		grid = index.find(lon, lat);
+		if((brute == -1) != (grid == -1))
+		{
+			++found_bad;
+			continue;
+		}
+		if(grid == -1)
+		{
+			if(index.height(lon, lat) != DEM_NO_DATA)
+				++height_bad;
+			continue;
+		}
+		double	h = index.height(lon, lat);
+		if(fabs(h - MeshHeightIndex::tri_height(index.tri(brute), lon, lat)) > 1.0e-6)
+			++height_bad;
+		if(fabs(h - MeshHeightAtPoint(mesh, lon, lat, hint)) > EXACT_TOL)
+			++exact_bad;
+	}
+	TEST_Run(found_bad == 0);
+	TEST_Run(height_bad == 0);
+	TEST_Run(exact_bad == 0);
+}
+
+// Every triangle's centroid finds that very triangle; every corner and edge midpoint is on the mesh, even the ones
+// that round to just outside both triangles they touch.
+static void	TEST_MeshHeightIndexTris(CDT& mesh, const MeshHeightIndex& index)
+{
+	int	hint = CDT::gen_cache_key();
+	int	centroid_bad = 0, edge_bad = 0;
+	for(int n = 0; n < index.tri_count(); ++n)
+	{
+		const MeshHeightIndex::tri_t& t(index.tri(n));
+		if(index.find((t.x[0] + t.x[1] + t.x[2]) / 3.0, (t.y[0] + t.y[1] + t.y[2]) / 3.0) != n)
+			++centroid_bad;
+		for(int v = 0; v < 3; ++v)
+		{
+			int		w = (v + 1) % 3;
+			double	pts[2][2] = { { t.x[v], t.y[v] }, { (t.x[v] + t.x[w]) * 0.5, (t.y[v] + t.y[w]) * 0.5 } };
+			for(int p = 0; p < 2; ++p)
+			if(index.find(pts[p][0], pts[p][1]) == -1 ||
+			   fabs(index.height(pts[p][0], pts[p][1]) - MeshHeightAtPoint(mesh, pts[p][0], pts[p][1], hint)) > EXACT_TOL)
+				++edge_bad;
+		}
+	}
+	TEST_Run(index.tri_count() == mesh.number_of_faces());
+	TEST_Run(centroid_bad == 0);
+	TEST_Run(edge_bad == 0);
+}
+
+// The batch call, split over threads, gives exactly what one lookup at a time gives.
+static void	TEST_MeshHeightIndexBatch(const MeshHeightIndex& index)
+{
+	const int		count = 50000;
+	vector<double>	lonlat(count * 2), batch(count);
+	for(int n = 0; n < count; ++n)
+	{
+		// A road-like walk, with the odd jump, so the last-hit shortcut is both taken and missed.
+		if(n == 0 || test_rand(0, 1) < 0.01)
+		{
+			lonlat[2 * n] = test_rand(-122.05, -120.95);
+			lonlat[2 * n + 1] = test_rand(46.95, 48.05);
+		}
+		else
+		{
+			lonlat[2 * n] = lonlat[2 * n - 2] + test_rand(-0.002, 0.002);
+			lonlat[2 * n + 1] = lonlat[2 * n - 1] + test_rand(-0.002, 0.002);
+		}
+	}
+	index.heights(count, &lonlat[0], &batch[0], 4);
+
+	int	bad = 0;
+	for(int n = 0; n < count; ++n)
+	{
+		double h = index.height(lonlat[2 * n], lonlat[2 * n + 1]);
+		if(h == DEM_NO_DATA ? batch[n] != DEM_NO_DATA : fabs(h - batch[n]) > 1.0e-6)
+			++bad;
+	}
+	TEST_Run(bad == 0);
+}
+
+void	TEST_MeshAlgs(void)
+{
+	CDT	mesh;
+	make_test_mesh(mesh, 60);
+
+	// A few triangles per cell, and the one-cell grid, which degenerates into the brute force scan.
+	MeshHeightIndex	index(mesh);
+	TEST_MeshHeightIndexRandom(mesh, index);
+	TEST_MeshHeightIndexTris(mesh, index);
+	TEST_MeshHeightIndexBatch(index);
+
+	MeshHeightIndex	coarse(mesh, mesh.number_of_faces());
+	TEST_MeshHeightIndexRandom(mesh, coarse);
+}
@@ -33,14 +33,14 @@ FileReader::FileReader(const char * inFileName, PlatformType platform)
 {
 	mFile = fopen(inFileName, "rb");
 	mClose = true;
-	mPlatform = platform;
+	mReadSwap = IO_NeedsSwap(platform);
 }
 
 FileReader::FileReader(FILE * inFile, PlatformType platform)
 {
 	mFile = inFile;
 	mClose = false;
-	mPlatform = platform;
+	mReadSwap = IO_NeedsSwap(platform);
 }
 
 FileReader::~FileReader()
@@ -49,88 +49,29 @@ FileReader::~FileReader()
 		fclose(mFile);
 }
 
-void	FileReader::ReadShort(short& x)
+// No window: we don't read ahead, so whoever else uses the FILE finds it where we left off.  stdio buffers anyway.
+void	FileReader::ReadMore(char * inBuf, int inLength)
 {
-	if (1 != fread(&x, sizeof(x), 1, mFile))
-		throw "fread error";
-	EndianSwapBuffer(mPlatform, platform_Native, kSwapTwo, &x);
-}
-
-void	FileReader::ReadInt(int& x)
-{
-	if (1 != fread(&x, sizeof(x), 1, mFile))
-		throw "fread error";
-	EndianSwapBuffer(mPlatform, platform_Native, kSwapFour, &x);
-}
-
-void	FileReader::ReadFloat(float& x)
-{
-	if (1 != fread(&x, sizeof(x), 1, mFile))
-		throw "fread error";
-	EndianSwapBuffer(mPlatform, platform_Native, kSwapFour, &x);
-}
-
-void	FileReader::ReadDouble(double& x)
-{
-	if (1 != fread(&x, sizeof(x), 1, mFile))
-		throw "fread error";
-	EndianSwapBuffer(mPlatform, platform_Native, kSwapEight, &x);
-}
-
-void	FileReader::ReadBulk(char * inBuf, int inLength, bool inZip)
-{
-	if (1 != fread(inBuf, inLength, 1, mFile))
+	if (inLength > 0 && 1 != fread(inBuf, inLength, 1, mFile))
 		throw "fread error";
 }
 
 MemFileReader::MemFileReader(const char * inStart, const char * inEnd, PlatformType platform)
 {
-	mPtr = inStart;
-	mEnd = inEnd;
-	mPlatform = platform;
+	mReadPos = inStart;
+	mReadEnd = inEnd;
+	mReadSwap = IO_NeedsSwap(platform);
 }
 
 MemFileReader::~MemFileReader()
 {
 }
 
-void	MemFileReader::ReadShort(short& x)
+// The whole file is the window, so we only get here at the end of it.  Reading past the end leaves the value
+// alone, like it always has.
+void	MemFileReader::ReadMore(char * inBuf, int inLength)
 {
-	if (mPtr >= mEnd)	return;
-	x = *((short *) mPtr);
-	mPtr += sizeof(short);
-	EndianSwapBuffer(mPlatform, platform_Native, kSwapTwo, &x);
-}
-
-void	MemFileReader::ReadInt(int& x)
-{
-	if (mPtr >= mEnd)	return;
-	x = *((int *) mPtr);
-	mPtr += sizeof(int);
-	EndianSwapBuffer(mPlatform, platform_Native, kSwapFour, &x);
-}
-
-void	MemFileReader::ReadFloat(float& x)
-{
-	if (mPtr >= mEnd)	return;
-	x = *((float *) mPtr);
-	mPtr += sizeof(float);
-	EndianSwapBuffer(mPlatform, platform_Native, kSwapFour, &x);
-}
-
-void	MemFileReader::ReadDouble(double& x)
-{
-	if (mPtr >= mEnd)	return;
-	x = *((double *) mPtr);
-	mPtr += sizeof(double);
-	EndianSwapBuffer(mPlatform, platform_Native, kSwapEight, &x);
-}
-
-void	MemFileReader::ReadBulk(char * inBuf, int inLength, bool inZip)
-{
-	if (mPtr >= mEnd) return;
-	memcpy(inBuf, mPtr, inLength);
-	mPtr += inLength;
+	mReadPos = mReadEnd;
 }
 
 
@@ -142,55 +83,52 @@ FileWriter::FileWriter(const char * inFileName, PlatformType platform)
 {
 	mFile = fopen(inFileName, "wb");
 	mClose = true;
-	mPlatform = platform;
+	mWriteSwap = IO_NeedsSwap(platform);
+	mWritePos = mBuffer;
+	mWriteEnd = mBuffer + sizeof(mBuffer);
 }
 
 FileWriter::FileWriter(FILE * inFile, PlatformType platform)
 {
 	mFile = inFile;
 	mClose = false;
-	mPlatform = platform;
+	mWriteSwap = IO_NeedsSwap(platform);
+	mWritePos = mBuffer;
+	mWriteEnd = mBuffer + sizeof(mBuffer);
 }
 
 FileWriter::~FileWriter()
 {
+	Flush();
 	if (mClose)
 		fclose(mFile);
 }
 
-void	FileWriter::WriteShort(short x)
-{
-	EndianSwapBuffer(platform_Native, mPlatform, kSwapTwo, &x);
-	fwrite(&x, sizeof(x), 1, mFile);
-}
-
-void	FileWriter::WriteInt(int x)
-{
-	EndianSwapBuffer(platform_Native, mPlatform, kSwapFour, &x);
-	fwrite(&x, sizeof(x), 1, mFile);
-}
-
-void	FileWriter::WriteFloat(float x)
+void	FileWriter::Flush(void)
 {
-	EndianSwapBuffer(platform_Native, mPlatform, kSwapFour, &x);
-	fwrite(&x, sizeof(x), 1, mFile);
+	if (mWritePos > mBuffer)
+		fwrite(mBuffer, mWritePos - mBuffer, 1, mFile);
+	mWritePos = mBuffer;
 }
 
-void	FileWriter::WriteDouble(double x)
+void	FileWriter::WriteMore(const char * inBuf, int inLength)
 {
-	EndianSwapBuffer(platform_Native, mPlatform, kSwapEight, &x);
-	fwrite(&x, sizeof(x), 1, mFile);
-}
-
-void	FileWriter::WriteBulk(const char * inBuf, int inLength, bool inZip)
-{
-	fwrite(inBuf, inLength, 1, mFile);
+	Flush();
+	if (inLength >= (int) sizeof(mBuffer))
+		fwrite(inBuf, inLength, 1, mFile);
+	else
+	{
+		memcpy(mWritePos, inBuf, inLength);
+		mWritePos += inLength;
+	}
 }
 
 ZipFileWriter::ZipFileWriter(const char * inFileName, const char * inEntryName, PlatformType platform)
 {
 	mFile = zipOpen(inFileName, 0);
-	mPlatform = platform;
+	mWriteSwap = IO_NeedsSwap(platform);
+	mWritePos = mBuffer;
+	mWriteEnd = mBuffer + sizeof(mBuffer);
 	if (mFile)
 	{
 		zipOpenNewFileInZip(mFile, inEntryName, NULL, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_DEFAULT_COMPRESSION);
@@ -201,39 +139,27 @@ ZipFileWriter::~ZipFileWriter()
 {
 	if (mFile)
 	{
+		Flush();
 		zipCloseFileInZip(mFile);
 		zipClose(mFile, NULL);
 	}
 }
 
-
-void	ZipFileWriter::WriteShort(short x)
-{
-	EndianSwapBuffer(platform_Native, mPlatform, kSwapTwo, &x);
-	zipWriteInFileInZip(mFile, &x, sizeof(x));
-}
-
-void	ZipFileWriter::WriteInt(int x)
+void	ZipFileWriter::Flush(void)
 {
-	EndianSwapBuffer(platform_Native, mPlatform, kSwapFour, &x);
-	zipWriteInFileInZip(mFile, &x, sizeof(x));
+	if (mWritePos > mBuffer)
+		zipWriteInFileInZip(mFile, mBuffer, mWritePos - mBuffer);
+	mWritePos = mBuffer;
 }
 
-void	ZipFileWriter::WriteFloat(float x)
+void	ZipFileWriter::WriteMore(const char * inBuf, int inLength)
 {
-	EndianSwapBuffer(platform_Native, mPlatform, kSwapFour, &x);
-	zipWriteInFileInZip(mFile, &x, sizeof(x));
-}
-
-void	ZipFileWriter::WriteDouble(double x)
-{
-	EndianSwapBuffer(platform_Native, mPlatform, kSwapEight, &x);
-	zipWriteInFileInZip(mFile, &x, sizeof(x));
-}
-
-void	ZipFileWriter::WriteBulk(const char * inBuf, int inLength, bool inZip)
-{
-	zipWriteInFileInZip(mFile, (void * const) inBuf, inLength);
+	Flush();
+	if (inLength >= (int) sizeof(mBuffer))
+		zipWriteInFileInZip(mFile, (void * const) inBuf, inLength);
+	else
+	{
+		memcpy(mWritePos, inBuf, inLength);
+		mWritePos += inLength;
+	}
 }
-
-
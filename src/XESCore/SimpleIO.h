@@ -32,6 +32,15 @@ const char	kSwapTwo[] = { 2, 0 };
 const char	kSwapFour[] = { 4, 0 };
 const char	kSwapEight[] =  { 8, 0 };
 
+// True if a stream in this byte order has to be swapped to or from ours.
+inline bool	IO_NeedsSwap(PlatformType platform)
+{
+	return platform != platform_Native && platform != GetNativePlatformType();
+}
+
+// File writers collect this much before each fwrite.  The writer is flushed when it is destroyed, so anyone who
+// also writes the FILE directly (atom headers) must let the writer go out of scope first.
+#define FILE_WRITER_BUFFER_SIZE 65536
 
 class	FileReader : public IOReader {
 public:
@@ -40,17 +49,14 @@ public:
 					FileReader(FILE * inFile, PlatformType platform = platform_LittleEndian);
 	virtual			~FileReader();
 
-	virtual	void	ReadShort(short&);
-	virtual	void	ReadInt(int&);
-	virtual	void	ReadFloat(float&);
-	virtual	void	ReadDouble(double&);
-	virtual	void	ReadBulk(char * inBuf, int inLength, bool inZip);
+protected:
+
+	virtual	void	ReadMore(char * inBuf, int inLength);
 
 private:
 
 	FILE *			mFile;
 	bool			mClose;
-	PlatformType	mPlatform;
 
 };
 
@@ -60,17 +66,9 @@ public:
 					MemFileReader(const char * inStart, const char * inEnd, PlatformType platform = platform_LittleEndian);
 	virtual			~MemFileReader();
 
-	virtual	void	ReadShort(short&);
-	virtual	void	ReadInt(int&);
-	virtual	void	ReadFloat(float&);
-	virtual	void	ReadDouble(double&);
-	virtual	void	ReadBulk(char * inBuf, int inLength, bool inZip);
-
-private:
+protected:
 
-	const char *	mPtr;
-	const char *	mEnd;
-	PlatformType	mPlatform;
+	virtual	void	ReadMore(char * inBuf, int inLength);
 
 };
 
@@ -80,18 +78,17 @@ public:
 					FileWriter(FILE * inFile, PlatformType platform = platform_LittleEndian);
 	virtual			~FileWriter();
 
+protected:
 
-	virtual	void	WriteShort(short);
-	virtual	void	WriteInt(int);
-	virtual	void	WriteFloat(float);
-	virtual	void	WriteDouble(double);
-	virtual	void	WriteBulk(const char * inBuf, int inLength, bool inZip);
+	virtual	void	WriteMore(const char * inBuf, int inLength);
 
 private:
 
+			void	Flush(void);
+
 	FILE *			mFile;
 	bool			mClose;
-	PlatformType	mPlatform;
+	char			mBuffer[FILE_WRITER_BUFFER_SIZE];
 
 };
 
@@ -100,17 +97,16 @@ public:
 					ZipFileWriter(const char * inFileName, const char * inEntryName, PlatformType platform = platform_LittleEndian);
 	virtual			~ZipFileWriter();
 
+protected:
 
-	virtual	void	WriteShort(short);
-	virtual	void	WriteInt(int);
-	virtual	void	WriteFloat(float);
-	virtual	void	WriteDouble(double);
-	virtual	void	WriteBulk(const char * inBuf, int inLength, bool inZip);
+	virtual	void	WriteMore(const char * inBuf, int inLength);
 
 private:
 
+			void	Flush(void);
+
 	zipFile			mFile;
-	PlatformType	mPlatform;
+	char			mBuffer[FILE_WRITER_BUFFER_SIZE];
 
 };
 
@@ -34,6 +34,7 @@
 #include "ParamDefs.h"
 #include "GISTool_Globals.h"
 #include "PerfUtils.h"
+#include "TraceUtils.h"
 #include "MapCreate.h"
 
 #include "XUtils.h"
@@ -45,7 +46,7 @@
 #if PROFILE_PERFORMANCE
 #define TIMER(x)	StElapsedTime	__PerfTimer##x(#x);
 #else
-#define TIMER(x)
+#define TIMER(x)	TRACE_Zone	__TraceZone##x(#x);
 #endif
 
 // SEt this to 1 to see the road restriction DEM - can explain why no roads showed up in a location.
@@ -44,6 +44,8 @@
 #include "BlockFill.h"
 #include "BlockAlgs.h"
 #include "MathUtils.h"
+#include "ThreadUtils.h"
+#include "TraceUtils.h"
 
 // NOTE: all that this does is propegate parks, forestparks, cemetaries and golf courses to the feature type if
 // it isn't assigned.
@@ -587,15 +589,177 @@ void kill_antennas(Pmwx& io_map, Pmwx::Face_handle f, float max_len)
 	} while (++circ != stop);
 }
 
+/************************************************************************************************************************
+ * PER-FACE RASTER STATISTICS
+ ************************************************************************************************************************
+
+	Most of the time in zoning goes into two raster scans per face - the land use histogram and the max slope.  Those
+	only read the DEMs and the face's outline, so ZoneManMadeAreas runs them for every face up front on a
+	THREAD_ParallelFor, then calls ZoneOneFace one face at a time, in map order, with the results.  ZoneOneFace still
+	has to be serial - it edits the map (kill_antennas) and looks at its neighbors.
+
+	The output does not depend on the thread count: each face writes only its own slot, and the scans give the same
+	answer before and after kill_antennas because antenna edges are never rasterized.
+
+	The workers must not touch CGAL numbers: the lazy exact number type caches its exact value the first time it is
+	asked and its handles are ref-counted without a lock.  So the outline is copied out to doubles on the main thread
+	and the workers see only zone_face_raster_t.  Each work item makes its own rasterizer.
+*/
+
+struct	zone_face_raster_t {
+	vector<double>		edges;			// x1,y1,x2,y2 lon/lat per edge, antennas skipped - what SetupRasterizerForDEM would use
+	Point2				any;			// a point on the outer CCB, for faces too small to cover a pixel center
+
+	float				count;
+	float				total_urban;
+	float				total_forest;
+	float				total_park;
+	map<int, int>		histo;			// land class category -> pixels
+	float				max_slope;
+};
+
+struct	zone_raster_job_t {
+	const DEMGeo *					landuse;
+	const DEMGeo *					forest;
+	const DEMGeo *					park;
+	const DEMGeo *					urban_density;
+	const DEMGeoSummary *			slope;
+	vector<zone_face_raster_t> *	faces;
+};
+
+static void	copy_face_edges(Pmwx::Face_handle f, zone_face_raster_t& io_raster)
+{
+	set<Halfedge_handle>	all;
+	FindEdgesForFace<Pmwx>(f, all);
+	for (set<Halfedge_handle>::iterator e = all.begin(); e != all.end(); ++e)
+	if ((*e)->face() != (*e)->twin()->face())
+	{
+		io_raster.edges.push_back(CGAL::to_double((*e)->source()->point().x()));
+		io_raster.edges.push_back(CGAL::to_double((*e)->source()->point().y()));
+		io_raster.edges.push_back(CGAL::to_double((*e)->target()->point().x()));
+		io_raster.edges.push_back(CGAL::to_double((*e)->target()->point().y()));
+	}
+	io_raster.any = cgal2ben(f->outer_ccb()->source()->point());
+}
+
+static int	setup_rasterizer_for_edges(const vector<double>& edges, const DEMGeo& dem, PolyRasterizer<double>& rasterizer)
+{
+	for (int n = 0; n < edges.size(); n += 4)
+		rasterizer.AddEdge(dem.lon_to_x(edges[n  ]), dem.lat_to_y(edges[n+1]),
+						   dem.lon_to_x(edges[n+2]), dem.lat_to_y(edges[n+3]));
+
+	rasterizer.SortMasters();
+
+	if (rasterizer.masters.empty())
+		 return 0;
+	return floor(rasterizer.masters.front().y1);
+}
+
+// e is land use, f forest, p park, d urban density.  find, not [] - this runs on worker threads.
+static void	accum_land_class(zone_face_raster_t& io_raster, float e, float f, float p, float d)
+{
+	io_raster.count++;
+	io_raster.total_urban += d;
+
+	LandClassInfoTable::const_iterator lc = gLandClassInfo.find(e);
+	if(lc != gLandClassInfo.end())
+	{
+		io_raster.histo[lc->second.category]++;
+		io_raster.total_forest += lc->second.veg_density;
+
+		// THIS IS INTENTIONAL!  We are ONLY accepting park raster points that CONVERT
+		// urban to park.  The reason: a giant state forest is tagged "forest park" in OSM
+		// but does NOT get special zoning treatment.
+		if(p != NO_VALUE)
+			io_raster.total_park += 1.0;
+	}
+	else
+	{
+		io_raster.histo[terrain_Natural]++;
+		if(f != NO_VALUE)
+			io_raster.total_forest += 1.0;
+	}
+}
+
+static void	zone_face_raster(int item, int worker, void * ref)
+{
+	TRACE_ZONE("zone_face_raster")
+	TRACE_COUNT("zoning faces rasterized", 1)
+	zone_raster_job_t * job = (zone_raster_job_t *) ref;
+	zone_face_raster_t& me((*job->faces)[item]);
+	const DEMGeo& inLanduse(*job->landuse);
+	const DEMGeo& inForest(*job->forest);
+	const DEMGeo& inPark(*job->park);
+	const DEMGeo& urban_density_from_lu(*job->urban_density);
+	const DEMGeo& inSlope(job->slope->dem());
+
+	me.count = me.total_urban = me.total_forest = me.total_park = 0;
+	me.max_slope = 0.0;
+
+	PolyRasterizer<double>	r;
+	int x, y, x1, x2;
+	y = setup_rasterizer_for_edges(me.edges, inLanduse, r);
+	r.StartScanline(y);
+
+	while (!r.DoneScan())
+	{
+		while (r.GetRange(x1, x2))
+		{
+			for (x = x1; x < x2; ++x)
+			{
+//				float p = inPark.get(x,y);
+				accum_land_class(me,
+					inLanduse.get(x,y),
+					inForest.get(x,y),
+					inPark.get(
+						inPark.map_x_from(inLanduse, x),
+						inPark.map_y_from(inLanduse,y)),
+					urban_density_from_lu.get(x,y));
+			}
+		}
+		++y;
+		if (y >= inLanduse.mHeight) break;
+		r.AdvanceScanline(y);
+	}
+
+	if(me.count == 0)
+	{
+		accum_land_class(me,
+			inLanduse.xy_nearest(me.any.x(),me.any.y()),
+			inForest.xy_nearest(me.any.x(),me.any.y()),
+			inPark.xy_nearest(me.any.x(),me.any.y()),
+			urban_density_from_lu.value_linear(me.any.x(), me.any.y()));
+	}
+
+	PolyRasterizer<double>  r2;
+	y = setup_rasterizer_for_edges(me.edges, inSlope, r2);
+	r2.StartScanline(y);
+	int scount = 0;
+	while (!r2.DoneScan())
+	{
+		while (r2.GetRange(x1, x2))
+		if (x1 < x2)
+		{
+			float lo = DEM_NO_DATA, hi = DEM_NO_DATA;
+			job->slope->run_min_max(x1, x2, y, lo, hi);
+			if (hi != DEM_NO_DATA)
+				me.max_slope = max(me.max_slope, hi);
+			scount += x2 - x1;
+		}
+		++y;
+		if (y >= inLanduse.mHeight) break;
+		r2.AdvanceScanline(y);
+	}
+
+	if(scount == 0)
+		me.max_slope = inSlope.xy_nearest(me.any.x(),me.any.y());
+}
+
 static void ZoneOneFace(
 				Pmwx& 				ioMap,
 				const DEMGeo&		inElev,
-				const DEMGeo& 		inLanduse,
-				const DEMGeo&		inForest,
-				const DEMGeo&		inPark,
-				const DEMGeo& 		inSlope,
 				const AptVector&	inApts,
-				const DEMGeo&		urban_density_from_lu,
+				const zone_face_raster_t& inRaster,
 				Pmwx::Face_handle	face)
 {
 	//--------------------------------------------------------------------------------------------------------------------------------
@@ -630,83 +794,12 @@ static void ZoneOneFace(
 	int has_non_local = 0;
 	Bbox2 face_extent;
 
-	PolyRasterizer<double>	r;
-	int x, y, x1, x2;
-	y = SetupRasterizerForDEM(face, inLanduse, r);
-	r.StartScanline(y);
-	float count = 0, total_forest = 0, total_urban = 0, total_park = 0;
-	map<int, int>		histo;
-
-	while (!r.DoneScan())
-	{
-		while (r.GetRange(x1, x2))
-		{
-			for (x = x1; x < x2; ++x)
-			{
-				float e = inLanduse.get(x,y);
-				float f = inForest.get(x,y);
-//				float p = inPark.get(x,y);
-				float p = inPark.get(
-					inPark.map_x_from(inLanduse, x),
-					inPark.map_y_from(inLanduse,y));
-				float d = urban_density_from_lu.get(x,y);
-				count++;
-
-				total_urban += d;
-
-				if(gLandClassInfo.count(e))
-				{
-					LandClassInfo_t& i(gLandClassInfo[e]);
-					histo[i.category]++;
-					total_forest += i.veg_density;
-
-					// THIS IS INTENTIONAL!  We are ONLY accepting park raster points that CONVERT
-					// urban to park.  The reason: a giant state forest is tagged "forest park" in OSM
-					// but does NOT get special zoning treatment.
-					if(p != NO_VALUE)
-						total_park += 1.0;
-				}
-				else
-				{
-					histo[terrain_Natural]++;
-					if(f != NO_VALUE)
-						total_forest += 1.0;
-				}
-
-			}
-		}
-		++y;
-		if (y >= inLanduse.mHeight) break;
-		r.AdvanceScanline(y);
-	}
-
-	if(count == 0)
-	{
-		Point2 any = cgal2ben(face->outer_ccb()->source()->point());
-		float e = inLanduse.xy_nearest(any.x(),any.y());
-		float f = inForest.xy_nearest(any.x(),any.y());
-		float p = inPark.xy_nearest(any.x(),any.y());
-		float d = urban_density_from_lu.value_linear(any.x(), any.y());
-
-		count++;
-
-		total_urban += d;
-		if(gLandClassInfo.count(e))
-		{
-			LandClassInfo_t& i(gLandClassInfo[e]);
-			histo[i.category]++;
-			total_forest += i.veg_density;
-			if(p != NO_VALUE)
-				total_park += 1.0;
-		}
-		else
-		{
-			histo[terrain_Natural]++;
-			if(f != NO_VALUE)
-				total_forest += 1.0;
-		}
-
-	}
+	float			count = inRaster.count;
+	float			total_urban = inRaster.total_urban;
+	float			total_forest = inRaster.total_forest;
+	float			total_park = inRaster.total_park;
+	float			max_slope = inRaster.max_slope;
+	const map<int, int>& histo(inRaster.histo);
 
 	if(count)
 	if((total_urban / count) > 0.5)
@@ -714,7 +807,7 @@ static void ZoneOneFace(
 		kill_antennas(ioMap,face,  ((total_urban / count) > 0.75) ? 35.0 : 20.0);
 
 	multimap<int, int, greater<int> > histo2;
-	for(map<int,int>::iterator i = histo.begin(); i != histo.end(); ++i)
+	for(map<int,int>::const_iterator i = histo.begin(); i != histo.end(); ++i)
 		histo2.insert(multimap<int,int, greater<int> >::value_type(i->second,i->first));
 
 	multimap<int, int, greater<int> >::iterator i = histo2.begin();
@@ -771,34 +864,6 @@ static void ZoneOneFace(
 	if(has_local && !has_non_local)	has_local = 2;
 
 
-	PolyRasterizer<double>  r2;
-	y = SetupRasterizerForDEM(face, inSlope, r2);
-	r2.StartScanline(y);
-	int scount = 0;
-	float max_slope = 0.0;
-	while (!r2.DoneScan())
-	{
-		while (r2.GetRange(x1, x2))
-		{
-			for (x = x1; x < x2; ++x)
-			{
-				float s = inSlope.get(x,y);
-				max_slope = max(max_slope, s);
-				++scount;
-			}
-		}
-		++y;
-		if (y >= inLanduse.mHeight) break;
-		r2.AdvanceScanline(y);
-	}
-
-	if(scount == 0)
-	{
-		Point2 any = cgal2ben(face->outer_ccb()->source()->point());
-		float s = inSlope.xy_nearest(any.x(),any.y());
-		max_slope = s;
-	}
-
 	//--------------------------------------------------------------------------------------------------------------------------------
 	// DETAILED EXAMINATION: VECTOR ANALYSIS IN METRIC SPACE
 	//--------------------------------------------------------------------------------------------------------------------------------
@@ -1111,28 +1176,40 @@ void	ZoneManMadeAreas(
 
 	GaussianBlurDEM(urban_density_from_lu, 1.0);
 
+	DEMGeoSummary	slope_stats(inSlope);
+
 //	gDem[dem_Wizard] = urban_density_from_lu;
 
 	/*****************************************************************************
 	 * PASS 1 - ZONING ASSIGNMENT VIA LAD USE DATA + FEATURES
 	 *****************************************************************************/
-	for (face = ioMap.faces_begin(); face != ioMap.faces_end(); ++face, ++ctr)
+	vector<Pmwx::Face_handle>	zone_faces;
+	for (face = ioMap.faces_begin(); face != ioMap.faces_end(); ++face)
 	if (!face->is_unbounded())
 	if(!face->data().IsWater())
 	if(inDebug == Pmwx::Face_handle() || face == inDebug)
+		zone_faces.push_back(face);
+
+	vector<zone_face_raster_t>	rasters(zone_faces.size());
+	for (int n = 0; n < zone_faces.size(); ++n)
+		copy_face_edges(zone_faces[n], rasters[n]);
+
+	slope_stats.build();
+	TRACE_ZONE("Zoning rasters")
+	zone_raster_job_t	job = { &inLanduse, &inForest, &inPark, &urban_density_from_lu, &slope_stats, &rasters };
+	THREAD_ParallelFor(rasters.size(), zone_face_raster, &job, gThreads);
+
+	int zone_total = zone_faces.size();
+	int zone_check = max(zone_total / 100, 1);
+	for (int n = 0; n < zone_total; ++n)
 	{
-		PROGRESS_CHECK(inProg, 0, 3, "Zoning terrain...", ctr, total, check)
+		PROGRESS_CHECK(inProg, 0, 3, "Zoning terrain...", n, zone_total, zone_check)
 		ZoneOneFace(
 					ioMap,
 					inElev,
-					inLanduse,
-					inForest,
-					inPark,
-					inSlope,
 					inApts,
-					urban_density_from_lu,
-		
-			face);
+					rasters[n],
+					zone_faces[n]);
 	}
 
 #define HEIGHT_SPREAD_FACTOR 0.5
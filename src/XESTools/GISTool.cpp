@@ -23,6 +23,7 @@
 #include "ParamDefs.h"
 #include "PerfUtils.h"
 #include "ProgressUtils.h"
+#include "TraceUtils.h"
 #include "AssertUtils.h"
 #include "XESInit.h"
 #include "GISTool_Globals.h"
@@ -83,6 +84,21 @@ static int DoTiming(const vector<const char *>& args)		{	gTiming = 1;	return 0;
 static int DoNoTiming(const vector<const char *>& args)		{	gTiming = 0;	return 0;	}
 static int DoProgress(const vector<const char *>& args)		{	gProgress = ConsoleProgressFunc;	return 0;	}
 static int DoNoProgress(const vector<const char *>& args)	{	gProgress = NULL;					return 0;	}
+static int DoThreads(const vector<const char *>& args)		{	gThreads = atoi(args[0]);			return 0;	}
+
+static string	sTraceFile;
+
+static int DoTrace(const vector<const char *>& args)		{	sTraceFile = args[0];	TRACE_Enable(true);	return 0;	}
+
+// Called on the way out, whether the commands worked or not - a trace of a failed run is still worth having.
+static void	WriteTrace(void)
+{
+	if (sTraceFile.empty()) return;
+	TRACE_Enable(false);
+	if (!TRACE_WriteChrome(sTraceFile.c_str()))
+		fprintf(stderr, "Could not write trace file %s.\n", sTraceFile.c_str());
+	TRACE_PrintSummary(stdout);
+}
 
 static	GISTool_RegCmd_t		sUtilCmds[] = {
 { "-help",			0, 1, DoHelp, "Prints help info for a command.", "" },
@@ -92,6 +108,8 @@ static	GISTool_RegCmd_t		sUtilCmds[] = {
 { "-notiming",		0, 0, DoNoTiming, "Disables performance timing.", "" },
 { "-progress",		0, 0, DoProgress, "Shows progress bars", "" },
 { "-noprogress",	0, 0, DoNoProgress, "Disables progress bars", "" },
+{ "-trace",			1, 1, DoTrace, "Records a trace of the rest of the run.", "Writes a Chrome/Perfetto trace (JSON) to the file and prints a per-zone summary at exit." },
+{ "-threads",		1, 1, DoThreads, "Sets worker threads for zoning and landuse.", "0 means one per core, 1 runs single-threaded." },
 { "-selftest",		0, 0, DoSelfTest, "Self test internal algorithms.", "" },
 #if USE_CHUD
 { "-chud_start",	1, 1, DoChudStart, "Start profiling", "" },
@@ -185,6 +203,7 @@ int	main(int argc, char * argv[])
 //		for(int n = 0; n < args.size(); ++n)
 //			printf("%d) '%s'\n", n,args[n]);
 		result = GISTool_ParseCommands(args);
+		WriteTrace();
 
 #if USE_CHUD
 		if (can_profile)	chudReleaseRemoteAccess();
@@ -39,6 +39,10 @@
 #include "MemFileUtils.h"
 #include "GISUtils.h"
 #include "XESInit.h"
+#include "MapCompact.h"
+#if LIN
+#include <malloc.h>
+#endif
 
 #if OPENGL_MAP
 #include "RF_Notify.h"
@@ -451,6 +455,27 @@ static int DoTagOrigin(const vector<const char *>& args)
 	return 0;
 }
 
+static int DoCompact(const vector<const char *>& args)
+{
+	compact_stats_t	map_stats, mesh_stats;
+	unsigned long long	mem_before = query_resident_bytes();
+	{
+		StElapsedTime	timer("Compact numbers");
+		CompactMapNumbers(gMap, &map_stats);
+		CompactMeshNumbers(gTriangulationHi, &mesh_stats);
+	}
+#if LIN
+	// glibc sits on freed blocks; hand them back so the number below means something.
+	malloc_trim(0);
+#endif
+	unsigned long long	mem_after = query_resident_bytes();
+
+	printf("Map:  %d coordinates, %d doubles, %d rationals.\n", map_stats.coords, map_stats.doubles, map_stats.rationals);
+	printf("Mesh: %d coordinates, %d doubles, %d rationals.\n", mesh_stats.coords, mesh_stats.doubles, mesh_stats.rationals);
+	printf("Resident memory: %.1f MB before, %.1f MB after.\n", (double) mem_before / (1024.0 * 1024.0), (double) mem_after / (1024.0 * 1024.0));
+	return 0;
+}
+
 static int DoSimplify(const vector<const char *>& args)
 {
 	if (gVerbose)
@@ -3004,6 +3029,7 @@ static	GISTool_RegCmd_t		sCoreCmds[] = {
 { "-cropsave", 		1, 1, DoCropSave, 		"Save only extent as an XES file.", "" },
 { "-overlay", 		1, 1, DoOverlay, 		"Superimpose/replace a second vector map.", "" },
 { "-merge", 		1, 1, DoMerge,			"Superimpose/merge a second vector map.", "" },
+{ "-compact",		0, 0, DoCompact,		"Collapse map and mesh coordinates to plain doubles where exact, and report memory.", "" },
 { "-simplify",		0, 0, DoSimplify,		"Remove unneeded vectors.", "" },
 { "-tag_origin",	1, 1, DoTagOrigin,		"Apply origin code X to this map.", "" },
 
@@ -50,6 +50,7 @@ vector<pair<Point2,Point3> >		gMeshLines;
 vector<pair<Bezier2,pair<Point3, Point3> > >		gMeshBeziers;
 bool				gVerbose = true;
 bool				gTiming = false;
+int					gThreads = 0;
 ProgressFunc		gProgress = ConsoleProgressFunc;
 
 int					gMapWest  = -180;
@@ -50,6 +50,7 @@ extern CDT					gTriangulationHi;
 
 extern bool					gVerbose;
 extern bool					gTiming;
+extern int					gThreads;		// Worker threads for the parallel passes; 0 = one per core, 1 = run inline.
 extern ProgressFunc			gProgress;
 
 extern	int					gMapWest;
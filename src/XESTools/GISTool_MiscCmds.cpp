@@ -110,6 +110,12 @@ static int	DoCheckSpreadsheet(const vector<const char *>& args)
 }
 */
 
+static int DoCheckTerrainIndex(const vector<const char *>& args)
+{
+	gNaturalTerrainCheckIndex = true;
+	return 0;
+}
+
 static int DoCheckWaterConform(const vector<const char *>& args)
 {
 	// XES source, SHP source, output
@@ -632,6 +638,7 @@ static	GISTool_RegCmd_t		sMiscCmds[] = {
 { "-wetinit", 0, 0, InitFromWet,						"init to all water.", ""},
 { "-obj2config", 	2, -1, 	DoObjToConfig, 			"Make obj spreadsheet from a real OBJ.", "" },
 //{ "-checkdem",		0, 0,  DoCheckSpreadsheet,		"Check spreadsheet coverage.", "" },
+{ "-check_terrain_index", 0, 0, DoCheckTerrainIndex,	"Cross-check terrain rule lookups against a linear scan.", "Every FindNaturalTerrain call also scans the rule table the slow way and reports any rule the index picked differently.  Slow!\n" },
 { "-checkwaterconform", 3, 3, DoCheckWaterConform, 	"Check water matchup", "" },
 { "-compare_water",	2,3,DoPreCheckWaterConform,		"Check LU vs. vector water", "" },
 { "-forest_types",	0,	1, DoDumpForests,			"Output types of forests from the spreadsaheet.", dump_forests_HELP },
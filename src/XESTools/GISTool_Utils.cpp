@@ -24,6 +24,7 @@
 #include "GISTool_Utils.h"
 #include <map>
 #include "PerfUtils.h"
+#include "TraceUtils.h"
 #include "GISTool_Globals.h"
 
 struct	GISTool_CmdInfo_t {
@@ -163,9 +164,8 @@ int	GISTool_ParseCommands(const vector<const char *>& args)
 				else
 				{
 					try {
-						StElapsedTime * timer = (gTiming ? new StElapsedTime(cname) : NULL);
+						StElapsedTime	timer(cname, gTiming);
 						int result = cmd(cmdargs);
-						delete timer;
 						if (result != 0) return result;
 					} catch(const char * msg) {
 						printf("Caught: %s\n", msg);
@@ -24,6 +24,8 @@
 #if DEV
 void TEST_CompGeomDefs2(void);
 void TEST_MapDefs(void);
+void TEST_CompGeomUtils(void);
+void TEST_MeshAlgs(void);
 #endif
 
 void SelfTestAll(void)
@@ -31,6 +33,8 @@ void SelfTestAll(void)
 #if DEV
 //	TEST_CompGeomDefs2();
 //	TEST_MapDefs();
+	TEST_CompGeomUtils();
+	TEST_MeshAlgs();
 	printf("Self-tests completed.\n");
 #endif
 }
\ No newline at end of file
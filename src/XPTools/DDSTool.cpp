@@ -25,7 +25,9 @@
 #include "BitmapUtils.h"
 #include "QuiltUtils.h"
 #include "FileUtils.h"
+#include "PlatformUtils.h"
 #include "MathUtils.h"
+#include "ThreadUtils.h"
 
 #if PHONE
 	#define WANT_PVR 1
@@ -321,52 +323,6 @@ static bool HandleScale(ImageInfo& info, bool up, bool down, bool half, bool squ
 }
 
 
-inline float to_srgb(float p)
-{
-	if(p <= 0.0031308f)
-		return 12.92f * p;
-	return 1.055f * pow(p,0.41666f) - 0.055f;
-}
-
-inline float from_srgb(float p)
-{
-	if(p <= 0.04045f)
-		return p / 12.92f;
-	else
-		return powf(p * (1.0/1.055f) + (0.055f/1.055f),2.4f);
-}
-
-unsigned char srgb_filter(unsigned char src[], int count, int channel, int level)
-{
-	if(channel == 3)	// alpha is not corrected
-	{
-		int total = 0;
-		for(int i = 0; i < count; ++i)
-			total += (int) src[i];
-		return min(255,total / count);
-	}
-	
-	float total = 0.f;
-	for(int i = 0; i < count; ++i)
-	{
-		float p = src[i];
-		p /= 255.0f;
-		p = from_srgb(p);
-		total += p;
-	}
-	
-	total /= ((float) count);
-	
-	total = to_srgb(total);
-	
-	total *= 255.0f;
-	
-	if(total <= 0.0f) return 0;
-	if (total >= 255.0f) return 255;
-
-	return round(total);   // msvc2010 has no roundf
-}
-
 unsigned char night_filter(unsigned char src[], int count, int channel, int level)
 {
 	int total = 0;
@@ -406,6 +362,171 @@ unsigned char fade_2_black_filter(unsigned char src[], int count, int channel, i
 }
 
 
+//------------------------------------------------------------------------------------------------------------------------------------
+// PNG -> DXT
+//------------------------------------------------------------------------------------------------------------------------------------
+
+struct	dxt_options_t {
+	int		dxt_type;		// 1, 3, 5 or 0 to pick by alpha
+	int		has_mips;		// 0 = std, 1 = pre-made, 2 = night, 3 = fade, 4 = ctl
+	float	gamma;
+	bool	scale_up;
+	bool	scale_down;
+	bool	scale_half;
+	int		max_workers;	// For the mip and DXT steps within one image
+};
+
+// argv[1] is the --png2dxt mode, followed by the mip, gamma and scale flags.  Returns the index of the input file.
+static int	parse_dxt_options(char * argv[], dxt_options_t& o)
+{
+	int arg_base = 2;
+	o.has_mips = 0;
+	o.max_workers = 0;
+
+	if(strcmp(argv[arg_base], "--std_mips") == 0)
+	{
+		o.has_mips = 0;
+		++arg_base;
+	}
+	else if(strcmp(argv[arg_base], "--pre_mips") == 0)
+	{
+		o.has_mips = 1;
+		++arg_base;
+	}
+	else if(strcmp(argv[arg_base], "--night_mips") == 0)
+	{
+		o.has_mips = 2;
+		++arg_base;
+	}
+	else if(strcmp(argv[arg_base], "--fade_mips") == 0)
+	{
+		o.has_mips = 3;
+		++arg_base;
+	}
+	else if(strcmp(argv[arg_base], "--ctl_mips") == 0)
+	{
+		o.has_mips = 4;
+		++arg_base;
+	}
+
+	o.gamma = (strcmp(argv[arg_base], "--gamma_22") == 0) ? 2.2f : 1.8f;
+	arg_base +=1;
+
+	o.scale_up = strcmp(argv[arg_base], "--scale_up") == 0;
+	o.scale_down = strcmp(argv[arg_base], "--scale_down") == 0;
+	o.scale_half = strcmp(argv[arg_base], "--scale_half") == 0;
+	arg_base +=1;
+
+	o.dxt_type = argv[1][9] ? argv[1][9]-'0' : 0;
+	return arg_base;
+}
+
+// Returns 0 on success, 1 on failure (after saying why).  out_path may be "-" to write next to the input.
+static int	convert_png_to_dxt(const dxt_options_t& o, const char * in_path, const char * out_path)
+{
+	ImageInfo	info;
+	if (CreateBitmapFromPNG(in_path, &info, false, o.gamma)!=0)
+	{
+		printf("Unable to open png file %s\n", in_path);
+		return 1;
+	}
+
+	if (!HandleScale(info, o.scale_up, o.scale_down, o.scale_half, false))
+	{
+		// Image does NOT meet our power of 2 needs.
+		if(!o.scale_up && !o.scale_down && !o.scale_half)
+		{
+			printf("The imager is not a power of 2.  It is: %ld by %ld\n", info.width, info.height);
+			DestroyBitmap(&info);
+			return 1;
+		}
+	}
+
+	char buf[1024];
+	const char * outf = out_path;
+	if(strcmp(outf,"-")==0)
+	{
+		strcpy(buf,in_path);
+		buf[strlen(buf)-4]=0;
+		strcat(buf,".dds");
+		outf=buf;
+	}
+
+	if(info.channels == 1)
+	{
+		printf("Unable to write DDS file from alpha-only PNG %s\n", out_path);
+	}
+	int dxt_type = o.dxt_type;
+	if(dxt_type == 0)
+	{
+		if(info.channels == 3)  dxt_type=1;
+		else					dxt_type=5;
+	}
+
+	ConvertBitmapToAlpha(&info,false);
+	switch(o.has_mips) {
+	case 0:			MakeMipmapStackSRGB(&info, o.max_workers);		break;
+	case 1:			MakeMipmapStackFromImage(&info);				break;
+	case 2:			MakeMipmapStackWithFilter(&info,night_filter);	break;
+	case 3:			MakeMipmapStackWithFilter(&info,fade_filter);	break;
+	case 4:			MakeMipmapStackWithFilter(&info,fade_2_black_filter);	break;
+	}
+
+	int result = 0;
+	if (WriteBitmapToDDSEx(info, dxt_type, outf, o.gamma == GAMMA_SRGB, dxt_quality_best, 0, o.max_workers)!=0)
+	{
+		printf("Unable to write DDS file %s\n", out_path);
+		result = 1;
+	}
+	DestroyBitmap(&info);
+	return result;
+}
+
+/*
+	Batch mode: convert every PNG in a directory, one image per worker.  With one image per core, each image's own
+	mip and DXT work stays on its thread; that beats splitting each image across all cores because decode and file
+	I/O run in parallel too.
+*/
+
+struct	dxt_batch_t {
+	dxt_options_t		opts;
+	vector<string>		files;
+	vector<int>			results;
+};
+
+static void	dxt_batch_one(int item, int worker, void * ref)
+{
+	dxt_batch_t * b = (dxt_batch_t *) ref;
+	b->results[item] = convert_png_to_dxt(b->opts, b->files[item].c_str(), "-");
+}
+
+static int	convert_dir_to_dxt(const dxt_options_t& o, const string& dir, int workers)
+{
+	vector<string>	names;
+	if(FILE_get_directory(dir, &names, NULL) < 0)
+	{
+		printf("Unable to read directory %s\n", dir.c_str());
+		return 1;
+	}
+
+	dxt_batch_t	b;
+	b.opts = o;
+	b.opts.max_workers = 1;
+	for(vector<string>::iterator n = names.begin(); n != names.end(); ++n)
+	if(n->size() > 4 && strcasecmp(n->c_str() + n->size() - 4, ".png") == 0)
+		b.files.push_back(dir + DIR_STR + *n);
+	sort(b.files.begin(), b.files.end());
+	b.results.resize(b.files.size(), 0);
+
+	THREAD_ParallelFor(b.files.size(), dxt_batch_one, &b, workers);
+
+	int failed = 0;
+	for(int i = 0; i < b.results.size(); ++i)
+		failed += b.results[i];
+	printf("Converted %d of %d PNG files.\n", (int) b.files.size() - failed, (int) b.files.size());
+	return failed ? 1 : 0;
+}
+
 int main(int argc, char * argv[])
 {
 	char	my_dir[2048];
@@ -478,6 +599,7 @@ int main(int argc, char * argv[])
 	if (argc < 4) {
 		printf("Usage: %s <convert mode> <options> <input_file> <output_file>|-\n",argv[0]);
 		printf("Usage: %s --quilt <input_file> <width> <height> <patch size> <overlap> <trials> <output_files>n",argv[0]);
+		printf("Usage: %s --batch <workers> --png2dxt[1|3|5] <mip mode> <gamma> <scale> <directory>\n",argv[0]);
 		printf("       %s --version\n",argv[0]);
 		exit(1);
 	}
@@ -664,98 +786,22 @@ int main(int argc, char * argv[])
 	   strcmp(argv[1],"--png2dxt3")==0 ||
 	   strcmp(argv[1],"--png2dxt5")==0)
 	{
-		int arg_base = 2;
-		int has_mips = 0;
-
-		if(strcmp(argv[arg_base], "--std_mips") == 0)
-		{
-			has_mips = 0;
-			++arg_base;
-		}
-		else if(strcmp(argv[arg_base], "--pre_mips") == 0)
-		{
-			has_mips = 1;
-			++arg_base;
-		}
-		else if(strcmp(argv[arg_base], "--night_mips") == 0)
-		{
-			has_mips = 2;
-			++arg_base;
-		}
-		else if(strcmp(argv[arg_base], "--fade_mips") == 0)
-		{
-			has_mips = 3;
-			++arg_base;
-		}
-		else if(strcmp(argv[arg_base], "--ctl_mips") == 0)
-		{
-			has_mips = 4;
-			++arg_base;
-		}
-
-		float gamma = (strcmp(argv[arg_base], "--gamma_22") == 0) ? 2.2f : 1.8f;
-		arg_base +=1;
-
-
-		bool scale_up = strcmp(argv[arg_base], "--scale_up") == 0;
-		bool scale_down = strcmp(argv[arg_base], "--scale_down") == 0;
-		bool scale_half = strcmp(argv[arg_base], "--scale_half") == 0;
-		arg_base +=1;
-
-		ImageInfo	info;
-		if (CreateBitmapFromPNG(argv[arg_base], &info, false, gamma)!=0)
-		{
-			printf("Unable to open png file %s\n", argv[arg_base]);
-			return 1;
-		}
-
-		if (!HandleScale(info, scale_up, scale_down, scale_half, false))
-		{
-			// Image does NOT meet our power of 2 needs.
-			if(!scale_up && !scale_down && !scale_half)
-			{
-				printf("The imager is not a power of 2.  It is: %ld by %ld\n", info.width, info.height);
-				return 1;
-			}
-		}
-
-		char buf[1024];
-		const char * outf = argv[arg_base+1];
-		if(strcmp(outf,"-")==0)
-		{
-			strcpy(buf,argv[arg_base]);
-			buf[strlen(buf)-4]=0;
-			strcat(buf,".dds");
-			outf=buf;
-		}
-
-		if(info.channels == 1)
-		{
-			printf("Unable to write DDS file from alpha-only PNG %s\n", argv[arg_base+1]);
-		}
-		int dxt_type = argv[1][9]-'0';
-		if(argv[1][9]==0)
-		{
-			if(info.channels == 3)  dxt_type=1;
-			else					dxt_type=5;
-		}
-
-		ConvertBitmapToAlpha(&info,false);
-		switch(has_mips) {
-//		case 0:			MakeMipmapStack(&info);							break;
-		case 0:			MakeMipmapStackWithFilter(&info,srgb_filter);	break;
-		case 1:			MakeMipmapStackFromImage(&info);				break;
-		case 2:			MakeMipmapStackWithFilter(&info,night_filter);	break;
-		case 3:			MakeMipmapStackWithFilter(&info,fade_filter);	break;
-		case 4:			MakeMipmapStackWithFilter(&info,fade_2_black_filter);	break;
-		}
-
-		if (WriteBitmapToDDS(info, dxt_type, outf, gamma == GAMMA_SRGB)!=0)
+		dxt_options_t opts;
+		int arg_base = parse_dxt_options(argv, opts);
+		return convert_png_to_dxt(opts, argv[arg_base], argv[arg_base+1]);
+	}
+	else if(strcmp(argv[1],"--batch")==0)
+	{
+		// DDSTool --batch <workers> --png2dxt... <mip mode> <gamma> <scale> <dir>
+		int workers = atoi(argv[2]);
+		if(argc < 7 || strncmp(argv[3],"--png2dxt",9) != 0)
 		{
-			printf("Unable to write DDS file %s\n", argv[arg_base+1]);
+			printf("Usage: %s --batch <workers> --png2dxt[1|3|5] <mip mode> <gamma> <scale> <directory>\n",argv[0]);
 			return 1;
 		}
-		return 0;
+		dxt_options_t opts;
+		int arg_base = parse_dxt_options(argv + 2, opts) + 2;
+		return convert_dir_to_dxt(opts, argv[arg_base], workers);
 	}
 	else if(strcmp(argv[1],"--png2rgb")==0)
 	{